@@ -1,103 +1,18 @@
 import Flutter
 import UIKit
 
-#if SIMULATOR
-// Simulator stub for SKBCoreServices that matches the real SDK method names
-public class SKBCoreServices: NSObject {
-    static func shareInstance() -> SKBCoreServices {
-        return SKBCoreServices()
-    }
-    
-    // Delegate property
-    weak var delegate: SocketConnectionDelegate?
-    
-    // Properties from the real SDK
-    var connected: Bool = false
-    var ipAdress: String = "127.0.0.1"
-    var portNumber: UInt = 0
-    var shouldReconnectAutomatically: Bool = false
-    var reconnectTimeInterval: TimeInterval = 5.0
-    var timeoutTimeInterval: TimeInterval = 30.0
-    
-    // Stub of real SDK method for backward compatibility
-    func initEcrTerminal() -> Bool {
-        print("SIMULATOR: initEcrTerminal called (stub method)")
-        return true
-    }
-    
-    // Stub of real SDK method for backward compatibility
-    func performTransaction(_ transaction: [AnyHashable: Any], completion: @escaping ([AnyHashable: Any]) -> Void) {
-        print("SIMULATOR: performTransaction called (stub method)")
-        let response: [String: Any] = [
-            "status": "success",
-            "message": "Simulator mock response",
-            "responseCode": "00",
-            "amount": "1000",
-            "transactionId": "SIM12345",
-            "cardType": "VISA",
-            "maskedPan": "************1234"
-        ]
-        completion(response as [AnyHashable : Any])
-    }
-    
-    // Real SDK methods
-    func connectSocket(_ ipAddress: String, portNumber: UInt) {
-        print("SIMULATOR: connectSocket called with IP: \(ipAddress) and port: \(portNumber)")
-        self.ipAdress = ipAddress
-        self.portNumber = portNumber
-        self.connected = true
-        
-        // Notify delegate
-        delegate?.socketConnectionStreamDidConnect?(self)
-    }
-    
-    func disConnectSocket() {
-        print("SIMULATOR: disConnectSocket called")
-        self.connected = false
-        
-        // Notify delegate
-        delegate?.socketConnectionStreamDidDisconnect?(self, willReconnectAutomatically: shouldReconnectAutomatically)
-    }
-    
-    func doTCPIPTransaction(_ ipAddress: String?, portNumber: UInt, requestData: String, transactionType: Int32, signature: String) {
-        print("SIMULATOR: doTCPIPTransaction called")
-        print("  - IP: \(ipAddress ?? "nil"), Port: \(portNumber)")
-        print("  - Request: \(requestData)")
-        print("  - Transaction Type: \(transactionType)")
-        print("  - Signature: \(signature)")
-        
-        // Create a simulated response
-        let responseData = NSMutableDictionary()
-        responseData["status"] = "success"
-        responseData["message"] = "Transaction processed in simulator"
-        responseData["amount"] = requestData.components(separatedBy: ";").dropFirst().first
-        responseData["transactionId"] = "SIM\(Int.random(in: 10000...99999))"
-        
-        // Wait a bit to simulate network delay
-        DispatchQueue.main.asyncAfter(deadline: .now() + 1.0) { [weak self] in
-            guard let self = self else { return }
-            self.delegate?.socketConnectionStream?(self, didReceiveData: responseData)
-        }
-    }
-}
-
-// Simulator stub for SocketConnectionDelegate that matches the real protocol
-@objc public protocol SocketConnectionDelegate: AnyObject {
-    @objc optional func socketConnectionStream(_ connection: SKBCoreServices, didReceiveData responseData: NSMutableDictionary)
-    @objc optional func socketConnectionStreamDidConnect(_ connection: SKBCoreServices)
-    @objc optional func socketConnectionStreamDidDisconnect(_ connection: SKBCoreServices, willReconnectAutomatically: Bool)
-    @objc optional func socketConnectionStream(_ connection: SKBCoreServices, didSendString string: String)
-    @objc optional func socketConnectionStreamDidFailToConnect(_ connection: SKBCoreServices)
-}
-#else
-// Try both import formats to ensure compatibility
-import SkyBandECRSDK;
-#endif
-
 public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDelegate {
     private var coreServices: SKBCoreServices?
     private var eventSink: FlutterEventSink?
-    private var paymentResult: FlutterResult?
+    // By ecrRefNum, oldest first; a resent reference joining the one in flight gets a reply of its own
+    private var paymentResults: [String: [FlutterResult]] = [:]
+    private var idempotentRetries = false
+    private var adaptiveTimeouts = false
+    private var compactResponses = false
+    private var lastReceipt: Any?
+    private var settlementRun: SKBSettlementRun?
+    // While set, payments without a deadline go out inside its Start/End Session (B6/B7)
+    private var session: SKBSession?
     
     public static func register(with registrar: FlutterPluginRegistrar) {
         let channel = FlutterMethodChannel(name: "skyband_ecr_plugin", binaryMessenger: registrar.messenger())
@@ -113,6 +28,11 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
             result("iOS " + UIDevice.current.systemVersion)
             
         case "initEcr":
+            if let args = call.arguments as? [String: Any] {
+                compactResponses = args["compactResponses"] as? Bool ?? false
+                idempotentRetries = args["idempotentRetries"] as? Bool ?? false
+                adaptiveTimeouts = args["adaptiveTimeouts"] as? Bool ?? false
+            }
             initializeEcr(result: result)
             
         case "performTransaction":
@@ -130,22 +50,42 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
             getDeviceStatus(result: result)
         case "initiatePayment":
             initiatePayment(call: call, result: result)
+        case "getTerminalHealth":
+            getTerminalHealth(result: result)
+        case "getTimeouts":
+            getTimeouts(result: result)
+        case "fetchReceipt":
+            result(lastReceipt)
+            lastReceipt = nil
+        case "exportSettlementTotals":
+            exportSettlementTotals(call: call, result: result)
+        case "startCapture":
+            startCapture(call: call, result: result)
+        case "streamSummaryReport":
+            streamSummaryReport(call: call, result: result)
+        case "settleTerminals":
+            settleTerminals(call: call, result: result)
+        case "startSession":
+            startSession(call: call, result: result)
+        case "endSession":
+            session?.close()
+            result(nil)
+        case "stopCapture":
+            coreServices?.stopCapture()
+            result(nil)
         default:
             result(FlutterMethodNotImplemented)
         }
     }
     
     private func initializeEcr(result: @escaping FlutterResult) {
-        #if SIMULATOR
-        coreServices = SKBCoreServices.shareInstance()
-        coreServices?.delegate = self
-        let initialized = coreServices?.initEcrTerminal() ?? false
-        #else
-        // The actual SDK uses `shareInstance` (not `shared`)
+        session?.invalidate()
+        session = nil
         coreServices = SKBCoreServices.shareInstance()
         coreServices?.delegate = self
+        coreServices?.idempotencyCache = idempotentRetries ? SKBIdempotencyCache.shareInstance() : nil
+        coreServices?.adaptiveTimeouts = adaptiveTimeouts ? SKBAdaptiveTimeouts.shareInstance() : nil
         let initialized = true
-        #endif
         result(initialized)
     }
     
@@ -157,18 +97,7 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
             return
         }
         
-        #if SIMULATOR
-        let transactionParams: [String: Any] = [
-            "amount": amount,
-            "terminalId": terminalId,
-            "transactionType": transactionType
-        ]
-        
-        coreServices?.performTransaction(transactionParams as [AnyHashable : Any]) { response in
-            result(response)
-        }
-        #else
-        // For real device, we use doTCPIPTransaction from the SDK
+        // Sent with doTCPIPTransaction from the SDK
         let dateFormat = "YYYYMMDD"
         let amountDouble = Double(amount) ?? 0.0
         let ecrRefNum = "REF" + String(Int.random(in: 10000...99999))
@@ -176,17 +105,19 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
         let request = "\(dateFormat);\(amountDouble);true;\(ecrRefNum)!"
         let transactionTypeInt = Int(transactionType) ?? 1
         
-        coreServices?.doTCPIPTransaction(
-            coreServices?.ipAdress,
-            portNumber: coreServices?.portNumber ?? 0,
+        guard let services = coreServices else {
+            result(notInitializedError())
+            return
+        }
+        // Stored before sending, so whatever answers the reference finds it
+        waitForPayment(ecrRefNum, result: result)
+        services.doTCPIPTransaction(
+            services.ipAdress,
+            portNumber: services.portNumber,
             requestData: request,
             transactionType: Int32(transactionTypeInt),
             signature: "false"
         )
-        
-        // Store the result callback to be called when the payment is complete
-        self.paymentResult = result
-        #endif
     }
     
     private func connectDevice(call: FlutterMethodCall, result: @escaping FlutterResult) {
@@ -200,33 +131,176 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
         }
         
         let portNumber = UInt(port)
-        #if SIMULATOR
         coreServices?.connectSocket(ipAddress, portNumber: portNumber)
-        #else
-        // The real SDK might have a different method name
-        coreServices?.connectSocket(ipAddress, portNumber: portNumber)
-        #endif
+        if let services = coreServices {
+            let monitor = SKBHealthMonitor.shareInstance()
+            monitor.delegate = self
+            monitor.monitorConnection(services)
+        }
         result(true)
     }
     
     private func disconnectDevice(result: @escaping FlutterResult) {
-        #if SIMULATOR
-        coreServices?.disConnectSocket()
-        #else
+        if let services = coreServices {
+            SKBHealthMonitor.shareInstance().stopMonitoringConnection(services)
+        }
         coreServices?.disConnectSocket()
-        #endif
         result(true)
     }
     
     private func getDeviceStatus(result: @escaping FlutterResult) {
-        #if SIMULATOR
-        let status = coreServices?.connected ?? false
-        #else
         let status = coreServices?.connected ?? false
-        #endif
         result(status)
     }
     
+    private func getTerminalHealth(result: @escaping FlutterResult) {
+        var health: [AnyHashable: Any] = ["readiness": "unknown"]
+        if let services = coreServices,
+           let terminalHealth = SKBHealthMonitor.shareInstance().health(forConnection: services) {
+            health = terminalHealth.dictionaryRepresentation()
+        }
+        result(health)
+    }
+    
+    private func getTimeouts(result: @escaping FlutterResult) {
+        let timeouts = coreServices?.currentTimeouts() ?? [:]
+        result(timeouts)
+    }
+    
+    private func exportSettlementTotals(call: FlutterMethodCall, result: @escaping FlutterResult) {
+        guard let args = call.arguments as? [String: Any],
+              let path = args["path"] as? String,
+              let format = args["format"] as? String else {
+            result(FlutterError(code: "INVALID_ARGUMENTS",
+                              message: "Invalid arguments for exportSettlementTotals",
+                              details: nil))
+            return
+        }
+        guard let services = coreServices else {
+            result(0)
+            return
+        }
+        let exportFormat: SKBSettlementExportFormat = (format == "columnar") ? .columnar : .CSV
+        let rows = services.exportSettlementTotals(toPath: path, format: exportFormat,
+                                                   clear: args["clear"] as? Bool ?? false)
+        guard rows >= 0 else {
+            result(FlutterError(code: "EXPORT_FAILED",
+                              message: "Could not write settlement totals to \(path)",
+                              details: nil))
+            return
+        }
+        result(rows)
+    }
+    
+    private func startCapture(call: FlutterMethodCall, result: @escaping FlutterResult) {
+        guard let args = call.arguments as? [String: Any],
+              let path = args["path"] as? String else {
+            result(FlutterError(code: "INVALID_ARGUMENTS",
+                              message: "Invalid arguments for startCapture",
+                              details: nil))
+            return
+        }
+        result(coreServices?.startCapture(toPath: path) ?? false)
+    }
+    
+    // Rows go out on the event channel page by page; the call completes with the row total
+    private func streamSummaryReport(call: FlutterMethodCall, result: @escaping FlutterResult) {
+        guard let args = call.arguments as? [String: Any],
+              let ecrRefNum = args["ecrRefNum"] as? String else {
+            result(FlutterError(code: "INVALID_ARGUMENTS",
+                              message: "Invalid arguments for streamSummaryReport",
+                              details: nil))
+            return
+        }
+        guard let services = coreServices else {
+            result(0)
+            return
+        }
+        services.streamSummaryReport(ecrRefNum, rows: { [weak self] rows in
+            self?.eventSink?(["reportRows": rows])
+        }, completion: { rowCount, error in
+            if let error = error {
+                result(FlutterError(code: "REPORT_FAILED", message: error, details: rowCount))
+            } else {
+                result(rowCount)
+            }
+        })
+    }
+    
+    // Progress goes out on the event channel; the call completes once every terminal has a result
+    private func settleTerminals(call: FlutterMethodCall, result: @escaping FlutterResult) {
+        guard let args = call.arguments as? [String: Any],
+              let terminals = args["terminals"] as? [String],
+              let ecrRefNum = args["ecrRefNum"] as? String else {
+            result(FlutterError(code: "INVALID_ARGUMENTS",
+                              message: "Invalid arguments for settleTerminals",
+                              details: nil))
+            return
+        }
+        if settlementRun?.running ?? false {
+            result(FlutterError(code: "SETTLEMENT_RUNNING",
+                              message: "A fleet settlement is already running",
+                              details: nil))
+            return
+        }
+        let run = SKBSettlementRun(terminals: terminals, ecrRefNum: ecrRefNum)
+        if let maxConcurrent = args["maxConcurrent"] as? Int {
+            run.maxConcurrentTerminals = UInt(max(maxConcurrent, 1))
+        }
+        if let maxAttempts = args["maxAttempts"] as? Int {
+            run.maxAttempts = UInt(max(maxAttempts, 1))
+        }
+        run.printReceipts = args["printReceipt"] as? Bool ?? false
+        run.terminalIds = args["terminalIds"] as? [String: String]
+        run.delegate = self
+        settlementRun = run
+        run.start { [weak self] results in
+            var response: [String: Any] = [
+                "terminals": results.count,
+                "succeeded": results.filter { $0.succeeded }.count,
+                "failed": run.failedResults.map { $0.dictionaryRepresentation() },
+                "totals": run.aggregateTotals()
+            ]
+            if let path = args["exportPath"] as? String {
+                let format: SKBSettlementExportFormat = (args["format"] as? String == "columnar") ? .columnar : .CSV
+                response["exported"] = run.exportTotals(toPath: path, format: format, aggregate: args["aggregate"] as? Bool ?? false)
+            }
+            run.delegate = nil
+            self?.settlementRun = nil
+            result(response)
+        }
+    }
+    
+    // The session takes over the connection's delegate and forwards every callback here
+    private func startSession(call: FlutterMethodCall, result: @escaping FlutterResult) {
+        guard let args = call.arguments as? [String: Any],
+              let cashRegisterNumber = args["cashRegisterNumber"] as? String else {
+            result(FlutterError(code: "INVALID_ARGUMENTS",
+                              message: "Invalid arguments for startSession",
+                              details: nil))
+            return
+        }
+        guard let services = coreServices else {
+            result(notInitializedError())
+            return
+        }
+        if let current = session {
+            guard !current.isOpen && current.pendingTransactions == 0 else {
+                result(FlutterError(code: "SESSION_ACTIVE",
+                                  message: "End the current session first",
+                                  details: nil))
+                return
+            }
+            current.invalidate()
+        }
+        let newSession = SKBSession(connection: services, cashRegisterNumber: cashRegisterNumber)
+        if let idleTimeout = args["idleTimeoutSeconds"] as? Double {
+            newSession.idleTimeout = idleTimeout
+        }
+        session = newSession
+        result(true)
+    }
+    
     private func initiatePayment(call: FlutterMethodCall, result: @escaping FlutterResult) {
         guard let args = call.arguments as? [String: Any],
               let dateFormat = args["dateFormat"] as? String,
@@ -243,29 +317,52 @@ public class SwiftSkybandEcrPlugin: NSObject, FlutterPlugin, SocketConnectionDel
         
         let request = "\(dateFormat);\(amount);\(printReceipt);\(ecrRefNum)!"
         let signatureStr = signature ? "true" : "false"
+        let receiptFormat = SKBReceiptFormat(rawValue: args["receiptFormat"] as? Int ?? 0) ?? .HTML
+        let deadline = args["deadlineSeconds"] as? Double ?? 0
         
-        coreServices?.doTCPIPTransaction(
-            coreServices?.ipAdress,
-            portNumber: coreServices?.portNumber ?? 0,
+        guard let services = coreServices else {
+            result(notInitializedError())
+            return
+        }
+        // Stored before sending, so whatever answers the reference finds it
+        waitForPayment(ecrRefNum, result: result)
+        // The session stamps and signs the frame itself
+        if let session = session, deadline == 0 {
+            session.submitTransaction(Int32(transactionType),
+                                      fields: ["\(amount)", "\(printReceipt)"],
+                                      ecrRefNum: ecrRefNum,
+                                      receiptFormat: receiptFormat)
+            return
+        }
+        services.doTCPIPTransaction(
+            services.ipAdress,
+            portNumber: services.portNumber,
             requestData: request,
             transactionType: Int32(transactionType),
-            signature: signatureStr
+            signature: signatureStr,
+            receiptFormat: receiptFormat,
+            deadline: deadline
         )
-        
-        #if SIMULATOR
-        // In simulator mode, immediately return a success response
-        let response: [String: Any] = [
-            "status": "success",
-            "message": "Payment processed in simulator",
-            "amount": String(amount),
-            "referenceNumber": ecrRefNum,
-            "transactionId": "SIM\(Int.random(in: 10000...99999))"
-        ]
-        result(response)
-        #else
-        // Store the result callback to be called when the payment is complete
-        self.paymentResult = result
-        #endif
+    }
+    
+    private func notInitializedError() -> FlutterError {
+        return FlutterError(code: "NOT_INITIALIZED",
+                            message: "Call initEcr before sending transactions",
+                            details: nil)
+    }
+    
+    private func waitForPayment(_ ecrRefNum: String, result: @escaping FlutterResult) {
+        paymentResults[ecrRefNum, default: []].append(result)
+    }
+    
+    // The oldest call waiting on ecrRefNum, if any
+    private func takePaymentResult(_ ecrRefNum: String?) -> FlutterResult? {
+        guard let ecrRefNum = ecrRefNum, var results = paymentResults[ecrRefNum], !results.isEmpty else {
+            return nil
+        }
+        let result = results.removeFirst()
+        paymentResults[ecrRefNum] = results.isEmpty ? nil : results
+        return result
     }
 }
 
@@ -283,19 +380,78 @@ extension SwiftSkybandEcrPlugin: FlutterStreamHandler {
     }
 }
 
-// Implementation of SocketConnectionDelegate for both simulator and real builds
+// MARK: - SKBHealthMonitorDelegate
+
+extension SwiftSkybandEcrPlugin: SKBHealthMonitorDelegate {
+    public func healthMonitor(_ monitor: SKBHealthMonitor, didUpdate health: SKBTerminalHealth, forConnection connection: SKBCoreServices) {
+        eventSink?(["health": health.dictionaryRepresentation()])
+    }
+}
+
+// MARK: - SKBSettlementRunDelegate
+
+extension SwiftSkybandEcrPlugin: SKBSettlementRunDelegate {
+    public func settlementRun(_ run: SKBSettlementRun, didFinishTerminal result: SKBSettlementResult) {
+        eventSink?(["settlementProgress": [
+            "completed": run.completedCount,
+            "total": run.terminals.count,
+            "result": result.dictionaryRepresentation()
+        ]])
+    }
+}
+
+// Implementation of SocketConnectionDelegate
 extension SwiftSkybandEcrPlugin {
-    // For simulator builds, we need these to be marked with @objc and be optional
-    // For real device builds, these match the actual SDK methods
-    
     @objc public func socketConnectionStream(_ connection: SKBCoreServices, didReceiveData responseData: NSMutableDictionary) {
-        if let result = paymentResult {
-            result(responseData as? [String: Any])
-            paymentResult = nil
+        let paymentResult = takePaymentResult(responseData["ecrRefNum"] as? String)
+        // Requests the SDK did not send fail their call
+        if let requestError = responseData["requestError"] as? String {
+            let codes = ["invalidDeadline": "INVALID_DEADLINE", "sessionRefused": "SESSION_REFUSED"]
+            paymentResult?(FlutterError(code: codes[requestError] ?? "INVALID_REQUEST",
+                                        message: responseData["responseMessage"] as? String,
+                                        details: nil))
+            return
+        }
+        // Never answered with another request's reply
+        if responseData["idempotencyReplay"] as? String == "rejected" {
+            let error = FlutterError(code: "IDEMPOTENCY_MISMATCH",
+                                     message: responseData["responseMessage"] as? String,
+                                     details: nil)
+            paymentResult?(error)
+            return
+        }
+        if compactResponses,
+           let fields = responseData as? [AnyHashable: Any],
+           let record = connection.compactRecord(forResponse: fields) {
+            // The receipt stays native until Dart asks for it with fetchReceipt,
+            // and the record crosses the channel exactly once.
+            lastReceipt = channelReceipt(responseData["receiptFormat"])
+            let payload = FlutterStandardTypedData(bytes: record)
+            if let paymentResult = paymentResult {
+                paymentResult(payload)
+            } else {
+                eventSink?(["responseRecord": payload])
+            }
+            return
         }
         
-        // Also update the event sink if needed
-        eventSink?(["response": responseData])
+        if let receipt = responseData["receiptFormat"] {
+            responseData["receiptFormat"] = channelReceipt(receipt)
+        }
+        // Each response goes out once: to the call waiting on it, or on the event channel
+        if let paymentResult = paymentResult {
+            paymentResult(responseData as? [String: Any])
+        } else {
+            eventSink?(["response": responseData])
+        }
+    }
+    
+    // ESC/POS receipts are bytes; the channel only carries them as typed data
+    private func channelReceipt(_ receipt: Any?) -> Any? {
+        if let bytes = receipt as? Data {
+            return FlutterStandardTypedData(bytes: bytes)
+        }
+        return receipt
     }
     
     @objc public func socketConnectionStreamDidFailToConnect(_ connection: SKBCoreServices) {
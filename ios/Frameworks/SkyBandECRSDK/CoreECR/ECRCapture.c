@@ -0,0 +1,240 @@
+/*
+ * ECRCapture.c
+ *
+ *  Wire capture and frame reassembly.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ECRCapture.h"
+#include "ECRSrc.h"
+
+//MARK: Little endian helpers
+
+static void vdPutLE(unsigned char *pucOut, unsigned long long ullValue, int inBytes)
+{
+	int i = 0;
+
+	for(i = 0; i < inBytes; i++)
+		pucOut[i] = (unsigned char)(ullValue >> (8 * i));
+}
+
+static unsigned long long ullGetLE(const unsigned char *pucIn, int inBytes)
+{
+	unsigned long long ullValue = 0;
+	int i = 0;
+
+	for(i = inBytes - 1; i >= 0; i--)
+		ullValue = (ullValue << 8) | pucIn[i];
+	return ullValue;
+}
+
+//MARK: Writer
+
+static int inIsCapture(FILE *fp)
+{
+	unsigned char aucHeader[ECR_CAPTURE_HEADER_SIZE];
+
+	if(fread(aucHeader, 1, sizeof(aucHeader), fp) != sizeof(aucHeader))
+		return 0;
+	return memcmp(aucHeader, ECR_CAPTURE_MAGIC, 4) == 0 && ullGetLE(&aucHeader[4], 2) == ECR_CAPTURE_VERSION;
+}
+
+EXPORT int ecrCaptureOpen(ECR_CAPTURE *pCapture, const char *pszPath)
+{
+	unsigned char aucHeader[ECR_CAPTURE_HEADER_SIZE];
+	FILE *fp = fopen(pszPath, "rb");
+
+	memset(pCapture, 0x00, sizeof(ECR_CAPTURE));
+	if(fp != NULL)
+	{
+		int inAppend = inIsCapture(fp);
+
+		fclose(fp);
+		if(inAppend)
+		{
+			pCapture->fp = fopen(pszPath, "ab");
+			return pCapture->fp != NULL ? 0 : -1;
+		}
+	}
+
+	pCapture->fp = fopen(pszPath, "wb");
+	if(pCapture->fp == NULL)
+		return -1;
+
+	memset(aucHeader, 0x00, sizeof(aucHeader));
+	memcpy(aucHeader, ECR_CAPTURE_MAGIC, 4);
+	vdPutLE(&aucHeader[4], ECR_CAPTURE_VERSION, 2);
+	if(fwrite(aucHeader, 1, sizeof(aucHeader), pCapture->fp) != sizeof(aucHeader))
+	{
+		ecrCaptureClose(pCapture);
+		return -1;
+	}
+	return 0;
+}
+
+EXPORT int ecrCaptureWrite(ECR_CAPTURE *pCapture, int inDirection, int transactionType, const char *pszTerminalId,
+		const unsigned char *pucFrame, int inLength, long long llTimestampUs)
+{
+	unsigned char aucRecord[ECR_CAPTURE_RECORD_SIZE];
+	size_t inTerminalIdLength = pszTerminalId != NULL ? strlen(pszTerminalId) : 0;
+
+	if(pCapture->fp == NULL || inLength < 0)
+		return -1;
+	// The length is one byte on file, terminal ids are 8 digits in practice
+	if(inTerminalIdLength > 0xFF)
+		inTerminalIdLength = 0xFF;
+
+	aucRecord[0] = (unsigned char)inDirection;
+	aucRecord[1] = (unsigned char)transactionType;
+	aucRecord[2] = (unsigned char)inTerminalIdLength;
+	aucRecord[3] = 0;
+	vdPutLE(&aucRecord[4], (unsigned long long)llTimestampUs, 8);
+	vdPutLE(&aucRecord[12], (unsigned long long)inLength, 4);
+
+	if(fwrite(aucRecord, 1, sizeof(aucRecord), pCapture->fp) != sizeof(aucRecord)
+			|| fwrite(pszTerminalId, 1, inTerminalIdLength, pCapture->fp) != inTerminalIdLength
+			|| fwrite(pucFrame, 1, (size_t)inLength, pCapture->fp) != (size_t)inLength
+			|| fflush(pCapture->fp) != 0)
+		return -1;
+
+	pCapture->llRecords++;
+	return 0;
+}
+
+EXPORT void ecrCaptureClose(ECR_CAPTURE *pCapture)
+{
+	if(pCapture->fp != NULL)
+		fclose(pCapture->fp);
+	pCapture->fp = NULL;
+}
+
+EXPORT long long ecrCaptureNow(void)
+{
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+	return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+//MARK: Reader
+
+EXPORT int ecrCaptureLoad(const char *pszPath, unsigned char **ppucData, long *plSize)
+{
+	FILE *fp = fopen(pszPath, "rb");
+	unsigned char *pucData = NULL;
+	long lSize = 0;
+
+	*ppucData = NULL;
+	*plSize = 0;
+	if(fp == NULL)
+		return -1;
+
+	if(fseek(fp, 0, SEEK_END) == 0)
+		lSize = ftell(fp);
+	if(lSize < ECR_CAPTURE_HEADER_SIZE || fseek(fp, 0, SEEK_SET) != 0)
+	{
+		fclose(fp);
+		return -1;
+	}
+
+	pucData = (unsigned char *)malloc((size_t)lSize);
+	if(pucData == NULL || fread(pucData, 1, (size_t)lSize, fp) != (size_t)lSize
+			|| memcmp(pucData, ECR_CAPTURE_MAGIC, 4) != 0 || ullGetLE(&pucData[4], 2) != ECR_CAPTURE_VERSION)
+	{
+		free(pucData);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+
+	*ppucData = pucData;
+	*plSize = lSize;
+	return 0;
+}
+
+EXPORT int ecrCaptureNext(const unsigned char *pucData, long lSize, long *plOffset, ECR_CAPTURE_RECORD *pRecord)
+{
+	const unsigned char *pucRecord = pucData + *plOffset;
+	long lLeft = lSize - *plOffset;
+	long lBody = 0;
+
+	if(lLeft <= 0)
+		return 0;
+	if(lLeft < ECR_CAPTURE_RECORD_SIZE)
+		return -1;
+
+	pRecord->inDirection = pucRecord[0];
+	pRecord->transactionType = pucRecord[1];
+	pRecord->inTerminalIdLength = pucRecord[2];
+	pRecord->llTimestampUs = (long long)ullGetLE(&pucRecord[4], 8);
+	pRecord->inFrameLength = (int)ullGetLE(&pucRecord[12], 4);
+
+	lBody = (long)pRecord->inTerminalIdLength + pRecord->inFrameLength;
+	if(pRecord->inFrameLength < 0 || lBody > lLeft - ECR_CAPTURE_RECORD_SIZE)
+		return -1;
+
+	pRecord->pszTerminalId = (const char *)pucRecord + ECR_CAPTURE_RECORD_SIZE;
+	pRecord->pucFrame = pucRecord + ECR_CAPTURE_RECORD_SIZE + pRecord->inTerminalIdLength;
+	*plOffset += ECR_CAPTURE_RECORD_SIZE + lBody;
+	return 1;
+}
+
+//MARK: Reassembly
+
+EXPORT void ecrReassemblerInit(ECR_REASSEMBLER *pReassembler)
+{
+	pReassembler->inLength = 0;
+}
+
+EXPORT int ecrReassemblerPush(ECR_REASSEMBLER *pReassembler, const unsigned char *pucData, int inLength,
+		ECR_FRAME_HANDLER pfnFrame, void *pvContext)
+{
+	int inFrames = 0;
+
+	while(inLength > 0)
+	{
+		int inCopy = ECR_CAPTURE_FRAME_MAX - pReassembler->inLength;
+		int inScan = pReassembler->inLength;
+		int inEnd = -1;
+
+		if(inCopy > inLength)
+			inCopy = inLength;
+		memcpy(&pReassembler->aucBuffer[pReassembler->inLength], pucData, (size_t)inCopy);
+		pReassembler->inLength += inCopy;
+		pucData += inCopy;
+		inLength -= inCopy;
+
+		// A frame ends with the LRC byte after ETX; the ETX of the previous push may still wait for it
+		if(inScan > 0)
+			inScan--;
+		while(inScan + 1 < pReassembler->inLength)
+		{
+			const unsigned char *pucEtx = (const unsigned char *)memchr(&pReassembler->aucBuffer[inScan], ETX[0],
+					(size_t)(pReassembler->inLength - 1 - inScan));
+
+			if(pucEtx == NULL)
+				break;
+			inEnd = (int)(pucEtx - pReassembler->aucBuffer) + 2;
+			pfnFrame(pvContext, pReassembler->aucBuffer, inEnd);
+			inFrames++;
+
+			memmove(pReassembler->aucBuffer, &pReassembler->aucBuffer[inEnd], (size_t)(pReassembler->inLength - inEnd));
+			pReassembler->inLength -= inEnd;
+			inScan = 0;
+		}
+
+		if(pReassembler->inLength == ECR_CAPTURE_FRAME_MAX)
+			inFrames += ecrReassemblerFlush(pReassembler, pfnFrame, pvContext);
+	}
+	return inFrames;
+}
+
+EXPORT int ecrReassemblerFlush(ECR_REASSEMBLER *pReassembler, ECR_FRAME_HANDLER pfnFrame, void *pvContext)
+{
+	if(pReassembler->inLength == 0)
+		return 0;
+	pfnFrame(pvContext, pReassembler->aucBuffer, pReassembler->inLength);
+	pReassembler->inLength = 0;
+	return 1;
+}
@@ -0,0 +1,148 @@
+/*
+ * ECRCapture.h
+ *
+ *  Wire capture of the raw frames exchanged with a terminal, and the frame
+ *  reassembly used to replay them.
+ *
+ *  Capture file (little endian):
+ *    [0..3]   "SBCP"
+ *    [4..5]   version
+ *    [6..7]   reserved
+ *  followed by one record per write or read on the socket:
+ *    [0]      direction (ECR_CAPTURE_INBOUND / ECR_CAPTURE_OUTBOUND)
+ *    [1]      transaction type
+ *    [2]      terminal id length
+ *    [3]      reserved
+ *    [4..11]  timestamp, microseconds since the epoch
+ *    [12..15] frame length
+ *    terminal id bytes, then frame bytes
+ *
+ *  Inbound records hold what one socket read returned, which is not always a
+ *  whole reply. Run them through ECR_REASSEMBLER to get frames back.
+ */
+
+#ifndef ECRSRC_ECRCAPTURE_H_
+#define ECRSRC_ECRCAPTURE_H_
+
+#include <stdio.h>
+#include "SBCoreECR.h"
+
+#define ECR_CAPTURE_MAGIC				"SBCP"
+#define ECR_CAPTURE_VERSION				1
+#define ECR_CAPTURE_HEADER_SIZE			8
+#define ECR_CAPTURE_RECORD_SIZE			16		// Fixed part of a record
+#define ECR_CAPTURE_FRAME_MAX			8192	// Longest frame the reassembler holds
+
+#define ECR_CAPTURE_INBOUND				0		// Terminal to ECR
+#define ECR_CAPTURE_OUTBOUND			1		// ECR to terminal
+
+typedef struct
+{
+	FILE *fp;
+	long long llRecords;
+} ECR_CAPTURE;
+
+typedef struct
+{
+	int inDirection;
+	int transactionType;
+	long long llTimestampUs;
+	const char *pszTerminalId;			// Not NUL terminated
+	int inTerminalIdLength;
+	const unsigned char *pucFrame;
+	int inFrameLength;
+} ECR_CAPTURE_RECORD;
+
+typedef void (*ECR_FRAME_HANDLER)(void *pvContext, const unsigned char *pucFrame, int inLength);
+
+typedef struct
+{
+	unsigned char aucBuffer[ECR_CAPTURE_FRAME_MAX];
+	int inLength;
+} ECR_REASSEMBLER;
+
+/*********************************************************************************************
+* @func int | ecrCaptureOpen |
+* This routine opens a capture file for writing. An existing capture is appended to,
+* any other file is replaced.
+*
+* @rdesc Returns 0 on success, -1 on an I/O error
+* @end
+**********************************************************************************************/
+EXPORT int ecrCaptureOpen(ECR_CAPTURE *pCapture, const char *pszPath);
+
+/*********************************************************************************************
+* @func int | ecrCaptureWrite |
+* This routine appends one record and flushes it, so a capture survives the app being killed.
+* Calls on one ECR_CAPTURE must not overlap.
+*
+* @parm int | inDirection |
+*       This is ECR_CAPTURE_INBOUND or ECR_CAPTURE_OUTBOUND
+*
+* @parm long long | llTimestampUs |
+*       This is the time the bytes went over the wire, see ecrCaptureNow
+*
+* @rdesc Returns 0 on success, -1 on an I/O error or if the capture is closed
+* @end
+**********************************************************************************************/
+EXPORT int ecrCaptureWrite(ECR_CAPTURE *pCapture, int inDirection, int transactionType, const char *pszTerminalId,
+		const unsigned char *pucFrame, int inLength, long long llTimestampUs);
+
+EXPORT void ecrCaptureClose(ECR_CAPTURE *pCapture);
+
+/*********************************************************************************************
+* @func long long | ecrCaptureNow |
+* This routine gives the wall clock in microseconds since the epoch
+* @end
+**********************************************************************************************/
+EXPORT long long ecrCaptureNow(void);
+
+/*********************************************************************************************
+* @func int | ecrCaptureLoad |
+* This routine reads a whole capture file into memory for ecrCaptureNext
+*
+* @parm unsigned char ** | ppucData |
+*       This is set to the file contents, release with free()
+*
+* @rdesc Returns 0 on success, -1 on an I/O error or if the file is not a capture
+* @end
+**********************************************************************************************/
+EXPORT int ecrCaptureLoad(const char *pszPath, unsigned char **ppucData, long *plSize);
+
+/*********************************************************************************************
+* @func int | ecrCaptureNext |
+* This routine decodes the record at *plOffset and moves the offset past it. The record
+* points into pucData, nothing is copied.
+*
+* @parm long * | plOffset |
+*       This is the read position, start at ECR_CAPTURE_HEADER_SIZE
+*
+* @rdesc Returns 1 if a record was read, 0 at the end, -1 if the last record is truncated
+* @end
+**********************************************************************************************/
+EXPORT int ecrCaptureNext(const unsigned char *pucData, long lSize, long *plOffset, ECR_CAPTURE_RECORD *pRecord);
+
+EXPORT void ecrReassemblerInit(ECR_REASSEMBLER *pReassembler);
+
+/*********************************************************************************************
+* @func int | ecrReassemblerPush |
+* This routine appends received bytes and hands every complete frame (up to and including
+* the LRC after ETX) to pfnFrame. Bytes that do not fit are handed on as they are.
+*
+* @rdesc Returns the number of frames handed on
+* @end
+**********************************************************************************************/
+EXPORT int ecrReassemblerPush(ECR_REASSEMBLER *pReassembler, const unsigned char *pucData, int inLength,
+		ECR_FRAME_HANDLER pfnFrame, void *pvContext);
+
+/*********************************************************************************************
+* @func int | ecrReassemblerFlush |
+* This routine hands on whatever is buffered as one frame, for replies that end without
+* ETX. A reply is over once the next request goes out, so replays flush there.
+*
+* @rdesc Returns 1 if a frame was handed on, 0 if nothing was buffered
+* @end
+**********************************************************************************************/
+EXPORT int ecrReassemblerFlush(ECR_REASSEMBLER *pReassembler, ECR_FRAME_HANDLER pfnFrame, void *pvContext);
+
+#endif /* ECRSRC_ECRCAPTURE_H_ */
@@ -0,0 +1,176 @@
+/*
+ * ECRFrameCache.c
+ *
+ *  Prebuilt request frames for status and housekeeping commands.
+ */
+#include <string.h>
+#include "ECRFrameCache.h"
+
+static const int ainCachedTypes[ECR_FRAME_CACHE_COMMANDS] =
+{
+	TYPE_PARAM_DOWNLOAD, TYPE_GET_PARAM, TYPE_CHECK_STATUS, TYPE_PARTIAL_DOWNLOAD, TYPE_SNAPSHOT_TOTAL
+};
+
+static int inCommandSlot(int transactionType)
+{
+	int i = 0;
+
+	for(i = 0; i < ECR_FRAME_CACHE_COMMANDS; i++)
+	{
+		if(ainCachedTypes[i] == transactionType)
+			return i;
+	}
+	return -1;
+}
+
+static int inAppend(unsigned char *pucFrame, int inIndex, const char *pszValue, int inLength)
+{
+	memcpy(&pucFrame[inIndex], pszValue, (size_t)inLength);
+	inIndex += inLength;
+	pucFrame[inIndex++] = (unsigned char)FIELD_SEPERATOR[0];
+	return inIndex;
+}
+
+// pack() sends the LRC through "%02x" and ascToHexConv(), which maps the lowercase
+// nibbles a..f to 3..8. Terminals take that byte, so cached frames send the same one.
+static unsigned char ucWireLrc(unsigned char ucLrc)
+{
+	int inHigh = ucLrc >> 4, inLow = ucLrc & 0x0F;
+
+	if(inHigh > 9)
+		inHigh -= 7;
+	if(inLow > 9)
+		inLow -= 7;
+	return (unsigned char)((inHigh << 4) + inLow);
+}
+
+// Same layout as pack() for these commands, with zeroed variable fields
+static void vdBuildTemplate(ECR_FRAME_TEMPLATE *pTemplate, int transactionType, int inRefNumLength)
+{
+	char szZeros[SIGNATURE_SIZE];
+	unsigned char ucLrc = 0;
+	int inIndex = 0;
+	int i = 0;
+
+	memset(szZeros, '0', sizeof(szZeros));
+	memset(pTemplate, 0x00, sizeof(ECR_FRAME_TEMPLATE));
+
+	pTemplate->aucFrame[inIndex++] = (unsigned char)STX[0];
+	pTemplate->aucFrame[inIndex++] = (unsigned char)FIELD_SEPERATOR[0];
+	inIndex = inAppend(pTemplate->aucFrame, inIndex, getCommand(transactionType), CMD_SIZE);
+	pTemplate->inDateTimeOffset = inIndex;
+	inIndex = inAppend(pTemplate->aucFrame, inIndex, szZeros, DATETIME_SIZE);
+	pTemplate->inRefNumOffset = inIndex;
+	inIndex = inAppend(pTemplate->aucFrame, inIndex, szZeros, inRefNumLength);
+	pTemplate->inSignatureOffset = inIndex;
+	inIndex = inAppend(pTemplate->aucFrame, inIndex, szZeros, SIGNATURE_SIZE);
+	inIndex = inAppend(pTemplate->aucFrame, inIndex, TIMEOUT_VAL, TIMEOUT_SIZE);
+	pTemplate->aucFrame[inIndex++] = (unsigned char)ETX[0];
+
+	//LRC, exclusive OR of every byte from STX to ETX
+	for(i = 0; i < inIndex; i++)
+		ucLrc ^= pTemplate->aucFrame[i];
+	pTemplate->inLrcOffset = inIndex;
+	pTemplate->ucLrc = ucLrc;
+	pTemplate->aucFrame[inIndex++] = ucWireLrc(ucLrc);
+	pTemplate->inLength = inIndex;
+}
+
+// Overwrites a field, folding the changed bytes into the LRC
+static void vdPatch(ECR_FRAME_TEMPLATE *pTemplate, int inOffset, const char *pszValue, int inLength)
+{
+	unsigned char *pucField = &pTemplate->aucFrame[inOffset];
+	unsigned char ucLrc = pTemplate->ucLrc;
+	int i = 0;
+
+	for(i = 0; i < inLength; i++)
+	{
+		ucLrc ^= pucField[i] ^ (unsigned char)pszValue[i];
+		pucField[i] = (unsigned char)pszValue[i];
+	}
+	pTemplate->ucLrc = ucLrc;
+	pTemplate->aucFrame[pTemplate->inLrcOffset] = ucWireLrc(ucLrc);
+}
+
+static int inIsDigits(const char *pszValue, int inLength)
+{
+	int i = 0;
+
+	for(i = 0; i < inLength; i++)
+	{
+		if(pszValue[i] < '0' || pszValue[i] > '9')
+			return 0;
+	}
+	return 1;
+}
+
+EXPORT void ecrFrameCacheInit(ECR_FRAME_CACHE *pCache)
+{
+	memset(pCache, 0x00, sizeof(ECR_FRAME_CACHE));
+}
+
+EXPORT int ecrFrameCacheEmit(ECR_FRAME_CACHE *pCache, int transactionType, const char *pszDateTime,
+		const char *pszRefNum, const char *pszSignature, unsigned char *pucFrame)
+{
+	ECR_FRAME_TEMPLATE *pTemplate = NULL;
+	int inSlot = inCommandSlot(transactionType);
+	int inRefNumLength = 0;
+
+	if(inSlot < 0 || pszDateTime == NULL || pszRefNum == NULL || pszSignature == NULL)
+		return -1;
+
+	// pack() writes the date time as %012lld and copies the others verbatim; anything it
+	// would rewrite, or a separator inside a field, goes through pack()
+	inRefNumLength = (int)strlen(pszRefNum);
+	if(strlen(pszDateTime) != DATETIME_SIZE || !inIsDigits(pszDateTime, DATETIME_SIZE)
+			|| inRefNumLength < 1 || inRefNumLength > REFNUM_SIZE || strlen(pszSignature) != SIGNATURE_SIZE
+			|| memchr(pszRefNum, FIELD_SEPERATOR[0], (size_t)inRefNumLength) != NULL
+			|| memchr(pszSignature, FIELD_SEPERATOR[0], SIGNATURE_SIZE) != NULL)
+		return -1;
+
+	pTemplate = &pCache->aTemplates[inSlot][inRefNumLength - 1];
+	if(pTemplate->inLength == 0)
+		vdBuildTemplate(pTemplate, transactionType, inRefNumLength);
+
+	vdPatch(pTemplate, pTemplate->inDateTimeOffset, pszDateTime, DATETIME_SIZE);
+	vdPatch(pTemplate, pTemplate->inRefNumOffset, pszRefNum, inRefNumLength);
+	vdPatch(pTemplate, pTemplate->inSignatureOffset, pszSignature, SIGNATURE_SIZE);
+
+	memcpy(pucFrame, pTemplate->aucFrame, (size_t)pTemplate->inLength);
+	return pTemplate->inLength;
+}
+
+EXPORT int ecrFrameCacheEmitRequest(ECR_FRAME_CACHE *pCache, int transactionType, const char *inputReqData,
+		const char *pszSignature, unsigned char *pucFrame)
+{
+	char szDateTime[DATETIME_SIZE + 1];
+	char szRefNum[REFNUM_SIZE + 1];
+	const char *pszSeparator = NULL;
+	const char *pszEnd = NULL;
+	size_t inLength = 0;
+
+	if(inCommandSlot(transactionType) < 0 || inputReqData == NULL)
+		return -1;
+
+	// Exactly two fields: "datetime;refnum!"
+	pszSeparator = strchr(inputReqData, DELIMITOR_CHAR);
+	if(pszSeparator == NULL)
+		return -1;
+	pszEnd = strchr(pszSeparator + 1, ENDMSG_CHAR);
+	if(pszEnd == NULL || pszEnd[1] != '\0' || memchr(pszSeparator + 1, DELIMITOR_CHAR, (size_t)(pszEnd - pszSeparator - 1)) != NULL)
+		return -1;
+
+	inLength = (size_t)(pszSeparator - inputReqData);
+	if(inLength != DATETIME_SIZE)
+		return -1;
+	memcpy(szDateTime, inputReqData, inLength);
+	szDateTime[inLength] = '\0';
+
+	inLength = (size_t)(pszEnd - pszSeparator - 1);
+	if(inLength > REFNUM_SIZE)
+		return -1;
+	memcpy(szRefNum, pszSeparator + 1, inLength);
+	szRefNum[inLength] = '\0';
+
+	return ecrFrameCacheEmit(pCache, transactionType, szDateTime, szRefNum, pszSignature, pucFrame);
+}
@@ -0,0 +1,81 @@
+/*
+ * ECRFrameCache.h
+ *
+ *  Prebuilt request frames for the status and housekeeping commands whose
+ *  frames only differ in date time, ECR reference number and signature:
+ *  Param Download (B2), Get Param (B4), Check Status (C3), Partial
+ *  Download (C4) and Snapshot Total (C5).
+ *
+ *    STX FS cmd FS datetime[12] FS refnum[n] FS signature[64] FS timeout[3] FS ETX LRC
+ *
+ *  A template is built once per command and reference number length. Emitting
+ *  a frame patches the three fields in place, updates the LRC by XORing out the
+ *  old bytes and XORing in the new ones, and copies the frame out. The bytes are
+ *  the same pack() produces for the same input.
+ */
+
+#ifndef ECRSRC_ECRFRAMECACHE_H_
+#define ECRSRC_ECRFRAMECACHE_H_
+
+#include "SBCoreECR.h"
+#include "ECRSrc.h"
+
+#define ECR_FRAME_CACHE_COMMANDS		5
+#define ECR_FRAME_TEMPLATE_MAX			128
+
+typedef struct
+{
+	unsigned char aucFrame[ECR_FRAME_TEMPLATE_MAX];
+	int inLength;						// 0 until built
+	int inDateTimeOffset;
+	int inRefNumOffset;
+	int inSignatureOffset;
+	int inLrcOffset;
+	unsigned char ucLrc;				// XOR of STX..ETX; the byte on the wire is encoded as pack() does
+} ECR_FRAME_TEMPLATE;
+
+typedef struct
+{
+	ECR_FRAME_TEMPLATE aTemplates[ECR_FRAME_CACHE_COMMANDS][REFNUM_SIZE];	// By command, then reference number length - 1
+} ECR_FRAME_CACHE;
+
+EXPORT void ecrFrameCacheInit(ECR_FRAME_CACHE *pCache);
+
+/*********************************************************************************************
+* @func int | ecrFrameCacheEmit |
+* This routine writes the request frame of a cached command
+*
+* @parm int | transactionType |
+*       This is TYPE_PARAM_DOWNLOAD, TYPE_GET_PARAM, TYPE_CHECK_STATUS,
+*       TYPE_PARTIAL_DOWNLOAD or TYPE_SNAPSHOT_TOTAL
+*
+* @parm const char * | pszDateTime |
+*       This is the date time stamp, exactly DATETIME_SIZE digits
+*
+* @parm const char * | pszRefNum |
+*       This is the ECR reference number, 1 to REFNUM_SIZE characters
+*
+* @parm const char * | pszSignature |
+*       This is the signature, exactly SIGNATURE_SIZE characters
+*
+* @parm unsigned char * | pucFrame |
+*       This is the output, at least ECR_FRAME_TEMPLATE_MAX bytes
+*
+* @rdesc Returns the frame length, -1 if the command is not cached or a field does not
+*        fit its template; pack() handles those
+* @end
+**********************************************************************************************/
+EXPORT int ecrFrameCacheEmit(ECR_FRAME_CACHE *pCache, int transactionType, const char *pszDateTime,
+		const char *pszRefNum, const char *pszSignature, unsigned char *pucFrame);
+
+/*********************************************************************************************
+* @func int | ecrFrameCacheEmitRequest |
+* This routine is ecrFrameCacheEmit for the "datetime;refnum!" input string pack() takes
+*
+* @rdesc Returns the frame length, -1 if pack() has to build the frame
+* @end
+**********************************************************************************************/
+EXPORT int ecrFrameCacheEmitRequest(ECR_FRAME_CACHE *pCache, int transactionType, const char *inputReqData,
+		const char *pszSignature, unsigned char *pucFrame);
+
+#endif /* ECRSRC_ECRFRAMECACHE_H_ */
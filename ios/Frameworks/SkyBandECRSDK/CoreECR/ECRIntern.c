@@ -0,0 +1,78 @@
+/*
+ * ECRIntern.c
+ *
+ *  Interning of response field values by their raw bytes.
+ */
+#include <string.h>
+#include "ECRIntern.h"
+
+#define FNV_OFFSET_BASIS				2166136261UL
+#define FNV_PRIME						16777619UL
+
+void ecrInternInit(ECR_INTERN_TABLE *pTable)
+{
+	int i = 0;
+
+	memset(pTable, 0x00, sizeof(ECR_INTERN_TABLE));
+	for(i = 0; i < ECR_INTERN_SLOTS; i++)
+		pTable->aSlots[i].inLength = -1;
+}
+
+unsigned long ecrInternHash(const unsigned char *pucValue, int inLength)
+{
+	unsigned long ulHash = FNV_OFFSET_BASIS;
+	int i = 0;
+
+	for(i = 0; i < inLength; i++)
+	{
+		ulHash ^= pucValue[i];
+		ulHash = (ulHash * FNV_PRIME) & 0xFFFFFFFFUL;
+	}
+	return ulHash;
+}
+
+int ecrInternFind(ECR_INTERN_TABLE *pTable, const unsigned char *pucValue, int inLength, int *pinFound)
+{
+	ECR_INTERN_SLOT *pSet = NULL;
+	ECR_INTERN_SLOT *pSlot = NULL;
+	unsigned long ulHash = 0;
+	int inSet = 0;
+	int inWay = 0;
+	int inVictim = 0;
+
+	*pinFound = 0;
+	if(inLength < 0 || inLength > ECR_INTERN_VALUE_MAX)
+		return -1;
+
+	ulHash = ecrInternHash(pucValue, inLength);
+	inSet = (int)(ulHash % ECR_INTERN_SETS);
+	pSet = &pTable->aSlots[inSet * ECR_INTERN_WAYS];
+	pTable->ulLookups++;
+
+	for(inWay = 0; inWay < ECR_INTERN_WAYS; inWay++)
+	{
+		pSlot = &pSet[inWay];
+		if(pSlot->inLength == inLength && pSlot->ulHash == ulHash
+				&& memcmp(pSlot->aucValue, pucValue, (size_t)inLength) == 0)
+		{
+			pSlot->inHits++;
+			pTable->ulHits++;
+			*pinFound = 1;
+			return inSet * ECR_INTERN_WAYS + inWay;
+		}
+		if(pSlot->inHits < pSet[inVictim].inHits || (pSlot->inLength < 0 && pSet[inVictim].inLength >= 0))
+			inVictim = inWay;
+	}
+
+	// Age the surviving ways so a constant that stopped repeating can be replaced
+	for(inWay = 0; inWay < ECR_INTERN_WAYS; inWay++)
+		if(inWay != inVictim)
+			pSet[inWay].inHits >>= 1;
+
+	pSlot = &pSet[inVictim];
+	pSlot->ulHash = ulHash;
+	pSlot->inLength = inLength;
+	pSlot->inHits = 0;
+	memcpy(pSlot->aucValue, pucValue, (size_t)inLength);
+	return inSet * ECR_INTERN_WAYS + inVictim;
+}
@@ -0,0 +1,58 @@
+/*
+ * ECRIntern.h
+ *
+ *  Interning of response field values by their raw bytes. Most fields of a
+ *  terminal's responses repeat from one transaction to the next (TID, MID,
+ *  merchant name and address, application version, disclaimer, category code),
+ *  so a connection keeps one decoded instance of each and reuses it.
+ *
+ *  The table is 2-way set associative, indexed by an FNV-1a hash of the bytes.
+ *  A miss replaces the way with fewer hits and halves the hits of the other, so
+ *  values that change every transaction (STAN, RRN, amounts) replace each other
+ *  instead of the constants. The table only tracks bytes; the caller keeps its
+ *  decoded objects by slot index and drops them when a slot is replaced.
+ */
+
+#ifndef ECRSRC_ECRINTERN_H_
+#define ECRSRC_ECRINTERN_H_
+
+#include "SBCoreECR.h"
+
+#define ECR_INTERN_SETS					64
+#define ECR_INTERN_WAYS					2
+#define ECR_INTERN_SLOTS				(ECR_INTERN_SETS * ECR_INTERN_WAYS)
+#define ECR_INTERN_VALUE_MAX			256		// Longer values are not interned
+
+typedef struct
+{
+	unsigned long ulHash;
+	int inLength;						// -1 while empty
+	int inHits;
+	unsigned char aucValue[ECR_INTERN_VALUE_MAX];
+} ECR_INTERN_SLOT;
+
+typedef struct
+{
+	ECR_INTERN_SLOT aSlots[ECR_INTERN_SLOTS];
+	unsigned long ulLookups;
+	unsigned long ulHits;
+} ECR_INTERN_TABLE;
+
+EXPORT void ecrInternInit(ECR_INTERN_TABLE *pTable);
+
+EXPORT unsigned long ecrInternHash(const unsigned char *pucValue, int inLength);
+
+/*********************************************************************************************
+* @func int | ecrInternFind |
+* This routine finds the slot holding pucValue, or places it in a slot
+*
+* @parm int * | pinFound |
+*       This is set to 1 if the value was already interned, 0 if it replaced what the
+*       slot held before
+*
+* @rdesc Returns the slot index, -1 if the value is longer than ECR_INTERN_VALUE_MAX
+* @end
+**********************************************************************************************/
+EXPORT int ecrInternFind(ECR_INTERN_TABLE *pTable, const unsigned char *pucValue, int inLength, int *pinFound);
+
+#endif /* ECRSRC_ECRINTERN_H_ */
@@ -0,0 +1,79 @@
+/*
+ * ECRLatency.c
+ *
+ *  Latency windows, percentiles and the timeouts derived from them.
+ */
+#include <string.h>
+#include "ECRLatency.h"
+
+static double dClamp(double dValue, double dMin, double dMax)
+{
+	if(dValue < dMin)
+		return dMin;
+	if(dValue > dMax)
+		return dMax;
+	return dValue;
+}
+
+EXPORT void ecrLatencyInit(ECR_LATENCY_WINDOW *pWindow)
+{
+	memset(pWindow, 0x00, sizeof(ECR_LATENCY_WINDOW));
+}
+
+EXPORT void ecrLatencyAdd(ECR_LATENCY_WINDOW *pWindow, double dSeconds)
+{
+	if(dSeconds < 0)
+		dSeconds = 0;
+	pWindow->adSamples[pWindow->inNext] = dSeconds;
+	pWindow->inNext = (pWindow->inNext + 1) % ECR_LATENCY_SAMPLES;
+	if(pWindow->inCount < ECR_LATENCY_SAMPLES)
+		pWindow->inCount++;
+}
+
+EXPORT double ecrLatencyPercentile(const ECR_LATENCY_WINDOW *pWindow, double dPercentile)
+{
+	double adSorted[ECR_LATENCY_SAMPLES];
+	double dValue = 0;
+	int inRank = 0;
+	int i = 0, j = 0;
+
+	if(pWindow->inCount == 0)
+		return -1;
+
+	//Insertion sort, the window is small
+	for(i = 0; i < pWindow->inCount; i++)
+	{
+		dValue = pWindow->adSamples[i];
+		for(j = i; j > 0 && adSorted[j - 1] > dValue; j--)
+			adSorted[j] = adSorted[j - 1];
+		adSorted[j] = dValue;
+	}
+
+	//Nearest rank: the smallest sample with at least dPercentile of the samples at or below it
+	inRank = (int)(dClamp(dPercentile, 0, 1) * pWindow->inCount + 0.999999);
+	if(inRank < 1)
+		inRank = 1;
+	if(inRank > pWindow->inCount)
+		inRank = pWindow->inCount;
+	return adSorted[inRank - 1];
+}
+
+EXPORT double ecrLatencyTimeout(const ECR_LATENCY_WINDOW *pWindow, double dPercentile, double dFactor,
+		double dMin, double dMax, double dDefault, int inMinSamples)
+{
+	if(pWindow->inCount < inMinSamples || pWindow->inCount == 0)
+		return dClamp(dDefault, dMin, dMax);
+	return dClamp(ecrLatencyPercentile(pWindow, dPercentile) * dFactor, dMin, dMax);
+}
+
+EXPORT double ecrLatencyBackoff(double dBase, int inFailures, double dMin, double dMax, double dJitter, double dRandom)
+{
+	double dDelay = dClamp(dBase, dMin, dMax);
+	int i = 0;
+
+	for(i = 1; i < inFailures && dDelay < dMax; i++)
+		dDelay *= 2;
+	dDelay = dClamp(dDelay, dMin, dMax);
+	dDelay *= 1 - dClamp(dJitter, 0, 1) * dClamp(dRandom, 0, 1);
+	return dClamp(dDelay, dMin, dMax);
+}
@@ -0,0 +1,68 @@
+/*
+ * ECRLatency.h
+ *
+ *  Recent latency samples of one terminal and operation (connect, or a
+ *  transaction type), and the timeouts and reconnect delays derived from them.
+ *
+ *  A window holds the last ECR_LATENCY_SAMPLES samples in a ring. Percentiles
+ *  are nearest rank over a sorted copy, so old samples age out as new ones come
+ *  in and one slow outlier moves the high percentiles only while it is in the
+ *  window.
+ */
+
+#ifndef ECRSRC_ECRLATENCY_H_
+#define ECRSRC_ECRLATENCY_H_
+
+#include "SBCoreECR.h"
+
+#define ECR_LATENCY_SAMPLES				64
+
+typedef struct
+{
+	double adSamples[ECR_LATENCY_SAMPLES];		// Seconds
+	int inCount;								// Samples held, up to ECR_LATENCY_SAMPLES
+	int inNext;									// Ring slot of the next sample
+} ECR_LATENCY_WINDOW;
+
+EXPORT void ecrLatencyInit(ECR_LATENCY_WINDOW *pWindow);
+EXPORT void ecrLatencyAdd(ECR_LATENCY_WINDOW *pWindow, double dSeconds);
+
+/*********************************************************************************************
+* @func double | ecrLatencyPercentile |
+* This routine returns the nearest rank percentile of the samples in the window
+*
+* @parm double | dPercentile |
+*       This is the percentile as a fraction, 0.5 for the median
+*
+* @rdesc Returns the latency in seconds, -1 if the window is empty
+* @end
+**********************************************************************************************/
+EXPORT double ecrLatencyPercentile(const ECR_LATENCY_WINDOW *pWindow, double dPercentile);
+
+/*********************************************************************************************
+* @func double | ecrLatencyTimeout |
+* This routine derives a timeout of dFactor times the dPercentile latency, within dMin and
+* dMax. Until the window holds inMinSamples samples, dDefault is used instead, within the
+* same bounds.
+*
+* @rdesc Returns the timeout in seconds
+* @end
+**********************************************************************************************/
+EXPORT double ecrLatencyTimeout(const ECR_LATENCY_WINDOW *pWindow, double dPercentile, double dFactor,
+		double dMin, double dMax, double dDefault, int inMinSamples);
+
+/*********************************************************************************************
+* @func double | ecrLatencyBackoff |
+* This routine returns the delay before the next reconnect: dBase doubled for every
+* consecutive failure after the first, capped at dMax, then scaled down by up to dJitter
+* (0 to 1) so terminals that dropped together do not reconnect together
+*
+* @parm double | dRandom |
+*       This is a uniform random number in [0, 1)
+*
+* @rdesc Returns the delay in seconds, at least dMin
+* @end
+**********************************************************************************************/
+EXPORT double ecrLatencyBackoff(double dBase, int inFailures, double dMin, double dMax, double dJitter, double dRandom);
+
+#endif /* ECRSRC_ECRLATENCY_H_ */
@@ -0,0 +1,113 @@
+/*
+ * ECRQueue.c
+ *
+ *  Lock-free handoff queues.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "ECRQueue.h"
+
+//MARK: Single producer, single consumer ring
+
+EXPORT int ecrSpscInit(ECR_SPSC_QUEUE *pQueue, int inCapacity)
+{
+	uint32_t ulCapacity = 1;
+
+	memset(pQueue, 0x00, sizeof(ECR_SPSC_QUEUE));
+	while(ulCapacity < (uint32_t)inCapacity && ulCapacity < 0x80000000u)
+		ulCapacity <<= 1;
+
+	pQueue->ppvSlots = (void **)calloc(ulCapacity, sizeof(void *));
+	if(pQueue->ppvSlots == NULL)
+		return -1;
+	pQueue->ulMask = ulCapacity - 1;
+	atomic_init(&pQueue->ulHead, 0);
+	atomic_init(&pQueue->ulTail, 0);
+	return 0;
+}
+
+EXPORT void ecrSpscDestroy(ECR_SPSC_QUEUE *pQueue)
+{
+	free(pQueue->ppvSlots);
+	pQueue->ppvSlots = NULL;
+}
+
+EXPORT int ecrSpscPush(ECR_SPSC_QUEUE *pQueue, void *pvItem)
+{
+	uint32_t ulTail = atomic_load_explicit(&pQueue->ulTail, memory_order_relaxed);
+	uint32_t ulHead = atomic_load_explicit(&pQueue->ulHead, memory_order_acquire);
+
+	if(ulTail - ulHead > pQueue->ulMask)
+		return -1;
+	pQueue->ppvSlots[ulTail & pQueue->ulMask] = pvItem;
+	// Publishes the slot to the consumer
+	atomic_store_explicit(&pQueue->ulTail, ulTail + 1, memory_order_release);
+	return 0;
+}
+
+EXPORT void *ecrSpscPop(ECR_SPSC_QUEUE *pQueue)
+{
+	uint32_t ulHead = atomic_load_explicit(&pQueue->ulHead, memory_order_relaxed);
+	uint32_t ulTail = atomic_load_explicit(&pQueue->ulTail, memory_order_acquire);
+	void *pvItem = NULL;
+
+	if(ulHead == ulTail)
+		return NULL;
+	pvItem = pQueue->ppvSlots[ulHead & pQueue->ulMask];
+	// Hands the slot back to the producer
+	atomic_store_explicit(&pQueue->ulHead, ulHead + 1, memory_order_release);
+	return pvItem;
+}
+
+//MARK: Multiple producer, single consumer list
+
+EXPORT void ecrMpscInit(ECR_MPSC_QUEUE *pQueue)
+{
+	memset(pQueue, 0x00, sizeof(ECR_MPSC_QUEUE));
+	atomic_init(&pQueue->stub.pNext, NULL);
+	atomic_init(&pQueue->pHead, &pQueue->stub);
+	pQueue->pTail = &pQueue->stub;
+}
+
+EXPORT void ecrMpscDestroy(ECR_MPSC_QUEUE *pQueue)
+{
+	while(ecrMpscPop(pQueue) != NULL)
+		;
+	if(pQueue->pTail != &pQueue->stub)
+		free(pQueue->pTail);
+	ecrMpscInit(pQueue);
+}
+
+EXPORT int ecrMpscPush(ECR_MPSC_QUEUE *pQueue, void *pvItem)
+{
+	ECR_MPSC_NODE *pNode = (ECR_MPSC_NODE *)malloc(sizeof(ECR_MPSC_NODE));
+	ECR_MPSC_NODE *pPrev = NULL;
+
+	if(pNode == NULL)
+		return -1;
+	pNode->pvItem = pvItem;
+	atomic_init(&pNode->pNext, NULL);
+
+	// Claim the head, then link the previous head to us; the consumer waits on that link
+	pPrev = atomic_exchange_explicit(&pQueue->pHead, pNode, memory_order_acq_rel);
+	atomic_store_explicit(&pPrev->pNext, pNode, memory_order_release);
+	return 0;
+}
+
+EXPORT void *ecrMpscPop(ECR_MPSC_QUEUE *pQueue)
+{
+	ECR_MPSC_NODE *pTail = pQueue->pTail;
+	ECR_MPSC_NODE *pNext = atomic_load_explicit(&pTail->pNext, memory_order_acquire);
+	void *pvItem = NULL;
+
+	if(pNext == NULL)
+		return NULL;
+
+	// pNext becomes the new dummy; its item is handed out and the old dummy freed
+	pQueue->pTail = pNext;
+	pvItem = pNext->pvItem;
+	pNext->pvItem = NULL;
+	if(pTail != &pQueue->stub)
+		free(pTail);
+	return pvItem;
+}
@@ -0,0 +1,108 @@
+/*
+ * ECRQueue.h
+ *
+ *  Lock-free handoff queues between the socket thread, the decode workers
+ *  and the thread that delivers results.
+ *
+ *  ECR_SPSC_QUEUE  bounded ring, exactly one producer and one consumer thread
+ *  ECR_MPSC_QUEUE  unbounded linked queue, any number of producers and one
+ *                  consumer (Vyukov). Push is wait-free; pop may report empty
+ *                  while a push is half way, the item shows up on the next pop.
+ *
+ *  Items are opaque pointers and are never NULL.
+ */
+
+#ifndef ECRSRC_ECRQUEUE_H_
+#define ECRSRC_ECRQUEUE_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "SBCoreECR.h"
+
+#define ECR_QUEUE_CACHE_LINE			64
+
+typedef struct
+{
+	void **ppvSlots;
+	uint32_t ulMask;
+	char acPad0[ECR_QUEUE_CACHE_LINE];
+	_Atomic uint32_t ulHead;			// Next slot to pop, written by the consumer
+	char acPad1[ECR_QUEUE_CACHE_LINE];
+	_Atomic uint32_t ulTail;			// Next slot to push, written by the producer
+	char acPad2[ECR_QUEUE_CACHE_LINE];
+} ECR_SPSC_QUEUE;
+
+typedef struct ECR_MPSC_NODE
+{
+	struct ECR_MPSC_NODE *_Atomic pNext;
+	void *pvItem;
+} ECR_MPSC_NODE;
+
+typedef struct
+{
+	ECR_MPSC_NODE *_Atomic pHead;		// Last pushed node, swapped by producers
+	char acPad0[ECR_QUEUE_CACHE_LINE];
+	ECR_MPSC_NODE *pTail;				// Consumer side
+	ECR_MPSC_NODE stub;
+} ECR_MPSC_QUEUE;
+
+/*********************************************************************************************
+* @func int | ecrSpscInit |
+* This routine allocates the ring
+*
+* @parm int | inCapacity |
+*       This is the number of slots, rounded up to a power of two
+*
+* @rdesc Returns 0 on success, -1 if memory ran out
+* @end
+**********************************************************************************************/
+EXPORT int ecrSpscInit(ECR_SPSC_QUEUE *pQueue, int inCapacity);
+EXPORT void ecrSpscDestroy(ECR_SPSC_QUEUE *pQueue);
+
+/*********************************************************************************************
+* @func int | ecrSpscPush |
+* This routine appends an item, producer thread only
+*
+* @rdesc Returns 0 on success, -1 if the ring is full
+* @end
+**********************************************************************************************/
+EXPORT int ecrSpscPush(ECR_SPSC_QUEUE *pQueue, void *pvItem);
+
+/*********************************************************************************************
+* @func void * | ecrSpscPop |
+* This routine removes the oldest item, consumer thread only
+*
+* @rdesc Returns the item, NULL if the ring is empty
+* @end
+**********************************************************************************************/
+EXPORT void *ecrSpscPop(ECR_SPSC_QUEUE *pQueue);
+
+EXPORT void ecrMpscInit(ECR_MPSC_QUEUE *pQueue);
+
+/*********************************************************************************************
+* @func void | ecrMpscDestroy |
+* This routine frees the nodes still queued. Their items are not touched, pop them
+* first if they own memory.
+* @end
+**********************************************************************************************/
+EXPORT void ecrMpscDestroy(ECR_MPSC_QUEUE *pQueue);
+
+/*********************************************************************************************
+* @func int | ecrMpscPush |
+* This routine appends an item from any thread
+*
+* @rdesc Returns 0 on success, -1 if no node could be allocated
+* @end
+**********************************************************************************************/
+EXPORT int ecrMpscPush(ECR_MPSC_QUEUE *pQueue, void *pvItem);
+
+/*********************************************************************************************
+* @func void * | ecrMpscPop |
+* This routine removes the oldest item, consumer thread only
+*
+* @rdesc Returns the item, NULL if nothing is ready
+* @end
+**********************************************************************************************/
+EXPORT void *ecrMpscPop(ECR_MPSC_QUEUE *pQueue);
+
+#endif /* ECRSRC_ECRQUEUE_H_ */
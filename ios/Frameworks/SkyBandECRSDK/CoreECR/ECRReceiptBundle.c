@@ -0,0 +1,283 @@
+/*
+ * ECRReceiptBundle.c
+ *
+ *  Memory mapped receipt template bundle.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ECRReceiptBundle.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint32_t ulRead32(const unsigned char *pucIn)
+{
+	return (uint32_t)pucIn[0] | ((uint32_t)pucIn[1] << 8) | ((uint32_t)pucIn[2] << 16) | ((uint32_t)pucIn[3] << 24);
+}
+
+static int inRead16(const unsigned char *pucIn)
+{
+	return pucIn[0] | (pucIn[1] << 8);
+}
+
+// A string in the bundle must lie inside the file and end with its NUL
+static int inIsString(const ECR_RECEIPT_BUNDLE *pBundle, uint32_t ulOffset, uint32_t ulLength)
+{
+	return ulOffset < pBundle->ulSize && ulLength < pBundle->ulSize - ulOffset && pBundle->pucBase[ulOffset + ulLength] == '\0';
+}
+
+static int inIsTable(const ECR_RECEIPT_BUNDLE *pBundle, uint32_t ulOffset, uint32_t ulCount, uint32_t ulEntrySize)
+{
+	return ulOffset >= ECR_RECEIPT_HEADER_SIZE && ulOffset <= pBundle->ulSize
+			&& (unsigned long long)ulCount * ulEntrySize <= pBundle->ulSize - ulOffset;
+}
+
+static int inCheckTemplate(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate)
+{
+	const unsigned char *pucEntry = pBundle->pucIndex + (size_t)inTemplate * ECR_RECEIPT_INDEX_ENTRY_SIZE;
+	uint32_t ulTextLength = ulRead32(pucEntry + 12);
+	uint32_t ulFirst = ulRead32(pucEntry + 16);
+	uint32_t ulCount = ulRead32(pucEntry + 20);
+	ECR_RECEIPT_SEGMENT segment;
+	uint32_t i = 0;
+
+	if(!inIsString(pBundle, ulRead32(pucEntry), ulRead32(pucEntry + 4)) || !inIsString(pBundle, ulRead32(pucEntry + 8), ulTextLength)
+			|| ulFirst > (uint32_t)pBundle->inSegments || ulCount > (uint32_t)pBundle->inSegments - ulFirst)
+		return -1;
+
+	// Names are sorted for ecrReceiptBundleFind
+	if(inTemplate > 0 && strcmp(ecrReceiptBundleName(pBundle, inTemplate - 1), ecrReceiptBundleName(pBundle, inTemplate)) >= 0)
+		return -1;
+
+	for(i = 0; i < ulCount; i++)
+	{
+		ecrReceiptBundleSegment(pBundle, inTemplate, (int)i, &segment);
+		if((uint32_t)segment.inStart + (uint32_t)segment.inLength > ulTextLength
+				|| (segment.inPlaceholder != ECR_RECEIPT_LITERAL && segment.inPlaceholder >= pBundle->inPlaceholders))
+			return -1;
+	}
+	return 0;
+}
+
+static int inCheckBundle(ECR_RECEIPT_BUNDLE *pBundle)
+{
+	const unsigned char *pucHeader = pBundle->pucBase;
+	uint32_t ulTemplates = 0, ulPlaceholders = 0, ulSegments = 0;
+	uint32_t ulIndex = 0, ulPlaceholderTable = 0, ulSegmentTable = 0;
+	int i = 0;
+
+	if(pBundle->ulSize < ECR_RECEIPT_HEADER_SIZE || memcmp(pucHeader, ECR_RECEIPT_MAGIC, 4) != 0
+			|| inRead16(pucHeader + 4) != ECR_RECEIPT_VERSION)
+		return -1;
+
+	ulTemplates = ulRead32(pucHeader + 8);
+	ulPlaceholders = ulRead32(pucHeader + 12);
+	ulSegments = ulRead32(pucHeader + 16);
+	ulIndex = ulRead32(pucHeader + 20);
+	ulPlaceholderTable = ulRead32(pucHeader + 24);
+	ulSegmentTable = ulRead32(pucHeader + 28);
+	if(ulTemplates > 0xFFFF || ulPlaceholders >= ECR_RECEIPT_LITERAL || ulSegments > 0x7FFFFFFF
+			|| !inIsTable(pBundle, ulIndex, ulTemplates, ECR_RECEIPT_INDEX_ENTRY_SIZE)
+			|| !inIsTable(pBundle, ulPlaceholderTable, ulPlaceholders, ECR_RECEIPT_PLACEHOLDER_SIZE)
+			|| !inIsTable(pBundle, ulSegmentTable, ulSegments, ECR_RECEIPT_SEGMENT_SIZE))
+		return -1;
+
+	pBundle->inTemplates = (int)ulTemplates;
+	pBundle->inPlaceholders = (int)ulPlaceholders;
+	pBundle->inSegments = (int)ulSegments;
+	pBundle->pucIndex = pBundle->pucBase + ulIndex;
+	pBundle->pucPlaceholders = pBundle->pucBase + ulPlaceholderTable;
+	pBundle->pucSegments = pBundle->pucBase + ulSegmentTable;
+
+	for(i = 0; i < pBundle->inPlaceholders; i++)
+	{
+		const unsigned char *pucEntry = pBundle->pucPlaceholders + (size_t)i * ECR_RECEIPT_PLACEHOLDER_SIZE;
+		if(!inIsString(pBundle, ulRead32(pucEntry), ulRead32(pucEntry + 4)))
+			return -1;
+	}
+	for(i = 0; i < pBundle->inTemplates; i++)
+	{
+		if(inCheckTemplate(pBundle, i) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+#ifndef _WIN32
+static int inMapFile(ECR_RECEIPT_BUNDLE *pBundle, const char *pszPath)
+{
+	struct stat st;
+	void *pvMap = MAP_FAILED;
+	int fd = open(pszPath, O_RDONLY);
+
+	if(fd < 0)
+		return -1;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+		pvMap = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(pvMap == MAP_FAILED)
+		return -1;
+
+	pBundle->pucBase = (const unsigned char *)pvMap;
+	pBundle->ulSize = (size_t)st.st_size;
+	pBundle->inMapped = 1;
+	return 0;
+}
+#else
+static int inMapFile(ECR_RECEIPT_BUNDLE *pBundle, const char *pszPath)
+{
+	FILE *fp = fopen(pszPath, "rb");
+	unsigned char *pucData = NULL;
+	long lSize = 0;
+
+	if(fp == NULL)
+		return -1;
+	if(fseek(fp, 0, SEEK_END) == 0)
+		lSize = ftell(fp);
+	if(lSize > 0 && fseek(fp, 0, SEEK_SET) == 0)
+		pucData = (unsigned char *)malloc((size_t)lSize);
+	if(pucData != NULL && fread(pucData, 1, (size_t)lSize, fp) != (size_t)lSize)
+	{
+		free(pucData);
+		pucData = NULL;
+	}
+	fclose(fp);
+	if(pucData == NULL)
+		return -1;
+
+	pBundle->pucBase = pucData;
+	pBundle->ulSize = (size_t)lSize;
+	return 0;
+}
+#endif
+
+EXPORT int ecrReceiptBundleOpen(ECR_RECEIPT_BUNDLE *pBundle, const char *pszPath)
+{
+	memset(pBundle, 0x00, sizeof(ECR_RECEIPT_BUNDLE));
+	if(inMapFile(pBundle, pszPath) != 0)
+		return -1;
+	if(inCheckBundle(pBundle) != 0)
+	{
+		ecrReceiptBundleClose(pBundle);
+		return -1;
+	}
+	return 0;
+}
+
+EXPORT void ecrReceiptBundleClose(ECR_RECEIPT_BUNDLE *pBundle)
+{
+	if(pBundle->pucBase != NULL)
+	{
+#ifndef _WIN32
+		if(pBundle->inMapped)
+			munmap((void *)pBundle->pucBase, pBundle->ulSize);
+		else
+#endif
+			free((void *)pBundle->pucBase);
+	}
+	memset(pBundle, 0x00, sizeof(ECR_RECEIPT_BUNDLE));
+}
+
+EXPORT const char *ecrReceiptBundleName(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate)
+{
+	const unsigned char *pucEntry = pBundle->pucIndex + (size_t)inTemplate * ECR_RECEIPT_INDEX_ENTRY_SIZE;
+
+	return (const char *)pBundle->pucBase + ulRead32(pucEntry);
+}
+
+EXPORT int ecrReceiptBundleFind(const ECR_RECEIPT_BUNDLE *pBundle, const char *pszName)
+{
+	int inLow = 0, inHigh = pBundle->inTemplates - 1;
+
+	while(inLow <= inHigh)
+	{
+		int inMid = inLow + (inHigh - inLow) / 2;
+		int inCompare = strcmp(pszName, ecrReceiptBundleName(pBundle, inMid));
+
+		if(inCompare == 0)
+			return inMid;
+		if(inCompare < 0)
+			inHigh = inMid - 1;
+		else
+			inLow = inMid + 1;
+	}
+	return -1;
+}
+
+EXPORT const char *ecrReceiptBundleText(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, int *pinLength)
+{
+	const unsigned char *pucEntry = pBundle->pucIndex + (size_t)inTemplate * ECR_RECEIPT_INDEX_ENTRY_SIZE;
+
+	if(pinLength != NULL)
+		*pinLength = (int)ulRead32(pucEntry + 12);
+	return (const char *)pBundle->pucBase + ulRead32(pucEntry + 8);
+}
+
+EXPORT const char *ecrReceiptBundlePlaceholder(const ECR_RECEIPT_BUNDLE *pBundle, int inPlaceholder, int *pinLength)
+{
+	const unsigned char *pucEntry = pBundle->pucPlaceholders + (size_t)inPlaceholder * ECR_RECEIPT_PLACEHOLDER_SIZE;
+
+	if(pinLength != NULL)
+		*pinLength = (int)ulRead32(pucEntry + 4);
+	return (const char *)pBundle->pucBase + ulRead32(pucEntry);
+}
+
+EXPORT int ecrReceiptBundleSegmentCount(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate)
+{
+	return (int)ulRead32(pBundle->pucIndex + (size_t)inTemplate * ECR_RECEIPT_INDEX_ENTRY_SIZE + 20);
+}
+
+EXPORT void ecrReceiptBundleSegment(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, int inSegment, ECR_RECEIPT_SEGMENT *pSegment)
+{
+	uint32_t ulFirst = ulRead32(pBundle->pucIndex + (size_t)inTemplate * ECR_RECEIPT_INDEX_ENTRY_SIZE + 16);
+	const unsigned char *pucSegment = pBundle->pucSegments + (size_t)(ulFirst + (uint32_t)inSegment) * ECR_RECEIPT_SEGMENT_SIZE;
+
+	pSegment->inStart = (int)ulRead32(pucSegment);
+	pSegment->inLength = inRead16(pucSegment + 4);
+	pSegment->inPlaceholder = inRead16(pucSegment + 6);
+}
+
+EXPORT int ecrReceiptBundleRender(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, ECR_RECEIPT_VALUE pfnValue,
+		void *pvContext, char *pszOut, int inCapacity)
+{
+	const char *pszText = ecrReceiptBundleText(pBundle, inTemplate, NULL);
+	int inSegments = ecrReceiptBundleSegmentCount(pBundle, inTemplate);
+	ECR_RECEIPT_SEGMENT segment;
+	int inLength = 0;
+	int i = 0;
+
+	for(i = 0; i < inSegments; i++)
+	{
+		const char *pszValue = NULL;
+		int inValueLength = 0;
+
+		ecrReceiptBundleSegment(pBundle, inTemplate, i, &segment);
+		pszValue = &pszText[segment.inStart];
+		inValueLength = segment.inLength;
+		if(segment.inPlaceholder != ECR_RECEIPT_LITERAL && pfnValue != NULL)
+		{
+			int inFilledLength = 0;
+			const char *pszFilled = pfnValue(pvContext, segment.inPlaceholder, &inFilledLength);
+
+			if(pszFilled != NULL)
+			{
+				pszValue = pszFilled;
+				inValueLength = inFilledLength;
+			}
+		}
+
+		if(inValueLength >= inCapacity - inLength)
+			return -1;
+		memcpy(&pszOut[inLength], pszValue, (size_t)inValueLength);
+		inLength += inValueLength;
+	}
+	if(inCapacity <= inLength)
+		return -1;
+	pszOut[inLength] = '\0';
+	return inLength;
+}
@@ -0,0 +1,120 @@
+/*
+ * ECRReceiptBundle.h
+ *
+ *  Read only access to the receipt template bundle that tool/receipt_bundle.c
+ *  compiles from the SKBTransactionRecipts HTML files at build time. The file is mapped
+ *  once; templates are read in place.
+ *
+ *  Bundle file (little endian, all offsets from the start of the file):
+ *    [0..3]   "SBRB"
+ *    [4..5]   version
+ *    [6..7]   reserved
+ *    [8..11]  templates
+ *    [12..15] placeholders
+ *    [16..19] segments
+ *    [20..23] template index offset
+ *    [24..27] placeholder table offset
+ *    [28..31] segment table offset
+ *  followed by
+ *    templates    x { name offset, name length, text offset, text length,
+ *                     first segment, segment count }   (uint32 each, sorted by name)
+ *    placeholders x { offset, length }                 (uint32 each)
+ *    segments     x { start, length (uint16),
+ *                     placeholder (uint16, ECR_RECEIPT_LITERAL for text) }
+ *    strings, each NUL terminated
+ *
+ *  A template's segments cover its text in order. At every position the longest
+ *  known placeholder is taken; everything else is literal.
+ */
+
+#ifndef ECRSRC_ECRRECEIPTBUNDLE_H_
+#define ECRSRC_ECRRECEIPTBUNDLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SBCoreECR.h"
+
+#define ECR_RECEIPT_MAGIC				"SBRB"
+#define ECR_RECEIPT_VERSION				1
+#define ECR_RECEIPT_HEADER_SIZE			32
+#define ECR_RECEIPT_INDEX_ENTRY_SIZE	24
+#define ECR_RECEIPT_PLACEHOLDER_SIZE	8
+#define ECR_RECEIPT_SEGMENT_SIZE		8
+#define ECR_RECEIPT_LITERAL				0xFFFF
+
+typedef struct
+{
+	const unsigned char *pucBase;
+	size_t ulSize;
+	int inMapped;						// 0 if the file was read into memory instead
+	int inTemplates;
+	int inPlaceholders;
+	int inSegments;
+	const unsigned char *pucIndex;
+	const unsigned char *pucPlaceholders;
+	const unsigned char *pucSegments;
+} ECR_RECEIPT_BUNDLE;
+
+typedef struct
+{
+	int inStart;						// Offset in the template text
+	int inLength;
+	int inPlaceholder;					// ECR_RECEIPT_LITERAL for literal text
+} ECR_RECEIPT_SEGMENT;
+
+/*********************************************************************************************
+* @func const char * | ECR_RECEIPT_VALUE |
+* Callback giving the value of a placeholder while rendering
+*
+* @rdesc Returns the value and sets *pinLength, or NULL to keep the placeholder text
+* @end
+**********************************************************************************************/
+typedef const char *(*ECR_RECEIPT_VALUE)(void *pvContext, int inPlaceholder, int *pinLength);
+
+/*********************************************************************************************
+* @func int | ecrReceiptBundleOpen |
+* This routine maps a bundle and checks every table entry lies inside the file
+*
+* @rdesc Returns 0 on success, -1 on an I/O or format error
+* @end
+**********************************************************************************************/
+EXPORT int ecrReceiptBundleOpen(ECR_RECEIPT_BUNDLE *pBundle, const char *pszPath);
+EXPORT void ecrReceiptBundleClose(ECR_RECEIPT_BUNDLE *pBundle);
+
+/*********************************************************************************************
+* @func int | ecrReceiptBundleFind |
+* This routine looks a template up by file name without ".html"
+*
+* @rdesc Returns the template index, -1 if there is none
+* @end
+**********************************************************************************************/
+EXPORT int ecrReceiptBundleFind(const ECR_RECEIPT_BUNDLE *pBundle, const char *pszName);
+
+EXPORT const char *ecrReceiptBundleName(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate);
+
+/*********************************************************************************************
+* @func const char * | ecrReceiptBundleText |
+* This routine gives the UTF-8 text of a template, NUL terminated, inside the mapping
+* @end
+**********************************************************************************************/
+EXPORT const char *ecrReceiptBundleText(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, int *pinLength);
+
+EXPORT const char *ecrReceiptBundlePlaceholder(const ECR_RECEIPT_BUNDLE *pBundle, int inPlaceholder, int *pinLength);
+
+EXPORT int ecrReceiptBundleSegmentCount(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate);
+EXPORT void ecrReceiptBundleSegment(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, int inSegment, ECR_RECEIPT_SEGMENT *pSegment);
+
+/*********************************************************************************************
+* @func int | ecrReceiptBundleRender |
+* This routine writes a template with its placeholders filled from pfnValue
+*
+* @parm char * | pszOut |
+*       This is the output, NUL terminated
+*
+* @rdesc Returns the rendered length, -1 if it does not fit inCapacity
+* @end
+**********************************************************************************************/
+EXPORT int ecrReceiptBundleRender(const ECR_RECEIPT_BUNDLE *pBundle, int inTemplate, ECR_RECEIPT_VALUE pfnValue,
+		void *pvContext, char *pszOut, int inCapacity);
+
+#endif /* ECRSRC_ECRRECEIPTBUNDLE_H_ */
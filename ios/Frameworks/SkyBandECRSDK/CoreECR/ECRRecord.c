@@ -0,0 +1,100 @@
+/*
+ * ECRRecord.c
+ *
+ *  Compact binary record for decoded terminal responses.
+ */
+#include <string.h>
+#include "ECRRecord.h"
+
+static void vdPutU16(unsigned char *pucOut, int inValue)
+{
+	pucOut[0] = (unsigned char)(inValue & 0xFF);
+	pucOut[1] = (unsigned char)((inValue >> 8) & 0xFF);
+}
+
+EXPORT void ecrRecordBegin(ECR_RECORD *pRecord, unsigned char *pucBuffer, int inCapacity, int transactionType)
+{
+	memset(pRecord, 0x00, sizeof(ECR_RECORD));
+	pRecord->pucBuffer = pucBuffer;
+	pRecord->inCapacity = inCapacity;
+
+	if(inCapacity < ECR_RECORD_HEADER_SIZE)
+	{
+		pRecord->inOverflow = 1;
+		return;
+	}
+	memcpy(pucBuffer, ECR_RECORD_MAGIC, 2);
+	pucBuffer[2] = ECR_RECORD_VERSION;
+	pucBuffer[3] = 0;
+	vdPutU16(&pucBuffer[4], transactionType);
+	vdPutU16(&pucBuffer[6], 0);
+	pRecord->inLength = ECR_RECORD_HEADER_SIZE;
+}
+
+EXPORT int ecrRecordPutString(ECR_RECORD *pRecord, int fieldId, const char *pszValue, int inLength)
+{
+	unsigned char *pucOut;
+
+	if(pRecord->inOverflow || inLength < 0 || inLength > ECR_RECORD_MAX_STRING
+			|| pRecord->inLength + 4 + inLength > pRecord->inCapacity)
+	{
+		pRecord->inOverflow = 1;
+		return -1;
+	}
+	pucOut = &pRecord->pucBuffer[pRecord->inLength];
+	pucOut[0] = (unsigned char)fieldId;
+	pucOut[1] = ECR_RECORD_KIND_STRING;
+	vdPutU16(&pucOut[2], inLength);
+	memcpy(&pucOut[4], pszValue, inLength);
+	pRecord->inLength += 4 + inLength;
+	pRecord->inFieldsCount++;
+	return 0;
+}
+
+EXPORT int ecrRecordPutAmount(ECR_RECORD *pRecord, int fieldId, long long llAmount)
+{
+	unsigned char *pucOut;
+	unsigned long long ullValue = (unsigned long long)llAmount;
+	int i = 0;
+
+	if(pRecord->inOverflow || pRecord->inLength + 10 > pRecord->inCapacity)
+	{
+		pRecord->inOverflow = 1;
+		return -1;
+	}
+	pucOut = &pRecord->pucBuffer[pRecord->inLength];
+	pucOut[0] = (unsigned char)fieldId;
+	pucOut[1] = ECR_RECORD_KIND_AMOUNT;
+	for(i = 0; i < 8; i++)
+		pucOut[2 + i] = (unsigned char)((ullValue >> (8 * i)) & 0xFF);
+	pRecord->inLength += 10;
+	pRecord->inFieldsCount++;
+	return 0;
+}
+
+EXPORT int ecrRecordFinish(ECR_RECORD *pRecord, int inFlags)
+{
+	if(pRecord->inOverflow)
+		return -1;
+	pRecord->pucBuffer[3] = (unsigned char)inFlags;
+	vdPutU16(&pRecord->pucBuffer[6], pRecord->inFieldsCount);
+	return pRecord->inLength;
+}
+
+EXPORT int ecrAmountToMinorUnits(const char *pszAmount, int inLength, long long *pllAmount)
+{
+	long long llValue = 0;
+	int i = 0;
+
+	// 18 digits always fit in a signed 64 bit value
+	if(inLength <= 0 || inLength > 18)
+		return -1;
+	for(i = 0; i < inLength; i++)
+	{
+		if(pszAmount[i] < '0' || pszAmount[i] > '9')
+			return -1;
+		llValue = (llValue * 10) + (pszAmount[i] - '0');
+	}
+	*pllAmount = llValue;
+	return 0;
+}
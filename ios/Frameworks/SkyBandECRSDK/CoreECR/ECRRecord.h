@@ -0,0 +1,134 @@
+/*
+ * ECRRecord.h
+ *
+ *  Compact binary record for decoded terminal responses.
+ *
+ *  Layout (little endian):
+ *    [0]    'S'
+ *    [1]    'B'
+ *    [2]    version
+ *    [3]    flags (ECR_RECORD_FLAG_*)
+ *    [4..5] transaction type
+ *    [6..7] number of fields
+ *  followed by one entry per field:
+ *    [0]    field id (ECR_RECORD_FIELD)
+ *    [1]    kind (ECR_RECORD_KIND_*)
+ *    STRING: [2..3] byte length, then UTF-8 bytes
+ *    AMOUNT: [2..9] signed 64 bit amount in minor units
+ */
+
+#ifndef ECRSRC_ECRRECORD_H_
+#define ECRSRC_ECRRECORD_H_
+
+#include "SBCoreECR.h"
+
+#define ECR_RECORD_MAGIC				"SB"
+#define ECR_RECORD_VERSION				1
+#define ECR_RECORD_HEADER_SIZE			8
+#define ECR_RECORD_MAX_STRING			0xFFFF
+
+#define ECR_RECORD_FLAG_RECEIPT			0x01	// Receipt is available through a separate fetch
+
+#define ECR_RECORD_KIND_STRING			0
+#define ECR_RECORD_KIND_AMOUNT			1
+
+/* Field ids are part of the wire format: append only, never renumber. */
+typedef enum
+{
+	ECR_FLD_TRAN_TYPE = 1, ECR_FLD_RESPONSE_CODE, ECR_FLD_RESPONSE_MESSAGE, ECR_FLD_RESPONSE_MESSAGE_ALT, ECR_FLD_PAN_NUMBER,
+	ECR_FLD_PAN_NO, ECR_FLD_TRAN_AMOUNT, ECR_FLD_CASHBACK_AMOUNT, ECR_FLD_TOTAL_AMOUNT, ECR_FLD_BUSS_CODE,
+	ECR_FLD_STAN_NO, ECR_FLD_DATE_TIME, ECR_FLD_DATE_TIME_ALT, ECR_FLD_DATE_TIME_STAMP, ECR_FLD_CARD_EXP_DATE,
+	ECR_FLD_RRN, ECR_FLD_AUTH_CODE, ECR_FLD_TID, ECR_FLD_MID, ECR_FLD_BATCH_NO,
+	ECR_FLD_AID, ECR_FLD_APP_CRYPTOGRAM, ECR_FLD_CID, ECR_FLD_CVR, ECR_FLD_TVR,
+	ECR_FLD_TSI, ECR_FLD_KERNEL_ID, ECR_FLD_PAR, ECR_FLD_PAN_SUFFIX, ECR_FLD_CARD_ENTRY_MODE,
+	ECR_FLD_MERCHANT_CATEGORY_CODE, ECR_FLD_TERM_TRAN_TYPE, ECR_FLD_SCHEME_LABEL, ECR_FLD_PRODUCT_INFO, ECR_FLD_APP_VERSION,
+	ECR_FLD_DISCLAIMER, ECR_FLD_MERCHANT_NAME, ECR_FLD_MERCHANT_ADDRESS, ECR_FLD_MERCHANT_NAME_ARABIC, ECR_FLD_MERCHANT_ADDRESS_ARABIC,
+	ECR_FLD_ECR_REF_NUM, ECR_FLD_SIGNATURE, ECR_FLD_TERMINAL_ID, ECR_FLD_VENDOR_ID, ECR_FLD_VENDOR_TERM_TYPE,
+	ECR_FLD_TRSM_ID, ECR_FLD_VENDOR_KEY_INDEX, ECR_FLD_SAMA_KEY_INDEX, ECR_FLD_VENDOR_ID_ALT, ECR_FLD_VENDOR_TERM_TYPE_ALT,
+	ECR_FLD_TRSM_ID_ALT, ECR_FLD_VENDOR_KEY_INDEX_ALT, ECR_FLD_SAMA_KEY_INDEX_ALT, ECR_FLD_POS_REF_NUM, ECR_FLD_TRACE_NUMBER,
+	ECR_FLD_MERCHANT_ID, ECR_FLD_TOTAL_SCHEME_LENGTH, ECR_FLD_SCHEMES, ECR_FLD_DEADLINE_OUTCOME, ECR_FLD_RESOLVED_BY,
+	ECR_FLD_CHECK_STATUS_RESPONSE_CODE, ECR_FLD_IDEMPOTENCY_REPLAY, ECR_FLD_REQUEST_REF_NUM, ECR_FLD_REQUEST_ERROR
+} ECR_RECORD_FIELD;
+
+typedef struct
+{
+	unsigned char *pucBuffer;
+	int inCapacity;
+	int inLength;
+	int inFieldsCount;
+	int inOverflow;
+} ECR_RECORD;
+
+/*********************************************************************************************
+* @func void | ecrRecordBegin |
+* This routine starts a new record in the caller supplied buffer
+*
+* @parm ECR_RECORD * | pRecord |
+*       This is the record state to initialise
+*
+* @parm unsigned char * | pucBuffer |
+*       This is the output buffer
+*
+* @parm int | inCapacity |
+*       This is the size of the output buffer
+*
+* @parm int | transactionType |
+*       This is the transaction type of the response
+*
+* @rdesc Returns nothing
+* @end
+**********************************************************************************************/
+EXPORT void ecrRecordBegin(ECR_RECORD *pRecord, unsigned char *pucBuffer, int inCapacity, int transactionType);
+
+/*********************************************************************************************
+* @func int | ecrRecordPutString |
+* This routine appends a string field to the record
+*
+* @parm int | fieldId |
+*       This is the ECR_RECORD_FIELD id
+*
+* @parm const char * | pszValue |
+*       This is the UTF-8 value
+*
+* @parm int | inLength |
+*       This is the value length in bytes
+*
+* @rdesc Returns 0 on success, -1 if the buffer is too small
+* @end
+**********************************************************************************************/
+EXPORT int ecrRecordPutString(ECR_RECORD *pRecord, int fieldId, const char *pszValue, int inLength);
+
+/*********************************************************************************************
+* @func int | ecrRecordPutAmount |
+* This routine appends an amount field (minor units) to the record
+*
+* @rdesc Returns 0 on success, -1 if the buffer is too small
+* @end
+**********************************************************************************************/
+EXPORT int ecrRecordPutAmount(ECR_RECORD *pRecord, int fieldId, long long llAmount);
+
+/*********************************************************************************************
+* @func int | ecrRecordFinish |
+* This routine writes the field count and flags into the record header
+*
+* @parm int | inFlags |
+*       This is a combination of ECR_RECORD_FLAG_* values
+*
+* @rdesc Returns the record length, -1 if any field did not fit
+* @end
+**********************************************************************************************/
+EXPORT int ecrRecordFinish(ECR_RECORD *pRecord, int inFlags);
+
+/*********************************************************************************************
+* @func int | ecrAmountToMinorUnits |
+* This routine converts a terminal amount field ("000000001050") into minor units
+*
+* @parm long long * | pllAmount |
+*       This is the parsed amount
+*
+* @rdesc Returns 0 on success, -1 if the field is not a plain digit string
+* @end
+**********************************************************************************************/
+EXPORT int ecrAmountToMinorUnits(const char *pszAmount, int inLength, long long *pllAmount);
+
+#endif /* ECRSRC_ECRRECORD_H_ */
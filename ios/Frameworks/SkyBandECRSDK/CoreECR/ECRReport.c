@@ -0,0 +1,111 @@
+/*
+ * ECRReport.c
+ *
+ *  Page decoding of the Print Summary Report (C1).
+ */
+#include <string.h>
+#include "ECRReport.h"
+
+#define REPORT_CODE_FIELD				2
+#define REPORT_MESSAGE_FIELD			3
+#define REPORT_ROWS_FIELD				4
+#define REPORT_FIRST_ROW_FIELD			5
+
+static const char *pszField(const char *pszResponse, int inIndex, int *pinLength)
+{
+	const char *pszStart = pszResponse;
+	const char *pszEnd = NULL;
+
+	while(inIndex-- > 0)
+	{
+		pszStart = strchr(pszStart, DELIMITOR_CHAR);
+		if(pszStart == NULL)
+			return NULL;
+		pszStart++;
+	}
+	pszEnd = strchr(pszStart, DELIMITOR_CHAR);
+	*pinLength = pszEnd ? (int)(pszEnd - pszStart) : (int)strlen(pszStart);
+	return pszStart;
+}
+
+static void vdCopyField(char *pszOut, const char *pszValue, int inLength)
+{
+	if(inLength >= ECR_REPORT_FIELD_SIZE)
+		inLength = ECR_REPORT_FIELD_SIZE - 1;
+	memcpy(pszOut, pszValue, (size_t)inLength);
+	pszOut[inLength] = 0x00;
+}
+
+void ecrReportInit(ECR_REPORT_STREAM *pStream)
+{
+	memset(pStream, 0x00, sizeof(ECR_REPORT_STREAM));
+}
+
+int ecrReportDecodePage(ECR_REPORT_STREAM *pStream, const char *pszResponse, ECR_REPORT_ROW_FN pfnRow, void *pvContext)
+{
+	ECR_REPORT_ROW row;
+	const char *pszValue = NULL;
+	const char *pszNext = NULL;
+	int inLength = 0;
+	int inFields = 1;
+	int inRows = 0;
+	int inDeclared = 0;
+	int i = 0;
+	int j = 0;
+
+	pStream->inRows = 0;
+	pStream->szResponseCode[0] = 0x00;
+	pStream->szResponseMessage[0] = 0x00;
+
+	for(pszValue = pszResponse; (pszValue = strchr(pszValue, DELIMITOR_CHAR)) != NULL; pszValue++)
+		inFields++;
+	if(inFields <= REPORT_ROWS_FIELD)
+	{
+		if((pszValue = pszField(pszResponse, REPORT_CODE_FIELD, &inLength)) != NULL)
+			vdCopyField(pStream->szResponseCode, pszValue, inLength);
+		if((pszValue = pszField(pszResponse, REPORT_MESSAGE_FIELD, &inLength)) != NULL)
+			vdCopyField(pStream->szResponseMessage, pszValue, inLength);
+		return ECR_REPORT_ERROR;
+	}
+	pszValue = pszField(pszResponse, REPORT_CODE_FIELD, &inLength);
+	vdCopyField(pStream->szResponseCode, pszValue, inLength);
+	pszValue = pszField(pszResponse, REPORT_MESSAGE_FIELD, &inLength);
+	vdCopyField(pStream->szResponseMessage, pszValue, inLength);
+
+	// Rows are the whole nine field groups after the row count; some terminals put the
+	// date time there instead, so it only limits them when it looks like a count
+	inRows = (inFields - REPORT_FIRST_ROW_FIELD) / ECR_REPORT_ROW_FIELDS;
+	pszValue = pszField(pszResponse, REPORT_ROWS_FIELD, &inLength);
+	if(inLength > 0 && inLength <= REQATTEMPTNUM_SIZE)
+	{
+		for(i = 0; i < inLength && pszValue[i] >= '0' && pszValue[i] <= '9'; i++)
+			inDeclared = inDeclared * 10 + (pszValue[i] - '0');
+		if(i == inLength && inDeclared < inRows)
+			inRows = inDeclared;
+	}
+	if(inRows <= 0)
+		return ECR_REPORT_END;
+
+	// An attempt past the end gets the last page again
+	pszValue = pszField(pszResponse, REPORT_FIRST_ROW_FIELD + (inRows - 1) * ECR_REPORT_ROW_FIELDS + ECR_REPORT_NUMBER, &inLength);
+	if(pStream->lnTotalRows > 0 && inLength == (int)strlen(pStream->szLastNumber)
+			&& memcmp(pszValue, pStream->szLastNumber, (size_t)inLength) == 0)
+		return ECR_REPORT_END;
+	vdCopyField(pStream->szLastNumber, pszValue, inLength);
+
+	pszNext = pszField(pszResponse, REPORT_FIRST_ROW_FIELD, &inLength);
+	for(i = 0; i < inRows; i++)
+	{
+		for(j = 0; j < ECR_REPORT_ROW_FIELDS; j++)
+		{
+			row.apszField[j] = pszNext;
+			row.aiLength[j] = inLength;
+			pszNext = pszField(pszNext, 1, &inLength);
+		}
+		if(pfnRow != NULL)
+			pfnRow(pvContext, &row);
+	}
+	pStream->inRows = inRows;
+	pStream->lnTotalRows += inRows;
+	return ECR_REPORT_MORE;
+}
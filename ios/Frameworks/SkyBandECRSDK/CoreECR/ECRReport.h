@@ -0,0 +1,79 @@
+/*
+ * ECRReport.h
+ *
+ *  Page decoding of the Print Summary Report (C1). The report comes one page
+ *  per request attempt (REQATTEMPTNUM_SIZE digits, from 1); after parse() a
+ *  page reads
+ *
+ *    ... ; response code ; response message ; rows ; row 1 ; ... ; row n ; ...
+ *
+ *  with nine fields a row: transaction type, date, RRN, amount, state, time,
+ *  PAN, approval code and transaction number. A page is decoded in place and
+ *  its rows handed out one at a time, so nothing beyond the response buffer is
+ *  held. Pages carry no "last page" mark: the report ends with a page without
+ *  rows, or with a page that repeats the previous one, which terminals send
+ *  for an attempt past the end.
+ */
+
+#ifndef ECRSRC_ECRREPORT_H_
+#define ECRSRC_ECRREPORT_H_
+
+#include "SBCoreECR.h"
+#include "ECRSrc.h"
+
+#define ECR_REPORT_ROW_FIELDS			9
+#define ECR_REPORT_FIELD_SIZE			32
+#define ECR_REPORT_ATTEMPT_MAX			999		// REQATTEMPTNUM_SIZE digits
+
+#define ECR_REPORT_MORE					1		// Rows delivered, request the next attempt
+#define ECR_REPORT_END					0
+#define ECR_REPORT_ERROR				-1		// The terminal answered without a report page
+
+typedef enum
+{
+	ECR_REPORT_TYPE = 0,
+	ECR_REPORT_DATE,
+	ECR_REPORT_RRN,
+	ECR_REPORT_AMOUNT,
+	ECR_REPORT_STATE,
+	ECR_REPORT_TIME,
+	ECR_REPORT_PAN,
+	ECR_REPORT_AUTH_CODE,
+	ECR_REPORT_NUMBER
+} ECR_REPORT_FIELD;
+
+typedef struct
+{
+	const char *apszField[ECR_REPORT_ROW_FIELDS];	// Into the response, not terminated
+	int aiLength[ECR_REPORT_ROW_FIELDS];
+} ECR_REPORT_ROW;
+
+typedef struct
+{
+	char szResponseCode[ECR_REPORT_FIELD_SIZE];
+	char szResponseMessage[ECR_REPORT_FIELD_SIZE];
+	char szLastNumber[ECR_REPORT_FIELD_SIZE];		// Transaction number of the last row delivered
+	int inRows;										// Of the last page
+	long lnTotalRows;
+} ECR_REPORT_STREAM;
+
+typedef void (*ECR_REPORT_ROW_FN)(void *pvContext, const ECR_REPORT_ROW *pRow);
+
+EXPORT void ecrReportInit(ECR_REPORT_STREAM *pStream);
+
+/*********************************************************************************************
+* @func int | ecrReportDecodePage |
+* This routine decodes one C1 page and calls pfnRow for each of its rows, in order
+*
+* @parm const char * | pszResponse |
+*       This is the response after parse(), fields separated by ';'
+*
+* @rdesc Returns ECR_REPORT_MORE, ECR_REPORT_END without calling pfnRow for an empty or
+*        repeated page, ECR_REPORT_ERROR if the response is not a report page; the
+*        response code and message are kept in pStream either way
+* @end
+**********************************************************************************************/
+EXPORT int ecrReportDecodePage(ECR_REPORT_STREAM *pStream, const char *pszResponse, ECR_REPORT_ROW_FN pfnRow,
+		void *pvContext);
+
+#endif /* ECRSRC_ECRREPORT_H_ */
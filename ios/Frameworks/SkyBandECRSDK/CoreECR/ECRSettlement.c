@@ -0,0 +1,622 @@
+/*
+ * ECRSettlement.c
+ *
+ *  Columnar scheme totals decoded from Reconciliation (B1) replies.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ECRSettlement.h"
+#include "ECRRecord.h"
+
+#define ECR_SETTLEMENT_MAX_FIELDS		1024
+#define ECR_SETTLEMENT_SCHEME_COUNT		9		// Field holding the number of schemes
+#define ECR_SETTLEMENT_HOST_BLOCK		15		// Name, flag, host, 6 count/amount pairs
+#define ECR_SETTLEMENT_POS_BLOCK		14		// Flag, label, 6 count/amount pairs
+#define ECR_SETTLEMENT_PAIRS			6
+
+typedef struct
+{
+	const char *pszValue;
+	int inLength;
+} ECR_FIELD;
+
+static const uint8_t aucHostKinds[ECR_SETTLEMENT_PAIRS] =
+{
+	ECR_KIND_DEBIT, ECR_KIND_CREDIT, ECR_KIND_NAQD, ECR_KIND_CADV, ECR_KIND_AUTH, ECR_KIND_TOTAL
+};
+
+static const uint8_t aucPosDetailKinds[ECR_SETTLEMENT_PAIRS] =
+{
+	ECR_KIND_POFF, ECR_KIND_PON, ECR_KIND_NAQD, ECR_KIND_REVERSAL, ECR_KIND_REFUND, ECR_KIND_COMP
+};
+
+static const char *aszSourceNames[] = { "host", "pos", "pos_details" };
+static const char *aszKindNames[] =
+{
+	"debit", "credit", "naqd", "cadv", "auth", "total", "poff", "pon", "reversal", "refund", "comp"
+};
+
+EXPORT const char *ecrSettlementSourceName(int inSource)
+{
+	if(inSource < 0 || inSource >= (int)(sizeof(aszSourceNames) / sizeof(aszSourceNames[0])))
+		return "";
+	return aszSourceNames[inSource];
+}
+
+EXPORT const char *ecrSettlementKindName(int inKind)
+{
+	if(inKind < 0 || inKind >= (int)(sizeof(aszKindNames) / sizeof(aszKindNames[0])))
+		return "";
+	return aszKindNames[inKind];
+}
+
+//MARK: Storage
+
+EXPORT void ecrSettlementInit(ECR_SETTLEMENT_COLUMNS *pColumns)
+{
+	memset(pColumns, 0x00, sizeof(ECR_SETTLEMENT_COLUMNS));
+}
+
+EXPORT void ecrSettlementFree(ECR_SETTLEMENT_COLUMNS *pColumns)
+{
+	free(pColumns->pllAmount);
+	free(pColumns->pulSettlement);
+	free(pColumns->pulCount);
+	free(pColumns->pusScheme);
+	free(pColumns->pucSource);
+	free(pColumns->pucKind);
+	free(pColumns->pSettlements);
+	free(pColumns->pszSchemes);
+	ecrSettlementInit(pColumns);
+}
+
+static int inGrow(void **ppv, int inCapacity, size_t width)
+{
+	void *pv = realloc(*ppv, (size_t)inCapacity * width);
+
+	if(pv == NULL)
+		return -1;
+	*ppv = pv;
+	return 0;
+}
+
+static int inReserveRows(ECR_SETTLEMENT_COLUMNS *pColumns, int inRows)
+{
+	int inCapacity = pColumns->inRowCapacity;
+
+	if(pColumns->inRows + inRows <= inCapacity)
+		return 0;
+	while(inCapacity < pColumns->inRows + inRows)
+		inCapacity = (inCapacity == 0) ? 256 : inCapacity * 2;
+
+	if(inGrow((void **)&pColumns->pllAmount, inCapacity, sizeof(int64_t)) == -1 ||
+	   inGrow((void **)&pColumns->pulSettlement, inCapacity, sizeof(uint32_t)) == -1 ||
+	   inGrow((void **)&pColumns->pulCount, inCapacity, sizeof(uint32_t)) == -1 ||
+	   inGrow((void **)&pColumns->pusScheme, inCapacity, sizeof(uint16_t)) == -1 ||
+	   inGrow((void **)&pColumns->pucSource, inCapacity, sizeof(uint8_t)) == -1 ||
+	   inGrow((void **)&pColumns->pucKind, inCapacity, sizeof(uint8_t)) == -1)
+		return -1;
+	pColumns->inRowCapacity = inCapacity;
+	return 0;
+}
+
+static void vdCopyName(char *szName, const char *pszValue, int inLength)
+{
+	if(inLength >= ECR_SETTLEMENT_NAME_SIZE)
+		inLength = ECR_SETTLEMENT_NAME_SIZE - 1;
+	memset(szName, 0x00, ECR_SETTLEMENT_NAME_SIZE);
+	memcpy(szName, pszValue, inLength);
+}
+
+static int inAddSettlement(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT *pSettlement)
+{
+	if(pColumns->inSettlements == pColumns->inSettlementCapacity)
+	{
+		int inCapacity = (pColumns->inSettlementCapacity == 0) ? 16 : pColumns->inSettlementCapacity * 2;
+		if(inGrow((void **)&pColumns->pSettlements, inCapacity, sizeof(ECR_SETTLEMENT)) == -1)
+			return -1;
+		pColumns->inSettlementCapacity = inCapacity;
+	}
+	pColumns->pSettlements[pColumns->inSettlements] = *pSettlement;
+	return pColumns->inSettlements++;
+}
+
+// Scheme names form a small dictionary (a few dozen at most), a linear scan is enough
+static int inInternScheme(ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszName, int inLength)
+{
+	char szName[ECR_SETTLEMENT_NAME_SIZE];
+	int i = 0;
+
+	vdCopyName(szName, pszName, inLength);
+	for(i = 0; i < pColumns->inSchemes; i++)
+	{
+		if(memcmp(pColumns->pszSchemes[i], szName, ECR_SETTLEMENT_NAME_SIZE) == 0)
+			return i;
+	}
+	if(pColumns->inSchemes > 0xFFFF)
+		return -1;
+	if(pColumns->inSchemes == pColumns->inSchemeCapacity)
+	{
+		int inCapacity = (pColumns->inSchemeCapacity == 0) ? 16 : pColumns->inSchemeCapacity * 2;
+		if(inGrow((void **)&pColumns->pszSchemes, inCapacity, ECR_SETTLEMENT_NAME_SIZE) == -1)
+			return -1;
+		pColumns->inSchemeCapacity = inCapacity;
+	}
+	memcpy(pColumns->pszSchemes[pColumns->inSchemes], szName, ECR_SETTLEMENT_NAME_SIZE);
+	return pColumns->inSchemes++;
+}
+
+static void vdPutRow(ECR_SETTLEMENT_COLUMNS *pColumns, int inSettlement, int inScheme, int inSource, int inKind, long long llCount, long long llAmount)
+{
+	int inRow = pColumns->inRows++;
+
+	pColumns->pllAmount[inRow] = llAmount;
+	pColumns->pulSettlement[inRow] = (uint32_t)inSettlement;
+	pColumns->pulCount[inRow] = (uint32_t)llCount;
+	pColumns->pusScheme[inRow] = (uint16_t)inScheme;
+	pColumns->pucSource[inRow] = (uint8_t)inSource;
+	pColumns->pucKind[inRow] = (uint8_t)inKind;
+}
+
+//MARK: Decoding
+
+static int inFieldIs(const ECR_FIELD *pField, const char *pszValue)
+{
+	int inLength = (int)strlen(pszValue);
+	return pField->inLength == inLength && memcmp(pField->pszValue, pszValue, inLength) == 0;
+}
+
+static int inIsPosLabel(const ECR_FIELD *pField)
+{
+	return inFieldIs(pField, "POS TERMINAL") || inFieldIs(pField, "POS TERMINAL DETAILS");
+}
+
+static int inSplitFields(const char *pszResponse, ECR_FIELD *pFields, int inMaxFields)
+{
+	const char *pszStart = pszResponse;
+	const char *pszCursor = pszResponse;
+	int inFields = 0;
+
+	for(;;)
+	{
+		if(*pszCursor == ';' || *pszCursor == '\0')
+		{
+			if(inFields == inMaxFields)
+				return -1;
+			pFields[inFields].pszValue = pszStart;
+			pFields[inFields].inLength = (int)(pszCursor - pszStart);
+			inFields++;
+			if(*pszCursor == '\0')
+				break;
+			pszStart = pszCursor + 1;
+		}
+		pszCursor++;
+	}
+	return inFields;
+}
+
+static long long llFieldNumber(const ECR_FIELD *pField)
+{
+	long long llValue = 0;
+
+	if(ecrAmountToMinorUnits(pField->pszValue, pField->inLength, &llValue) == -1)
+		return 0;
+	return llValue;
+}
+
+static void vdPutPairs(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_FIELD *pPairs, int inSettlement, int inScheme, int inSource, const uint8_t *pucKinds)
+{
+	int i = 0;
+
+	for(i = 0; i < ECR_SETTLEMENT_PAIRS; i++)
+		vdPutRow(pColumns, inSettlement, inScheme, inSource, pucKinds[i], llFieldNumber(&pPairs[2*i]), llFieldNumber(&pPairs[2*i+1]));
+}
+
+EXPORT int ecrSettlementDecode(ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszTerminalId, const char *pszResponse)
+{
+	ECR_FIELD *pFields = NULL;
+	ECR_SETTLEMENT settlement;
+	int inFields = 0, inSchemeTotal = 0, inSchemesSeen = 0, inSettlement = 0, inScheme = 0, inRowsBefore = 0, k = 0;
+
+	pFields = (ECR_FIELD *)malloc(sizeof(ECR_FIELD) * ECR_SETTLEMENT_MAX_FIELDS);
+	if(pFields == NULL)
+		return -1;
+	inFields = inSplitFields(pszResponse, pFields, ECR_SETTLEMENT_MAX_FIELDS);
+	if(inFields <= ECR_SETTLEMENT_SCHEME_COUNT || !(inFieldIs(&pFields[2], "500") || inFieldIs(&pFields[2], "501")))
+	{
+		free(pFields);
+		return -1;
+	}
+
+	vdCopyName(settlement.szTerminalId, pszTerminalId, (int)strlen(pszTerminalId));
+	vdCopyName(settlement.szDateTime, pFields[4].pszValue, pFields[4].inLength);
+	inSettlement = inAddSettlement(pColumns, &settlement);
+	inSchemeTotal = (int)llFieldNumber(&pFields[ECR_SETTLEMENT_SCHEME_COUNT]);
+	inScheme = -1;
+	inRowsBefore = pColumns->inRows;
+
+	// Same walk as the reconciliation receipt: POS blocks belong to the scheme before them
+	// and do not count towards the number of schemes.
+	k = ECR_SETTLEMENT_SCHEME_COUNT;
+	while(inSettlement != -1 && k + 2 < inFields)
+	{
+		if(inFieldIs(&pFields[k + 2], "0"))
+		{
+			// Scheme without transactions: name, flag, host
+			if(inSchemesSeen == inSchemeTotal)
+				break;
+			inSchemesSeen++;
+			k = k + 3;
+		}
+		else if(inIsPosLabel(&pFields[k + 2]))
+		{
+			if(k + ECR_SETTLEMENT_POS_BLOCK >= inFields || inReserveRows(pColumns, ECR_SETTLEMENT_PAIRS) == -1)
+				break;
+			if(inScheme == -1)
+				inScheme = inInternScheme(pColumns, pFields[k + 2].pszValue, pFields[k + 2].inLength);
+			if(inScheme == -1)
+				break;
+			if(inFieldIs(&pFields[k + 2], "POS TERMINAL"))
+				vdPutPairs(pColumns, &pFields[k + 3], inSettlement, inScheme, ECR_SOURCE_POS, aucHostKinds);
+			else
+				vdPutPairs(pColumns, &pFields[k + 3], inSettlement, inScheme, ECR_SOURCE_POS_DETAILS, aucPosDetailKinds);
+			k = k + ECR_SETTLEMENT_POS_BLOCK;
+		}
+		else if(inFieldIs(&pFields[k + 1], "0"))
+		{
+			// POS terminal flag without transactions
+			k = k + 1;
+		}
+		else
+		{
+			if(inSchemesSeen == inSchemeTotal || k + ECR_SETTLEMENT_HOST_BLOCK >= inFields || inReserveRows(pColumns, ECR_SETTLEMENT_PAIRS) == -1)
+				break;
+			inScheme = inInternScheme(pColumns, pFields[k + 1].pszValue, pFields[k + 1].inLength);
+			if(inScheme == -1)
+				break;
+			vdPutPairs(pColumns, &pFields[k + 4], inSettlement, inScheme, ECR_SOURCE_HOST, aucHostKinds);
+			inSchemesSeen++;
+			k = k + ECR_SETTLEMENT_HOST_BLOCK;
+		}
+	}
+
+	free(pFields);
+	if(inSettlement == -1)
+		return -1;
+	return pColumns->inRows - inRowsBefore;
+}
+
+EXPORT int ecrSettlementSum(const ECR_SETTLEMENT_COLUMNS *pColumns, int inSource, int inKind, long long *pllCount, long long *pllAmount)
+{
+	long long llCount = 0, llAmount = 0;
+	int i = 0, inMatched = 0;
+
+	for(i = 0; i < pColumns->inRows; i++)
+	{
+		if((inSource != ECR_SETTLEMENT_ANY && pColumns->pucSource[i] != inSource) ||
+		   (inKind != ECR_SETTLEMENT_ANY && pColumns->pucKind[i] != inKind))
+			continue;
+		llCount += pColumns->pulCount[i];
+		llAmount += pColumns->pllAmount[i];
+		inMatched++;
+	}
+	*pllCount = llCount;
+	*pllAmount = llAmount;
+	return inMatched;
+}
+
+//MARK: Merging
+
+static int inAppendColumns(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource, int *pinSettlementMap, int *pinSchemeMap)
+{
+	int i = 0;
+
+	if(inReserveRows(pColumns, pSource->inRows) == -1)
+		return -1;
+	for(i = 0; i < pSource->inSettlements; i++)
+	{
+		if((pinSettlementMap[i] = inAddSettlement(pColumns, &pSource->pSettlements[i])) == -1)
+			return -1;
+	}
+	for(i = 0; i < pSource->inSchemes; i++)
+	{
+		if((pinSchemeMap[i] = inInternScheme(pColumns, pSource->pszSchemes[i], (int)strlen(pSource->pszSchemes[i]))) == -1)
+			return -1;
+	}
+	for(i = 0; i < pSource->inRows; i++)
+		vdPutRow(pColumns, pinSettlementMap[pSource->pulSettlement[i]], pinSchemeMap[pSource->pusScheme[i]],
+				pSource->pucSource[i], pSource->pucKind[i], pSource->pulCount[i], pSource->pllAmount[i]);
+	return pSource->inRows;
+}
+
+EXPORT int ecrSettlementAppend(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource)
+{
+	int *pinSettlementMap = (int *)malloc(sizeof(int) * (pSource->inSettlements + 1));
+	int *pinSchemeMap = (int *)malloc(sizeof(int) * (pSource->inSchemes + 1));
+	int inResult = -1;
+
+	if(pinSettlementMap != NULL && pinSchemeMap != NULL)
+		inResult = inAppendColumns(pColumns, pSource, pinSettlementMap, pinSchemeMap);
+	free(pinSettlementMap);
+	free(pinSchemeMap);
+	return inResult;
+}
+
+#define ECR_SETTLEMENT_SOURCES			(int)(sizeof(aszSourceNames) / sizeof(aszSourceNames[0]))
+#define ECR_SETTLEMENT_KINDS			(int)(sizeof(aszKindNames) / sizeof(aszKindNames[0]))
+
+// pinRowMap holds the aggregate row of every (scheme, source, kind) of pSource, -1 until seen
+static int inAggregateColumns(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource, const ECR_SETTLEMENT *pSettlement, int *pinRowMap)
+{
+	int inRowsBefore = pColumns->inRows;
+	int inSettlement = inAddSettlement(pColumns, pSettlement);
+	int inScheme = 0, inKey = 0, inRow = 0, i = 0;
+
+	if(inSettlement == -1)
+		return -1;
+	for(i = 0; i < pSource->inRows; i++)
+	{
+		// Sources and kinds this build does not know are left out
+		if(pSource->pucSource[i] >= ECR_SETTLEMENT_SOURCES || pSource->pucKind[i] >= ECR_SETTLEMENT_KINDS)
+			continue;
+		inKey = (pSource->pusScheme[i] * ECR_SETTLEMENT_SOURCES + pSource->pucSource[i]) * ECR_SETTLEMENT_KINDS + pSource->pucKind[i];
+		if(pinRowMap[inKey] == -1)
+		{
+			inScheme = inInternScheme(pColumns, pSource->pszSchemes[pSource->pusScheme[i]],
+					(int)strlen(pSource->pszSchemes[pSource->pusScheme[i]]));
+			if(inScheme == -1 || inReserveRows(pColumns, 1) == -1)
+				return -1;
+			pinRowMap[inKey] = pColumns->inRows;
+			vdPutRow(pColumns, inSettlement, inScheme, pSource->pucSource[i], pSource->pucKind[i], 0, 0);
+		}
+		inRow = pinRowMap[inKey];
+		pColumns->pulCount[inRow] += pSource->pulCount[i];
+		pColumns->pllAmount[inRow] += pSource->pllAmount[i];
+	}
+	return pColumns->inRows - inRowsBefore;
+}
+
+EXPORT int ecrSettlementAggregate(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource,
+		const char *pszTerminalId, const char *pszDateTime)
+{
+	ECR_SETTLEMENT settlement;
+	size_t ulKeys = (size_t)(pSource->inSchemes + 1) * ECR_SETTLEMENT_SOURCES * ECR_SETTLEMENT_KINDS;
+	int *pinRowMap = (int *)malloc(sizeof(int) * ulKeys);
+	int inResult = -1;
+
+	if(pinRowMap == NULL)
+		return -1;
+	memset(pinRowMap, 0xFF, sizeof(int) * ulKeys);
+	vdCopyName(settlement.szTerminalId, pszTerminalId, (int)strlen(pszTerminalId));
+	vdCopyName(settlement.szDateTime, pszDateTime, (int)strlen(pszDateTime));
+	inResult = inAggregateColumns(pColumns, pSource, &settlement, pinRowMap);
+	free(pinRowMap);
+	return inResult;
+}
+
+//MARK: Export
+
+static void vdWriteCsvText(FILE *fp, const char *pszValue)
+{
+	if(strpbrk(pszValue, ",\"\r\n") == NULL)
+	{
+		fputs(pszValue, fp);
+		return;
+	}
+	fputc('"', fp);
+	for(; *pszValue != '\0'; pszValue++)
+	{
+		if(*pszValue == '"')
+			fputc('"', fp);
+		fputc(*pszValue, fp);
+	}
+	fputc('"', fp);
+}
+
+EXPORT int ecrSettlementWriteCsv(const ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath)
+{
+	FILE *fp = fopen(pszPath, "w");
+	const ECR_SETTLEMENT *pSettlement = NULL;
+	int i = 0, inResult = 0;
+
+	if(fp == NULL)
+		return -1;
+
+	fputs("terminal_id,date_time,scheme,source,kind,count,amount\n", fp);
+	for(i = 0; i < pColumns->inRows; i++)
+	{
+		pSettlement = &pColumns->pSettlements[pColumns->pulSettlement[i]];
+		vdWriteCsvText(fp, pSettlement->szTerminalId);
+		fputc(',', fp);
+		vdWriteCsvText(fp, pSettlement->szDateTime);
+		fputc(',', fp);
+		vdWriteCsvText(fp, pColumns->pszSchemes[pColumns->pusScheme[i]]);
+		fprintf(fp, ",%s,%s,%u,%lld\n", ecrSettlementSourceName(pColumns->pucSource[i]), ecrSettlementKindName(pColumns->pucKind[i]),
+				(unsigned int)pColumns->pulCount[i], (long long)pColumns->pllAmount[i]);
+	}
+
+	if(ferror(fp))
+		inResult = -1;
+	if(fclose(fp) != 0)
+		inResult = -1;
+	return inResult;
+}
+
+static int inHostIsLittleEndian(void)
+{
+	const uint16_t usOne = 1;
+	return *(const uint8_t *)&usOne == 1;
+}
+
+// Columns go out as-is on little endian hosts, byte swapped per element otherwise
+static int inWriteColumn(FILE *fp, const void *pv, size_t width, int inRows)
+{
+	const uint8_t *puc = (const uint8_t *)pv;
+	uint8_t aucElement[8];
+	size_t j = 0;
+	int i = 0;
+
+	if(inRows == 0)
+		return 0;
+	if(width == 1 || inHostIsLittleEndian())
+		return fwrite(pv, width, inRows, fp) == (size_t)inRows ? 0 : -1;
+
+	for(i = 0; i < inRows; i++, puc += width)
+	{
+		for(j = 0; j < width; j++)
+			aucElement[j] = puc[width - 1 - j];
+		if(fwrite(aucElement, width, 1, fp) != 1)
+			return -1;
+	}
+	return 0;
+}
+
+static int inReadColumn(FILE *fp, void *pv, size_t width, int inRows)
+{
+	uint8_t *puc = (uint8_t *)pv, ucSwap = 0;
+	size_t j = 0;
+	int i = 0;
+
+	if(inRows == 0)
+		return 0;
+	if(fread(pv, width, inRows, fp) != (size_t)inRows)
+		return -1;
+	if(width == 1 || inHostIsLittleEndian())
+		return 0;
+
+	for(i = 0; i < inRows; i++, puc += width)
+	{
+		for(j = 0; j < width / 2; j++)
+		{
+			ucSwap = puc[j];
+			puc[j] = puc[width - 1 - j];
+			puc[width - 1 - j] = ucSwap;
+		}
+	}
+	return 0;
+}
+
+static void vdPutU32(uint8_t *puc, uint32_t ulValue)
+{
+	puc[0] = (uint8_t)ulValue;
+	puc[1] = (uint8_t)(ulValue >> 8);
+	puc[2] = (uint8_t)(ulValue >> 16);
+	puc[3] = (uint8_t)(ulValue >> 24);
+}
+
+static uint32_t ulGetU32(const uint8_t *puc)
+{
+	return (uint32_t)puc[0] | ((uint32_t)puc[1] << 8) | ((uint32_t)puc[2] << 16) | ((uint32_t)puc[3] << 24);
+}
+
+EXPORT int ecrSettlementWriteColumnar(const ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath)
+{
+	uint8_t aucHeader[ECR_SETTLEMENT_HEADER_SIZE];
+	FILE *fp = fopen(pszPath, "wb");
+	int inResult = 0;
+
+	if(fp == NULL)
+		return -1;
+
+	memset(aucHeader, 0x00, sizeof(aucHeader));
+	memcpy(aucHeader, ECR_SETTLEMENT_MAGIC, 4);
+	aucHeader[4] = ECR_SETTLEMENT_VERSION;
+	vdPutU32(&aucHeader[8], (uint32_t)pColumns->inRows);
+	vdPutU32(&aucHeader[12], (uint32_t)pColumns->inSettlements);
+	vdPutU32(&aucHeader[16], (uint32_t)pColumns->inSchemes);
+
+	if(fwrite(aucHeader, sizeof(aucHeader), 1, fp) != 1 ||
+	   inWriteColumn(fp, pColumns->pSettlements, 1, pColumns->inSettlements * (int)sizeof(ECR_SETTLEMENT)) == -1 ||
+	   inWriteColumn(fp, pColumns->pszSchemes, 1, pColumns->inSchemes * ECR_SETTLEMENT_NAME_SIZE) == -1 ||
+	   inWriteColumn(fp, pColumns->pllAmount, sizeof(int64_t), pColumns->inRows) == -1 ||
+	   inWriteColumn(fp, pColumns->pulSettlement, sizeof(uint32_t), pColumns->inRows) == -1 ||
+	   inWriteColumn(fp, pColumns->pulCount, sizeof(uint32_t), pColumns->inRows) == -1 ||
+	   inWriteColumn(fp, pColumns->pusScheme, sizeof(uint16_t), pColumns->inRows) == -1 ||
+	   inWriteColumn(fp, pColumns->pucSource, 1, pColumns->inRows) == -1 ||
+	   inWriteColumn(fp, pColumns->pucKind, 1, pColumns->inRows) == -1)
+		inResult = -1;
+
+	if(fclose(fp) != 0)
+		inResult = -1;
+	return inResult;
+}
+
+static int inReadColumnarFile(ECR_SETTLEMENT_COLUMNS *pColumns, FILE *fp, int **ppinSettlementMap, int **ppinSchemeMap)
+{
+	uint8_t aucHeader[ECR_SETTLEMENT_HEADER_SIZE];
+	ECR_SETTLEMENT settlement;
+	char szScheme[ECR_SETTLEMENT_NAME_SIZE];
+	int *pinSettlementMap = NULL, *pinSchemeMap = NULL;
+	int inRows = 0, inSettlements = 0, inSchemes = 0, inFirstRow = 0, i = 0;
+
+	if(fread(aucHeader, sizeof(aucHeader), 1, fp) != 1 || memcmp(aucHeader, ECR_SETTLEMENT_MAGIC, 4) != 0 || aucHeader[4] != ECR_SETTLEMENT_VERSION)
+		return -1;
+
+	inRows = (int)ulGetU32(&aucHeader[8]);
+	inSettlements = (int)ulGetU32(&aucHeader[12]);
+	inSchemes = (int)ulGetU32(&aucHeader[16]);
+	if(inRows < 0 || inSettlements < 0 || inSchemes < 0 || inSchemes > 0x10000)
+		return -1;
+
+	// Owned by the caller so they are released on every exit path
+	pinSettlementMap = *ppinSettlementMap = (int *)malloc(sizeof(int) * (inSettlements + 1));
+	pinSchemeMap = *ppinSchemeMap = (int *)malloc(sizeof(int) * (inSchemes + 1));
+	if(pinSettlementMap == NULL || pinSchemeMap == NULL)
+		return -1;
+
+	for(i = 0; i < inSettlements; i++)
+	{
+		if(fread(&settlement, sizeof(settlement), 1, fp) != 1)
+			return -1;
+		settlement.szTerminalId[ECR_SETTLEMENT_NAME_SIZE - 1] = '\0';
+		settlement.szDateTime[ECR_SETTLEMENT_NAME_SIZE - 1] = '\0';
+		if((pinSettlementMap[i] = inAddSettlement(pColumns, &settlement)) == -1)
+			return -1;
+	}
+	for(i = 0; i < inSchemes; i++)
+	{
+		if(fread(szScheme, sizeof(szScheme), 1, fp) != 1)
+			return -1;
+		szScheme[ECR_SETTLEMENT_NAME_SIZE - 1] = '\0';
+		if((pinSchemeMap[i] = inInternScheme(pColumns, szScheme, (int)strlen(szScheme))) == -1)
+			return -1;
+	}
+
+	if(inReserveRows(pColumns, inRows) == -1)
+		return -1;
+	inFirstRow = pColumns->inRows;
+	if(inReadColumn(fp, &pColumns->pllAmount[inFirstRow], sizeof(int64_t), inRows) == -1 ||
+	   inReadColumn(fp, &pColumns->pulSettlement[inFirstRow], sizeof(uint32_t), inRows) == -1 ||
+	   inReadColumn(fp, &pColumns->pulCount[inFirstRow], sizeof(uint32_t), inRows) == -1 ||
+	   inReadColumn(fp, &pColumns->pusScheme[inFirstRow], sizeof(uint16_t), inRows) == -1 ||
+	   inReadColumn(fp, &pColumns->pucSource[inFirstRow], 1, inRows) == -1 ||
+	   inReadColumn(fp, &pColumns->pucKind[inFirstRow], 1, inRows) == -1)
+		return -1;
+
+	for(i = inFirstRow; i < inFirstRow + inRows; i++)
+	{
+		if(pColumns->pulSettlement[i] >= (uint32_t)inSettlements || pColumns->pusScheme[i] >= inSchemes)
+			return -1;
+		pColumns->pulSettlement[i] = (uint32_t)pinSettlementMap[pColumns->pulSettlement[i]];
+		pColumns->pusScheme[i] = (uint16_t)pinSchemeMap[pColumns->pusScheme[i]];
+	}
+	// Rows only become visible once the whole file checked out
+	pColumns->inRows += inRows;
+	return inRows;
+}
+
+EXPORT int ecrSettlementReadColumnar(ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath)
+{
+	int *pinSettlementMap = NULL, *pinSchemeMap = NULL;
+	int inResult = 0;
+	FILE *fp = fopen(pszPath, "rb");
+
+	if(fp == NULL)
+		return -1;
+	inResult = inReadColumnarFile(pColumns, fp, &pinSettlementMap, &pinSchemeMap);
+	free(pinSettlementMap);
+	free(pinSchemeMap);
+	fclose(fp);
+	return inResult;
+}
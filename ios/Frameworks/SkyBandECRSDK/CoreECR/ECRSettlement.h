@@ -0,0 +1,168 @@
+/*
+ * ECRSettlement.h
+ *
+ *  Columnar scheme totals decoded from Reconciliation (B1) replies.
+ *
+ *  Every row is one (settlement, scheme, source, kind) total. The columns are
+ *  parallel arrays so a day of settlements can be summed with plain scans.
+ *
+ *  Binary columnar file (little endian, sections 8 byte aligned):
+ *    [0..3]   "SBST"
+ *    [4..5]   version
+ *    [6..7]   reserved
+ *    [8..11]  rows
+ *    [12..15] settlements
+ *    [16..19] schemes
+ *    [20..31] reserved
+ *  followed by
+ *    settlements x { terminal id[32], date time[32] }
+ *    schemes     x { name[32] }
+ *    amount      int64  x rows   (minor units)
+ *    settlement  uint32 x rows   (index into settlements)
+ *    count       uint32 x rows
+ *    scheme      uint16 x rows   (index into schemes)
+ *    source      uint8  x rows   (ECR_SETTLEMENT_SOURCE)
+ *    kind        uint8  x rows   (ECR_SETTLEMENT_KIND)
+ */
+
+#ifndef ECRSRC_ECRSETTLEMENT_H_
+#define ECRSRC_ECRSETTLEMENT_H_
+
+#include <stdint.h>
+#include "SBCoreECR.h"
+
+#define ECR_SETTLEMENT_MAGIC			"SBST"
+#define ECR_SETTLEMENT_VERSION			1
+#define ECR_SETTLEMENT_HEADER_SIZE		32
+#define ECR_SETTLEMENT_NAME_SIZE		32		// Terminal id, date time and scheme name slots, NUL padded
+#define ECR_SETTLEMENT_ANY				-1
+
+/* Source and kind values are part of the file format: append only. */
+typedef enum
+{
+	ECR_SOURCE_HOST = 0,				// Scheme host block ("mada HOST")
+	ECR_SOURCE_POS,						// "POS TERMINAL" block
+	ECR_SOURCE_POS_DETAILS				// "POS TERMINAL DETAILS" block
+} ECR_SETTLEMENT_SOURCE;
+
+typedef enum
+{
+	ECR_KIND_DEBIT = 0, ECR_KIND_CREDIT, ECR_KIND_NAQD, ECR_KIND_CADV, ECR_KIND_AUTH,
+	ECR_KIND_TOTAL, ECR_KIND_POFF, ECR_KIND_PON, ECR_KIND_REVERSAL, ECR_KIND_REFUND,
+	ECR_KIND_COMP
+} ECR_SETTLEMENT_KIND;
+
+typedef struct
+{
+	char szTerminalId[ECR_SETTLEMENT_NAME_SIZE];
+	char szDateTime[ECR_SETTLEMENT_NAME_SIZE];
+} ECR_SETTLEMENT;
+
+typedef struct
+{
+	int inRows;
+	int inRowCapacity;
+	int64_t *pllAmount;
+	uint32_t *pulSettlement;
+	uint32_t *pulCount;
+	uint16_t *pusScheme;
+	uint8_t *pucSource;
+	uint8_t *pucKind;
+
+	ECR_SETTLEMENT *pSettlements;
+	int inSettlements;
+	int inSettlementCapacity;
+
+	char (*pszSchemes)[ECR_SETTLEMENT_NAME_SIZE];
+	int inSchemes;
+	int inSchemeCapacity;
+} ECR_SETTLEMENT_COLUMNS;
+
+EXPORT void ecrSettlementInit(ECR_SETTLEMENT_COLUMNS *pColumns);
+EXPORT void ecrSettlementFree(ECR_SETTLEMENT_COLUMNS *pColumns);
+
+/*********************************************************************************************
+* @func int | ecrSettlementDecode |
+* This routine appends the scheme totals of one B1 reply to the columns
+*
+* @parm const char * | pszTerminalId |
+*       This is the terminal the reply came from
+*
+* @parm const char * | pszResponse |
+*       This is the ';' separated output of parse()
+*
+* @rdesc Returns the number of rows added, -1 if the reply is not a successful
+*        reconciliation or memory ran out
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementDecode(ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszTerminalId, const char *pszResponse);
+
+/*********************************************************************************************
+* @func int | ecrSettlementSum |
+* This routine sums count and amount over the rows matching source and kind
+*
+* @parm int | inSource |
+*       This is an ECR_SETTLEMENT_SOURCE value or ECR_SETTLEMENT_ANY
+*
+* @parm int | inKind |
+*       This is an ECR_SETTLEMENT_KIND value or ECR_SETTLEMENT_ANY
+*
+* @rdesc Returns the number of matching rows
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementSum(const ECR_SETTLEMENT_COLUMNS *pColumns, int inSource, int inKind, long long *pllCount, long long *pllAmount);
+
+/*********************************************************************************************
+* @func int | ecrSettlementWriteCsv |
+* This routine writes one line per row:
+* terminal_id,date_time,scheme,source,kind,count,amount
+*
+* @rdesc Returns 0 on success, -1 on an I/O error
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementWriteCsv(const ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath);
+
+/*********************************************************************************************
+* @func int | ecrSettlementWriteColumnar |
+* This routine writes the binary columnar file described at the top of this header
+*
+* @rdesc Returns 0 on success, -1 on an I/O error
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementWriteColumnar(const ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath);
+
+/*********************************************************************************************
+* @func int | ecrSettlementReadColumnar |
+* This routine appends the rows of a binary columnar file, remapping settlement and
+* scheme indices, so files from many terminals can be merged and summed
+*
+* @rdesc Returns the number of rows added, -1 on an I/O or format error
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementReadColumnar(ECR_SETTLEMENT_COLUMNS *pColumns, const char *pszPath);
+
+/*********************************************************************************************
+* @func int | ecrSettlementAppend |
+* This routine appends the rows of pSource, remapping settlement and scheme indices, so
+* replies decoded apart (one terminal each, on different threads) can be merged
+*
+* @rdesc Returns the number of rows added, -1 if memory ran out
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementAppend(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource);
+
+/*********************************************************************************************
+* @func int | ecrSettlementAggregate |
+* This routine appends one settlement (pszTerminalId, pszDateTime) holding a row per scheme,
+* source and kind of pSource, with count and amount summed over all its settlements
+*
+* @rdesc Returns the number of rows added, -1 if memory ran out
+* @end
+**********************************************************************************************/
+EXPORT int ecrSettlementAggregate(ECR_SETTLEMENT_COLUMNS *pColumns, const ECR_SETTLEMENT_COLUMNS *pSource,
+		const char *pszTerminalId, const char *pszDateTime);
+
+EXPORT const char *ecrSettlementSourceName(int inSource);
+EXPORT const char *ecrSettlementKindName(int inKind);
+
+#endif /* ECRSRC_ECRSETTLEMENT_H_ */
@@ -0,0 +1,347 @@
+/*
+ * ECRSha256.c
+ *
+ *  Portable SHA-256 for request signatures. Uses the SHA-NI (x86) or
+ *  ARMv8 crypto extension block function when the CPU has it.
+ */
+#include <string.h>
+#include "ECRSha256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA256_ARMV8 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*SHA256_BLOCKS_FN)(uint32_t state[8], const unsigned char *pucData, size_t blocks);
+
+static const uint32_t K256[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+//MARK: Portable block function
+
+#define ROTR(x, n)		(((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)		(((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z)	(((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define BSIG0(x)		(ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BSIG1(x)		(ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SSIG0(x)		(ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x)		(ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static void sha256BlocksPortable(uint32_t state[8], const unsigned char *pucData, size_t blocks)
+{
+	uint32_t W[64], a, b, c, d, e, f, g, h, t1, t2;
+	int i = 0;
+
+	while(blocks--)
+	{
+		for(i = 0; i < 16; i++)
+			W[i] = ((uint32_t)pucData[4*i] << 24) | ((uint32_t)pucData[4*i+1] << 16) | ((uint32_t)pucData[4*i+2] << 8) | pucData[4*i+3];
+		for(i = 16; i < 64; i++)
+			W[i] = SSIG1(W[i-2]) + W[i-7] + SSIG0(W[i-15]) + W[i-16];
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+		for(i = 0; i < 64; i++)
+		{
+			t1 = h + BSIG1(e) + CH(e, f, g) + K256[i] + W[i];
+			t2 = BSIG0(a) + MAJ(a, b, c);
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+		pucData += SHA256_BLOCK_SIZE;
+	}
+}
+
+#ifdef SHA256_X86
+//MARK: SHA-NI block function
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256BlocksShaNi(uint32_t state[8], const unsigned char *pucData, size_t blocks)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i STATE0, STATE1, TMP, MSG, ABEF_SAVE, CDGH_SAVE;
+	__m128i X[4];
+	int i = 0;
+
+	TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+	STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+	TMP = _mm_shuffle_epi32(TMP, 0xB1);				// CDAB
+	STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);		// EFGH
+	STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);		// ABEF
+	STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);	// CDGH
+
+	while(blocks--)
+	{
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+		for(i = 0; i < 4; i++)
+			X[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(pucData + 16*i)), MASK);
+
+		// Four rounds per step; the schedule word four steps ahead is built in place
+		for(i = 0; i < 16; i++)
+		{
+			MSG = _mm_add_epi32(X[i & 3], _mm_loadu_si128((const __m128i *)&K256[4*i]));
+			STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+			if(i < 12)
+				X[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(X[i & 3], X[(i+1) & 3]),
+						_mm_alignr_epi8(X[(i+3) & 3], X[(i+2) & 3], 4)), X[(i+3) & 3]);
+			MSG = _mm_shuffle_epi32(MSG, 0x0E);
+			STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+		}
+
+		STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+		STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+		pucData += SHA256_BLOCK_SIZE;
+	}
+
+	TMP = _mm_shuffle_epi32(STATE0, 0x1B);			// FEBA
+	STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);		// DCHG
+	STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);	// DCBA
+	STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);		// HGFE
+	_mm_storeu_si128((__m128i *)&state[0], STATE0);
+	_mm_storeu_si128((__m128i *)&state[4], STATE1);
+}
+
+static int inCpuHasShaNi(void)
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	if(!(ecx & (1u << 19)) || !(ecx & (1u << 9)))	// SSE4.1, SSSE3
+		return 0;
+	if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+	return (ebx & (1u << 29)) != 0;					// SHA
+}
+#endif
+
+#ifdef SHA256_ARMV8
+//MARK: ARMv8 crypto extension block function
+
+static void sha256BlocksArmV8(uint32_t state[8], const unsigned char *pucData, size_t blocks)
+{
+	uint32x4_t STATE0 = vld1q_u32(&state[0]);
+	uint32x4_t STATE1 = vld1q_u32(&state[4]);
+	uint32x4_t ABCD_SAVE, EFGH_SAVE, WK, TMP;
+	uint32x4_t X[4];
+	int i = 0;
+
+	while(blocks--)
+	{
+		ABCD_SAVE = STATE0;
+		EFGH_SAVE = STATE1;
+		for(i = 0; i < 4; i++)
+			X[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(pucData + 16*i)));
+
+		for(i = 0; i < 16; i++)
+		{
+			WK = vaddq_u32(X[i & 3], vld1q_u32(&K256[4*i]));
+			if(i < 12)
+				X[i & 3] = vsha256su1q_u32(vsha256su0q_u32(X[i & 3], X[(i+1) & 3]), X[(i+2) & 3], X[(i+3) & 3]);
+			TMP = STATE0;
+			STATE0 = vsha256hq_u32(STATE0, STATE1, WK);
+			STATE1 = vsha256h2q_u32(STATE1, TMP, WK);
+		}
+
+		STATE0 = vaddq_u32(STATE0, ABCD_SAVE);
+		STATE1 = vaddq_u32(STATE1, EFGH_SAVE);
+		pucData += SHA256_BLOCK_SIZE;
+	}
+	vst1q_u32(&state[0], STATE0);
+	vst1q_u32(&state[4], STATE1);
+}
+#endif
+
+//MARK: Dispatch
+
+static SHA256_BLOCKS_FN pfnBlocks = NULL;
+static const char *pszBackend = "portable";
+
+static SHA256_BLOCKS_FN sha256SelectBlocks(void)
+{
+	// Idempotent, so a racing first call from two threads is harmless
+	if(pfnBlocks == NULL)
+	{
+		SHA256_BLOCKS_FN pfnSelected = sha256BlocksPortable;
+#if defined(SHA256_X86)
+		if(inCpuHasShaNi())
+		{
+			pfnSelected = sha256BlocksShaNi;
+			pszBackend = "sha-ni";
+		}
+#elif defined(SHA256_ARMV8)
+		pfnSelected = sha256BlocksArmV8;
+		pszBackend = "armv8";
+#endif
+		pfnBlocks = pfnSelected;
+	}
+	return pfnBlocks;
+}
+
+EXPORT const char *sha256Backend(void)
+{
+	sha256SelectBlocks();
+	return pszBackend;
+}
+
+EXPORT int sha256SelectBackend(const char *pszName)
+{
+	if(pszName == NULL)
+	{
+		pfnBlocks = NULL;
+		pszBackend = "portable";
+		sha256SelectBlocks();
+		return 0;
+	}
+	if(strcmp(pszName, "portable") == 0)
+	{
+		pfnBlocks = sha256BlocksPortable;
+		pszBackend = "portable";
+		return 0;
+	}
+#if defined(SHA256_X86)
+	if(strcmp(pszName, "sha-ni") == 0 && inCpuHasShaNi())
+	{
+		pfnBlocks = sha256BlocksShaNi;
+		pszBackend = "sha-ni";
+		return 0;
+	}
+#elif defined(SHA256_ARMV8)
+	if(strcmp(pszName, "armv8") == 0)
+	{
+		pfnBlocks = sha256BlocksArmV8;
+		pszBackend = "armv8";
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+//MARK: Streaming interface
+
+EXPORT void sha256Init(SHA256_CTX *pCtx)
+{
+	static const uint32_t H0[8] =
+	{
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(pCtx->state, H0, sizeof(H0));
+	pCtx->ullBitCount = 0;
+	pCtx->inBufferLength = 0;
+}
+
+EXPORT void sha256Update(SHA256_CTX *pCtx, const void *pData, size_t length)
+{
+	const unsigned char *pucData = (const unsigned char *)pData;
+	SHA256_BLOCKS_FN pfnSelected = sha256SelectBlocks();
+	size_t fill = 0, blocks = 0;
+
+	pCtx->ullBitCount += (uint64_t)length * 8;
+
+	if(pCtx->inBufferLength > 0)
+	{
+		fill = SHA256_BLOCK_SIZE - pCtx->inBufferLength;
+		if(length < fill)
+		{
+			memcpy(&pCtx->ucBuffer[pCtx->inBufferLength], pucData, length);
+			pCtx->inBufferLength += (int)length;
+			return;
+		}
+		memcpy(&pCtx->ucBuffer[pCtx->inBufferLength], pucData, fill);
+		pfnSelected(pCtx->state, pCtx->ucBuffer, 1);
+		pucData += fill;
+		length -= fill;
+		pCtx->inBufferLength = 0;
+	}
+
+	blocks = length / SHA256_BLOCK_SIZE;
+	if(blocks > 0)
+	{
+		pfnSelected(pCtx->state, pucData, blocks);
+		pucData += blocks * SHA256_BLOCK_SIZE;
+		length -= blocks * SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(pCtx->ucBuffer, pucData, length);
+	pCtx->inBufferLength = (int)length;
+}
+
+EXPORT void sha256Final(SHA256_CTX *pCtx, unsigned char digest[SHA256_DIGEST_SIZE])
+{
+	SHA256_BLOCKS_FN pfnSelected = sha256SelectBlocks();
+	uint64_t ullBitCount = pCtx->ullBitCount;
+	int i = 0;
+
+	pCtx->ucBuffer[pCtx->inBufferLength++] = 0x80;
+	if(pCtx->inBufferLength > SHA256_BLOCK_SIZE - 8)
+	{
+		memset(&pCtx->ucBuffer[pCtx->inBufferLength], 0x00, SHA256_BLOCK_SIZE - pCtx->inBufferLength);
+		pfnSelected(pCtx->state, pCtx->ucBuffer, 1);
+		pCtx->inBufferLength = 0;
+	}
+	memset(&pCtx->ucBuffer[pCtx->inBufferLength], 0x00, SHA256_BLOCK_SIZE - 8 - pCtx->inBufferLength);
+	for(i = 0; i < 8; i++)
+		pCtx->ucBuffer[SHA256_BLOCK_SIZE - 1 - i] = (unsigned char)(ullBitCount >> (8 * i));
+	pfnSelected(pCtx->state, pCtx->ucBuffer, 1);
+
+	for(i = 0; i < 8; i++)
+	{
+		digest[4*i] = (unsigned char)(pCtx->state[i] >> 24);
+		digest[4*i+1] = (unsigned char)(pCtx->state[i] >> 16);
+		digest[4*i+2] = (unsigned char)(pCtx->state[i] >> 8);
+		digest[4*i+3] = (unsigned char)pCtx->state[i];
+	}
+}
+
+//MARK: Signatures
+
+EXPORT void sha256ToHex(const unsigned char digest[SHA256_DIGEST_SIZE], char *szHex)
+{
+	static const char szHexDigits[] = "0123456789abcdef";
+	int i = 0;
+
+	for(i = 0; i < SHA256_DIGEST_SIZE; i++)
+	{
+		szHex[2*i] = szHexDigits[digest[i] >> 4];
+		szHex[2*i+1] = szHexDigits[digest[i] & 0x0F];
+	}
+}
+
+EXPORT void sha256Signature(const char *pszRefNum, const char *pszTerminalId, char szSignature[SHA256_HEX_SIZE])
+{
+	SHA256_CTX ctx;
+	unsigned char digest[SHA256_DIGEST_SIZE];
+
+	// Hashed in place of a joined copy
+	sha256Init(&ctx);
+	sha256Update(&ctx, pszRefNum, strlen(pszRefNum));
+	sha256Update(&ctx, pszTerminalId, strlen(pszTerminalId));
+	sha256Final(&ctx, digest);
+	sha256ToHex(digest, szSignature);
+}
+
+EXPORT void sha256SignatureBatch(const char *pszRefNum, const char **pszTerminalIds, int inCount, char *szSignatures)
+{
+	int i = 0;
+
+	// Reference number and terminal id fit one block, so there is no midstate worth sharing
+	for(i = 0; i < inCount; i++)
+		sha256Signature(pszRefNum, pszTerminalIds[i], &szSignatures[i * SHA256_HEX_SIZE]);
+}
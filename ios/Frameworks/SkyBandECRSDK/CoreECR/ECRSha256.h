@@ -0,0 +1,92 @@
+/*
+ * ECRSha256.h
+ *
+ *  Portable SHA-256 for request signatures. Uses the SHA-NI (x86) or
+ *  ARMv8 crypto extension block function when the CPU has it.
+ */
+
+#ifndef ECRSRC_ECRSHA256_H_
+#define ECRSRC_ECRSHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SBCoreECR.h"
+
+#define SHA256_DIGEST_SIZE				32
+#define SHA256_BLOCK_SIZE				64
+#define SHA256_HEX_SIZE					64		// Same as SIGNATURE_SIZE, no terminator is written
+
+typedef struct
+{
+	uint32_t state[8];
+	uint64_t ullBitCount;
+	unsigned char ucBuffer[SHA256_BLOCK_SIZE];
+	int inBufferLength;
+} SHA256_CTX;
+
+EXPORT void sha256Init(SHA256_CTX *pCtx);
+EXPORT void sha256Update(SHA256_CTX *pCtx, const void *pData, size_t length);
+EXPORT void sha256Final(SHA256_CTX *pCtx, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+/*********************************************************************************************
+* @func void | sha256ToHex |
+* This routine writes the lower case hex form of a digest into a 64 byte slot
+*
+* @parm char * | szHex |
+*       This is the output slot, e.g. the signature buffer handed to pack()
+*
+* @rdesc Returns nothing
+* @end
+**********************************************************************************************/
+EXPORT void sha256ToHex(const unsigned char digest[SHA256_DIGEST_SIZE], char *szHex);
+
+/*********************************************************************************************
+* @func void | sha256Signature |
+* This routine writes the request signature, SHA-256 of the ECR reference number followed
+* by the terminal id, as lower case hex
+*
+* @parm char * | szSignature |
+*       This is the 64 byte output slot, e.g. the signature buffer handed to pack()
+*
+* @rdesc Returns nothing
+* @end
+**********************************************************************************************/
+EXPORT void sha256Signature(const char *pszRefNum, const char *pszTerminalId, char szSignature[SHA256_HEX_SIZE]);
+
+/*********************************************************************************************
+* @func void | sha256SignatureBatch |
+* This routine signs one ECR reference number for inCount terminals, e.g. a reconciliation
+* sent to a fleet
+*
+* @parm const char ** | pszTerminalIds |
+*       These are the terminal ids
+*
+* @parm char * | szSignatures |
+*       This is the output, inCount consecutive 64 byte slots
+*
+* @rdesc Returns nothing
+* @end
+**********************************************************************************************/
+EXPORT void sha256SignatureBatch(const char *pszRefNum, const char **pszTerminalIds, int inCount, char *szSignatures);
+
+/*********************************************************************************************
+* @func const char * | sha256Backend |
+* This routine names the block function in use: "sha-ni", "armv8" or "portable"
+* @end
+**********************************************************************************************/
+EXPORT const char *sha256Backend(void);
+
+/*********************************************************************************************
+* @func int | sha256SelectBackend |
+* This routine forces a block function, for tests. Not thread safe: call it while no hash
+* is being computed.
+*
+* @parm const char * | pszName |
+*       This is "sha-ni", "armv8", "portable", or NULL for the one the CPU is detected to run best
+*
+* @rdesc Returns 0, or -1 if this build or CPU has no such block function
+* @end
+**********************************************************************************************/
+EXPORT int sha256SelectBackend(const char *pszName);
+
+#endif /* ECRSRC_ECRSHA256_H_ */
@@ -39,6 +39,7 @@
 #define DELIMITOR_CHAR 					';'
 #define ENDMSG_CHAR 					'!'
 #define TIMEOUT_VAL						"120"
+#define TIMEOUT_MAX						999		// Seconds, the most TIMEOUT_SIZE digits can carry
 #define OUT_DELIMITER					"fffffffc"
 
 #define AMT_SIZE 						12
@@ -0,0 +1,547 @@
+/*
+ * ECRTextReceipt.c
+ *
+ *  Fixed width text and ESC/POS receipts.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ECRSrc.h"
+#include "ECRTextReceipt.h"
+
+#define TEXT_LINE_MAX					512		// Characters of one ecrTextReceiptLine call; the rest is dropped
+#define TEXT_VALUE_SIZE					128
+
+static const unsigned char aucEscPosInit[] = { 0x1B, 0x40, 0x1B, 0x74, ECR_ESCPOS_CODEPAGE_WPC1256 };
+static const unsigned char aucEscPosBoldOn[] = { 0x1B, 0x45, 0x01 };
+static const unsigned char aucEscPosBoldOff[] = { 0x1B, 0x45, 0x00 };
+static const unsigned char aucEscPosTallOn[] = { 0x1D, 0x21, 0x01 };
+static const unsigned char aucEscPosTallOff[] = { 0x1D, 0x21, 0x00 };
+static const unsigned char aucEscPosCut[] = { 0x1B, 0x64, 0x03, 0x1D, 0x56, 0x42, 0x00 };
+
+// Unicode of WPC1256 bytes 0x80..0xFF
+static const unsigned short ausWpc1256[128] =
+{
+	0x20AC, 0x067E, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0679, 0x2039, 0x0152, 0x0686, 0x0698, 0x0688,
+	0x06AF, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x06A9, 0x2122, 0x0691, 0x203A, 0x0153, 0x200C, 0x200D, 0x06BA,
+	0x00A0, 0x060C, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x06BE, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x061B, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x061F,
+	0x06C1, 0x0621, 0x0622, 0x0623, 0x0624, 0x0625, 0x0626, 0x0627,
+	0x0628, 0x0629, 0x062A, 0x062B, 0x062C, 0x062D, 0x062E, 0x062F,
+	0x0630, 0x0631, 0x0632, 0x0633, 0x0634, 0x0635, 0x0636, 0x00D7,
+	0x0637, 0x0638, 0x0639, 0x063A, 0x0640, 0x0641, 0x0642, 0x0643,
+	0x00E0, 0x0644, 0x00E2, 0x0645, 0x0646, 0x0647, 0x0648, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x0649, 0x064A, 0x00EE, 0x00EF,
+	0x064B, 0x064C, 0x064D, 0x064E, 0x00F4, 0x064F, 0x0650, 0x00F7,
+	0x0651, 0x00F9, 0x0652, 0x00FB, 0x00FC, 0x200E, 0x200F, 0x06D2
+};
+
+// WPC1256 bytes of U+0600..U+06FF, 0 where there is none; the rest of ausWpc1256 is searched
+static const unsigned char aucArabicWpc1256[256] =
+{
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xA1, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xBA, 0x00, 0x00, 0x00, 0xBF,
+	0x00, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+	0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD8, 0xD9, 0xDA, 0xDB, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xDC, 0xDD, 0xDE, 0xDF, 0xE1, 0xE3, 0xE4, 0xE5, 0xE6, 0xEC, 0xED, 0xF0, 0xF1, 0xF2, 0xF3, 0xF5,
+	0xF6, 0xF8, 0xFA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x8A, 0x00, 0x00, 0x00, 0x00, 0x81, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x8D, 0x00, 0x8F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x9A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x8E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x98, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x9F, 0x00, 0x00, 0x00, 0xAA, 0x00,
+	0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+typedef struct
+{
+	int transactionType;
+	const char *pszTitle;
+	const char *pszTitleArabic;
+	const char *pszAmount;
+	const char *pszAmountArabic;
+} CARD_RECEIPT;
+
+static const CARD_RECEIPT aCardReceipts[] =
+{
+	{ TYPE_PURCHASE, "PURCHASE", "\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1",
+		"PURCHASE AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1" },
+	{ TYPE_PURCHASE_CASHBACK, "PURCHASE WITH NAQD", "\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1 \xD9\x85\xD8\xB9 \xD9\x86\xD9\x82\xD8\xAF",
+		"PURCHASE AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1" },
+	{ TYPE_REFUND, "REFUND", "\xD8\xA7\xD8\xB3\xD8\xAA\xD8\xB1\xD8\xAF\xD8\xA7\xD8\xAF",
+		"REFUND AMOUNT", "\xD8\xA7\xD9\x84\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD9\x85\xD8\xB3\xD8\xAA\xD8\xB1\xD8\xAF" },
+	{ TYPE_PREAUTH, "AUTHORIZATION", "\xD8\xAA\xD9\x81\xD9\x88\xD9\x8A\xD8\xB6 \xD9\x85\xD8\xB3\xD8\xA8\xD9\x82",
+		"AUTHORIZATION AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xAA\xD9\x81\xD9\x88\xD9\x8A\xD8\xB6" },
+	// The SDK prints completions with the advice receipt
+	{ TYPE_PRECOMP, "PURCHASE ADVICE", "\xD8\xA5\xD8\xB4\xD8\xB9\xD8\xA7\xD8\xB1 \xD8\xA8\xD8\xA7\xD9\x84\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1",
+		"PURCHASE ADVICE AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xA5\xD8\xB4\xD8\xB9\xD8\xA7\xD8\xB1" },
+	{ TYPE_PREAUTH_EXT, "PRE-AUTH EXTENSION", "\xD8\xAA\xD9\x85\xD8\xAF\xD9\x8A\xD8\xAF \xD8\xA7\xD9\x84\xD8\xAA\xD9\x81\xD9\x88\xD9\x8A\xD8\xB6",
+		"AUTHORIZATION AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xAA\xD9\x81\xD9\x88\xD9\x8A\xD8\xB6" },
+	{ TYPE_PREAUTH_VOID, "PRE-AUTH VOID", "\xD8\xA5\xD9\x84\xD8\xBA\xD8\xA7\xD8\xA1 \xD8\xA7\xD9\x84\xD8\xAA\xD9\x81\xD9\x88\xD9\x8A\xD8\xB6",
+		"PRE-AUTH VOID AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xA5\xD9\x84\xD8\xBA\xD8\xA7\xD8\xA1" },
+	{ TYPE_ADVICE, "PURCHASE ADVICE", "\xD8\xA5\xD8\xB4\xD8\xB9\xD8\xA7\xD8\xB1 \xD8\xA8\xD8\xA7\xD9\x84\xD8\xB4\xD8\xB1\xD8\xA7\xD8\xA1",
+		"PURCHASE ADVICE AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xA5\xD8\xB4\xD8\xB9\xD8\xA7\xD8\xB1" },
+	{ TYPE_CASH_ADVANCE, "CASH ADVANCE", "\xD8\xB3\xD9\x84\xD9\x81\xD8\xA9 \xD9\x86\xD9\x82\xD8\xAF\xD9\x8A\xD8\xA9",
+		"CASH ADVANCE AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xB3\xD9\x84\xD9\x81\xD8\xA9 \xD8\xA7\xD9\x84\xD9\x86\xD9\x82\xD8\xAF\xD9\x8A\xD8\xA9" },
+	{ TYPE_REVERSAL, "REVERSAL", "\xD8\xB9\xD9\x85\xD9\x84\xD9\x8A\xD8\xA9 \xD9\x85\xD8\xB9\xD9\x83\xD9\x88\xD8\xB3\xD8\xA9",
+		"REVERSAL AMOUNT", "\xD8\xA7\xD9\x84\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD9\x85\xD9\x84\xD8\xBA\xD9\x8A" },
+	{ TYPE_BILL_PAY, "BILL PAYMENT", "\xD8\xB3\xD8\xAF\xD8\xA7\xD8\xAF \xD9\x81\xD8\xA7\xD8\xAA\xD9\x88\xD8\xB1\xD8\xA9",
+		"BILL AMOUNT", "\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD9\x81\xD8\xA7\xD8\xAA\xD9\x88\xD8\xB1\xD8\xA9" }
+};
+
+#define ARABIC_NAQD_AMOUNT				"\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD9\x86\xD9\x82\xD8\xAF"
+#define ARABIC_TOTAL_AMOUNT				"\xD8\xA7\xD9\x84\xD9\x85\xD8\xA8\xD9\x84\xD8\xBA \xD8\xA7\xD9\x84\xD8\xA5\xD8\xAC\xD9\x85\xD8\xA7\xD9\x84\xD9\x8A"
+#define ARABIC_APPROVAL_CODE			"\xD8\xB1\xD9\x85\xD8\xB2 \xD8\xA7\xD9\x84\xD9\x85\xD9\x88\xD8\xA7\xD9\x81\xD9\x82\xD8\xA9"
+#define ARABIC_THANK_YOU				"\xD8\xB4\xD9\x83\xD8\xB1\xD8\xA7 \xD9\x84\xD8\xA7\xD8\xB3\xD8\xAA\xD8\xAE\xD8\xAF\xD8\xA7\xD9\x85\xD9\x83\xD9\x85 \xD9\x85\xD8\xAF\xD9\x89"
+#define ARABIC_RETAIN_RECEIPT			"\xD9\x8A\xD8\xB1\xD8\xAC\xD9\x8A \xD8\xA7\xD9\x84\xD8\xA7\xD8\xAD\xD8\xAA\xD9\x81\xD8\xA7\xD8\xB8 \xD8\xA8\xD8\xA7\xD9\x84\xD8\xA5\xD9\x8A\xD8\xB5\xD8\xA7\xD9\x84"
+#define ARABIC_RETAILER_COPY			"** \xD9\x86\xD8\xB3\xD8\xAE\xD8\xA9 \xD8\xA7\xD9\x84\xD8\xAA\xD8\xA7\xD8\xAC\xD8\xB1 **"
+#define ARABIC_CUSTOMER_COPY			"** \xD9\x86\xD8\xB3\xD8\xAE\xD8\xA9 \xD8\xA7\xD9\x84\xD8\xB9\xD9\x85\xD9\x8A\xD9\x84 **"
+
+//MARK: - Characters -
+
+static int inDecode(const unsigned char *pucText, unsigned long *pulCode)
+{
+	unsigned char ucLead = pucText[0];
+	int inLength = 0;
+	int i = 0;
+
+	if(ucLead < 0x80)
+	{
+		*pulCode = ucLead;
+		return 1;
+	}
+	if(ucLead >= 0xC2 && ucLead <= 0xDF)
+	{
+		*pulCode = ucLead & 0x1F;
+		inLength = 2;
+	}
+	else if(ucLead >= 0xE0 && ucLead <= 0xEF)
+	{
+		*pulCode = ucLead & 0x0F;
+		inLength = 3;
+	}
+	else if(ucLead >= 0xF0 && ucLead <= 0xF4)
+	{
+		*pulCode = ucLead & 0x07;
+		inLength = 4;
+	}
+	else
+	{
+		*pulCode = '?';
+		return 1;
+	}
+	for(i = 1; i < inLength; i++)
+	{
+		if((pucText[i] & 0xC0) != 0x80)
+		{
+			*pulCode = '?';
+			return i;
+		}
+		*pulCode = (*pulCode << 6) | (pucText[i] & 0x3F);
+	}
+	return inLength;
+}
+
+// Harakat and zero width controls take no column
+static int inIsCombining(unsigned long ulCode)
+{
+	return (ulCode >= 0x064B && ulCode <= 0x065F) || ulCode == 0x0670 || (ulCode >= 0x06D6 && ulCode <= 0x06ED)
+			|| (ulCode >= 0x08D3 && ulCode <= 0x08FF) || (ulCode >= 0x200B && ulCode <= 0x200F);
+}
+
+static int inIsLatinRun(unsigned long ulCode)
+{
+	return ulCode > ' ' && ulCode < 0x7F;
+}
+
+static unsigned char ucWpc1256(unsigned long ulCode)
+{
+	int i = 0;
+
+	if(ulCode < 0x80)
+		return (unsigned char)ulCode;
+	if(ulCode >= 0x0600 && ulCode <= 0x06FF)
+		return aucArabicWpc1256[ulCode - 0x0600] != 0 ? aucArabicWpc1256[ulCode - 0x0600] : '?';
+	for(i = 0; i < 128; i++)
+	{
+		if(ausWpc1256[i] == ulCode)
+			return (unsigned char)(0x80 + i);
+	}
+	return '?';
+}
+
+//MARK: - Output -
+
+static void vdPut(ECR_TEXT_RECEIPT *pReceipt, const unsigned char *pucBytes, int inLength)
+{
+	if(pReceipt->inOverflow || pReceipt->inLength + inLength > pReceipt->inCapacity)
+	{
+		pReceipt->inOverflow = 1;
+		return;
+	}
+	memcpy(&pReceipt->pucOut[pReceipt->inLength], pucBytes, (size_t)inLength);
+	pReceipt->inLength += inLength;
+}
+
+static void vdPutRun(ECR_TEXT_RECEIPT *pReceipt, unsigned char ucByte, int inCount)
+{
+	unsigned char aucRun[ECR_TEXT_RECEIPT_WIDTH_MAX];
+
+	if(inCount <= 0)
+		return;
+	if(inCount > ECR_TEXT_RECEIPT_WIDTH_MAX)
+		inCount = ECR_TEXT_RECEIPT_WIDTH_MAX;
+	memset(aucRun, ucByte, (size_t)inCount);
+	vdPut(pReceipt, aucRun, inCount);
+}
+
+static int inEncode(int inFormat, unsigned long ulCode, unsigned char *puc)
+{
+	if(inFormat == ECR_RECEIPT_FORMAT_ESCPOS)
+	{
+		puc[0] = ucWpc1256(ulCode);
+		return 1;
+	}
+	if(ulCode < 0x80)
+	{
+		puc[0] = (unsigned char)ulCode;
+		return 1;
+	}
+	if(ulCode < 0x800)
+	{
+		puc[0] = (unsigned char)(0xC0 | (ulCode >> 6));
+		puc[1] = (unsigned char)(0x80 | (ulCode & 0x3F));
+		return 2;
+	}
+	if(ulCode < 0x10000)
+	{
+		puc[0] = (unsigned char)(0xE0 | (ulCode >> 12));
+		puc[1] = (unsigned char)(0x80 | ((ulCode >> 6) & 0x3F));
+		puc[2] = (unsigned char)(0x80 | (ulCode & 0x3F));
+		return 3;
+	}
+	puc[0] = (unsigned char)(0xF0 | (ulCode >> 18));
+	puc[1] = (unsigned char)(0x80 | ((ulCode >> 12) & 0x3F));
+	puc[2] = (unsigned char)(0x80 | ((ulCode >> 6) & 0x3F));
+	puc[3] = (unsigned char)(0x80 | (ulCode & 0x3F));
+	return 4;
+}
+
+static void vdReverse(unsigned long *pulCodes, int inCount)
+{
+	int i = 0;
+
+	for(i = 0; i < inCount / 2; i++)
+	{
+		unsigned long ulCode = pulCodes[i];
+
+		pulCodes[i] = pulCodes[inCount - 1 - i];
+		pulCodes[inCount - 1 - i] = ulCode;
+	}
+}
+
+// Logical to visual order for a printer that prints left to right
+static void vdVisualOrder(unsigned long *pulCodes, int inCount)
+{
+	int inStart = 0, i = 0;
+
+	vdReverse(pulCodes, inCount);
+	while(inStart < inCount)
+	{
+		if(!inIsLatinRun(pulCodes[inStart]))
+		{
+			inStart++;
+			continue;
+		}
+		for(i = inStart; i < inCount && inIsLatinRun(pulCodes[i]); i++)
+			;
+		vdReverse(&pulCodes[inStart], i - inStart);
+		inStart = i;
+	}
+}
+
+// One printed line: pulCodes fits the width and inColumns is its width
+static void vdWriteLine(ECR_TEXT_RECEIPT *pReceipt, unsigned long *pulCodes, int inCount, int inColumns, int inAlign, int inStyle)
+{
+	int inPad = pReceipt->inWidth - inColumns;
+	int inEscPos = pReceipt->inFormat == ECR_RECEIPT_FORMAT_ESCPOS;
+	unsigned char auc[4];
+	unsigned char *pucOut = NULL;
+	int inDirect = 0;
+	int i = 0;
+
+	if(inEscPos && (inStyle & ECR_TEXT_RTL))
+		vdVisualOrder(pulCodes, inCount);
+
+	if(inEscPos && (inStyle & ECR_TEXT_BOLD))
+		vdPut(pReceipt, aucEscPosBoldOn, sizeof(aucEscPosBoldOn));
+	if(inEscPos && (inStyle & ECR_TEXT_TALL))
+		vdPut(pReceipt, aucEscPosTallOn, sizeof(aucEscPosTallOn));
+
+	if(inAlign == ECR_TEXT_CENTER)
+		vdPutRun(pReceipt, ' ', inPad / 2);
+	else if(inAlign == ECR_TEXT_RIGHT)
+		vdPutRun(pReceipt, ' ', inPad);
+
+	// Encoded straight into the output when the worst case of 4 bytes a character fits
+	inDirect = !pReceipt->inOverflow && pReceipt->inLength + inCount * 4 <= pReceipt->inCapacity;
+	pucOut = pReceipt->pucOut + pReceipt->inLength;
+	for(i = 0; i < inCount; i++)
+	{
+		// The code page has no harakat positioning; they are left out
+		if(inEscPos && inIsCombining(pulCodes[i]))
+			continue;
+		if(inDirect)
+			pucOut += inEncode(pReceipt->inFormat, pulCodes[i], pucOut);
+		else
+			vdPut(pReceipt, auc, inEncode(pReceipt->inFormat, pulCodes[i], auc));
+	}
+	if(inDirect)
+		pReceipt->inLength = (int)(pucOut - pReceipt->pucOut);
+
+	if(inEscPos && (inStyle & ECR_TEXT_TALL))
+		vdPut(pReceipt, aucEscPosTallOff, sizeof(aucEscPosTallOff));
+	if(inEscPos && (inStyle & ECR_TEXT_BOLD))
+		vdPut(pReceipt, aucEscPosBoldOff, sizeof(aucEscPosBoldOff));
+	vdPut(pReceipt, (const unsigned char *)"\n", 1);
+}
+
+// Decodes UTF-8, with Arabic-Indic digits as ASCII for the printer code page
+static int inDecodeText(const ECR_TEXT_RECEIPT *pReceipt, const char *pszText, unsigned long *pulCodes, int inMax, int *pinColumns)
+{
+	const unsigned char *pucText = (const unsigned char *)pszText;
+	int inCount = 0;
+
+	*pinColumns = 0;
+	while(*pucText != '\0' && inCount < inMax)
+	{
+		unsigned long ulCode = 0;
+
+		pucText += inDecode(pucText, &ulCode);
+		if(ulCode == '\r' || ulCode == '\n' || ulCode == '\t')
+			ulCode = ' ';
+		if(pReceipt->inFormat == ECR_RECEIPT_FORMAT_ESCPOS && ulCode >= 0x0660 && ulCode <= 0x0669)
+			ulCode = '0' + (ulCode - 0x0660);
+		pulCodes[inCount++] = ulCode;
+		if(!inIsCombining(ulCode))
+			(*pinColumns)++;
+	}
+	return inCount;
+}
+
+static void vdPutEscPos(ECR_TEXT_RECEIPT *pReceipt, const unsigned char *pucBytes, int inLength)
+{
+	if(pReceipt->inFormat == ECR_RECEIPT_FORMAT_ESCPOS)
+		vdPut(pReceipt, pucBytes, inLength);
+}
+
+//MARK: - Receipt -
+
+EXPORT void ecrTextReceiptBegin(ECR_TEXT_RECEIPT *pReceipt, int inFormat, int inWidth, unsigned char *pucOut, int inCapacity)
+{
+	memset(pReceipt, 0x00, sizeof(ECR_TEXT_RECEIPT));
+	pReceipt->pucOut = pucOut;
+	pReceipt->inCapacity = inCapacity;
+	pReceipt->inFormat = inFormat == ECR_RECEIPT_FORMAT_ESCPOS ? ECR_RECEIPT_FORMAT_ESCPOS : ECR_RECEIPT_FORMAT_TEXT;
+	if(inWidth < ECR_TEXT_RECEIPT_WIDTH_MIN)
+		inWidth = ECR_TEXT_RECEIPT_WIDTH_MIN;
+	if(inWidth > ECR_TEXT_RECEIPT_WIDTH_MAX)
+		inWidth = ECR_TEXT_RECEIPT_WIDTH_MAX;
+	pReceipt->inWidth = inWidth;
+
+	vdPutEscPos(pReceipt, aucEscPosInit, sizeof(aucEscPosInit));
+}
+
+EXPORT void ecrTextReceiptLine(ECR_TEXT_RECEIPT *pReceipt, const char *pszText, int inAlign, int inStyle)
+{
+	unsigned long aulCodes[TEXT_LINE_MAX];
+	int inColumns = 0, inStart = 0;
+	int inCount = inDecodeText(pReceipt, pszText, aulCodes, TEXT_LINE_MAX, &inColumns);
+
+	// Wrap at the last space that keeps the line inside the width
+	while(inStart < inCount)
+	{
+		int inEnd = inStart, inBreak = -1, inLineColumns = 0, inBreakColumns = 0;
+
+		while(inEnd < inCount && (inLineColumns < pReceipt->inWidth || inIsCombining(aulCodes[inEnd])))
+		{
+			if(aulCodes[inEnd] == ' ')
+			{
+				inBreak = inEnd;
+				inBreakColumns = inLineColumns;
+			}
+			if(!inIsCombining(aulCodes[inEnd]))
+				inLineColumns++;
+			inEnd++;
+		}
+		if(inEnd < inCount && aulCodes[inEnd] != ' ' && inBreak > inStart)
+		{
+			inEnd = inBreak;
+			inLineColumns = inBreakColumns;
+		}
+		vdWriteLine(pReceipt, &aulCodes[inStart], inEnd - inStart, inLineColumns, inAlign, inStyle);
+
+		inStart = inEnd;
+		while(inStart < inCount && aulCodes[inStart] == ' ')
+			inStart++;
+	}
+}
+
+EXPORT void ecrTextReceiptPair(ECR_TEXT_RECEIPT *pReceipt, const char *pszLeft, const char *pszRight, int inStyle)
+{
+	unsigned long aulCodes[TEXT_LINE_MAX];
+	int inLeftColumns = 0, inRightColumns = 0;
+	int inLeft = inDecodeText(pReceipt, pszLeft, aulCodes, TEXT_LINE_MAX, &inLeftColumns);
+	int inRight = 0;
+	int inGap = 0;
+	int i = 0;
+
+	inRight = inDecodeText(pReceipt, pszRight, &aulCodes[inLeft], TEXT_LINE_MAX - inLeft, &inRightColumns);
+	inGap = pReceipt->inWidth - inLeftColumns - inRightColumns;
+	if(inGap < 1 || inLeft + inGap + inRight > TEXT_LINE_MAX || inLeft == 0 || inRight == 0)
+	{
+		ecrTextReceiptLine(pReceipt, pszLeft, (inStyle & ECR_TEXT_RTL) ? ECR_TEXT_RIGHT : ECR_TEXT_LEFT, inStyle);
+		ecrTextReceiptLine(pReceipt, pszRight, (inStyle & ECR_TEXT_RTL) ? ECR_TEXT_LEFT : ECR_TEXT_RIGHT, inStyle);
+		return;
+	}
+
+	// Logical order "left, gap, right"; an Arabic pair prints with left on the right
+	memmove(&aulCodes[inLeft + inGap], &aulCodes[inLeft], (size_t)inRight * sizeof(unsigned long));
+	for(i = 0; i < inGap; i++)
+		aulCodes[inLeft + i] = ' ';
+	vdWriteLine(pReceipt, aulCodes, inLeft + inGap + inRight, pReceipt->inWidth, ECR_TEXT_LEFT, inStyle);
+}
+
+EXPORT void ecrTextReceiptRule(ECR_TEXT_RECEIPT *pReceipt)
+{
+	vdPutRun(pReceipt, '-', pReceipt->inWidth);
+	vdPut(pReceipt, (const unsigned char *)"\n", 1);
+}
+
+static void vdCut(ECR_TEXT_RECEIPT *pReceipt)
+{
+	if(pReceipt->inFormat == ECR_RECEIPT_FORMAT_ESCPOS)
+		vdPut(pReceipt, aucEscPosCut, sizeof(aucEscPosCut));
+	else
+		vdPut(pReceipt, (const unsigned char *)"\n\n", 2);
+}
+
+EXPORT int ecrTextReceiptFinish(ECR_TEXT_RECEIPT *pReceipt)
+{
+	vdCut(pReceipt);
+	return pReceipt->inOverflow ? -1 : pReceipt->inLength;
+}
+
+//MARK: - Card Transaction Receipt -
+
+static const char *pszField(const char *apszFields[ECR_TEXT_FIELDS], int inField)
+{
+	return apszFields[inField] != NULL ? apszFields[inField] : "";
+}
+
+static void vdLineIf(ECR_TEXT_RECEIPT *pReceipt, const char *pszText, int inStyle)
+{
+	if(pszText[0] != '\0')
+		ecrTextReceiptLine(pReceipt, pszText, ECR_TEXT_CENTER, inStyle);
+}
+
+static void vdPairIf(ECR_TEXT_RECEIPT *pReceipt, const char *pszLeft, const char *pszRight, int inStyle)
+{
+	if(pszLeft[0] != '\0' || pszRight[0] != '\0')
+		ecrTextReceiptPair(pReceipt, pszLeft, pszRight, inStyle);
+}
+
+// Amount in both languages, the way the HTML receipt shows "SAR 10.00"
+static void vdAmount(ECR_TEXT_RECEIPT *pReceipt, const char *apszFields[ECR_TEXT_FIELDS], const char *pszLabel,
+		const char *pszLabelArabic, int inAmount, int inAmountArabic)
+{
+	char szValue[TEXT_VALUE_SIZE];
+
+	if(pszField(apszFields, inAmount)[0] == '\0')
+		return;
+	snprintf(szValue, sizeof(szValue), "%s %s", pszField(apszFields, ECR_TEXT_FIELD_CURRENCY_AR), pszField(apszFields, inAmountArabic));
+	ecrTextReceiptPair(pReceipt, pszLabelArabic, szValue, ECR_TEXT_RTL);
+	snprintf(szValue, sizeof(szValue), "SAR %s", pszField(apszFields, inAmount));
+	ecrTextReceiptPair(pReceipt, pszLabel, szValue, ECR_TEXT_BOLD);
+}
+
+static void vdCardCopy(ECR_TEXT_RECEIPT *pReceipt, const CARD_RECEIPT *pCard, const char *apszFields[ECR_TEXT_FIELDS],
+		const char *pszCopy, const char *pszCopyArabic)
+{
+	char szThanks[TEXT_VALUE_SIZE];
+
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_MERCHANT_NAME_AR), ECR_TEXT_RTL | ECR_TEXT_BOLD);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_MERCHANT_NAME), ECR_TEXT_BOLD);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_MERCHANT_ADDRESS_AR), ECR_TEXT_RTL);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_MERCHANT_ADDRESS), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_DATE), pszField(apszFields, ECR_TEXT_FIELD_TIME), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_MID), pszField(apszFields, ECR_TEXT_FIELD_TID), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_BUSS_CODE), pszField(apszFields, ECR_TEXT_FIELD_STAN), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_APP_VERSION), pszField(apszFields, ECR_TEXT_FIELD_RRN), 0);
+	ecrTextReceiptRule(pReceipt);
+
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_SCHEME_AR), ECR_TEXT_RTL);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_SCHEME), 0);
+	vdLineIf(pReceipt, pCard->pszTitleArabic, ECR_TEXT_RTL | ECR_TEXT_BOLD);
+	vdLineIf(pReceipt, pCard->pszTitle, ECR_TEXT_BOLD | ECR_TEXT_TALL);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_PAN), pszField(apszFields, ECR_TEXT_FIELD_EXPIRY), 0);
+	vdAmount(pReceipt, apszFields, pCard->pszAmount, pCard->pszAmountArabic, ECR_TEXT_FIELD_AMOUNT, ECR_TEXT_FIELD_AMOUNT_AR);
+	vdAmount(pReceipt, apszFields, "NAQD AMOUNT", ARABIC_NAQD_AMOUNT, ECR_TEXT_FIELD_CASHBACK, ECR_TEXT_FIELD_CASHBACK_AR);
+	vdAmount(pReceipt, apszFields, "TOTAL AMOUNT", ARABIC_TOTAL_AMOUNT, ECR_TEXT_FIELD_TOTAL, ECR_TEXT_FIELD_TOTAL_AR);
+	ecrTextReceiptRule(pReceipt);
+
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_RESULT_AR), ECR_TEXT_RTL | ECR_TEXT_BOLD);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_RESULT), ECR_TEXT_BOLD | ECR_TEXT_TALL);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_DISCLAIMER_AR), ECR_TEXT_RTL);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_DISCLAIMER), 0);
+	if(pszField(apszFields, ECR_TEXT_FIELD_AUTH_CODE)[0] != '\0')
+	{
+		ecrTextReceiptPair(pReceipt, ARABIC_APPROVAL_CODE, pszField(apszFields, ECR_TEXT_FIELD_AUTH_CODE_AR), ECR_TEXT_RTL);
+		ecrTextReceiptPair(pReceipt, "APPROVAL CODE", pszField(apszFields, ECR_TEXT_FIELD_AUTH_CODE), 0);
+	}
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_DATE), pszField(apszFields, ECR_TEXT_FIELD_TIME), 0);
+	vdLineIf(pReceipt, ARABIC_THANK_YOU, ECR_TEXT_RTL);
+	snprintf(szThanks, sizeof(szThanks), "THANK YOU FOR USING %s", pszField(apszFields, ECR_TEXT_FIELD_SCHEME));
+	vdLineIf(pReceipt, szThanks, 0);
+	vdLineIf(pReceipt, ARABIC_RETAIN_RECEIPT, ECR_TEXT_RTL);
+	vdLineIf(pReceipt, "PLEASE RETAIN RECEIPT", 0);
+	vdLineIf(pReceipt, pszCopyArabic, ECR_TEXT_RTL | ECR_TEXT_BOLD);
+	vdLineIf(pReceipt, pszCopy, ECR_TEXT_BOLD);
+	ecrTextReceiptRule(pReceipt);
+
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_ENTRY_MODE), pszField(apszFields, ECR_TEXT_FIELD_RESPONSE_CODE), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_AID), pszField(apszFields, ECR_TEXT_FIELD_TVR), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_CVR), pszField(apszFields, ECR_TEXT_FIELD_CID), 0);
+	vdLineIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_CRYPTOGRAM), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_KERNEL_ID), pszField(apszFields, ECR_TEXT_FIELD_PAR), 0);
+	vdPairIf(pReceipt, pszField(apszFields, ECR_TEXT_FIELD_PAN_SUFFIX), pszField(apszFields, ECR_TEXT_FIELD_TSI), 0);
+}
+
+EXPORT int ecrTextReceiptCard(int transactionType, const char *apszFields[ECR_TEXT_FIELDS], int inFormat, int inWidth,
+		unsigned char *pucOut, int inCapacity)
+{
+	ECR_TEXT_RECEIPT receipt;
+	const CARD_RECEIPT *pCard = NULL;
+	size_t i = 0;
+
+	for(i = 0; i < sizeof(aCardReceipts) / sizeof(aCardReceipts[0]); i++)
+	{
+		if(aCardReceipts[i].transactionType == transactionType)
+			pCard = &aCardReceipts[i];
+	}
+	if(pCard == NULL)
+		return -1;
+
+	ecrTextReceiptBegin(&receipt, inFormat, inWidth, pucOut, inCapacity);
+	vdCardCopy(&receipt, pCard, apszFields, "** RETAILER COPY **", ARABIC_RETAILER_COPY);
+	vdCut(&receipt);
+	vdCardCopy(&receipt, pCard, apszFields, "** CUSTOMER COPY **", ARABIC_CUSTOMER_COPY);
+	return ecrTextReceiptFinish(&receipt);
+}
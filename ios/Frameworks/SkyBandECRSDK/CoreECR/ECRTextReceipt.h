@@ -0,0 +1,153 @@
+/*
+ * ECRTextReceipt.h
+ *
+ *  Fixed width receipts for printers that take text directly, as an
+ *  alternative to the HTML receipt that has to be rendered first.
+ *
+ *  ECR_RECEIPT_FORMAT_TEXT gives UTF-8 lines ending in '\n', Arabic in logical
+ *  order and right aligned. ECR_RECEIPT_FORMAT_ESCPOS gives a byte stream for
+ *  ESC/POS printers: ESC @, the Arabic code page (WPC1256), the lines, then a
+ *  feed and a partial cut. Arabic lines are sent in visual order with Latin and
+ *  digit runs kept left to right; letters go in their base form, shaping is
+ *  left to the printer. Arabic-Indic digits are sent as ASCII digits and
+ *  characters the code page lacks as '?'.
+ *
+ *  Widths are counted in characters, combining marks excluded.
+ */
+
+#ifndef ECRSRC_ECRTEXTRECEIPT_H_
+#define ECRSRC_ECRTEXTRECEIPT_H_
+
+#include "SBCoreECR.h"
+
+#define ECR_RECEIPT_FORMAT_HTML			0
+#define ECR_RECEIPT_FORMAT_TEXT			1
+#define ECR_RECEIPT_FORMAT_ESCPOS		2
+
+#define ECR_TEXT_RECEIPT_WIDTH			48		// Font A on 80 mm paper; 32 on 58 mm
+#define ECR_TEXT_RECEIPT_WIDTH_MIN		24
+#define ECR_TEXT_RECEIPT_WIDTH_MAX		64
+#define ECR_TEXT_RECEIPT_BUFFER_SIZE	8192	// Enough for both copies of a card receipt at the widest
+#define ECR_ESCPOS_CODEPAGE_WPC1256		50
+
+#define ECR_TEXT_LEFT					0
+#define ECR_TEXT_CENTER					1
+#define ECR_TEXT_RIGHT					2
+
+#define ECR_TEXT_BOLD					0x01
+#define ECR_TEXT_TALL					0x02	// Double height; ESC/POS only
+#define ECR_TEXT_RTL					0x04	// Arabic line
+
+/* Formatted values of a card transaction receipt, as the HTML receipt shows them */
+typedef enum
+{
+	ECR_TEXT_FIELD_MERCHANT_NAME = 0,
+	ECR_TEXT_FIELD_MERCHANT_ADDRESS,
+	ECR_TEXT_FIELD_MERCHANT_NAME_AR,
+	ECR_TEXT_FIELD_MERCHANT_ADDRESS_AR,
+	ECR_TEXT_FIELD_DATE,
+	ECR_TEXT_FIELD_TIME,
+	ECR_TEXT_FIELD_MID,
+	ECR_TEXT_FIELD_TID,
+	ECR_TEXT_FIELD_BUSS_CODE,
+	ECR_TEXT_FIELD_STAN,
+	ECR_TEXT_FIELD_APP_VERSION,
+	ECR_TEXT_FIELD_RRN,
+	ECR_TEXT_FIELD_SCHEME,
+	ECR_TEXT_FIELD_SCHEME_AR,
+	ECR_TEXT_FIELD_PAN,
+	ECR_TEXT_FIELD_EXPIRY,
+	ECR_TEXT_FIELD_AMOUNT,
+	ECR_TEXT_FIELD_AMOUNT_AR,
+	ECR_TEXT_FIELD_CASHBACK,			// Purchase with cashback only
+	ECR_TEXT_FIELD_CASHBACK_AR,
+	ECR_TEXT_FIELD_TOTAL,
+	ECR_TEXT_FIELD_TOTAL_AR,
+	ECR_TEXT_FIELD_CURRENCY_AR,
+	ECR_TEXT_FIELD_RESULT,
+	ECR_TEXT_FIELD_RESULT_AR,
+	ECR_TEXT_FIELD_DISCLAIMER,
+	ECR_TEXT_FIELD_DISCLAIMER_AR,
+	ECR_TEXT_FIELD_AUTH_CODE,
+	ECR_TEXT_FIELD_AUTH_CODE_AR,
+	ECR_TEXT_FIELD_ENTRY_MODE,
+	ECR_TEXT_FIELD_RESPONSE_CODE,
+	ECR_TEXT_FIELD_AID,
+	ECR_TEXT_FIELD_TVR,
+	ECR_TEXT_FIELD_CVR,
+	ECR_TEXT_FIELD_CID,
+	ECR_TEXT_FIELD_CRYPTOGRAM,
+	ECR_TEXT_FIELD_KERNEL_ID,
+	ECR_TEXT_FIELD_PAR,
+	ECR_TEXT_FIELD_PAN_SUFFIX,
+	ECR_TEXT_FIELD_TSI,
+	ECR_TEXT_FIELDS
+} ECR_TEXT_FIELD;
+
+typedef struct
+{
+	unsigned char *pucOut;
+	int inCapacity;
+	int inLength;
+	int inFormat;
+	int inWidth;
+	int inOverflow;						// Set once a write did not fit; the output is then unusable
+} ECR_TEXT_RECEIPT;
+
+/*********************************************************************************************
+* @func void | ecrTextReceiptBegin |
+* This routine starts a receipt in pucOut; for ESC/POS it writes the printer setup
+*
+* @parm int | inFormat |
+*       This is ECR_RECEIPT_FORMAT_TEXT or ECR_RECEIPT_FORMAT_ESCPOS
+*
+* @parm int | inWidth |
+*       This is the line width in characters, clamped to ECR_TEXT_RECEIPT_WIDTH_MIN..MAX
+* @end
+**********************************************************************************************/
+EXPORT void ecrTextReceiptBegin(ECR_TEXT_RECEIPT *pReceipt, int inFormat, int inWidth, unsigned char *pucOut, int inCapacity);
+
+/*********************************************************************************************
+* @func void | ecrTextReceiptLine |
+* This routine writes UTF-8 text aligned by inAlign, wrapped at spaces if it is too wide
+* @end
+**********************************************************************************************/
+EXPORT void ecrTextReceiptLine(ECR_TEXT_RECEIPT *pReceipt, const char *pszText, int inAlign, int inStyle);
+
+/*********************************************************************************************
+* @func void | ecrTextReceiptPair |
+* This routine writes pszLeft and pszRight on one line, or on two if they do not fit
+* @end
+**********************************************************************************************/
+EXPORT void ecrTextReceiptPair(ECR_TEXT_RECEIPT *pReceipt, const char *pszLeft, const char *pszRight, int inStyle);
+
+EXPORT void ecrTextReceiptRule(ECR_TEXT_RECEIPT *pReceipt);
+
+/*********************************************************************************************
+* @func int | ecrTextReceiptFinish |
+* This routine ends the receipt; for ESC/POS it feeds and cuts
+*
+* @rdesc Returns the output length, -1 if the output did not fit inCapacity
+* @end
+**********************************************************************************************/
+EXPORT int ecrTextReceiptFinish(ECR_TEXT_RECEIPT *pReceipt);
+
+/*********************************************************************************************
+* @func int | ecrTextReceiptCard |
+* This routine writes the merchant and customer copies of a card transaction receipt,
+* laid out as the HTML receipt of the same transaction
+*
+* @parm int | transactionType |
+*       This is TYPE_PURCHASE to TYPE_REVERSAL or TYPE_BILL_PAY
+*
+* @parm const char ** | apszFields |
+*       These are the values by ECR_TEXT_FIELD; NULL or "" leaves a field out
+*
+* @rdesc Returns the output length, -1 for another transaction type or if the output
+*        did not fit inCapacity
+* @end
+**********************************************************************************************/
+EXPORT int ecrTextReceiptCard(int transactionType, const char *apszFields[ECR_TEXT_FIELDS], int inFormat, int inWidth,
+		unsigned char *pucOut, int inCapacity);
+
+#endif /* ECRSRC_ECRTEXTRECEIPT_H_ */
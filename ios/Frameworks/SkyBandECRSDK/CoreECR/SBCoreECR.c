@@ -13,6 +13,11 @@ extern char *getCommand(int tranType);
 extern int validateFieldsCount(int tranType, int fieldsCount);
 
 EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char *szEcrBuffer)
+{
+	return packWithTimeout(inputReqData, transactionType, szSignature, 0, szEcrBuffer);
+}
+
+EXPORT int packWithTimeout(char *inputReqData, int transactionType, char *szSignature, int inTimeoutSeconds, char *szEcrBuffer)
 {
 	int inFieldsCount = 0, inReqPacketIndex = 0, inLCR = 0, retVal = 0, i = 0;
 	char szLCR[LCRBUFFER_SIZE], szLCR_Hex[LCRBUFFER_SIZE];
@@ -45,6 +50,9 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
         memset(szReqFields[i], 0x00, REQFIELD_SIZE+1);
 	}
 
+	if(inTimeoutSeconds > 0)
+		snprintf(sTimeout, sizeof(sTimeout), "%03d", inTimeoutSeconds > TIMEOUT_MAX ? TIMEOUT_MAX : inTimeoutSeconds);
+
 	vdParseRequestData(inputReqData, szReqFields, &inFieldsCount);
 
 	printf("\nszReqFields count = %d\n", inFieldsCount);
@@ -56,7 +64,12 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 	retVal = validateFieldsCount(transactionType, inFieldsCount);
 	if(retVal == -1)
+	{
+		for(i=0; i<10; i++)
+			free(szReqFields[i]);
+		free(szReqFields);
 		return retVal;
+	}
 
 	//STX ("02" Hex)
 	memcpy(szEcrBuffer, STX, STX_SIZE);
@@ -81,14 +94,14 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		if(transactionType == TYPE_BILL_PAY)
 		{
 			memset(szBillerID, 0x00, sizeof(szBillerID));
-			sprintf(szBillerID, "%06lld", atoll(szReqFields[2]));
+			snprintf(szBillerID, sizeof(szBillerID), "%06lld", atoll(szReqFields[2]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szBillerID, BILLERID_SIZE); // Biller Id
 			inReqPacketIndex += BILLERID_SIZE;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
 			inReqPacketIndex++;
 
 			memset(szBillNum, 0x00, sizeof(szBillNum));
-			sprintf(szBillNum, "%06lld", atoll(szReqFields[3]));
+			snprintf(szBillNum, sizeof(szBillNum), "%06lld", atoll(szReqFields[3]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szBillNum, BILLNUM_SIZE); // Bill Number
 			inReqPacketIndex += BILLNUM_SIZE;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -96,7 +109,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		}
 
 		memset(szAmountField, 0x00, sizeof(szAmountField));
-		sprintf(szAmountField, "%012lld", atoll(szReqFields[1]));
+		snprintf(szAmountField, sizeof(szAmountField), "%012lld", atoll(szReqFields[1]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szAmountField, AMT_SIZE); // Transaction Amount
 		inReqPacketIndex += AMT_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -105,7 +118,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		if(transactionType == TYPE_PURCHASE_CASHBACK)
 		{
 			memset(szCashbackAmountField, 0x00, sizeof(szCashbackAmountField));
-			sprintf(szCashbackAmountField, "%012lld", atoll(szReqFields[2]));
+			snprintf(szCashbackAmountField, sizeof(szCashbackAmountField), "%012lld", atoll(szReqFields[2]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szCashbackAmountField, AMT_SIZE); // Cash Back Amount
 			inReqPacketIndex += AMT_SIZE;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -115,7 +128,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 	//Date Time Stamp
 	memset(szDateTimeStamp, 0x00, sizeof(szDateTimeStamp));
-	sprintf(szDateTimeStamp, "%012lld", atoll(szReqFields[0]));
+	snprintf(szDateTimeStamp, sizeof(szDateTimeStamp), "%012lld", atoll(szReqFields[0]));
 	memcpy(&szEcrBuffer[inReqPacketIndex], szDateTimeStamp, DATETIME_SIZE);
 	inReqPacketIndex += DATETIME_SIZE;
 	memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -125,7 +138,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 	{
 		//Request Attempted Number
 		memset(szReqAttemptNum, 0x00, sizeof(szReqAttemptNum));
-		sprintf(szReqAttemptNum, "%03lld", atoll(szReqFields[1]));
+		snprintf(szReqAttemptNum, sizeof(szReqAttemptNum), "%03lld", atoll(szReqFields[1]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szReqAttemptNum, REQATTEMPTNUM_SIZE);
 		inReqPacketIndex += REQATTEMPTNUM_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -136,7 +149,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 	{
 		//Cash Register Number
 		memset(szCashRegNum, 0x00, sizeof(szCashRegNum));
-        sprintf(szCashRegNum, "%s", szReqFields[1]);
+        snprintf(szCashRegNum, sizeof(szCashRegNum), "%s", szReqFields[1]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szCashRegNum, CASHREGNUM_SIZE);
 		inReqPacketIndex += CASHREGNUM_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -150,7 +163,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		{
 			//Refund Amount
 			memset(szRefundAmountField, 0x00, sizeof(szRefundAmountField));
-			sprintf(szRefundAmountField, "%012lld", atoll(szReqFields[1]));
+			snprintf(szRefundAmountField, sizeof(szRefundAmountField), "%012lld", atoll(szReqFields[1]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szRefundAmountField, AMT_SIZE);
 			inReqPacketIndex += AMT_SIZE;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -160,9 +173,9 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		//RRN
 		memset(szRRNField, 0x00, sizeof(szRefundAmountField));
 		if(transactionType == TYPE_PREAUTH_EXT)/* || (transactionType == TYPE_REVERSAL)*/
-			sprintf(szRRNField, "%s", szReqFields[1]);
+			snprintf(szRRNField, sizeof(szRRNField), "%s", szReqFields[1]);
 		else
-			sprintf(szRRNField, "%s", szReqFields[2]);
+			snprintf(szRRNField, sizeof(szRRNField), "%s", szReqFields[2]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szRRNField, RRN_SIZE);
 		inReqPacketIndex += strlen(szRRNField);
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -174,9 +187,9 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		//Original Tran Date
 		memset(szOrigTranDate, 0x00, sizeof(szOrigTranDate));
 		if(transactionType == TYPE_PREAUTH_EXT)
-			sprintf(szOrigTranDate, "%06lld", atoll(szReqFields[2]));
+			snprintf(szOrigTranDate, sizeof(szOrigTranDate), "%06lld", atoll(szReqFields[2]));
 		else
-			sprintf(szOrigTranDate, "%06lld", atoll(szReqFields[3]));
+			snprintf(szOrigTranDate, sizeof(szOrigTranDate), "%06lld", atoll(szReqFields[3]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szOrigTranDate, DATE_SIZE);
 		inReqPacketIndex += DATE_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -185,9 +198,9 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		//Original Approval Code
 		memset(szOrigApprCode, 0x00, sizeof(szOrigApprCode));
 		if(transactionType == TYPE_PREAUTH_EXT)
-			sprintf(szOrigApprCode, "%s", szReqFields[3]);
+			snprintf(szOrigApprCode, sizeof(szOrigApprCode), "%s", szReqFields[3]);
 		else
-			sprintf(szOrigApprCode, "%s", szReqFields[4]);
+			snprintf(szOrigApprCode, sizeof(szOrigApprCode), "%s", szReqFields[4]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szOrigApprCode, APPRCODE_SIZE);
 		inReqPacketIndex += strlen(szOrigApprCode);
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -196,7 +209,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		if((transactionType != TYPE_PREAUTH_EXT) && (transactionType != TYPE_PREAUTH_VOID))
 		{
 			//Partial Completion
-			sprintf(szPartialComp, "%lld", atoll(szReqFields[5]));
+			snprintf(szPartialComp, sizeof(szPartialComp), "%lld", atoll(szReqFields[5]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szPartialComp, PARTIALCOMP_SIZE);
 			inReqPacketIndex++;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -208,7 +221,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 	{
 		//Vendor ID
 		memset(szVendorID, 0x00, sizeof(szVendorID));
-		sprintf(szVendorID, "%s", szReqFields[1]);
+		snprintf(szVendorID, sizeof(szVendorID), "%s", szReqFields[1]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szVendorID, VENDORID_SIZE);
 		inReqPacketIndex += VENDORID_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -216,7 +229,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 		//Vendor Terminal type
 		memset(szVendorTermType, 0x00, sizeof(szVendorTermType));
-		sprintf(szVendorTermType, "%s", szReqFields[2]);
+		snprintf(szVendorTermType, sizeof(szVendorTermType), "%s", szReqFields[2]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szVendorTermType, TERMTYPE_SIZE);
 		inReqPacketIndex += TERMTYPE_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -224,7 +237,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 		//TRSM ID
 		memset(szTRSMID, 0x00, sizeof(szTRSMID));
-		sprintf(szTRSMID, "%s", szReqFields[3]);
+		snprintf(szTRSMID, sizeof(szTRSMID), "%s", szReqFields[3]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szTRSMID, TRSMID_SIZE);
 		inReqPacketIndex += TRSMID_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -232,7 +245,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 		//Vendor Key Index
 		memset(szVendorKeyIndex, 0x00, sizeof(szVendorKeyIndex));
-		sprintf(szVendorKeyIndex, "%02lld", atoll(szReqFields[4]));
+		snprintf(szVendorKeyIndex, sizeof(szVendorKeyIndex), "%02lld", atoll(szReqFields[4]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szVendorKeyIndex, KEYINDEX_SIZE);
 		inReqPacketIndex += KEYINDEX_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -240,7 +253,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 
 		//SAMA Key Index
 		memset(szSAMAKeyIndex, 0x00, sizeof(szSAMAKeyIndex));
-		sprintf(szSAMAKeyIndex, "%02lld", atoll(szReqFields[5]));
+		snprintf(szSAMAKeyIndex, sizeof(szSAMAKeyIndex), "%02lld", atoll(szReqFields[5]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szSAMAKeyIndex, KEYINDEX_SIZE);
 		inReqPacketIndex += KEYINDEX_SIZE;
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -251,10 +264,10 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 	{
 		//Previous ECR Number
 		memset(szPrevECRNum, 0x00, sizeof(szPrevECRNum));
-		sprintf(szPrevECRNum, "%06lld", atoll(szReqFields[1]));
+		snprintf(szPrevECRNum, sizeof(szPrevECRNum), "%06lld", atoll(szReqFields[1]));
 		memcpy(&szEcrBuffer[inReqPacketIndex], szPrevECRNum, ECRNUM_SIZE);
 		inReqPacketIndex += ECRNUM_SIZE;
-		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, ECRNUM_SIZE); // Field separator
+		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
 		inReqPacketIndex++;
 	}
 
@@ -263,21 +276,21 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		//ECR Transaction Reference Number
 		memset(szECRRefNum, 0x00, sizeof(szECRRefNum));
 		if(transactionType == TYPE_PURCHASE || transactionType == TYPE_PREAUTH || transactionType == TYPE_CASH_ADVANCE/* || transactionType == TYPE_REVERSAL*/)
-			sprintf(szECRRefNum, "%s", szReqFields[3]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[3]);
 		else if(transactionType == TYPE_PURCHASE_CASHBACK)
-			sprintf(szECRRefNum, "%s", szReqFields[4]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[4]);
 		else if(transactionType == TYPE_RECONCILATION || transactionType == TYPE_SET_TERM_LANG || transactionType == TYPE_REPEAT
 				|| (transactionType == TYPE_PRNT_SUMMARY_RPORT) || transactionType == TYPE_REVERSAL)
-			sprintf(szECRRefNum, "%s", szReqFields[2]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[2]);
 		else if((transactionType == TYPE_REFUND) || (transactionType == TYPE_PREAUTH_EXT) || (transactionType == TYPE_BILL_PAY))
-			sprintf(szECRRefNum, "%s", szReqFields[5]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[5]);
 		else if(transactionType == TYPE_PRECOMP)
-			sprintf(szECRRefNum, "%s", szReqFields[7]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[7]);
 		else if((transactionType == TYPE_PREAUTH_VOID) || (transactionType == TYPE_SET_PARAM))
-			sprintf(szECRRefNum, "%s", szReqFields[6]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[6]);
 		else if((transactionType == TYPE_PARAM_DOWNLOAD) || (transactionType == TYPE_GET_PARAM) || (transactionType == TYPE_PRNT_DETAIL_RPORT)
 				 || (transactionType == TYPE_CHECK_STATUS) || (transactionType == TYPE_PARTIAL_DOWNLOAD) || (transactionType == TYPE_SNAPSHOT_TOTAL))
-			sprintf(szECRRefNum, "%s", szReqFields[1]);
+			snprintf(szECRRefNum, sizeof(szECRRefNum), "%s", szReqFields[1]);
 		memcpy(&szEcrBuffer[inReqPacketIndex], szECRRefNum, REFNUM_SIZE);
 		inReqPacketIndex += strlen(szECRRefNum);
 		memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -287,7 +300,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		{
 			//Language
 			memset(szLanguage, 0x00, sizeof(szLanguage));
-			sprintf(szLanguage, "%lld", atoll(szReqFields[1]));
+			snprintf(szLanguage, sizeof(szLanguage), "%lld", atoll(szReqFields[1]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szLanguage, LANG_SIZE);
 			inReqPacketIndex++;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -301,17 +314,17 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 		{
 			//Receipt print Flag
 			if(transactionType == TYPE_PURCHASE || transactionType == TYPE_PREAUTH || transactionType == TYPE_CASH_ADVANCE/* || transactionType == TYPE_REVERSAL*/)
-				sprintf(szRcptPrntFlag, "%lld", atoll(szReqFields[2]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld", atoll(szReqFields[2]));
 			else if((transactionType == TYPE_PURCHASE_CASHBACK) || (transactionType == TYPE_REFUND))
-				sprintf(szRcptPrntFlag, "%lld",atoll( szReqFields[3]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld",atoll( szReqFields[3]));
 			else if(transactionType == TYPE_RECONCILATION || transactionType == TYPE_REVERSAL)
-				sprintf(szRcptPrntFlag, "%lld", atoll(szReqFields[1]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld", atoll(szReqFields[1]));
 			else if(transactionType == TYPE_PRECOMP)
-				sprintf(szRcptPrntFlag, "%lld", atoll(szReqFields[6]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld", atoll(szReqFields[6]));
 			else if(transactionType == TYPE_PREAUTH_VOID)
-				sprintf(szRcptPrntFlag, "%lld", atoll(szReqFields[5]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld", atoll(szReqFields[5]));
 			else if((transactionType == TYPE_PREAUTH_EXT) || (transactionType == TYPE_BILL_PAY))
-				sprintf(szRcptPrntFlag, "%lld", atoll(szReqFields[4]));
+				snprintf(szRcptPrntFlag, sizeof(szRcptPrntFlag), "%lld", atoll(szReqFields[4]));
 			memcpy(&szEcrBuffer[inReqPacketIndex], szRcptPrntFlag, PRNTFLAG_SIZE);
 			inReqPacketIndex++;
 			memcpy(&szEcrBuffer[inReqPacketIndex], FIELD_SEPERATOR, FIELDSEP_SIZE); // Field separator
@@ -339,7 +352,7 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 	xorOpBtwnChars ((unsigned char *)szEcrBuffer, inReqPacketIndex, &inLCR);
 	memset(szLCR, 0x00, sizeof(szLCR));
 	memset(szLCR_Hex, 0x00, sizeof(szLCR_Hex));
-	sprintf(szLCR, "%02x", inLCR);
+	snprintf(szLCR, sizeof(szLCR), "%02x", inLCR);
 	if(strlen(szLCR) == 1)
 		ascToHexConv((unsigned char *)szLCR_Hex, (unsigned char *)szLCR, 1);
 	else
@@ -356,22 +369,16 @@ EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char
 EXPORT void parse(char *respData, char *respOutData)
 {
 	int inRespDataIndex = 0;
-	char szDelimiter[DELIMITER_SIZE], szRespDataChar_hex[DELIMITER_SIZE];
+	int inRespDataLength = (int)strlen(respData);
 
-	memset(szDelimiter, 0x00, sizeof(szDelimiter));
-	memset(szRespDataChar_hex, 0x00, sizeof(szRespDataChar_hex));
-	memcpy(szDelimiter, OUT_DELIMITER, strlen(OUT_DELIMITER));
-	for(inRespDataIndex=0; inRespDataIndex<strlen(respData); inRespDataIndex++)
+	// Byte compare instead of formatting every byte as hex against OUT_DELIMITER;
+	// that only matched where char is signed
+	for(inRespDataIndex=0; inRespDataIndex<inRespDataLength; inRespDataIndex++)
 	{
-		sprintf(szRespDataChar_hex, "%x", respData[inRespDataIndex]);
-		if(!strcmp(szRespDataChar_hex, szDelimiter))
-		{
+		if((unsigned char)respData[inRespDataIndex] == (unsigned char)FIELD_SEPERATOR[0])
 			respOutData[inRespDataIndex] = DELIMITOR_CHAR;
-		}
-		if(strcmp(szRespDataChar_hex, szDelimiter))
-		{
-			memcpy(&respOutData[inRespDataIndex], &respData[inRespDataIndex], 1);
-		}
+		else
+			respOutData[inRespDataIndex] = respData[inRespDataIndex];
 	}
 }
 
@@ -25,6 +25,18 @@
 **********************************************************************************************/
 EXPORT int pack(char *inputReqData, int transactionType, char *szSignature, char *szEcrBuffer);
 
+/*********************************************************************************************
+* @func int | packWithTimeout |
+* This routine is pack() with the frame's time out field set by the caller
+*
+* @parm int | inTimeoutSeconds |
+*       This is the time the terminal is given, capped at TIMEOUT_MAX; 0 sends TIMEOUT_VAL
+*
+* @rdesc Returns number of input request data
+* @end
+**********************************************************************************************/
+EXPORT int packWithTimeout(char *inputReqData, int transactionType, char *szSignature, int inTimeoutSeconds, char *szEcrBuffer);
+
 
 /*********************************************************************************************
 * @func void | parse |
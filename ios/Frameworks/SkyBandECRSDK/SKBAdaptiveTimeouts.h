@@ -0,0 +1,53 @@
+//
+//  SKBAdaptiveTimeouts.h
+//  SkyBandECRSDK
+//
+//  Connect and transaction timeouts, and reconnect delays, derived per terminal
+//  from the latencies it recently showed.
+//
+
+#import <Foundation/Foundation.h>
+
+// Main thread only
+@interface SKBAdaptiveTimeouts : NSObject
+
+//MARK: - Derivation Properties -
+
+// Timeouts are timeoutFactor x the percentile latency of the last 64 samples, within
+// the bounds below. Until minSamples are in, the caller's fixed value is used.
+@property (nonatomic) double percentile;                    // Default 0.95
+@property (nonatomic) double timeoutFactor;                 // Default 2
+@property (nonatomic) NSUInteger minSamples;                // Default 8
+@property (nonatomic) NSTimeInterval minConnectTimeout;     // Default 2 s
+@property (nonatomic) NSTimeInterval maxConnectTimeout;     // Default 15 s
+@property (nonatomic) NSTimeInterval minTransactionTimeout; // Default 15 s
+@property (nonatomic) NSTimeInterval maxTransactionTimeout; // Default 150 s
+@property (nonatomic) NSTimeInterval minReconnectInterval;  // Default 1 s
+@property (nonatomic) NSTimeInterval maxReconnectInterval;  // Default 30 s
+@property (nonatomic) double jitter;                        // Reconnect delays drop by up to this fraction, default 0.5
+
++ (SKBAdaptiveTimeouts *)shareInstance;
+
+//MARK: - Sample Methods -
+
+// terminal is "ip:port"
+- (void)recordConnectLatency:(NSTimeInterval)latency terminal:(NSString *)terminal;
+- (void)recordConnectFailure:(NSString *)terminal;
+// A timed out transaction is recorded with the timeout as its latency, so the timeout
+// widens when it keeps cutting replies off
+- (void)recordResponseLatency:(NSTimeInterval)latency transactionType:(int)transactionType terminal:(NSString *)terminal;
+- (void)removeAllSamples;
+
+//MARK: - Timeout Methods -
+
+// Each consecutive connect failure adds one derived timeout, up to maxConnectTimeout,
+// so a slow lane still gets through while a dead one is given up on quickly
+- (NSTimeInterval)connectTimeoutForTerminal:(NSString *)terminal fallback:(NSTimeInterval)fallback;
+- (NSTimeInterval)transactionTimeoutForTerminal:(NSString *)terminal transactionType:(int)transactionType fallback:(NSTimeInterval)fallback;
+// The connect timeout, doubled for each consecutive failure after the first and jittered
+- (NSTimeInterval)reconnectIntervalForTerminal:(NSString *)terminal fallback:(NSTimeInterval)fallback;
+
+// Current values: timeouts, reconnect delay before jitter, sample counts and p50/p95 in ms
+- (NSDictionary *)dictionaryRepresentationForTerminal:(NSString *)terminal connectFallback:(NSTimeInterval)connectFallback reconnectFallback:(NSTimeInterval)reconnectFallback transactionFallback:(NSTimeInterval)transactionFallback;
+
+@end
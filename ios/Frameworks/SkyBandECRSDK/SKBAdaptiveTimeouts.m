@@ -0,0 +1,194 @@
+//
+//  SKBAdaptiveTimeouts.m
+//  SkyBandECRSDK
+//
+//  Connect and transaction timeouts, and reconnect delays, derived per terminal
+//  from the latencies it recently showed.
+//
+
+#import "SKBAdaptiveTimeouts.h"
+#include "ECRLatency.h"
+
+@interface SKBTerminalLatency : NSObject {
+@public
+    ECR_LATENCY_WINDOW _connect;
+}
+
+// Transaction type to an ECR_LATENCY_WINDOW
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSMutableData *> *responses;
+@property (nonatomic) NSUInteger consecutiveFailures;
+
+@end
+
+@implementation SKBTerminalLatency
+
+- (instancetype)init {
+
+    self = [super init];
+    if (self) {
+        ecrLatencyInit(&_connect);
+        _responses = [[NSMutableDictionary alloc]init];
+    }
+    return self;
+}
+
+- (ECR_LATENCY_WINDOW *)responseWindow:(int)transactionType create:(BOOL)create {
+
+    NSMutableData *window = self.responses[@(transactionType)];
+    if (window == nil && create) {
+        window = [NSMutableData dataWithLength:sizeof(ECR_LATENCY_WINDOW)];
+        ecrLatencyInit((ECR_LATENCY_WINDOW *)[window mutableBytes]);
+        self.responses[@(transactionType)] = window;
+    }
+    return (ECR_LATENCY_WINDOW *)[window mutableBytes];
+}
+
+@end
+
+@interface SKBAdaptiveTimeouts ()
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SKBTerminalLatency *> *terminals;
+
+@end
+
+@implementation SKBAdaptiveTimeouts
+
+- (instancetype)init {
+
+    self = [super init];
+    if (self) {
+        _percentile = 0.95;
+        _timeoutFactor = 2;
+        _minSamples = 8;
+        _minConnectTimeout = 2;
+        _maxConnectTimeout = 15;
+        _minTransactionTimeout = 15;
+        _maxTransactionTimeout = 150;
+        _minReconnectInterval = 1;
+        _maxReconnectInterval = 30;
+        _jitter = 0.5;
+        _terminals = [[NSMutableDictionary alloc]init];
+    }
+    return self;
+}
+
++ (SKBAdaptiveTimeouts *)shareInstance {
+
+    static dispatch_once_t once;
+    static id adaptiveTimeouts;
+    dispatch_once(&once, ^{
+        adaptiveTimeouts = [[SKBAdaptiveTimeouts alloc]init];
+    });
+    return adaptiveTimeouts;
+}
+
+- (SKBTerminalLatency *)latencyForTerminal:(NSString *)terminal create:(BOOL)create {
+
+    SKBTerminalLatency *latency = self.terminals[terminal];
+    if (latency == nil && create && terminal != nil) {
+        latency = [[SKBTerminalLatency alloc]init];
+        self.terminals[terminal] = latency;
+    }
+    return latency;
+}
+
+//MARK: - Samples -
+
+- (void)recordConnectLatency:(NSTimeInterval)latency terminal:(NSString *)terminal {
+
+    SKBTerminalLatency *terminalLatency = [self latencyForTerminal:terminal create:YES];
+    ecrLatencyAdd(&terminalLatency->_connect, latency);
+    terminalLatency.consecutiveFailures = 0;
+}
+
+- (void)recordConnectFailure:(NSString *)terminal {
+
+    [self latencyForTerminal:terminal create:YES].consecutiveFailures++;
+}
+
+- (void)recordResponseLatency:(NSTimeInterval)latency transactionType:(int)transactionType terminal:(NSString *)terminal {
+
+    SKBTerminalLatency *terminalLatency = [self latencyForTerminal:terminal create:YES];
+    ecrLatencyAdd([terminalLatency responseWindow:transactionType create:YES], latency);
+}
+
+- (void)removeAllSamples {
+
+    [self.terminals removeAllObjects];
+}
+
+//MARK: - Timeouts -
+
+- (NSTimeInterval)baseConnectTimeout:(SKBTerminalLatency *)latency fallback:(NSTimeInterval)fallback {
+
+    if (latency == nil) {
+        return MIN(MAX(fallback, self.minConnectTimeout), self.maxConnectTimeout);
+    }
+    return ecrLatencyTimeout(&latency->_connect, self.percentile, self.timeoutFactor, self.minConnectTimeout, self.maxConnectTimeout, fallback, (int)self.minSamples);
+}
+
+- (NSTimeInterval)connectTimeoutForTerminal:(NSString *)terminal fallback:(NSTimeInterval)fallback {
+
+    SKBTerminalLatency *latency = [self latencyForTerminal:terminal create:NO];
+    NSTimeInterval timeout = [self baseConnectTimeout:latency fallback:fallback];
+    return MIN(timeout * (1 + latency.consecutiveFailures), self.maxConnectTimeout);
+}
+
+- (NSTimeInterval)transactionTimeoutForTerminal:(NSString *)terminal transactionType:(int)transactionType fallback:(NSTimeInterval)fallback {
+
+    ECR_LATENCY_WINDOW *window = [[self latencyForTerminal:terminal create:NO] responseWindow:transactionType create:NO];
+    if (window == NULL) {
+        return MIN(MAX(fallback, self.minTransactionTimeout), self.maxTransactionTimeout);
+    }
+    return ecrLatencyTimeout(window, self.percentile, self.timeoutFactor, self.minTransactionTimeout, self.maxTransactionTimeout, fallback, (int)self.minSamples);
+}
+
+- (NSTimeInterval)reconnectIntervalForTerminal:(NSString *)terminal fallback:(NSTimeInterval)fallback jitter:(double)jitter {
+
+    SKBTerminalLatency *latency = [self latencyForTerminal:terminal create:NO];
+    // Fast networks retry quickly, slow ones wait about as long as a connect takes there
+    NSTimeInterval base = latency != nil && latency->_connect.inCount >= (int)self.minSamples ? [self baseConnectTimeout:latency fallback:fallback] : fallback;
+    double random = arc4random_uniform(UINT32_MAX) / (double)UINT32_MAX;
+    return ecrLatencyBackoff(base, (int)latency.consecutiveFailures, self.minReconnectInterval, self.maxReconnectInterval, jitter, random);
+}
+
+- (NSTimeInterval)reconnectIntervalForTerminal:(NSString *)terminal fallback:(NSTimeInterval)fallback {
+
+    return [self reconnectIntervalForTerminal:terminal fallback:fallback jitter:self.jitter];
+}
+
+//MARK: - Current Values -
+
+- (NSDictionary *)dictionaryRepresentationForWindow:(const ECR_LATENCY_WINDOW *)window timeout:(NSTimeInterval)timeout {
+
+    NSMutableDictionary *values = [[NSMutableDictionary alloc]init];
+    values[@"timeout"] = @(timeout);
+    values[@"samples"] = @(window ? window->inCount : 0);
+    if (window != NULL && window->inCount > 0) {
+        values[@"p50Ms"] = @((NSInteger)(ecrLatencyPercentile(window, 0.5) * 1000));
+        values[@"p95Ms"] = @((NSInteger)(ecrLatencyPercentile(window, 0.95) * 1000));
+    }
+    return values;
+}
+
+- (NSDictionary *)dictionaryRepresentationForTerminal:(NSString *)terminal connectFallback:(NSTimeInterval)connectFallback reconnectFallback:(NSTimeInterval)reconnectFallback transactionFallback:(NSTimeInterval)transactionFallback {
+
+    SKBTerminalLatency *latency = [self latencyForTerminal:terminal create:NO];
+    NSMutableDictionary *transactions = [[NSMutableDictionary alloc]init];
+    for (NSNumber *transactionType in latency.responses) {
+        ECR_LATENCY_WINDOW *window = [latency responseWindow:[transactionType intValue] create:NO];
+        NSTimeInterval timeout = [self transactionTimeoutForTerminal:terminal transactionType:[transactionType intValue] fallback:transactionFallback];
+        transactions[[transactionType stringValue]] = [self dictionaryRepresentationForWindow:window timeout:timeout];
+    }
+    NSMutableDictionary *connect = [[self dictionaryRepresentationForWindow:latency ? &latency->_connect : NULL timeout:[self connectTimeoutForTerminal:terminal fallback:connectFallback]] mutableCopy];
+    connect[@"consecutiveFailures"] = @(latency.consecutiveFailures);
+    return @{
+        @"terminal": terminal ?: @"",
+        @"connect": connect,
+        @"reconnectInterval": @([self reconnectIntervalForTerminal:terminal fallback:reconnectFallback jitter:0]),
+        @"defaultTransactionTimeout": @(MIN(MAX(transactionFallback, self.minTransactionTimeout), self.maxTransactionTimeout)),
+        @"transactions": transactions
+    };
+}
+
+@end
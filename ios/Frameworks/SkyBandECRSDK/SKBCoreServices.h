@@ -9,6 +9,19 @@
 #import <Foundation/Foundation.h>
 
 @protocol SocketConnectionDelegate;
+@class SKBIdempotencyCache;
+@class SKBAdaptiveTimeouts;
+
+typedef NS_ENUM(NSInteger, SKBSettlementExportFormat) {
+    SKBSettlementExportFormatCSV = 0,
+    SKBSettlementExportFormatColumnar   // Binary columnar file, layout in ECRSettlement.h
+};
+
+typedef NS_ENUM(NSInteger, SKBReceiptFormat) {
+    SKBReceiptFormatHTML = 0,           // NSString, the HTML receipt
+    SKBReceiptFormatText,               // NSString, fixed width UTF-8 lines
+    SKBReceiptFormatESCPOS              // NSData, ESC/POS commands, layout in ECRTextReceipt.h
+};
 
 @interface SKBCoreServices : NSObject
 
@@ -21,6 +34,12 @@
 @property (nonatomic) NSTimeInterval timeoutTimeInterval;
 @property (nonatomic, strong) NSString *ipAdress;
 @property (nonatomic) NSUInteger portNumber;
+@property (nonatomic, readonly) BOOL transactionInFlight;
+@property (atomic, readonly) BOOL probeInFlight;
+@property (nonatomic, readonly) NSDate *lastResponseDate;
+// Characters per line of text and ESC/POS receipts (48 for 80 mm paper, 32 for 58 mm),
+// as it was when the transaction was sent
+@property (nonatomic) NSUInteger receiptLineWidth;
 
 + (SKBCoreServices *)shareInstance;
 
@@ -28,9 +47,122 @@
 - (void)connectSocket:(NSString *)ipAddress portNumber:(NSUInteger)portNumber;
 - (void)disConnectSocket;
 - (NSString*)computeSha256Hash:(NSString *)inputString;
+// Date/time stamp field for a request frame (ddMMyyHHmmss, now)
+- (NSString *)currentDateTimeStamp;
+// Request signature: SHA-256 of the ECR reference number and the registered terminal id
+- (NSString *)requestSignature:(NSString *)ecrRefNum;
+// Same, for a terminal other than the one in the terminalSerialNumber user default
+- (NSString *)requestSignature:(NSString *)ecrRefNum terminalId:(NSString *)terminalId;
 //MARK: - Transaction Method -
 
+// Every response to a transaction carries the request's ECR reference number in
+// "ecrRefNum"; replies from the cache below can overtake the one in flight, so match
+// them by reference. A request pack() refuses sends nothing and gets a
+// "responseMessage" error with "requestError": "invalidRequest". A nil signature is
+// requestSignature: of the request's last field, signed straight into the frame.
 - (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature;
+// As above, with "receiptFormat" of card transactions in receiptFormat. Reports stay HTML.
+- (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature receiptFormat:(SKBReceiptFormat)receiptFormat;
+
+//MARK: - Deadline Transactions -
+
+// Extra time given to settle a transaction whose deadline passed, default 20 s
+@property (nonatomic) NSTimeInterval resolutionTimeout;
+// As above, with the reply due within deadline seconds instead of 150. The terminal gets
+// the deadline less 3 s in the frame's time out field (whole seconds, up to 999), so it
+// has given up before it is asked about the transaction. If no reply comes in time,
+// card transactions are settled with Repeat (C2) and others with Check Status (C3)
+// before the delegate hears anything; the lane is free again within deadline +
+// resolutionTimeout. Responses carry "deadlineOutcome": "completed", "resolved" (the
+// repeated reply), "notProcessed" (the terminal holds no transaction at all) or
+// "unknown" (also when the Repeat returns another reference), and "resolvedBy".
+// Repeat names the transaction by the last 6 digits of its reference, so card
+// transactions need an all digit reference of 6 to 14 digits. A deadline under 4 s or
+// another reference sends nothing and gets a "responseMessage" error with
+// "requestError": "invalidDeadline".
+// The transaction's own reply, if it arrives during the Repeat, is used instead
+// ("resolvedBy": "lateReply"); only a C2 reply is read as the Repeat's answer. The
+// SDK's own requests use references from a sequence of its own, 14 digits from 9.
+- (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature receiptFormat:(SKBReceiptFormat)receiptFormat deadline:(NSTimeInterval)deadline;
+
+//MARK: - Idempotent Retries -
+
+// With a cache set, card transactions are keyed by "ip:port" and ECR reference number.
+// A reference already answered gets that reply again without a frame, tagged
+// "idempotencyReplay": "cached". A reference in flight sends nothing and gets a copy of
+// the pending reply, tagged "joined". Timeouts, and outcomes a deadline left unknown or
+// not processed, are not kept, so the next submission goes to the terminal. A reference
+// reused with another transaction type or other fields sends nothing and gets a
+// "responseMessage" error tagged "rejected".
+@property (nonatomic, strong) SKBIdempotencyCache *idempotencyCache;
+
+//MARK: - Adaptive Timeouts -
+
+// With adaptive timeouts set, the connect timeout, reconnect delay and transaction
+// timeout (when no deadline is given) come from this terminal's recent latencies, per
+// transaction type, instead of timeoutTimeInterval, reconnectTimeInterval and 150 s.
+// Those stay the values used until enough samples are in. Card transactions (those
+// settled by Repeat) wait on the customer and always keep 150 s.
+@property (nonatomic, strong) SKBAdaptiveTimeouts *adaptiveTimeouts;
+// The values the next connect, reconnect and transactions to this terminal would use
+- (NSDictionary *)currentTimeouts;
+
+//MARK: - Health Probe -
+
+// Sends a Check Status (C3) frame outside the delegate flow. The reply is handed to
+// completion only; a transaction started meanwhile waits until the probe settles. After
+// a timeout the connection is reset first, so a late reply is never taken for a transaction's.
+// Returns NO without sending if disconnected or a transaction or probe is in flight.
+- (BOOL)sendCheckStatusProbe:(NSTimeInterval)timeout completion:(void (^)(BOOL success, NSTimeInterval latency))completion;
+
+//MARK: - Summary Report Stream -
+
+// Requests the Print Summary Report (C1) page by page and hands each page's rows to
+// rowsHandler on the main thread as soon as the page is decoded, with the next page
+// already requested. Rows are dictionaries of "transactionType", "date", "rrn",
+// "amount", "state", "time", "pan", "authCode" and "transactionNumber"; no more than
+// one page is held. completion gets the row total and nil, or the
+// terminal's error or "Timeout". Delegate responses are not sent for the pages.
+// Nothing is sent, and completion gets 0 and "Transaction in flight", while a
+// transaction, reconciliation or probe is out, or "Not connected".
+- (void)streamSummaryReport:(NSString *)ecrRefNum rows:(void (^)(NSArray<NSDictionary<NSString *, NSString *> *> *rows))rowsHandler completion:(void (^)(NSUInteger rowCount, NSString *error))completion;
+
+//MARK: - Reconciliation -
+
+// Sends Reconciliation (B1) and hands the reply to completion on the main thread as
+// parse() left it: NUL terminated, fields separated by ';'. No receipt is built, the
+// delegate is not called and settlementTotalRows is not updated; decode the reply with
+// ecrSettlementDecode. completion gets nil and "Timeout" (the connection is then
+// disconnected, not reconnected), "Disconnected", "Not connected", "Transaction in
+// flight" or "Invalid request" (a reference pack() cannot carry) without a reply.
+- (void)sendReconciliation:(NSString *)ecrRefNum printReceipt:(BOOL)printReceipt signature:(NSString *)signature completion:(void (^)(NSData *reply, NSString *error))completion;
+
+//MARK: - Compact Response Record -
+
+// Encodes a response dictionary into the binary record described in ECRRecord.h.
+// "receiptFormat" is left out of the record and only flagged as available.
+// Returns nil if the dictionary holds a key or value the record cannot carry.
+- (NSData *)compactRecordForResponse:(NSDictionary *)responseData;
+
+//MARK: - Settlement Totals -
+
+// Scheme totals of every successful Reconciliation (B1) reply since the last clear,
+// one row per terminal, settlement, scheme, source block and transaction kind.
+@property (nonatomic, readonly) NSUInteger settlementTotalRows;
+- (BOOL)exportSettlementTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format;
+// Writes the rows and, with clear, drops them in the same step, so a reply decoded
+// meanwhile is kept for the next export. Returns the rows written, -1 if the file could
+// not be written (nothing is cleared then).
+- (NSInteger)exportSettlementTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format clear:(BOOL)clear;
+- (void)clearSettlementTotals;
+
+//MARK: - Wire Capture -
+
+// Records every frame written to and read from the terminal, with time, terminal id and
+// transaction type, to the capture file described in ECRCapture.h. An existing capture is
+// appended to. Replay captures with tool/ecr_replay.c.
+- (BOOL)startCaptureToPath:(NSString *)path;
+- (void)stopCapture;
 
 @end
 
@@ -7,29 +7,145 @@
 //
 
 #import "SKBCoreServices.h"
+#import "SKBIdempotencyCache.h"
+#import "SKBAdaptiveTimeouts.h"
 #include "SBCoreECR.h"
-#include <CommonCrypto/CommonDigest.h>
+#include "ECRSrc.h"
 #include "Utilities.h"
+#include "ECRRecord.h"
+#include "ECRSha256.h"
+#include "ECRSettlement.h"
+#include "ECRQueue.h"
+#include "ECRCapture.h"
+#include "ECRFrameCache.h"
+#include "ECRReceiptBundle.h"
+#include "ECRTextReceipt.h"
+#include "ECRIntern.h"
+#include "ECRReport.h"
 #include <UIKit/UIKit.h>
+#include <unistd.h>
 
 static BOOL kShouldReconnectAutomatically = FALSE;
 static NSTimeInterval kReconnectTimeInterval = 3;
 static NSTimeInterval kTimeoutTimeInterval = 5;
+static NSTimeInterval kTransactionTimeInterval = 150;
+static NSTimeInterval kResolutionTimeInterval = 20;
+static NSTimeInterval kDeadlineGuardInterval = 3;     // The terminal times out this much before the deadline
 #define RESPONSE_BUFFER_SIZE 2000
+#define RECEIVE_BUFFER_SIZE 1024
+#define STREAM_EVENT_QUEUE_SIZE 256
+#define DECODE_WORKER_MAX 4
 
-@interface SKBCoreServices () <NSStreamDelegate>
+// Where a transaction sent with a deadline stands; main thread only
+typedef NS_ENUM(NSInteger, SKBResolutionStep) {
+    SKBResolutionStepNone = 0,
+    SKBResolutionStepArmed,             // Deadline running, no reply yet
+    SKBResolutionStepRepeat,            // Repeat (C2) of the expired transaction sent
+    SKBResolutionStepCheckStatus        // Check Status (C3) sent after an expired non-card transaction
+};
+
+@interface SKBCoreServices () <NSStreamDelegate> {
+    ECR_SETTLEMENT_COLUMNS _settlementColumns;
+    ECR_CAPTURE _capture;
+    ECR_FRAME_CACHE _frameCache;        // Main thread only
+    ECR_INTERN_TABLE _internTable;      // Decode queue only, as are the two arrays by slot
+    __strong NSString *_internedFields[ECR_INTERN_SLOTS];
+    __strong NSString *_internedArabic[ECR_INTERN_SLOTS];
+    ECR_REPORT_STREAM _reportStream;    // Decode queue only
+    _Atomic int _sentTransactionType;   // Written by the main thread as a request goes out
+    _Atomic int _sentReceiptFormat;     // Same, the request's receipt format
+    _Atomic int _sentReceiptLineWidth;  // Same, receiptLineWidth when it went out
+    uint64_t _readThrough;              // Socket thread only: sequence of the last frame read
+    _Atomic uint64_t _decodedThrough;   // Sequence of the last frame decoded
+}
 
 @property (nonatomic) CFSocketRef socket;
 @property (nonatomic, strong) NSInputStream *inputStream;
 @property (nonatomic, strong) NSOutputStream *outputStream;
 @property (nonatomic) BOOL connected;
 @property (nonatomic) int transactionType;
+@property (nonatomic) SKBReceiptFormat receiptFormat;
 @property (nonatomic) int summaryReportCalled;
 @property (strong, nonatomic) NSTimer *timer;
 @property (strong,nonatomic) NSMutableDictionary *summaryReport;
+@property (nonatomic) BOOL transactionInFlight;
+@property (atomic) BOOL probeInFlight;
+@property (nonatomic, strong) NSDate *lastResponseDate;
+@property (nonatomic, strong) NSDate *probeStartDate;
+@property (strong, nonatomic) NSTimer *probeTimer;
+@property (nonatomic, copy) void (^probeCompletion)(BOOL success, NSTimeInterval latency);
+@property (nonatomic, strong) NSMutableArray<dispatch_block_t> *pendingTransactions;     // Oldest first
+@property (nonatomic) BOOL probeReconnecting;       // A timed out probe's reply may still come, so the connection is reset
+@property (nonatomic, strong) NSDateFormatter *requestDateFormatter;
+@property (nonatomic, strong) dispatch_queue_t decodeQueue;
+@property (nonatomic, strong) dispatch_queue_t settlementQueue;     // Guards _settlementColumns
+@property (atomic) BOOL reportStreaming;
+@property (nonatomic, copy) NSString *reportRefNum;
+@property (nonatomic) int reportAttempt;
+@property (nonatomic) NSUInteger reportRowCount;
+@property (nonatomic, copy) void (^reportRowsHandler)(NSArray<NSDictionary<NSString *, NSString *> *> *rows);
+@property (nonatomic, copy) void (^reportCompletion)(NSUInteger rowCount, NSString *error);
+@property (atomic) BOOL reconciliationPending;
+@property (nonatomic, copy) void (^reconciliationCompletion)(NSData *reply, NSString *error);
+@property (nonatomic) SKBResolutionStep resolutionStep;
+@property (nonatomic, copy) NSString *deadlineRefNum;
+@property (nonatomic) int deadlineTransactionType;
+@property (nonatomic, strong) NSMutableDictionary *lateResponse;   // The expired transaction's own reply, come during its Repeat
+@property (nonatomic) BOOL decodingLateResponse;                    // Decode queue only
+@property (nonatomic) uint64_t decodeSequence;                      // Decode queue only
+@property (nonatomic) int decodeTransactionType;                    // Decode queue only, the type sent when the frame was read
+@property (nonatomic) SKBReceiptFormat decodeReceiptFormat;         // Decode queue only, as are the two below
+@property (nonatomic) int decodeReceiptLineWidth;
+@property (nonatomic, copy) NSString *requestRefNum;        // The app's reference of the transaction in flight
+@property (nonatomic, copy) NSString *idempotencyRefNum;
+@property (nonatomic, copy) NSString *idempotencyTerminal;
+@property (nonatomic, strong) NSDate *connectStartDate;
+@property (nonatomic, strong) NSDate *transactionStartDate;    // Nil while a resolution request is out
+@property (nonatomic) NSTimeInterval transactionTimeout;
+
+@end
+
+//MARK: - Execution Model -
+//
+// Socket I/O runs on one shared thread, response decoding and receipt rendering on a
+// small pool of serial worker queues. Results come back to the main thread through
+// lock-free queues: stream events over an SPSC ring (the socket thread is the only
+// producer) and decoded responses over an MPSC list (one producer per worker).
+//
+// Frames and stream events are numbered on the socket thread as they arrive, and the
+// main thread delivers them in that order: an event waits until the frames its
+// connection read before it are decoded.
+
+typedef NS_ENUM(NSInteger, SKBHandoffKind) {
+    SKBHandoffKindStreamEvent = 0,
+    SKBHandoffKindResponse,
+    SKBHandoffKindProbeReply,
+    SKBHandoffKindReportPage,
+    SKBHandoffKindReconciliation,
+    SKBHandoffKindLateResponse          // A reply other than the Repeat (C2) answer while a Repeat is out
+};
 
+@interface SKBHandoffItem : NSObject
+
+@property (nonatomic) SKBHandoffKind kind;
+@property (nonatomic) uint64_t sequence;                // Arrival order
+@property (nonatomic) uint64_t awaitsSequence;          // Stream events: the last frame read before
+@property (nonatomic) int transactionType;              // Responses: the type the frame answered
+@property (nonatomic, strong) SKBCoreServices *connection;
+@property (nonatomic, strong) NSStream *stream;
+@property (nonatomic) NSStreamEvent event;
+@property (nonatomic, strong) NSMutableDictionary *responseData;
+
+@end
+
+@implementation SKBHandoffItem
 @end
 
+static ECR_SPSC_QUEUE streamEventQueue;
+static ECR_MPSC_QUEUE responseQueue;
+static _Atomic int drainScheduled;
+static _Atomic uint64_t handoffSequence;
+
 @implementation SKBCoreServices
 
 - (instancetype)init {
@@ -39,11 +155,26 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         self.shouldReconnectAutomatically = kShouldReconnectAutomatically;
         self.reconnectTimeInterval = kReconnectTimeInterval;
         self.timeoutTimeInterval = kTimeoutTimeInterval;
+        self.resolutionTimeout = kResolutionTimeInterval;
+        self.receiptLineWidth = ECR_TEXT_RECEIPT_WIDTH;
         _summaryReport = [[NSMutableDictionary alloc]init];
+        _pendingTransactions = [[NSMutableArray alloc]init];
+        ecrSettlementInit(&_settlementColumns);
+        ecrFrameCacheInit(&_frameCache);
+        ecrInternInit(&_internTable);
+        _decodeQueue = dispatch_queue_create("com.skyband.ecr.decode", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_decodeQueue, [SKBCoreServices nextDecodeWorker]);
+        _settlementQueue = dispatch_queue_create("com.skyband.ecr.settlement", DISPATCH_QUEUE_SERIAL);
     }
     return self;
 }
 
+- (void)dealloc {
+    
+    ecrSettlementFree(&_settlementColumns);
+    ecrCaptureClose(&_capture);
+}
+
 + (SKBCoreServices *)shareInstance {
     
     static dispatch_once_t once;
@@ -54,6 +185,259 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     return  socketService;
 }
 
+//MARK: - Socket Thread And Workers -
+
++ (NSThread *)socketThread {
+    
+    static dispatch_once_t once;
+    static NSThread *socketThread;
+    dispatch_once(&once, ^{
+        ecrSpscInit(&streamEventQueue, STREAM_EVENT_QUEUE_SIZE);
+        ecrMpscInit(&responseQueue);
+        socketThread = [[NSThread alloc]initWithTarget:self selector:@selector(socketThreadMain:) object:nil];
+        socketThread.name = @"com.skyband.ecr.socket";
+        socketThread.qualityOfService = NSQualityOfServiceUserInitiated;
+        [socketThread start];
+    });
+    return socketThread;
+}
+
++ (void)socketThreadMain:(id)object {
+    
+    // The port keeps the run loop alive while no stream is scheduled
+    [[NSRunLoop currentRunLoop] addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+    while (YES) {
+        @autoreleasepool {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+        }
+    }
+}
+
+// Connections are spread over the pool; each keeps its own serial queue so its
+// replies are decoded in arrival order.
++ (dispatch_queue_t)nextDecodeWorker {
+    
+    static dispatch_once_t once;
+    static NSArray<dispatch_queue_t> *workers;
+    static _Atomic unsigned int nextWorker;
+    dispatch_once(&once, ^{
+        NSUInteger count = MAX(1, MIN(DECODE_WORKER_MAX, (NSInteger)[NSProcessInfo processInfo].activeProcessorCount - 1));
+        NSMutableArray *queues = [[NSMutableArray alloc]init];
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+        for (NSUInteger i = 0; i < count; i++) {
+            [queues addObject:dispatch_queue_create("com.skyband.ecr.worker", attributes)];
+        }
+        workers = queues;
+    });
+    return workers[atomic_fetch_add(&nextWorker, 1) % workers.count];
+}
+
++ (void)scheduleDrain {
+    
+    if (atomic_exchange(&drainScheduled, 1) == 0) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [SKBCoreServices drainHandoffQueues];
+        });
+    }
+}
+
++ (uint64_t)nextHandoffSequence {
+    
+    return atomic_fetch_add(&handoffSequence, 1) + 1;
+}
+
+// Main thread only
++ (void)drainHandoffQueues {
+    
+    // The head of each queue, held until it is its turn
+    static SKBHandoffItem *heldResponse;
+    static SKBHandoffItem *heldEvent;
+    
+    // Cleared first, so an item pushed while draining schedules another pass
+    atomic_store(&drainScheduled, 0);
+    while (YES) {
+        void *item = NULL;
+        if (heldResponse == nil && (item = ecrMpscPop(&responseQueue)) != NULL) {
+            heldResponse = (__bridge_transfer SKBHandoffItem *)item;
+        }
+        if (heldEvent == nil && (item = ecrSpscPop(&streamEventQueue)) != NULL) {
+            heldEvent = (__bridge_transfer SKBHandoffItem *)item;
+        }
+        // The frame decode that finishes schedules the pass the event waits for
+        BOOL eventReady = heldEvent != nil && [heldEvent.connection decodedThrough] >= heldEvent.awaitsSequence;
+        SKBHandoffItem *handoff = nil;
+        if (eventReady && (heldResponse == nil || heldEvent.sequence < heldResponse.sequence)) {
+            handoff = heldEvent;
+            heldEvent = nil;
+        }
+        else if (heldResponse != nil) {
+            handoff = heldResponse;
+            heldResponse = nil;
+        }
+        else {
+            break;
+        }
+        [handoff.connection handleHandoffItem:handoff];
+    }
+}
+
+// Socket thread only. Events the ring has no room for wait here in order; the socket
+// thread cannot block on the main thread, which waits on it to open and close streams.
++ (void)flushStreamEventBacklog:(NSMutableArray<SKBHandoffItem *> *)backlog {
+    
+    while (backlog.count > 0) {
+        void *item = (__bridge_retained void *)backlog[0];
+        if (ecrSpscPush(&streamEventQueue, item) == -1) {
+            CFBridgingRelease(item);
+            [self performSelector:@selector(flushStreamEventBacklog:) withObject:backlog afterDelay:0.001];
+            break;
+        }
+        [backlog removeObjectAtIndex:0];
+    }
+    [SKBCoreServices scheduleDrain];
+}
+
+// Socket thread only
+- (void)postStreamEvent:(NSStreamEvent)streamEvent stream:(NSStream *)theStream {
+    
+    static NSMutableArray<SKBHandoffItem *> *backlog;
+    if (backlog == nil) {
+        backlog = [[NSMutableArray alloc]init];
+    }
+    SKBHandoffItem *handoff = [[SKBHandoffItem alloc]init];
+    handoff.kind = SKBHandoffKindStreamEvent;
+    handoff.sequence = [SKBCoreServices nextHandoffSequence];
+    handoff.awaitsSequence = _readThrough;
+    handoff.connection = self;
+    handoff.stream = theStream;
+    handoff.event = streamEvent;
+    [backlog addObject:handoff];
+    // A retry is already scheduled for a backlog left over
+    if (backlog.count == 1) {
+        [SKBCoreServices flushStreamEventBacklog:backlog];
+    }
+}
+
+- (uint64_t)decodedThrough {
+    
+    return atomic_load_explicit(&_decodedThrough, memory_order_acquire);
+}
+
+// Decode workers only
+- (void)postResponse:(NSMutableDictionary *)responseData kind:(SKBHandoffKind)kind {
+    
+    SKBHandoffItem *handoff = [[SKBHandoffItem alloc]init];
+    handoff.kind = kind;
+    handoff.connection = self;
+    // The summary report dictionary is reused by the next reconciliation decode
+    handoff.responseData = (responseData == _summaryReport) ? [responseData mutableCopy] : responseData;
+    handoff.sequence = self.decodeSequence;
+    handoff.transactionType = self.decodeTransactionType;
+    void *item = (__bridge_retained void *)handoff;
+    // Push fails only when no node could be allocated; waiting keeps the order
+    while (ecrMpscPush(&responseQueue, item) == -1) {
+        usleep(1000);
+    }
+    [SKBCoreServices scheduleDrain];
+}
+
+- (void)deliverResponse:(NSMutableDictionary *)responseData {
+    
+    [self postResponse:responseData kind:self.decodingLateResponse ? SKBHandoffKindLateResponse : SKBHandoffKindResponse];
+}
+
+// Main thread only
+- (void)handleHandoffItem:(SKBHandoffItem *)handoff {
+    
+    switch (handoff.kind) {
+        case SKBHandoffKindStreamEvent:
+            [self handleStreamEvent:handoff.event stream:handoff.stream];
+            break;
+            
+        case SKBHandoffKindProbeReply:
+            //Health probe replies never reach the delegate
+            if (self.probeInFlight) {
+                [self finishProbe:YES];
+            }
+            break;
+            
+        case SKBHandoffKindResponse:
+            //Timer
+            [self.timer invalidate];
+            self.transactionInFlight = NO;
+            self.lastResponseDate = [NSDate date];
+            [self recordResponseLatency:handoff.transactionType];
+            [self finishTransactionResponse:handoff.responseData];
+            break;
+            
+        case SKBHandoffKindLateResponse:
+            if (self.resolutionStep != SKBResolutionStepRepeat) {
+                // Not waiting on a resolution: an ordinary reply to a Repeat sent by the app
+                [self.timer invalidate];
+                self.transactionInFlight = NO;
+                self.lastResponseDate = [NSDate date];
+                [self finishTransactionResponse:handoff.responseData];
+                break;
+            }
+            // Kept until the Repeat answer, which is still to come, so that one is not
+            // taken for the next transaction's reply
+            if ([[handoff.responseData[@"ECR Transaction Reference Number"] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] isEqualToString:self.deadlineRefNum]) {
+                self.lateResponse = handoff.responseData;
+            }
+            else {
+                NSLog(@"Dropped a late reply for another reference during Repeat");
+            }
+            break;
+            
+        case SKBHandoffKindReportPage:
+            [self.timer invalidate];
+            self.transactionInFlight = NO;
+            self.lastResponseDate = [NSDate date];
+            [self recordResponseLatency:handoff.transactionType];
+            [self reportPageReceived:handoff.responseData];
+            break;
+            
+        case SKBHandoffKindReconciliation:
+            [self.timer invalidate];
+            self.transactionInFlight = NO;
+            self.lastResponseDate = [NSDate date];
+            [self recordResponseLatency:handoff.transactionType];
+            if (self.reconciliationPending) {
+                [self finishReconciliation:handoff.responseData[@"reply"] error:nil];
+            }
+            break;
+    }
+}
+
+// Settles, caches and hands a transaction's reply to the delegate and joined submissions
+- (void)finishTransactionResponse:(NSMutableDictionary *)responseData {
+    
+    if (self.resolutionStep != SKBResolutionStepNone) {
+        [self settleDeadlineResponse:responseData];
+    }
+    [self tagRequestRefNum:responseData];
+    NSString *outcome = responseData[@"deadlineOutcome"];
+    BOOL final = outcome == nil || [outcome isEqualToString:@"completed"] || [outcome isEqualToString:@"resolved"];
+    NSUInteger waiters = [self finishIdempotentTransaction:responseData final:final];
+    // Copied before the delegate gets to change it
+    NSDictionary *joinedResponse = waiters > 0 ? [responseData copy] : nil;
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+        [self.delegate socketConnectionStream:self didReceiveData:responseData];
+    }
+    [self deliverJoined:waiters response:joinedResponse];
+}
+
+- (void)writeToSocket:(NSData *)data {
+    
+    [self performSelector:@selector(writeOnSocketThread:) onThread:[SKBCoreServices socketThread] withObject:data waitUntilDone:NO];
+}
+
+- (void)writeOnSocketThread:(NSData *)data {
+    
+    [self captureBytes:[data bytes] length:[data length] direction:ECR_CAPTURE_OUTBOUND];
+    [self.outputStream write:[data bytes] maxLength:[data length]];
+}
+
 //MARK:  - Socket Connection -
 
 - (void)connectSocket:(NSString *)ipAddress portNumber:(NSUInteger)portNumber {
@@ -64,6 +448,20 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     NSLog(@"connect to %@:%@", self.ipAdress, @(self.portNumber));
     
     [self disConnectSocket];
+    [self performSelector:@selector(openStreams) onThread:[SKBCoreServices socketThread] withObject:nil waitUntilDone:YES];
+    
+    // Set timeout and interval
+    NSTimeInterval connectTimeout = self.timeoutTimeInterval;
+    if (self.adaptiveTimeouts != nil) {
+        connectTimeout = [self.adaptiveTimeouts connectTimeoutForTerminal:[self terminalAddress] fallback:self.timeoutTimeInterval];
+    }
+    self.connectStartDate = [NSDate date];
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(timeout) object:nil];
+    [self performSelector:@selector(timeout) withObject:nil afterDelay:connectTimeout];
+}
+
+// Socket thread only
+- (void)openStreams {
     
     // Create input and output streams
     CFReadStreamRef readStream;
@@ -88,17 +486,13 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     [self.inputStream setDelegate:self];
     [self.outputStream setDelegate:self];
     
-    // Run the stream loop
+    // Run the stream loop on the socket thread
     [self.inputStream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
     [self.outputStream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
     
     // Open connections
     [self.inputStream open];
     [self.outputStream open];
-    
-    // Set timeout and interval
-    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(timeout) object:nil];
-    [self performSelector:@selector(timeout) withObject:nil afterDelay:self.timeoutTimeInterval];
 }
 
 //MARK:  - Socket Disconnect -
@@ -110,6 +504,20 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     }
     NSLog(@"disconnect");
 
+    [self performSelector:@selector(closeStreams) onThread:[SKBCoreServices socketThread] withObject:nil waitUntilDone:YES];
+    self.connected = NO;
+    
+    // No reply can come for a reconciliation on the wire anymore
+    if (self.reconciliationPending) {
+        [self.timer invalidate];
+        self.transactionInFlight = NO;
+        [self finishReconciliation:nil error:@"Disconnected"];
+    }
+}
+
+// Socket thread only
+- (void)closeStreams {
+    
     // Close streams
     [self.inputStream close];
     [self.outputStream close];
@@ -121,7 +529,6 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     // Dealloc streams
     self.inputStream = nil;
     self.outputStream = nil;
-    self.connected = NO;
 }
 
 - (void)timeout {
@@ -132,11 +539,15 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 
 - (void)reconnectAutomatically {
     
-    NSLog(@"Will reconnect automatically in %@s", @(self.reconnectTimeInterval));
+    NSTimeInterval reconnectInterval = self.reconnectTimeInterval;
+    if (self.adaptiveTimeouts != nil) {
+        reconnectInterval = [self.adaptiveTimeouts reconnectIntervalForTerminal:[self terminalAddress] fallback:self.reconnectTimeInterval];
+    }
+    NSLog(@"Will reconnect automatically in %@s", @(reconnectInterval));
     
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(timeout) object:nil];
     [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(connect) object:nil];
-    [self performSelector:@selector(connect) withObject:nil afterDelay:self.reconnectTimeInterval];
+    [self performSelector:@selector(connect) withObject:nil afterDelay:reconnectInterval];
 }
 
 - (void)setShouldReconnectAutomatically:(BOOL)shouldReconnectAutomatically {
@@ -163,6 +574,13 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(timeout) object:nil];
         
         self.connected = YES;
+        if (self.probeReconnecting) {
+            [self releasePendingTransactions];
+        }
+        if (self.connectStartDate != nil) {
+            [self.adaptiveTimeouts recordConnectLatency:-[self.connectStartDate timeIntervalSinceNow] terminal:[self terminalAddress]];
+            self.connectStartDate = nil;
+        }
         
         // Call delegate after successful connection
         if ([self.delegate respondsToSelector:@selector(socketConnectionStreamDidConnect:)]) {
@@ -176,9 +594,17 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 - (void)connectFailure {
     
     NSLog(@"Can not connect to the host!");
+    if (self.connectStartDate != nil) {
+        [self.adaptiveTimeouts recordConnectFailure:[self terminalAddress]];
+        self.connectStartDate = nil;
+    }
     [self conectionfailDelegate];
     // Confirm disconnection
     [self disConnectSocket];
+    // Queued behind a timed out probe: sent anyway, so their callers get the timeout
+    if (self.probeReconnecting) {
+        [self releasePendingTransactions];
+    }
 
     // Retry if set
     if (self.shouldReconnectAutomatically) {
@@ -199,28 +625,87 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 -(NSString*)computeSha256Hash:(NSString*)input {
     
     const char* str = [input UTF8String];
-    unsigned char result[CC_SHA256_DIGEST_LENGTH];
-    CC_SHA256(str, strlen(str), result);
+    unsigned char result[SHA256_DIGEST_SIZE];
+    char hex[SHA256_HEX_SIZE];
+    SHA256_CTX ctx;
+    sha256Init(&ctx);
+    sha256Update(&ctx, str, strlen(str));
+    sha256Final(&ctx, result);
+    sha256ToHex(result, hex);
+    
+    return [[NSString alloc]initWithBytes:hex length:SHA256_HEX_SIZE encoding:NSASCIIStringEncoding];
+}
 
-    NSMutableString *ret = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH*2];
+- (NSString *)currentDateTimeStamp {
     
-    for(int i = 0; i<CC_SHA256_DIGEST_LENGTH; i++) {
-        [ret appendFormat:@"%02x",result[i]];
+    if (self.requestDateFormatter == nil) {
+        self.requestDateFormatter = [[NSDateFormatter alloc]init];
+        [self.requestDateFormatter setDateFormat:@"ddMMyyHHmmss"];
     }
-    return ret;
+    return [self.requestDateFormatter stringFromDate:[NSDate date]];
+}
+
+- (NSString *)requestSignature:(NSString *)ecrRefNum {
+    
+    NSString *terminalId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+    return [self requestSignature:ecrRefNum terminalId:terminalId];
+}
+
+- (NSString *)requestSignature:(NSString *)ecrRefNum terminalId:(NSString *)terminalId {
+    
+    char signature[SHA256_HEX_SIZE];
+    sha256Signature([ecrRefNum UTF8String], [terminalId UTF8String], signature);
+    return [[NSString alloc]initWithBytes:signature length:SHA256_HEX_SIZE encoding:NSASCIIStringEncoding];
 }
 
 -(void)timeOutException:(NSTimer *)timer {
     
     [self.timer invalidate];
-    if (self.transactionType != 23) {
+    self.transactionInFlight = NO;
+    // No reply within the timeout: the latency was at least that long. Deadlines are the
+    // caller's choice and say nothing about the terminal, so they are not recorded.
+    if (self.transactionStartDate != nil && self.resolutionStep == SKBResolutionStepNone && ![self resolvesByRepeat:self.transactionType]) {
+        [self.adaptiveTimeouts recordResponseLatency:self.transactionTimeout transactionType:self.transactionType terminal:[self terminalAddress]];
+    }
+    self.transactionStartDate = nil;
+    if (self.transactionType != 23 && self.resolutionStep != SKBResolutionStepCheckStatus) {
         [[NSUserDefaults standardUserDefaults]setInteger:self.transactionType forKey:@"LAST_TRANSACTON_TYPE"];
     }
+    if (self.reportStreaming) {
+        [self finishReportStream:@"Timeout"];
+        [self connect];
+        return;
+    }
+    // The connection is reset, reconnecting is up to the caller
+    if (self.reconciliationPending) {
+        self.reconciliationPending = NO;
+        [self disConnectSocket];
+        [self finishReconciliation:nil error:@"Timeout"];
+        return;
+    }
+    // Settle the outcome before the delegate hears of the timeout
+    if (self.resolutionStep == SKBResolutionStepArmed) {
+        [self resolveExpiredTransaction];
+        return;
+    }
+    // The Repeat went unanswered, but the transaction's own reply came meanwhile
+    if (self.resolutionStep == SKBResolutionStepRepeat && self.lateResponse != nil) {
+        [self finishTransactionResponse:[[NSMutableDictionary alloc]init]];
+        [self connect];
+        return;
+    }
     NSMutableDictionary *responseData = [[NSMutableDictionary alloc]init];
     [responseData setValue:@"Timeout Please try again" forKey:@"responseMessage"];
+    if (self.resolutionStep != SKBResolutionStepNone) {
+        self.resolutionStep = SKBResolutionStepNone;
+        [responseData setValue:@"unknown" forKey:@"deadlineOutcome"];
+    }
+    [self tagRequestRefNum:responseData];
+    NSUInteger waiters = [self finishIdempotentTransaction:responseData final:NO];
     if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
         [self.delegate socketConnectionStream:self didReceiveData:responseData];
     }
+    [self deliverJoined:waiters response:responseData];
     //Disconnect and ReConnect
     [self connect];
 }
@@ -229,13 +714,106 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 //MARK:  - Send Data to Socket -
 
 - (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature {
+    
+    [self doTCPIPTransaction:ipAddress portNumber:portNumber requestData:requestData transactionType:transactionType signature:signature receiptFormat:SKBReceiptFormatHTML];
+}
+
+- (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature receiptFormat:(SKBReceiptFormat)receiptFormat {
+    
+    [self doTCPIPTransaction:ipAddress portNumber:portNumber requestData:requestData transactionType:transactionType signature:signature receiptFormat:receiptFormat deadline:0];
+}
+
+- (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature receiptFormat:(SKBReceiptFormat)receiptFormat deadline:(NSTimeInterval)deadline {
     int retVal = -1;
+    
+    // Never interleave with a health probe, its reply would be taken for ours
+    if (self.probeInFlight || self.probeReconnecting) {
+        __weak SKBCoreServices *weakSelf = self;
+        [self.pendingTransactions addObject:^{
+            [weakSelf doTCPIPTransaction:ipAddress portNumber:portNumber requestData:requestData transactionType:transactionType signature:signature receiptFormat:receiptFormat deadline:deadline];
+        }];
+        return;
+    }
+    
+    // A deadline the terminal cannot be held to, or a card transaction whose Repeat
+    // could not name it, is refused before anything is sent
+    BOOL resolving = self.resolutionStep == SKBResolutionStepRepeat || self.resolutionStep == SKBResolutionStepCheckStatus;
+    if (deadline > 0 && !resolving) {
+        NSString *error = nil;
+        if (deadline < kDeadlineGuardInterval + 1) {
+            error = [NSString stringWithFormat:@"Deadline must be at least %@ seconds", @(kDeadlineGuardInterval + 1)];
+        }
+        else if ([self resolvesByRepeat:transactionType] && [self previousEcrNumber:[self lastRequestField:requestData]] == nil) {
+            error = [NSString stringWithFormat:@"ECR reference number must be at least %d digits for a deadline", ECRNUM_SIZE];
+        }
+        if (error != nil) {
+            [self refuseRequest:requestData error:@"invalidDeadline" message:error];
+            return;
+        }
+    }
+    
+    // A resent reference is answered locally or joins the one in flight
+    if (self.idempotencyCache != nil && [self resolvesByRepeat:transactionType]) {
+        NSString *ecrRefNum = [self lastRequestField:requestData];
+        NSString *terminal = [self terminalAddress];
+        NSString *digest = [self requestDigest:requestData transactionType:transactionType];
+        NSMutableDictionary *cachedResponse = nil;
+        SKBIdempotencyState state = [self.idempotencyCache beginTransaction:ecrRefNum terminal:terminal digest:digest response:&cachedResponse];
+        if (state == SKBIdempotencyStateCompleted) {
+            [cachedResponse setValue:@"cached" forKey:@"idempotencyReplay"];
+        }
+        else if (state == SKBIdempotencyStateMismatch) {
+            cachedResponse = [[NSMutableDictionary alloc]init];
+            [cachedResponse setValue:@"ECR reference number already used for a different request" forKey:@"responseMessage"];
+            [cachedResponse setValue:@"rejected" forKey:@"idempotencyReplay"];
+        }
+        if (cachedResponse != nil) {
+            // Callers match replies by reference, so this may overtake the one in flight
+            [cachedResponse setValue:ecrRefNum forKey:@"ecrRefNum"];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+                    [self.delegate socketConnectionStream:self didReceiveData:cachedResponse];
+                }
+            });
+            return;
+        }
+        if (state == SKBIdempotencyStatePending) {
+            NSLog(@"Trnx %@ already in flight, joined", ecrRefNum);
+            return;
+        }
+        self.idempotencyRefNum = ecrRefNum;
+        self.idempotencyTerminal = terminal;
+    }
+    
+    // The terminal gets the deadline less a guard in whole seconds, in the frame's time out
+    // field, so it has given up before the Repeat goes out even if its clock started late
+    int frameTimeout = deadline > 0 ? (int)MIN(MAX(floor(deadline - kDeadlineGuardInterval), 1), TIMEOUT_MAX) : 0;
+    
+    // Resolution requests keep the state of the transaction they settle
+    if (self.resolutionStep == SKBResolutionStepNone || self.resolutionStep == SKBResolutionStepArmed) {
+        self.resolutionStep = deadline > 0 ? SKBResolutionStepArmed : SKBResolutionStepNone;
+        self.deadlineRefNum = deadline > 0 ? [self lastRequestField:requestData] : nil;
+        self.deadlineTransactionType = transactionType;
+        self.lateResponse = nil;
+        self.requestRefNum = [self lastRequestField:requestData];
+        self.transactionStartDate = [NSDate date];
+    }
+    else {
+        self.transactionStartDate = nil;
+    }
+    
     NSLog(@"inputRequest:%@, TransactionType: %d", requestData,transactionType);
     const char *inputRequest = [requestData cStringUsingEncoding:NSUTF8StringEncoding];
     self.transactionType = transactionType;
+    atomic_store(&_sentTransactionType, transactionType);
+    atomic_store(&_sentReceiptFormat, (int)receiptFormat);
+    atomic_store(&_sentReceiptLineWidth, (int)MIN(self.receiptLineWidth, ECR_TEXT_RECEIPT_WIDTH_MAX));
+    self.receiptFormat = receiptFormat;
+    self.transactionInFlight = YES;
     
     //Timer
-    self.timer = [NSTimer scheduledTimerWithTimeInterval:150.0 target:self selector:@selector(timeOutException:) userInfo:nil repeats:NO];
+    self.transactionTimeout = deadline > 0 ? deadline : [self transactionTimeoutForType:transactionType];
+    self.timer = [NSTimer scheduledTimerWithTimeInterval:self.transactionTimeout target:self selector:@selector(timeOutException:) userInfo:nil repeats:NO];
     
     NSLog(@"Trnx:%d",self.transactionType);
     
@@ -243,39 +821,40 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
     unsigned char ecrBuffer[600];
     memset(ecrBuffer, 0x00, sizeof(ecrBuffer));
     if (transactionType == 17 || transactionType == 18 || transactionType == 19) {
-        retVal = pack((char *)inputRequest, transactionType, "00000000000000000000000", (char *)ecrBuffer);
+        retVal = packWithTimeout((char *)inputRequest, transactionType, "00000000000000000000000", frameTimeout, (char *)ecrBuffer);
         if(retVal == -1) {
-            UIAlertController *alert = [UIAlertController alertControllerWithTitle:@"Skyband ECR" message:@"Invalid input request packet. Please check input fields" preferredStyle:UIAlertControllerStyleAlert];
-            UIAlertAction * ok = [UIAlertAction actionWithTitle:@"OK" style:UIAlertActionStyleDefault handler:^(UIAlertAction * action) {
-                [self.delegate socketConnectionStreamDidDisconnect:self willReconnectAutomatically:NO];
-            }];
-            [alert addAction:ok];
-            UIViewController *currentTopVC = [self currentTopViewController];
-            [currentTopVC presentViewController:alert animated:YES completion:nil];
+            [self requestPackFailed:requestData];
             return;
         }
         else {
             NSLog(@"ecrbufferdata:%s ,%lu",ecrBuffer,strlen(ecrBuffer));
             
              NSData *inputData = [NSData dataWithBytes:ecrBuffer length:strlen(ecrBuffer)];
-            [self.outputStream write:[inputData bytes] maxLength:[inputData length]];
+            [self writeToSocket:inputData];
         }
         
     }
     else {
  
-        const char *sig = [signature cStringUsingEncoding:NSUTF8StringEncoding];
+        // The SDK's own requests are signed here, straight into the slot pack() reads
+        char signatureSlot[SHA256_HEX_SIZE + 1] = { 0 };
+        if (signature == nil) {
+            NSString *terminalId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+            sha256Signature([[self lastRequestField:requestData] UTF8String], [terminalId UTF8String], signatureSlot);
+        }
+        const char *sig = signature ? [signature cStringUsingEncoding:NSUTF8StringEncoding] : signatureSlot;
+        
+        //Status and housekeeping commands come from a prebuilt template, which carries TIMEOUT_VAL
+        int frameLength = frameTimeout > 0 ? -1 : ecrFrameCacheEmitRequest(&_frameCache, transactionType, inputRequest, sig, ecrBuffer);
+        if (frameLength > 0) {
+            [self writeToSocket:[NSData dataWithBytes:ecrBuffer length:frameLength]];
+            return;
+        }
         
         //Packing the input data
-        retVal = pack((char *)inputRequest, transactionType, (char *)sig, (char *)ecrBuffer);
+        retVal = packWithTimeout((char *)inputRequest, transactionType, (char *)sig, frameTimeout, (char *)ecrBuffer);
         if(retVal == -1) {
-            UIAlertController *alert = [UIAlertController alertControllerWithTitle:@"Skyband ECR" message:@"Invalid input request packet. Please check input fields" preferredStyle:UIAlertControllerStyleAlert];
-            UIAlertAction * ok = [UIAlertAction actionWithTitle:@"OK" style:UIAlertActionStyleDefault handler:^(UIAlertAction * action) {
-                [self.delegate socketConnectionStreamDidDisconnect:self willReconnectAutomatically:NO];
-            }];
-            [alert addAction:ok];
-            UIViewController *currentTopVC = [self currentTopViewController];
-            [currentTopVC presentViewController:alert animated:YES completion:nil];
+            [self requestPackFailed:requestData];
             return;
         }
         else {
@@ -284,55 +863,127 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             NSData *inputData = [NSData dataWithBytes:ecrBuffer length:strlen(ecrBuffer)];
             
             // Send string as bytes
-            [self.outputStream write:[inputData bytes] maxLength:[inputData length]];
+            [self writeToSocket:inputData];
+        }
+    }
+}
+
+// pack() refused the request: nothing was sent, so the caller is told now
+- (void)requestPackFailed:(NSString *)requestData {
+    
+    [self.timer invalidate];
+    self.transactionInFlight = NO;
+    self.transactionStartDate = nil;
+    self.resolutionStep = SKBResolutionStepNone;
+    self.requestRefNum = nil;
+    // The SDK's own requests fail through their completion, without UI
+    if (self.reconciliationPending) {
+        [self finishReconciliation:nil error:@"Invalid request"];
+        return;
+    }
+    if (self.reportStreaming) {
+        [self finishReportStream:@"Invalid request"];
+        return;
+    }
+    [self finishIdempotentTransaction:nil final:NO];
+    [self refuseRequest:requestData error:@"invalidRequest" message:@"Invalid input request packet. Please check input fields"];
+    UIAlertController *alert = [UIAlertController alertControllerWithTitle:@"Skyband ECR" message:@"Invalid input request packet. Please check input fields" preferredStyle:UIAlertControllerStyleAlert];
+    UIAlertAction * ok = [UIAlertAction actionWithTitle:@"OK" style:UIAlertActionStyleDefault handler:^(UIAlertAction * action) {
+        [self.delegate socketConnectionStreamDidDisconnect:self willReconnectAutomatically:NO];
+    }];
+    [alert addAction:ok];
+    UIViewController *currentTopVC = [self currentTopViewController];
+    [currentTopVC presentViewController:alert animated:YES completion:nil];
+}
+
+// Answers a request that was not sent with a "responseMessage" error and its kind in "requestError"
+- (void)refuseRequest:(NSString *)requestData error:(NSString *)error message:(NSString *)message {
+    
+    NSMutableDictionary *responseData = [[NSMutableDictionary alloc]init];
+    [responseData setValue:message forKey:@"responseMessage"];
+    [responseData setValue:error forKey:@"requestError"];
+    [responseData setValue:[self lastRequestField:requestData] forKey:@"ecrRefNum"];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+            [self.delegate socketConnectionStream:self didReceiveData:responseData];
         }
+    });
+}
+
+// Every response to an app's request carries its reference in "ecrRefNum", so callers
+// with several requests out match replies by reference, not by order
+- (void)tagRequestRefNum:(NSMutableDictionary *)responseData {
+    
+    if (self.requestRefNum != nil) {
+        [responseData setValue:self.requestRefNum forKey:@"ecrRefNum"];
+        self.requestRefNum = nil;
     }
 }
 
 //MARK:  - Data Received From Socket -
 
+// Runs on the connection's decode queue; the result reaches the delegate through deliverResponse:
 -(void)receivedData:(uint8_t[1024])receivedData {
     
-    //Timer
-    [self.timer invalidate];
+    //Health probe replies skip decoding
+    if (self.probeInFlight) {
+        [self postResponse:nil kind:SKBHandoffKindProbeReply];
+        return;
+    }
+    self.decodingLateResponse = NO;
     
     char ecrResponse[RESPONSE_BUFFER_SIZE];
     memset(ecrResponse, 0x00, sizeof(ecrResponse));
     
     parse(receivedData, ecrResponse);
     
-    NSLog(@"output data parser for the Trnx:%d",self.transactionType);
-    NSString *str = [NSString stringWithFormat:@"%s",ecrResponse];
-    NSArray *szRespFiel = [str componentsSeparatedByString:@";"];
-    NSMutableArray *szRespField = [[NSMutableArray alloc]initWithArray:szRespFiel];
+    //Summary report pages are decoded in place, rows only
+    if (self.decodeTransactionType == 22 && self.reportStreaming) {
+        [self decodeReportPage:ecrResponse];
+        return;
+    }
+    
+    //Reconciliation replies asked for raw are decoded by the caller
+    if (self.decodeTransactionType == 10 && self.reconciliationPending) {
+        NSMutableDictionary *reply = [[NSMutableDictionary alloc]init];
+        [reply setValue:[NSData dataWithBytes:ecrResponse length:strlen(ecrResponse) + 1] forKey:@"reply"];
+        [self postResponse:reply kind:SKBHandoffKindReconciliation];
+        return;
+    }
+    
+    NSLog(@"output data parser for the Trnx:%d",self.decodeTransactionType);
+    NSMutableArray *szRespField = [self internedFields:ecrResponse];
     
     NSMutableDictionary *responseData = [[NSMutableDictionary alloc]init];
     
-    if (self.transactionType == 23) { //REPEAT
+    if (self.decodeTransactionType == 23) { //REPEAT
         if ([[NSUserDefaults standardUserDefaults]valueForKey:@"LAST_TRANSACTON_TYPE"]) {
             unsigned int trnxType = [[[NSUserDefaults standardUserDefaults] objectForKey:@"LAST_TRANSACTON_TYPE"] unsignedIntValue];
-             self.transactionType = trnxType;
+             self.decodeTransactionType = trnxType;
             
-            if (szRespField.count > 5 ) {
+            // Only a C2 reply carries the Repeat fields; anything else is the previous
+            // transaction's own reply, come late, and is decoded as it is
+            if (szRespField.count > 1 && ![szRespField[1] isEqualToString:@CMD_REPEAT]) {
+                self.decodingLateResponse = YES;
+            }
+            else if (szRespField.count > 5 ) {
                 for (int i = 3; i > -1; --i) {
                     [szRespField removeObjectAtIndex:i];
                 }
             }
             if ([szRespField[1] isEqual:@"NO DATA FOUND"]) {
                 [responseData setValue:@"NO DATA FOUND" forKey:@"responseMessage"];
-                if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
-                    [self.delegate socketConnectionStream:self didReceiveData:responseData];
-                }
+                [self deliverResponse:responseData];
                 return;
             }
         }
     }
     
-    if (self.transactionType != 23) {
-        [[NSUserDefaults standardUserDefaults]setInteger:self.transactionType forKey:@"LAST_TRANSACTON_TYPE"];
+    if (self.decodeTransactionType != 23) {
+        [[NSUserDefaults standardUserDefaults]setInteger:self.decodeTransactionType forKey:@"LAST_TRANSACTON_TYPE"];
     }
     
-    if (self.transactionType == 0) { // SALE
+    if (self.decodeTransactionType == 0) { // SALE
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"0"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -347,8 +998,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -360,24 +1011,24 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
-            NSLog(@"MerchantName_Arebic encodingISO_8859_6: %@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]);
-            NSLog(@"MerchantAddress_Arebic encodingISO_8859_6: %@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]);
+            [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
+            NSLog(@"MerchantName_Arebic encodingISO_8859_6: %@", [self arabicField:[szRespField objectAtIndex:33]]);
+            NSLog(@"MerchantAddress_Arebic encodingISO_8859_6: %@", [self arabicField:[szRespField objectAtIndex:34]]);
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-                NSString *htmlString = [self getHtmlString:@"Purchase(customer_copy)" transactionType:0 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+                id receipt = [self receiptForTemplate:@"Purchase(customer_copy)" transactionType:0 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -389,7 +1040,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 1) { // SALE WITH CASHBACK
+    else if (self.decodeTransactionType == 1) { // SALE WITH CASHBACK
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"1"] forKey:@"Transaction type"];
         if (szRespField.count > 33) {
@@ -407,8 +1058,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:14] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:15] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:17]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:18]] forKey:@"Application Cryptogram"];
@@ -420,22 +1071,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:27] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:33]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:34]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:35]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:36]]]] forKey:@"MerchantAddress_Arebic"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:33] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:34] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:35]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:36]] forKey:@"MerchantAddress_Arebic"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:37]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:38]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-               NSString *htmlString = [self getHtmlString:@"Purchase cashback(customer copy))" transactionType:1 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Purchase cashback(customer copy))" transactionType:1 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         
         }
@@ -448,7 +1099,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 2) { // REFUND
+    else if (self.decodeTransactionType == 2) { // REFUND
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"2"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -463,8 +1114,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+             [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+             [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -476,22 +1127,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+             [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+             [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+             [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+             [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-                NSString *htmlString = [self getHtmlString:@"Refund(customer_copy)" transactionType:2 trxnResponse:szRespField];
-                [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+                id receipt = [self receiptForTemplate:@"Refund(customer_copy)" transactionType:2 trxnResponse:szRespField];
+                [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -503,7 +1154,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 3) { // Preautharization
+    else if (self.decodeTransactionType == 3) { // Preautharization
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"3"] forKey:@"Transaction type"];
         if (szRespField.count > 31 ) {
@@ -519,8 +1170,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+             [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+             [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -532,22 +1183,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+             [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+             [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+             [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+             [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-               NSString *htmlString = [self getHtmlString:@"Pre-Auth(Customer_copy)" transactionType:3 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Pre-Auth(Customer_copy)" transactionType:3 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -559,7 +1210,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 4 || self.transactionType == 27) { // PURCHASE ADVICE (FULL or PARTIAL)
+    else if (self.decodeTransactionType == 4 || self.decodeTransactionType == 27) { // PURCHASE ADVICE (FULL or PARTIAL)
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"4"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -574,8 +1225,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+             [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+             [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -587,22 +1238,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+             [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+             [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+             [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+             [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-                NSString *htmlString = [self getHtmlString:@"Purchase Advice(Customer_copy)" transactionType:4 trxnResponse:szRespField];
-                [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+                id receipt = [self receiptForTemplate:@"Purchase Advice(Customer_copy)" transactionType:4 trxnResponse:szRespField];
+                [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -614,7 +1265,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 5) { // PRE AUTH EXTENSION
+    else if (self.decodeTransactionType == 5) { // PRE AUTH EXTENSION
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"5"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -629,8 +1280,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -642,22 +1293,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+            [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-                NSString *htmlString = [self getHtmlString:@"Pre-Extension(Customer_copy)" transactionType:5 trxnResponse:szRespField];
-                [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+                id receipt = [self receiptForTemplate:@"Pre-Extension(Customer_copy)" transactionType:5 trxnResponse:szRespField];
+                [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -669,7 +1320,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 6) { // PRE AUTH VOID
+    else if (self.decodeTransactionType == 6) { // PRE AUTH VOID
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"6"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -684,8 +1335,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -697,22 +1348,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+            [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-               NSString *htmlString = [self getHtmlString:@"Pre-void(Customer_copy)" transactionType:6 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Pre-void(Customer_copy)" transactionType:6 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -725,7 +1376,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 8) { // CASH ADVANCE
+    else if (self.decodeTransactionType == 8) { // CASH ADVANCE
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"8"] forKey:@"Transaction type"];
         if (szRespField.count > 31) {
@@ -740,8 +1391,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+             [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+             [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -753,22 +1404,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+             [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+             [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+            [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+             [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+             [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+            [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
              [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
             
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-               NSString *htmlString = [self getHtmlString:@"Cash_Advance(Customer_copy)" transactionType:8 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Cash_Advance(Customer_copy)" transactionType:8 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
         }
         else if (szRespField.count >= 4) {
@@ -781,7 +1432,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 9) { // REVERSAL
+    else if (self.decodeTransactionType == 9) { // REVERSAL
         
        [responseData setValue:[NSString stringWithFormat:@"%@", @"9"] forKey:@"Transaction type"];
        if (szRespField.count > 31) {
@@ -796,8 +1447,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -809,22 +1460,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-           [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-           [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-           [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+            [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+           [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+           [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+           [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
 
            if ([szRespField[2] isEqual: @"400"]) {
-               NSString *htmlString = [self getHtmlString:@"Reversal(Customer_copy)" transactionType:9 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Reversal(Customer_copy)" transactionType:9 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
            }
            
         }
@@ -838,7 +1489,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 10) { // SETTLEMENT
+    else if (self.decodeTransactionType == 10) { // SETTLEMENT
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"10"] forKey:@"Transaction type"];
         
@@ -846,6 +1497,11 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         
           if ([szRespField[2] isEqual: @"500"] || [szRespField[2] isEqual: @"501"] ) {
 
+             NSString *terminalId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+             const char *reply = ecrResponse;
+             dispatch_sync(self.settlementQueue, ^{
+                 ecrSettlementDecode(&self->_settlementColumns, [terminalId UTF8String], reply);
+             });
              NSString *htmlString = [self getHtmlString:@"Reconcilation" transactionType:10 trxnResponse:szRespField];
              responseData = _summaryReport;
              [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
@@ -854,10 +1510,10 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
           else {
              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[2]] forKey:@"Response Code"];
              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[3]] forKey:@"Response Message"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[4]] forKey:@"Merchant Name"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[5]] forKey:@"Merchant Address"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[6]]]] forKey:@"MerchantName_Arebic"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[7]]]] forKey:@"MerchantAddress_Arebic"];
+             [responseData setValue:szRespField[4] forKey:@"Merchant Name"];
+             [responseData setValue:szRespField[5] forKey:@"Merchant Address"];
+              [responseData setValue:[self arabicField:szRespField[6]] forKey:@"MerchantName_Arebic"];
+              [responseData setValue:[self arabicField:szRespField[7]] forKey:@"MerchantAddress_Arebic"];
              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[8]] forKey:@"ECR Transaction Reference Number"];
              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[9]] forKey:@"Signature"];
            }
@@ -871,7 +1527,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 11) { // PARAMETER DOWNLOAD
+    else if (self.decodeTransactionType == 11) { // PARAMETER DOWNLOAD
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"11"] forKey:@"Transaction type"];
         if (szRespField.count > 5) {
@@ -897,7 +1553,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 12) { // SET PARAMETER
+    else if (self.decodeTransactionType == 12) { // SET PARAMETER
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"12"] forKey:@"Transaction type"];
         if (szRespField.count >= 6) {
@@ -918,7 +1574,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 13) { // GET PARAMETER
+    else if (self.decodeTransactionType == 13) { // GET PARAMETER
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"13"] forKey:@"Transaction type"];
         if (szRespField.count >= 10) {
@@ -944,7 +1600,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 14) { // SET TERMINAL LANGUAGE
+    else if (self.decodeTransactionType == 14) { // SET TERMINAL LANGUAGE
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"14"] forKey:@"Transaction type"];
         if (szRespField.count >= 10) {
@@ -968,7 +1624,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 17) { // REGISTRATION
+    else if (self.decodeTransactionType == 17) { // REGISTRATION
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"17"] forKey:@"Transaction type"];
         [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:2]] forKey:@"Response Code"];
@@ -985,7 +1641,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 18) { // Start Session
+    else if (self.decodeTransactionType == 18) { // Start Session
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"18"] forKey:@"Transaction type"];
         if (szRespField.count >= 3) {
@@ -995,7 +1651,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 19) { // End Session
+    else if (self.decodeTransactionType == 19) { // End Session
         
           [responseData setValue:[NSString stringWithFormat:@"%@", @"19"] forKey:@"Transaction type"];
           if (szRespField.count >= 3) {
@@ -1005,7 +1661,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
              [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
          }
     }
-    else if (self.transactionType == 20) { // Bill Payment
+    else if (self.decodeTransactionType == 20) { // Bill Payment
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"20"] forKey:@"Transaction type"];
          if (szRespField.count >= 31 ) {
@@ -1020,8 +1676,8 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:9]] forKey:@"Card Exp Date"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:10]] forKey:@"RRN"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:11]] forKey:@"Auth Code"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:12]] forKey:@"TID"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:13]] forKey:@"MID"];
+            [responseData setValue:[szRespField objectAtIndex:12] forKey:@"TID"];
+            [responseData setValue:[szRespField objectAtIndex:13] forKey:@"MID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:14]] forKey:@"Batch No"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:15]] forKey:@"AID"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:16]] forKey:@"Application Cryptogram"];
@@ -1033,22 +1689,22 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:22]] forKey:@"PAR"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:23]] forKey:@"PANSUFFIX"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:24]] forKey:@"Card Entry Mode"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:25]] forKey:@"Merchant Category Code"];
+            [responseData setValue:[szRespField objectAtIndex:25] forKey:@"Merchant Category Code"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:26]] forKey:@"Terminal Transaction Type"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:27]] forKey:@"Scheme Label"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:28]] forKey:@"Product Info"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:29]] forKey:@"Application Version"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:30]] forKey:@"Disclaimer"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:31]] forKey:@"Merchant Name"];
-            [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:32]] forKey:@"Merchant Address"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:33]]]] forKey:@"MerchantName_Arebic"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:[szRespField objectAtIndex:34]]]] forKey:@"MerchantAddress_Arebic"];
+            [responseData setValue:[szRespField objectAtIndex:29] forKey:@"Application Version"];
+             [responseData setValue:[szRespField objectAtIndex:30] forKey:@"Disclaimer"];
+            [responseData setValue:[szRespField objectAtIndex:31] forKey:@"Merchant Name"];
+            [responseData setValue:[szRespField objectAtIndex:32] forKey:@"Merchant Address"];
+             [responseData setValue:[self arabicField:[szRespField objectAtIndex:33]] forKey:@"MerchantName_Arebic"];
+             [responseData setValue:[self arabicField:[szRespField objectAtIndex:34]] forKey:@"MerchantAddress_Arebic"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:35]] forKey:@"ECR Transaction Reference Number"];
             [responseData setValue:[NSString stringWithFormat:@"%@", [szRespField objectAtIndex:36]] forKey:@"Signature"];
              
             if ([szRespField[3] isEqual: @"APPROVED"] || [szRespField[3] isEqual: @"DECLINED"] || [szRespField[3] isEqual: @"DECLINE"]) {
-               NSString *htmlString = [self getHtmlString:@"Bill Pyment(Customer_copy)" transactionType:20 trxnResponse:szRespField];
-               [responseData setValue:[NSString stringWithFormat:@"%@", htmlString] forKey:@"receiptFormat"];
+               id receipt = [self receiptForTemplate:@"Bill Pyment(Customer_copy)" transactionType:20 trxnResponse:szRespField];
+               [responseData setValue:receipt forKey:@"receiptFormat"];
             }
          }
         else if (szRespField.count >= 3) {
@@ -1060,7 +1716,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 21) { // PRINT DETAIL REPORT OR Running Total
+    else if (self.decodeTransactionType == 21) { // PRINT DETAIL REPORT OR Running Total
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"21"] forKey:@"Transaction type"];
         
@@ -1077,10 +1733,10 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
               
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[2]] forKey:@"Response Code"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[3]] forKey:@"Response Message"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[4]] forKey:@"Merchant Name"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[5]] forKey:@"Merchant Address"];
-               [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[6]]]] forKey:@"MerchantName_Arebic"];
-               [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[7]]]] forKey:@"MerchantAddress_Arebic"];
+              [responseData setValue:szRespField[4] forKey:@"Merchant Name"];
+              [responseData setValue:szRespField[5] forKey:@"Merchant Address"];
+               [responseData setValue:[self arabicField:szRespField[6]] forKey:@"MerchantName_Arebic"];
+               [responseData setValue:[self arabicField:szRespField[7]] forKey:@"MerchantAddress_Arebic"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[8]] forKey:@"ECR Transaction Reference Number"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[9]] forKey:@"Signature"];
             }
@@ -1088,10 +1744,10 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
          else if (szRespField.count >= 8) {
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[2]] forKey:@"Response Code"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[3]] forKey:@"Response Message"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[4]] forKey:@"Merchant Name"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[5]] forKey:@"Merchant Address"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[6]]]] forKey:@"MerchantName_Arebic"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[7]]]] forKey:@"MerchantAddress_Arebic"];
+              [responseData setValue:szRespField[4] forKey:@"Merchant Name"];
+              [responseData setValue:szRespField[5] forKey:@"Merchant Address"];
+             [responseData setValue:[self arabicField:szRespField[6]] forKey:@"MerchantName_Arebic"];
+             [responseData setValue:[self arabicField:szRespField[7]] forKey:@"MerchantAddress_Arebic"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[8]] forKey:@"ECR Transaction Reference Number"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[9]] forKey:@"Signature"];
          }
@@ -1099,15 +1755,13 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
          }
     }
-    else if (self.transactionType == 22) { //PRINT SUMMARY REPORT
+    else if (self.decodeTransactionType == 22) { //PRINT SUMMARY REPORT
         
         [responseData setValue:szRespField forKey:@"responseData"];
-        if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
-           [self.delegate socketConnectionStream:self didReceiveData:responseData];
-        }
+        [self deliverResponse:responseData];
         return;
     }
-    else if (self.transactionType == 24) { //CHECK STATUS
+    else if (self.decodeTransactionType == 24) { //CHECK STATUS
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"24"] forKey:@"Transaction type"];
         if (szRespField.count >= 6) {
@@ -1127,7 +1781,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             [responseData setValue:@"Error occurred Please try again" forKey:@"responseMessage"];
         }
     }
-    else if (self.transactionType == 25) { // PARTIAL DOWNLOAD
+    else if (self.decodeTransactionType == 25) { // PARTIAL DOWNLOAD
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"25"] forKey:@"Transaction type"];
         if (szRespField.count > 5) {
@@ -1153,7 +1807,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         }
         
     }
-    else if (self.transactionType == 26) { // Snapshot Total
+    else if (self.decodeTransactionType == 26) { // Snapshot Total
         
         [responseData setValue:[NSString stringWithFormat:@"%@", @"26"] forKey:@"Transaction type"];
         
@@ -1170,10 +1824,10 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
               
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[2]] forKey:@"Response Code"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[3]] forKey:@"Response Message"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[4]] forKey:@"Merchant Name"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[5]] forKey:@"Merchant Address"];
-               [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[6]]]] forKey:@"MerchantName_Arebic"];
-               [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[7]]]] forKey:@"MerchantAddress_Arebic"];
+              [responseData setValue:szRespField[4] forKey:@"Merchant Name"];
+              [responseData setValue:szRespField[5] forKey:@"Merchant Address"];
+               [responseData setValue:[self arabicField:szRespField[6]] forKey:@"MerchantName_Arebic"];
+               [responseData setValue:[self arabicField:szRespField[7]] forKey:@"MerchantAddress_Arebic"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[8]] forKey:@"ECR Transaction Reference Number"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[9]] forKey:@"Signature"];
             }
@@ -1181,10 +1835,10 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
          else if (szRespField.count >= 8) {
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[2]] forKey:@"Response Code"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[3]] forKey:@"Response Message"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[4]] forKey:@"Merchant Name"];
-              [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[5]] forKey:@"Merchant Address"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[6]]]] forKey:@"MerchantName_Arebic"];
-             [responseData setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:szRespField[7]]]] forKey:@"MerchantAddress_Arebic"];
+              [responseData setValue:szRespField[4] forKey:@"Merchant Name"];
+              [responseData setValue:szRespField[5] forKey:@"Merchant Address"];
+             [responseData setValue:[self arabicField:szRespField[6]] forKey:@"MerchantName_Arebic"];
+             [responseData setValue:[self arabicField:szRespField[7]] forKey:@"MerchantAddress_Arebic"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[8]] forKey:@"ECR Transaction Reference Number"];
               [responseData setValue:[NSString stringWithFormat:@"%@", szRespField[9]] forKey:@"Signature"];
          }
@@ -1196,9 +1850,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         NSLog(@"Deafault Transaction called");
     }
     
-    if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
-        [self.delegate socketConnectionStream:self didReceiveData:responseData];
-    }
+    [self deliverResponse:responseData];
 }
 - (NSString *)maskedPan:(NSString*)inputPanNumber {
     
@@ -1225,473 +1877,647 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 }
 //MARK: - HTML Print Receipt -
 
--(NSString *)getHtmlString:(NSString*)fileName transactionType:(int)transactionType trxnResponse:(NSArray *)trxnResponse {
+// Receipts.skbrb is built from SKBTransactionRecipts by the "Compile Receipt Bundle"
+// phase. It stays mapped for the life of the process and templates are rendered in place.
+static ECR_RECEIPT_BUNDLE receiptBundle;
+static NSDictionary<NSString *, NSNumber *> *receiptTemplateIndexes;
+static NSArray<NSString *> *receiptPlaceholders;
+
+typedef struct {
+    const char **values;                // By placeholder index, NULL keeps the placeholder
+    int *lengths;
+} SKBReceiptValues;
+
+static const char *receiptValue(void *context, int placeholder, int *length) {
     
-    NSString *htmlString = @"";
-    NSURL *bundlePaths = [[NSBundle bundleForClass:[self class]] URLForResource:fileName withExtension:@"html"];
-    htmlString = [NSString stringWithContentsOfURL:bundlePaths encoding:NSUTF8StringEncoding error:nil];
-//    NSString *merchantNameArebic = @"معرض سليمان السيف ل لاواني المنزل";
-//    NSString *mechantAddressArebic = @"طريق الملك خالد بريدة";
+    SKBReceiptValues *receiptValues = (SKBReceiptValues *)context;
+    *length = receiptValues->lengths[placeholder];
+    return receiptValues->values[placeholder];
+}
+
++ (void)openReceiptBundle {
     
-    if (transactionType == 0 && htmlString != nil) { // Purchase
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        NSString *path = [[NSBundle bundleForClass:self] pathForResource:@"Receipts" ofType:@"skbrb"];
+        NSMutableDictionary *indexes = [[NSMutableDictionary alloc]init];
+        NSMutableArray *placeholders = [[NSMutableArray alloc]init];
+        if (path != nil && ecrReceiptBundleOpen(&receiptBundle, path.fileSystemRepresentation) == 0) {
+            for (int i = 0; i < receiptBundle.inTemplates; i++) {
+                indexes[@(ecrReceiptBundleName(&receiptBundle, i))] = @(i);
+            }
+            for (int i = 0; i < receiptBundle.inPlaceholders; i++) {
+                int length = 0;
+                const char *placeholder = ecrReceiptBundlePlaceholder(&receiptBundle, i, &length);
+                [placeholders addObject:[[NSString alloc]initWithBytes:placeholder length:length encoding:NSUTF8StringEncoding] ?: @""];
+            }
+        }
+        receiptTemplateIndexes = [indexes copy];
+        receiptPlaceholders = [placeholders copy];
+    });
+}
 
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        
-        NSString *res = trxnResponse[3];
-        NSString *arabic = [self checkingArabic:res];
-        arabic = [arabic stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"مقبولة" withString:arabic];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:trxnResponse [6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[self expiryDate:[NSString stringWithFormat:@"%@", trxnResponse[9]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:trxnResponse [11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-        
-    }
-    else if (transactionType == 1 && htmlString != nil) { // Purchase with Cashback
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[10]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[10]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        NSString *res = trxnResponse[3];
-        NSString *arabic = [self checkingArabic:res];
-        arabic = [arabic stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"مقبولة" withString:arabic];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TransactionAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSARPUR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CashbackAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[6]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSARcashback" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[6]]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TotalAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[7]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSARtotal" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[7]]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:8]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[13]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:14]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:26]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:29]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:32]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:33]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:34]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:35]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:36]]]];
-        return htmlString;
-        
-    }
-    else if (transactionType == 2 && htmlString != nil) { // Refund
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-         htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-         htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-        
-    }
-    else if (transactionType == 3 && htmlString != nil) { // Preautharization
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-    }
-    else if ((transactionType == 4 || transactionType == 27) && htmlString != nil) {  // PURCHASE ADVICE (FULL or PARTIAL)
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-         htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-    }
-    else if (transactionType == 5 && htmlString != nil) { // PRE AUTH EXTENSION
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-
-        return htmlString;
-    }
-    else if (transactionType == 6 && htmlString != nil) { // PRE AUTH VOID
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-    }
-    else if (transactionType == 8 && htmlString != nil) {  // CASH ADVANCE
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-    }
-    else if (transactionType == 9 && htmlString != nil) { // REVERSAL
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-
-    }
-    else if ((transactionType == 11 || transactionType == 25 ) && htmlString != nil) { // PARAMETER DOWNLOAD OR PARTIAL DOWNLOAD
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"responseCode" withString:[trxnResponse objectAtIndex:2]];
-        NSString *teminalID = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"];
-        if (teminalID.length > 9) {
-            NSString *terminal = [teminalID substringWithRange:NSMakeRange( 0, 8)];
-            htmlString = [htmlString stringByReplacingOccurrencesOfString:@"terminalId" withString:terminal];
-        }
-        return htmlString;
-
-    }
-
-    else if (transactionType == 20 && htmlString != nil) { // BillPayment
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[8]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ResponseCode" withString:[trxnResponse objectAtIndex:2]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approved" withString:[trxnResponse objectAtIndex:3]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"panNumber" withString:[self maskedPan:[trxnResponse objectAtIndex:4]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CurrentAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
-        
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"amountSAR" withString:[self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"approovalcodearabic" withString:[self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"arabicSAR" withString:[self checkingArabic:@"SAR"]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Buzzcode" withString:[trxnResponse objectAtIndex:6]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"StanNo" withString:[trxnResponse objectAtIndex:7]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ExpiryDate" withString:[trxnResponse objectAtIndex:9]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"RRN" withString:[trxnResponse objectAtIndex:10]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:11]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TID" withString:[trxnResponse objectAtIndex:12]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MID" withString:[trxnResponse objectAtIndex:13]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"AIDaid" withString:[trxnResponse objectAtIndex:15]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"applicationCryptogram" withString:[trxnResponse objectAtIndex:16]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CID" withString:[trxnResponse objectAtIndex:17]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CVR" withString:[trxnResponse objectAtIndex:18]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TVR" withString:[trxnResponse objectAtIndex:19]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"TSI" withString:[trxnResponse objectAtIndex:20]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"KERNEL-ID" withString:[trxnResponse objectAtIndex:21]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PAR" withString:[trxnResponse objectAtIndex:22]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"PANSUFFIX" withString:[trxnResponse objectAtIndex:23]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"CONTACTLESS" withString:[trxnResponse objectAtIndex:24]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantCategoryCode" withString:[trxnResponse objectAtIndex:25]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeLabel" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Scheme Text" withString:[trxnResponse objectAtIndex:27]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"SchemeText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:27]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"ApplicationVersion" withString:[trxnResponse objectAtIndex:29]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Disclaimer Text" withString:[trxnResponse objectAtIndex:30]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"DisclaimerText_Arabic" withString:[self checkingArabic:[trxnResponse objectAtIndex:30]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Name" withString:[trxnResponse objectAtIndex:31]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"Merchant Address" withString:[trxnResponse objectAtIndex:32]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:33]]]];
-        htmlString = [htmlString stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:[trxnResponse objectAtIndex:34]]]];
-        return htmlString;
-    }
-    else if ( transactionType == 10 && htmlString != nil) { // SETTLEMENT OR Reconciliation
+-(BOOL)hasReceiptTemplate:(NSString *)name {
+    
+    [SKBCoreServices openReceiptBundle];
+    return receiptTemplateIndexes[name] != nil || [[NSBundle bundleForClass:[self class]] URLForResource:name withExtension:@"html"] != nil;
+}
+
+// The template with every placeholder in values filled in one pass over its segments;
+// placeholders without a value keep their text. nil if there is no such template.
+-(NSString *)renderReceipt:(NSString *)name values:(NSDictionary<NSString *, NSString *> *)values {
+    
+    [SKBCoreServices openReceiptBundle];
+    NSNumber *index = receiptTemplateIndexes[name];
+    if (index == nil) {
+        return [self replaceReceiptPlaceholders:name values:values];
+    }
+    
+    NSUInteger count = receiptPlaceholders.count;
+    const char *filled[count + 1];
+    int lengths[count + 1];
+    int capacity = 0;
+    ecrReceiptBundleText(&receiptBundle, index.intValue, &capacity);
+    for (NSUInteger i = 0; i < count; i++) {
+        filled[i] = [values[receiptPlaceholders[i]] UTF8String];
+        lengths[i] = filled[i] != NULL ? (int)strlen(filled[i]) : 0;
+        capacity += lengths[i];
+    }
+    SKBReceiptValues receiptValues = { filled, lengths };
+    
+    // Enough unless a placeholder repeats, then grown until it fits
+    NSMutableData *receipt = [[NSMutableData alloc]initWithLength:capacity + 1];
+    int length = 0;
+    while ((length = ecrReceiptBundleRender(&receiptBundle, index.intValue, receiptValue, &receiptValues, receipt.mutableBytes, (int)receipt.length)) < 0) {
+        receipt.length *= 2;
+    }
+    return [[NSString alloc]initWithBytes:receipt.bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+// Bundle missing or stale: read the HTML resource as before, longest placeholders first
+-(NSString *)replaceReceiptPlaceholders:(NSString *)name values:(NSDictionary<NSString *, NSString *> *)values {
+    
+    NSURL *bundlePaths = [[NSBundle bundleForClass:[self class]] URLForResource:name withExtension:@"html"];
+    NSString *template = [NSString stringWithContentsOfURL:bundlePaths encoding:NSUTF8StringEncoding error:nil];
+    NSArray *placeholders = [values.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSString *first, NSString *second) {
+        return first.length > second.length ? NSOrderedAscending : first.length < second.length ? NSOrderedDescending : NSOrderedSame;
+    }];
+    for (NSString *placeholder in placeholders) {
+        template = [template stringByReplacingOccurrencesOfString:placeholder withString:values[placeholder]];
+    }
+    return template;
+}
+
+// The receipt in the format the transaction asked for. Only card transactions have a
+// text layout; reports are HTML whatever the format.
+-(id)receiptForTemplate:(NSString *)fileName transactionType:(int)transactionType trxnResponse:(NSArray *)trxnResponse {
+    
+    if (self.decodeReceiptFormat != SKBReceiptFormatHTML) {
+        id receipt = [self textReceipt:transactionType trxnResponse:trxnResponse];
+        if (receipt != nil) {
+            return receipt;
+        }
+    }
+    return [NSString stringWithFormat:@"%@", [self getHtmlString:fileName transactionType:transactionType trxnResponse:trxnResponse]];
+}
+
+// Same values as the HTML receipt of the transaction, laid out by ecrTextReceiptCard.
+// Text comes back as NSString, ESC/POS as NSData.
+-(id)textReceipt:(int)transactionType trxnResponse:(NSArray *)trxnResponse {
+    
+    // Purchase with cashback carries two more amounts ahead of the common fields
+    NSUInteger shift = transactionType == 1 ? 2 : 0;
+    if (trxnResponse.count <= 34 + shift) {
+        return nil;
+    }
+    
+    __strong NSString *values[ECR_TEXT_FIELDS] = { nil };
+    values[ECR_TEXT_FIELD_MERCHANT_NAME] = trxnResponse[31 + shift];
+    values[ECR_TEXT_FIELD_MERCHANT_ADDRESS] = trxnResponse[32 + shift];
+    values[ECR_TEXT_FIELD_MERCHANT_NAME_AR] = [self arabicField:trxnResponse[33 + shift]];
+    values[ECR_TEXT_FIELD_MERCHANT_ADDRESS_AR] = [self arabicField:trxnResponse[34 + shift]];
+    values[ECR_TEXT_FIELD_DATE] = [self getDate:trxnResponse[8 + shift]];
+    values[ECR_TEXT_FIELD_TIME] = [self getTime:trxnResponse[8 + shift]];
+    values[ECR_TEXT_FIELD_MID] = trxnResponse[13 + shift];
+    values[ECR_TEXT_FIELD_TID] = trxnResponse[12 + shift];
+    values[ECR_TEXT_FIELD_BUSS_CODE] = trxnResponse[6 + shift];
+    values[ECR_TEXT_FIELD_STAN] = trxnResponse[7 + shift];
+    values[ECR_TEXT_FIELD_APP_VERSION] = trxnResponse[29 + shift];
+    values[ECR_TEXT_FIELD_RRN] = trxnResponse[10 + shift];
+    values[ECR_TEXT_FIELD_SCHEME] = trxnResponse[27 + shift];
+    values[ECR_TEXT_FIELD_SCHEME_AR] = [self checkingArabic:trxnResponse[27 + shift]];
+    values[ECR_TEXT_FIELD_PAN] = [self maskedPan:trxnResponse[4]];
+    values[ECR_TEXT_FIELD_EXPIRY] = [self expiryDate:[NSString stringWithFormat:@"%@", trxnResponse[9 + shift]]];
+    values[ECR_TEXT_FIELD_AMOUNT] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+    values[ECR_TEXT_FIELD_AMOUNT_AR] = [self numToArabicConverter:values[ECR_TEXT_FIELD_AMOUNT]];
+    if (transactionType == 1) {
+        values[ECR_TEXT_FIELD_CASHBACK] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[6]]];
+        values[ECR_TEXT_FIELD_CASHBACK_AR] = [self numToArabicConverter:values[ECR_TEXT_FIELD_CASHBACK]];
+        values[ECR_TEXT_FIELD_TOTAL] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[7]]];
+        values[ECR_TEXT_FIELD_TOTAL_AR] = [self numToArabicConverter:values[ECR_TEXT_FIELD_TOTAL]];
+    }
+    values[ECR_TEXT_FIELD_CURRENCY_AR] = [self checkingArabic:@"SAR"];
+    values[ECR_TEXT_FIELD_RESULT] = trxnResponse[3];
+    values[ECR_TEXT_FIELD_RESULT_AR] = [[self checkingArabic:trxnResponse[3]] stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
+    values[ECR_TEXT_FIELD_DISCLAIMER] = trxnResponse[30 + shift];
+    values[ECR_TEXT_FIELD_DISCLAIMER_AR] = [self checkingArabic:trxnResponse[30 + shift]];
+    values[ECR_TEXT_FIELD_AUTH_CODE] = trxnResponse[11 + shift];
+    values[ECR_TEXT_FIELD_AUTH_CODE_AR] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11 + shift]]];
+    values[ECR_TEXT_FIELD_ENTRY_MODE] = trxnResponse[24 + shift];
+    values[ECR_TEXT_FIELD_RESPONSE_CODE] = trxnResponse[2];
+    values[ECR_TEXT_FIELD_AID] = trxnResponse[15 + shift];
+    values[ECR_TEXT_FIELD_TVR] = trxnResponse[19 + shift];
+    values[ECR_TEXT_FIELD_CVR] = trxnResponse[18 + shift];
+    values[ECR_TEXT_FIELD_CID] = trxnResponse[17 + shift];
+    values[ECR_TEXT_FIELD_CRYPTOGRAM] = trxnResponse[16 + shift];
+    values[ECR_TEXT_FIELD_KERNEL_ID] = trxnResponse[21 + shift];
+    values[ECR_TEXT_FIELD_PAR] = trxnResponse[22 + shift];
+    values[ECR_TEXT_FIELD_PAN_SUFFIX] = trxnResponse[23 + shift];
+    values[ECR_TEXT_FIELD_TSI] = trxnResponse[20 + shift];
+    
+    const char *fields[ECR_TEXT_FIELDS];
+    for (int i = 0; i < ECR_TEXT_FIELDS; i++) {
+        fields[i] = [values[i] UTF8String];
+    }
+    int format = self.decodeReceiptFormat == SKBReceiptFormatESCPOS ? ECR_RECEIPT_FORMAT_ESCPOS : ECR_RECEIPT_FORMAT_TEXT;
+    NSMutableData *receipt = [[NSMutableData alloc]initWithLength:ECR_TEXT_RECEIPT_BUFFER_SIZE];
+    int length = ecrTextReceiptCard(transactionType, fields, format, self.decodeReceiptLineWidth, receipt.mutableBytes, (int)receipt.length);
+    if (length < 0) {
+        return nil;
+    }
+    receipt.length = length;
+    if (format == ECR_RECEIPT_FORMAT_TEXT) {
+        return [[NSString alloc]initWithData:receipt encoding:NSUTF8StringEncoding];
+    }
+    return receipt;
+}
+
+-(NSString *)getHtmlString:(NSString*)fileName transactionType:(int)transactionType trxnResponse:(NSArray *)trxnResponse {
+    
+    NSMutableDictionary<NSString *, NSString *> *values = [[NSMutableDictionary alloc]init];
+    BOOL hasTemplate = [self hasReceiptTemplate:fileName];
+//    NSString *merchantNameArebic = @"معرض سليمان السيف ل لاواني المنزل";
+//    NSString *mechantAddressArebic = @"طريق الملك خالد بريدة";
+    
+    if (transactionType == 0 && hasTemplate) { // Purchase
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        
+        NSString *res = trxnResponse[3];
+        NSString *arabic = [self checkingArabic:res];
+        arabic = [arabic stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
+        values[@"مقبولة"] = arabic;
+        
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"Buzzcode"] = trxnResponse [6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [self expiryDate:[NSString stringWithFormat:@"%@", trxnResponse[9]]];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"authCode"] = trxnResponse [11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+        
+    }
+    else if (transactionType == 1 && hasTemplate) { // Purchase with Cashback
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[10]];
+        values[@"currentDate"] = [self getDate:trxnResponse[10]];
+        
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        NSString *res = trxnResponse[3];
+        NSString *arabic = [self checkingArabic:res];
+        arabic = [arabic stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
+        values[@"مقبولة"] = arabic;
+        
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        
+        values[@"TransactionAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        values[@"amountSARPUR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        
+        values[@"CashbackAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[6]]];
+        values[@"amountSARcashback"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[6]]]];
+        
+        values[@"TotalAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[7]]];
+        values[@"amountSARtotal"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[7]]]];
+        
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:8];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:9];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:11];
+        values[@"RRN"] = [trxnResponse objectAtIndex:12];
+        values[@"authCode"] = [trxnResponse objectAtIndex:13];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[13]]];
+        values[@"TID"] = [trxnResponse objectAtIndex:14];
+        values[@"MID"] = [trxnResponse objectAtIndex:15];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:17];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:18];
+        values[@"CID"] = [trxnResponse objectAtIndex:19];
+        values[@"CVR"] = [trxnResponse objectAtIndex:20];
+        values[@"TVR"] = [trxnResponse objectAtIndex:21];
+        values[@"TSI"] = [trxnResponse objectAtIndex:22];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:23];
+        values[@"PAR"] = [trxnResponse objectAtIndex:24];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:25];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:26];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:29];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:29];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:29]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:31];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:32];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:32]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:33];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:34];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:35]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:36]];
+        return [self renderReceipt:fileName values:values];
+        
+    }
+    else if (transactionType == 2 && hasTemplate) { // Refund
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+         values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+         values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+        
+    }
+    else if (transactionType == 3 && hasTemplate) { // Preautharization
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+    }
+    else if ((transactionType == 4 || transactionType == 27) && hasTemplate) {  // PURCHASE ADVICE (FULL or PARTIAL)
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+         values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+    }
+    else if (transactionType == 5 && hasTemplate) { // PRE AUTH EXTENSION
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+
+        return [self renderReceipt:fileName values:values];
+    }
+    else if (transactionType == 6 && hasTemplate) { // PRE AUTH VOID
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+    }
+    else if (transactionType == 8 && hasTemplate) {  // CASH ADVANCE
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+    }
+    else if (transactionType == 9 && hasTemplate) { // REVERSAL
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+
+    }
+    else if ((transactionType == 11 || transactionType == 25 ) && hasTemplate) { // PARAMETER DOWNLOAD OR PARTIAL DOWNLOAD
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[4]];
+        values[@"currentDate"] = [self getDate:trxnResponse[4]];
+        values[@"responseCode"] = [trxnResponse objectAtIndex:2];
+        NSString *teminalID = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"];
+        if (teminalID.length > 9) {
+            NSString *terminal = [teminalID substringWithRange:NSMakeRange( 0, 8)];
+            values[@"terminalId"] = terminal;
+        }
+        return [self renderReceipt:fileName values:values];
+
+    }
+
+    else if (transactionType == 20 && hasTemplate) { // BillPayment
+        
+        values[@"currentTime"] = [self getTime:trxnResponse[8]];
+        values[@"currentDate"] = [self getDate:trxnResponse[8]];
+        values[@"ResponseCode"] = [trxnResponse objectAtIndex:2];
+        values[@"approved"] = [trxnResponse objectAtIndex:3];
+        values[@"panNumber"] = [self maskedPan:[trxnResponse objectAtIndex:4]];
+        values[@"CurrentAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]];
+        
+        values[@"amountSAR"] = [self numToArabicConverter:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[5]]]];
+        values[@"approovalcodearabic"] = [self numToArabicConverter:[NSString stringWithFormat:@"%@", trxnResponse[11]]];
+        values[@"arabicSAR"] = [self checkingArabic:@"SAR"];
+        values[@"Buzzcode"] = [trxnResponse objectAtIndex:6];
+        values[@"StanNo"] = [trxnResponse objectAtIndex:7];
+        values[@"ExpiryDate"] = [trxnResponse objectAtIndex:9];
+        values[@"RRN"] = [trxnResponse objectAtIndex:10];
+        values[@"authCode"] = [trxnResponse objectAtIndex:11];
+        values[@"TID"] = [trxnResponse objectAtIndex:12];
+        values[@"MID"] = [trxnResponse objectAtIndex:13];
+        values[@"AIDaid"] = [trxnResponse objectAtIndex:15];
+        values[@"applicationCryptogram"] = [trxnResponse objectAtIndex:16];
+        values[@"CID"] = [trxnResponse objectAtIndex:17];
+        values[@"CVR"] = [trxnResponse objectAtIndex:18];
+        values[@"TVR"] = [trxnResponse objectAtIndex:19];
+        values[@"TSI"] = [trxnResponse objectAtIndex:20];
+        values[@"KERNEL-ID"] = [trxnResponse objectAtIndex:21];
+        values[@"PAR"] = [trxnResponse objectAtIndex:22];
+        values[@"PANSUFFIX"] = [trxnResponse objectAtIndex:23];
+        values[@"CONTACTLESS"] = [trxnResponse objectAtIndex:24];
+        values[@"MerchantCategoryCode"] = [trxnResponse objectAtIndex:25];
+        values[@"SchemeLabel"] = [trxnResponse objectAtIndex:27];
+        values[@"Scheme Text"] = [trxnResponse objectAtIndex:27];
+        values[@"SchemeText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:27]];
+        values[@"ApplicationVersion"] = [trxnResponse objectAtIndex:29];
+        values[@"Disclaimer Text"] = [trxnResponse objectAtIndex:30];
+        values[@"DisclaimerText_Arabic"] = [self checkingArabic:[trxnResponse objectAtIndex:30]];
+        values[@"Merchant Name"] = [trxnResponse objectAtIndex:31];
+        values[@"Merchant Address"] = [trxnResponse objectAtIndex:32];
+        values[@"MerchantName_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:33]];
+        values[@"MerchantAddress_Arebic"] = [self arabicField:[trxnResponse objectAtIndex:34]];
+        return [self renderReceipt:fileName values:values];
+    }
+    else if ( transactionType == 10 && hasTemplate) { // SETTLEMENT OR Reconciliation
        
          //Buffer Receive Parsing
          NSString *printSettlment = [NSString stringWithFormat:
@@ -1869,37 +2695,27 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[4]] forKey:@"Date Time Stamp"];
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[6]] forKey:@"Trace Number"];
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[7]] forKey:@"Buss Code"];
-         [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[8]] forKey:@"Application Version"];
+         [_summaryReport setValue:trxnResponse[8] forKey:@"Application Version"];
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[9]] forKey:@"Total Scheme Length"];
           
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", printFinalReport1] forKey:@"Schemes"];
         
-         [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+1]] forKey:@"Merchant Name"];
-         [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+2]] forKey:@"Merchant Address"];
+         [_summaryReport setValue:trxnResponse[k+1] forKey:@"Merchant Name"];
+         [_summaryReport setValue:trxnResponse[k+2] forKey:@"Merchant Address"];
         
-        [_summaryReport setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:trxnResponse[k+3]]]] forKey:@"MerchantName_Arebic"];
-        [_summaryReport setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:trxnResponse[k+4]]]] forKey:@"MerchantAddress_Arebic"];
+        [_summaryReport setValue:[self arabicField:trxnResponse[k+3]] forKey:@"MerchantName_Arebic"];
+        [_summaryReport setValue:[self arabicField:trxnResponse[k+4]] forKey:@"MerchantAddress_Arebic"];
         
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+5]] forKey:@"ECR Transaction Reference Number"];
          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+6]] forKey:@"Signature"];
                 
        //HTML Response parsing
        
-       NSString *builder = [[NSString alloc]initWithString:htmlString];
-
-       NSURL *summaryToHTMLFilePosTable = [[NSBundle bundleForClass:[self class]] URLForResource:@"PosTable" withExtension:@"html"];
-       NSString *summaryhtmlStringPosTable = [NSString stringWithContentsOfURL:summaryToHTMLFilePosTable encoding:NSUTF8StringEncoding error:nil];
-       NSString *htmlSummaryReportPosTable = summaryhtmlStringPosTable;
-       
-       NSURL *summaryToHTMLFileMadaHost = [[NSBundle bundleForClass:[self class]] URLForResource:@"madaHostTable" withExtension:@"html"];
-       NSString *summaryhtmlStringMadaHost = [NSString stringWithContentsOfURL:summaryToHTMLFileMadaHost encoding:NSUTF8StringEncoding error:nil];
-       NSString *htmlSummaryReportMadaHost = summaryhtmlStringMadaHost;
-        
-       NSURL *summaryToHTMLFilePosDetials = [[NSBundle bundleForClass:[self class]] URLForResource:@"PosTerminalDetails" withExtension:@"html"];
-       NSString *summaryhtmlStringPosDetials = [NSString stringWithContentsOfURL:summaryToHTMLFilePosDetials encoding:NSUTF8StringEncoding error:nil];
-       NSString *htmlSummaryReportPosDetials = summaryhtmlStringPosDetials;
+       NSMutableDictionary<NSString *, NSString *> *posTableValues = [[NSMutableDictionary alloc]init];
+       NSMutableDictionary<NSString *, NSString *> *madaHostValues = [[NSMutableDictionary alloc]init];
+       NSMutableDictionary<NSString *, NSString *> *posDetailsValues = [[NSMutableDictionary alloc]init];
        
-       NSString *SummaryFinalReport = @"";
+       NSMutableString *SummaryFinalReport = [[NSMutableString alloc]init];
        
        int b = 9;
        NSNumber *coun = [trxnResponse objectAtIndex:9];
@@ -1909,22 +2725,18 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 
            if ([trxnResponse[b + 2] isEqual: @"0"]) {
                
-               NSURL *ReconcilationToHTMLFile = [[NSBundle bundleForClass:[self class]] URLForResource:@"ReconcilationTable" withExtension:@"html"];
-               NSString *ReconcilationNoTable = [NSString stringWithContentsOfURL:ReconcilationToHTMLFile encoding:NSUTF8StringEncoding error:nil];
-               NSString *htmlreconcilationNoTable = ReconcilationNoTable;
-               
+               NSMutableDictionary<NSString *, NSString *> *noTableValues = [[NSMutableDictionary alloc]init];
                NSString *res = trxnResponse[b + 1];
                NSString *arabi = [self checkingArabic:res];
                
                arabi = [arabi stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
 
-               htmlreconcilationNoTable = [htmlreconcilationNoTable stringByReplacingOccurrencesOfString:@"Scheme" withString:trxnResponse[b + 1]];
-               htmlreconcilationNoTable = [htmlreconcilationNoTable stringByReplacingOccurrencesOfString:@"قَدِيرٞ" withString:arabi];
+               noTableValues[@"Scheme"] = trxnResponse[b + 1];
+               noTableValues[@"قَدِيرٞ"] = arabi;
                
                b = b + 3;
                
-               SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlreconcilationNoTable];
-               htmlreconcilationNoTable = ReconcilationNoTable;
+               [SummaryFinalReport appendString:[self renderReceipt:@"ReconcilationTable" values:noTableValues]];
                
            }
            else {
@@ -1935,28 +2747,27 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
                         NSString *res = trxnResponse[b + 1];
                         NSString *arabi = [self checkingArabic:res];
                         arabi = [arabi stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
-                        htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"مدى" withString:arabi];
+                        madaHostValues[@"مدى"] = arabi;
                          
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"schemename" withString:[trxnResponse objectAtIndex: b + 1]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"totalDBCount" withString:[trxnResponse objectAtIndex:b + 4]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"totalDBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 5]]]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"totalCBCount" withString:[trxnResponse objectAtIndex:b + 6]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"totalCBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 7]]]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"NAQDCount" withString:[trxnResponse objectAtIndex:b + 8]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"NAQDAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 9]]]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"CADVCount" withString:[trxnResponse objectAtIndex:b + 10]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"CADVAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 11]]]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"AUTHCount" withString:[trxnResponse objectAtIndex:b + 12]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"AUTHAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 13]]]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"TOTALSCount" withString:[trxnResponse objectAtIndex:b + 14]];
-                       htmlSummaryReportMadaHost = [htmlSummaryReportMadaHost stringByReplacingOccurrencesOfString:@"TOTALSAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 15]]]];
+                       madaHostValues[@"schemename"] = [trxnResponse objectAtIndex: b + 1];
+                       madaHostValues[@"totalDBCount"] = [trxnResponse objectAtIndex:b + 4];
+                       madaHostValues[@"totalDBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 5]]];
+                       madaHostValues[@"totalCBCount"] = [trxnResponse objectAtIndex:b + 6];
+                       madaHostValues[@"totalCBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 7]]];
+                       madaHostValues[@"NAQDCount"] = [trxnResponse objectAtIndex:b + 8];
+                       madaHostValues[@"NAQDAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 9]]];
+                       madaHostValues[@"CADVCount"] = [trxnResponse objectAtIndex:b + 10];
+                       madaHostValues[@"CADVAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 11]]];
+                       madaHostValues[@"AUTHCount"] = [trxnResponse objectAtIndex:b + 12];
+                       madaHostValues[@"AUTHAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 13]]];
+                       madaHostValues[@"TOTALSCount"] = [trxnResponse objectAtIndex:b + 14];
+                       madaHostValues[@"TOTALSAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 15]]];
 
                        }else {
                          break;
                        }
                        b = b + 15;
-                       SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlSummaryReportMadaHost];
-                       htmlSummaryReportMadaHost = [[NSString alloc]initWithString:summaryhtmlStringMadaHost];
+                       [SummaryFinalReport appendString:[self renderReceipt:@"madaHostTable" values:madaHostValues]];
                  }
                  else if ([trxnResponse[b + 2]  isEqual: @"POS TERMINAL"]) {
                    
@@ -1964,84 +2775,80 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
                          
                       j = j - 1;
                          
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalDBCount" withString:[trxnResponse objectAtIndex:b + 3]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalDBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalCBCount" withString:[trxnResponse objectAtIndex:b + 5]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalCBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"NAQDCount" withString:[trxnResponse objectAtIndex:b + 7]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"NAQDAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"CADVCount" withString:[trxnResponse objectAtIndex:b + 9]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"CADVAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"AUTHCount" withString:[trxnResponse objectAtIndex:b + 11]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"AUTHAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"TOTALSCount" withString:trxnResponse[13]];
-                       htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"TOTALSAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[14]]]];
+                       posTableValues[@"totalDBCount"] = [trxnResponse objectAtIndex:b + 3];
+                       posTableValues[@"totalDBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]];
+                       posTableValues[@"totalCBCount"] = [trxnResponse objectAtIndex:b + 5];
+                       posTableValues[@"totalCBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]];
+                       posTableValues[@"NAQDCount"] = [trxnResponse objectAtIndex:b + 7];
+                       posTableValues[@"NAQDAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]];
+                       posTableValues[@"CADVCount"] = [trxnResponse objectAtIndex:b + 9];
+                       posTableValues[@"CADVAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]];
+                       posTableValues[@"AUTHCount"] = [trxnResponse objectAtIndex:b + 11];
+                       posTableValues[@"AUTHAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]];
+                       posTableValues[@"TOTALSCount"] = trxnResponse[13];
+                       posTableValues[@"TOTALSAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[14]]];
 
                        }else {
                          break;
                        }
                        b = b + 14;
-                       SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlSummaryReportPosTable];
-                       htmlSummaryReportPosTable = [[NSString alloc]initWithString:summaryhtmlStringPosTable];
+                       [SummaryFinalReport appendString:[self renderReceipt:@"PosTable" values:posTableValues]];
                  }
                  else if ([trxnResponse[b + 2]  isEqual: @"POS TERMINAL DETAILS"]) {
                     
                    if (trxnResponse.count >= b+14) {
                        
                          j = j - 1;
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalDBCount" withString:[trxnResponse objectAtIndex:b + 3]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalDBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalCBCount" withString:[trxnResponse objectAtIndex:b + 5]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalCBAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"NAQDCount" withString:[trxnResponse objectAtIndex:b + 7]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"NAQDAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"CADVCount" withString:[trxnResponse objectAtIndex:b + 9]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"CADVAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"AUTHCount" withString:[trxnResponse objectAtIndex:b + 11]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"AUTHAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]]];
+                         posDetailsValues[@"totalDBCount"] = [trxnResponse objectAtIndex:b + 3];
+                         posDetailsValues[@"totalDBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]];
+                         posDetailsValues[@"totalCBCount"] = [trxnResponse objectAtIndex:b + 5];
+                         posDetailsValues[@"totalCBAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]];
+                         posDetailsValues[@"NAQDCount"] = [trxnResponse objectAtIndex:b + 7];
+                         posDetailsValues[@"NAQDAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]];
+                         posDetailsValues[@"CADVCount"] = [trxnResponse objectAtIndex:b + 9];
+                         posDetailsValues[@"CADVAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]];
+                         posDetailsValues[@"AUTHCount"] = [trxnResponse objectAtIndex:b + 11];
+                         posDetailsValues[@"AUTHAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]];
                          
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"TOTALSCount" withString:trxnResponse[13]];
-                         htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"TOTALSAmount" withString:[self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[14]]]];
+                         posDetailsValues[@"TOTALSCount"] = trxnResponse[13];
+                         posDetailsValues[@"TOTALSAmount"] = [self decimalWithCommaSeperated:[NSString stringWithFormat:@"%@", trxnResponse[14]]];
 
                      }else {
                        break;
                      }
                      b = b + 14;
-                     SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlSummaryReportPosDetials];
-                     htmlSummaryReportPosDetials = [[NSString alloc]initWithString:summaryhtmlStringPosDetials];
+                     [SummaryFinalReport appendString:[self renderReceipt:@"PosTerminalDetails" values:posDetailsValues]];
                 }
                 else if ([trxnResponse[b + 2]  isEqual: @"POS TERMINAL DETAILS"]) {
-                     NSURL *ReconcilationToHTMLFile = [[NSBundle bundleForClass:[self class]] URLForResource:@"ReconcilationTable1" withExtension:@"html"];
-                     NSString *ReconcilationNoTable = [NSString stringWithContentsOfURL:ReconcilationToHTMLFile encoding:NSUTF8StringEncoding error:nil];
-                     NSString *SummaryFinalReport = ReconcilationNoTable;
+                     NSString *SummaryFinalReport = [self renderReceipt:@"ReconcilationTable1" values:@{}];
                      b = b + 1;
                 }
            }
        }
        
-       builder = [builder stringByReplacingOccurrencesOfString:@"PosTable" withString:SummaryFinalReport];
-       builder = [builder stringByReplacingOccurrencesOfString:@"merchantId" withString:trxnResponse[5]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"busscode" withString:trxnResponse[6]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"traceNumber" withString:trxnResponse[7]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[4]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[4]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"AppVersion" withString:trxnResponse[8]];
+       values[@"PosTable"] = SummaryFinalReport;
+       values[@"merchantId"] = trxnResponse[5];
+       values[@"busscode"] = trxnResponse[6];
+       values[@"traceNumber"] = trxnResponse[7];
+       values[@"currentTime"] = [self getTime:trxnResponse[4]];
+       values[@"currentDate"] = [self getDate:trxnResponse[4]];
+       values[@"AppVersion"] = trxnResponse[8];
        
        NSString *teminalID = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"];
        if (teminalID.length > 9) {
            NSString *terminal = [teminalID substringWithRange:NSMakeRange( 0, 8)];
-           builder = [builder stringByReplacingOccurrencesOfString:@"TerminalId" withString:terminal];
+           values[@"TerminalId"] = terminal;
        }
         
         b = (int)trxnResponse.count - 8;
-       builder = [builder stringByReplacingOccurrencesOfString:@"Merchant Name" withString:trxnResponse[b+1]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"Merchant Address" withString:trxnResponse[b+2]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:trxnResponse[b+3]]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:trxnResponse[b+4]]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MADA" withString:@"mada"];    
-       return builder;
+       values[@"Merchant Name"] = trxnResponse[b+1];
+       values[@"Merchant Address"] = trxnResponse[b+2];
+       values[@"MerchantName_Arebic"] = [self arabicField:trxnResponse[b+3]];
+       values[@"MerchantAddress_Arebic"] = [self arabicField:trxnResponse[b+4]];
+       // Also catches the scheme names the terminal sends in capitals
+       return [[self renderReceipt:fileName values:values] stringByReplacingOccurrencesOfString:@"MADA" withString:@"mada"];
    }
-   else if ((transactionType == 21 || transactionType == 26) && htmlString != nil) {   // PRINT DETAIL REPORT OR RUNNING TOTAL
+   else if ((transactionType == 21 || transactionType == 26) && hasTemplate) {   // PRINT DETAIL REPORT OR RUNNING TOTAL
         
           //Buffer Receive Parsing
           NSString *printSettlmentPos = [NSString stringWithFormat:
@@ -2162,33 +2969,26 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[4]] forKey:@"Date Time Stamp"];
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[5]] forKey:@"Merchant id"];
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[6]] forKey:@"Buss Code"];
-          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[7]] forKey:@"Application Version"];
+          [_summaryReport setValue:trxnResponse[7] forKey:@"Application Version"];
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[8]] forKey:@"Total Scheme Length"];
            
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", printFinalReport1] forKey:@"Schemes"];
        
-          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+1]] forKey:@"Merchant Name"];
-          [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+2]] forKey:@"Merchant Address"];
+          [_summaryReport setValue:trxnResponse[k+1] forKey:@"Merchant Name"];
+          [_summaryReport setValue:trxnResponse[k+2] forKey:@"Merchant Address"];
        
-           [_summaryReport setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:trxnResponse[k+3]]]] forKey:@"MerchantName_Arebic"];
-            [_summaryReport setValue:[NSString stringWithFormat:@"%@", [self encodingISO_8859_6:[self hexStringToData:trxnResponse[k+4]]]] forKey:@"MerchantAddress_Arebic"];
+           [_summaryReport setValue:[self arabicField:trxnResponse[k+3]] forKey:@"MerchantName_Arebic"];
+            [_summaryReport setValue:[self arabicField:trxnResponse[k+4]] forKey:@"MerchantAddress_Arebic"];
        
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+5]] forKey:@"ECR Transaction Reference Number"];
           [_summaryReport setValue:[NSString stringWithFormat:@"%@", trxnResponse[k+6]] forKey:@"Signature"];
                  
         //HTML Response parsing
         
-        NSString *builder = [[NSString alloc]initWithString:htmlString];
-
-        NSURL *bundlePaths = [[NSBundle bundleForClass:[self class]] URLForResource:@"PosTableRunning" withExtension:@"html"];
-        NSString *summaryhtmlStringPosTable = [NSString stringWithContentsOfURL:bundlePaths encoding:NSUTF8StringEncoding error:nil];
-        NSString *htmlSummaryReportPosTable = summaryhtmlStringPosTable;
-        
-        NSURL *summaryToHTMLFilePosDetials = [[NSBundle bundleForClass:[self class]] URLForResource:@"PosTerminalDetails" withExtension:@"html"];
-        NSString *summaryhtmlStringPosDetials = [NSString stringWithContentsOfURL:summaryToHTMLFilePosDetials encoding:NSUTF8StringEncoding error:nil];
-        NSString *htmlSummaryReportPosDetials = summaryhtmlStringPosDetials;
+        NSMutableDictionary<NSString *, NSString *> *posTableValues = [[NSMutableDictionary alloc]init];
+        NSMutableDictionary<NSString *, NSString *> *posDetailsValues = [[NSMutableDictionary alloc]init];
         
-        NSString *SummaryFinalReport = @"";
+        NSMutableString *SummaryFinalReport = [[NSMutableString alloc]init];
         
         int b = 8;
         NSNumber *coun = [trxnResponse objectAtIndex:8];
@@ -2198,22 +2998,18 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 
             if ([trxnResponse[b + 2] isEqual: @"0"]) {
                 
-                NSURL *tableUrl = [[NSBundle bundleForClass:[self class]] URLForResource:@"ReconcilationTable" withExtension:@"html"];
-                NSString *ReconcilationNoTable = [NSString stringWithContentsOfURL:tableUrl encoding:NSUTF8StringEncoding error:nil];
-                NSString *htmlreconcilationNoTable = ReconcilationNoTable;
-                
+                NSMutableDictionary<NSString *, NSString *> *noTableValues = [[NSMutableDictionary alloc]init];
                 NSString *res = trxnResponse[b + 1];
                 NSString *arabi = [self checkingArabic:res];
                 
                 arabi = [arabi stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
 
-                htmlreconcilationNoTable = [htmlreconcilationNoTable stringByReplacingOccurrencesOfString:@"Scheme" withString:trxnResponse[b + 1]];
-                htmlreconcilationNoTable = [htmlreconcilationNoTable stringByReplacingOccurrencesOfString:@"قَدِيرٞ" withString:arabi];
+                noTableValues[@"Scheme"] = trxnResponse[b + 1];
+                noTableValues[@"قَدِيرٞ"] = arabi;
                 
                 b = b + 2;
                 
-                SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlreconcilationNoTable];
-                htmlreconcilationNoTable = ReconcilationNoTable;
+                [SummaryFinalReport appendString:[self renderReceipt:@"ReconcilationTable" values:noTableValues]];
                 
             }
             else {
@@ -2224,93 +3020,85 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
                          NSString *res = trxnResponse[b + 1];
                          NSString *arabi = [self checkingArabic:res];
                          arabi = [arabi stringByReplacingOccurrencesOfString:@"\u08F1" withString:@""];
-                         htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"مدى" withString:arabi];
+                         posTableValues[@"مدى"] = arabi;
                           
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"schemename" withString:[trxnResponse objectAtIndex: b + 1]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalDBCount" withString:[trxnResponse objectAtIndex:b + 4]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalDBAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 5]]]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalCBCount" withString:[trxnResponse objectAtIndex:b + 6]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"totalCBAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 7]]]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"NAQDCount" withString:[trxnResponse objectAtIndex:b + 8]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"NAQDAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 9]]]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"CADVCount" withString:[trxnResponse objectAtIndex:b + 10]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"CADVAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 11]]]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"AUTHCount" withString:[trxnResponse objectAtIndex:b + 12]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"AUTHAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 13]]]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"TOTALSCount" withString:trxnResponse[14]];
-                        htmlSummaryReportPosTable = [htmlSummaryReportPosTable stringByReplacingOccurrencesOfString:@"TOTALSAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[15]]]];
+                        posTableValues[@"schemename"] = [trxnResponse objectAtIndex: b + 1];
+                        posTableValues[@"totalDBCount"] = [trxnResponse objectAtIndex:b + 4];
+                        posTableValues[@"totalDBAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 5]]];
+                        posTableValues[@"totalCBCount"] = [trxnResponse objectAtIndex:b + 6];
+                        posTableValues[@"totalCBAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 7]]];
+                        posTableValues[@"NAQDCount"] = [trxnResponse objectAtIndex:b + 8];
+                        posTableValues[@"NAQDAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 9]]];
+                        posTableValues[@"CADVCount"] = [trxnResponse objectAtIndex:b + 10];
+                        posTableValues[@"CADVAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 11]]];
+                        posTableValues[@"AUTHCount"] = [trxnResponse objectAtIndex:b + 12];
+                        posTableValues[@"AUTHAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 13]]];
+                        posTableValues[@"TOTALSCount"] = trxnResponse[14];
+                        posTableValues[@"TOTALSAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[15]]];
 
                         }else {
                           break;
                         }
                         b = b + 15;
-                        SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlSummaryReportPosTable];
-                        htmlSummaryReportPosTable = [[NSString alloc]initWithString:summaryhtmlStringPosTable];
+                        [SummaryFinalReport appendString:[self renderReceipt:@"PosTableRunning" values:posTableValues]];
                   }
                   else if ([trxnResponse[b + 2]  isEqual: @"POS TERMINAL DETAILS"]) {
                      
                     if (trxnResponse.count >= b+14) {
                         
                           j = j - 1;
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalDBCount" withString:[trxnResponse objectAtIndex:b + 3]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalDBAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalCBCount" withString:[trxnResponse objectAtIndex:b + 5]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"totalCBAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"NAQDCount" withString:[trxnResponse objectAtIndex:b + 7]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"NAQDAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"CADVCount" withString:[trxnResponse objectAtIndex:b + 9]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"CADVAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"AUTHCount" withString:[trxnResponse objectAtIndex:b + 11]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"AUTHAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]]];
+                          posDetailsValues[@"totalDBCount"] = [trxnResponse objectAtIndex:b + 3];
+                          posDetailsValues[@"totalDBAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 4]]];
+                          posDetailsValues[@"totalCBCount"] = [trxnResponse objectAtIndex:b + 5];
+                          posDetailsValues[@"totalCBAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 6]]];
+                          posDetailsValues[@"NAQDCount"] = [trxnResponse objectAtIndex:b + 7];
+                          posDetailsValues[@"NAQDAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 8]]];
+                          posDetailsValues[@"CADVCount"] = [trxnResponse objectAtIndex:b + 9];
+                          posDetailsValues[@"CADVAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 10]]];
+                          posDetailsValues[@"AUTHCount"] = [trxnResponse objectAtIndex:b + 11];
+                          posDetailsValues[@"AUTHAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[b + 12]]];
                           
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"TOTALSCount" withString:trxnResponse[13]];
-                          htmlSummaryReportPosDetials = [htmlSummaryReportPosDetials stringByReplacingOccurrencesOfString:@"TOTALSAmount" withString:[self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[14]]]];
+                          posDetailsValues[@"TOTALSCount"] = trxnResponse[13];
+                          posDetailsValues[@"TOTALSAmount"] = [self decimalValue:[NSString stringWithFormat:@"%@", trxnResponse[14]]];
 
                       }else {
                         break;
                       }
                       b = b + 14;
-                      SummaryFinalReport = [SummaryFinalReport stringByAppendingString:htmlSummaryReportPosDetials];
-                      htmlSummaryReportPosDetials = [[NSString alloc]initWithString:summaryhtmlStringPosDetials];
+                      [SummaryFinalReport appendString:[self renderReceipt:@"PosTerminalDetails" values:posDetailsValues]];
                  }
             }
         }
         
-        builder = [builder stringByReplacingOccurrencesOfString:@"PosTable" withString:SummaryFinalReport];
-        builder = [builder stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[4]]];
-        builder = [builder stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[4]]];
-        builder = [builder stringByReplacingOccurrencesOfString:@"RetailerId" withString:trxnResponse[5]];
-        builder = [builder stringByReplacingOccurrencesOfString:@"Buzzcode" withString:trxnResponse[6]];
-        builder = [builder stringByReplacingOccurrencesOfString:@"AppVersion" withString:trxnResponse[7]];
+        values[@"PosTable"] = SummaryFinalReport;
+        values[@"currentTime"] = [self getTime:trxnResponse[4]];
+        values[@"currentDate"] = [self getDate:trxnResponse[4]];
+        values[@"RetailerId"] = trxnResponse[5];
+        values[@"Buzzcode"] = trxnResponse[6];
+        values[@"AppVersion"] = trxnResponse[7];
         
         NSString *teminalID = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"];
 //        if (teminalID.length > 9) {
 //            NSString *terminal = [teminalID substringWithRange:NSMakeRange( 0, 8)];
-//            builder = [builder stringByReplacingOccurrencesOfString:@"TerminalId" withString:terminal];
+//            values[@"TerminalId"] = terminal;
 //        }
-       builder = [builder stringByReplacingOccurrencesOfString:@"TerminalId" withString:teminalID];
+       values[@"TerminalId"] = teminalID;
        
-       builder = [builder stringByReplacingOccurrencesOfString:@"Merchant Name" withString:trxnResponse[b+1]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"Merchant Address" withString:trxnResponse[b+2]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MerchantName_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:trxnResponse[b+3]]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MerchantAddress_Arebic" withString:[self encodingISO_8859_6:[self hexStringToData:trxnResponse[b+4]]]];
-       builder = [builder stringByReplacingOccurrencesOfString:@"MADA" withString:@"mada"];
+       values[@"Merchant Name"] = trxnResponse[b+1];
+       values[@"Merchant Address"] = trxnResponse[b+2];
+       values[@"MerchantName_Arebic"] = [self arabicField:trxnResponse[b+3]];
+       values[@"MerchantAddress_Arebic"] = [self arabicField:trxnResponse[b+4]];
        if(transactionType == 21)
-           builder = [builder stringByReplacingOccurrencesOfString:@"running balance" withString:@"RUNNING BALANCE"];
+           values[@"running balance"] = @"RUNNING BALANCE";
        else
-           builder = [builder stringByReplacingOccurrencesOfString:@"running balance" withString:@"SNAPSHOT BALANCE"];
-       return builder;
+           values[@"running balance"] = @"SNAPSHOT BALANCE";
+       // Also catches the scheme names the terminal sends in capitals
+       return [[self renderReceipt:fileName values:values] stringByReplacingOccurrencesOfString:@"MADA" withString:@"mada"];
     }
-    else if (transactionType == 22 && htmlString != nil) { // PRINT SUMMARY REPORT
+    else if (transactionType == 22 && hasTemplate) { // PRINT SUMMARY REPORT
                 
-        NSString *builder = [[NSString alloc]initWithString:htmlString];
-
-        NSString *summaryhtmlString = @"";
-        NSURL *bundlePaths = [[NSBundle bundleForClass:[self class]] URLForResource:@"Summary" withExtension:@"html"];
-        summaryhtmlString = [NSString stringWithContentsOfURL:bundlePaths encoding:NSUTF8StringEncoding error:nil];
-        
-        NSString *htmlSummaryReport = [[NSString alloc]initWithString:summaryhtmlString];
-        NSString *SummaryFinalReport = @"";
+        NSMutableDictionary<NSString *, NSString *> *summaryValues = [[NSMutableDictionary alloc]init];
+        NSMutableString *SummaryFinalReport = [[NSMutableString alloc]init];
 
         int j = 5;
         NSNumber* count = [trxnResponse objectAtIndex:4];
@@ -2319,38 +3107,37 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
         for (int i = 1; i <= transactionsLength; i++) {
                
             if (trxnResponse.count >= j+8) {
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionType" withString:[trxnResponse objectAtIndex:j]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionDate" withString:[trxnResponse objectAtIndex:j+1]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionRRN" withString:[trxnResponse objectAtIndex:j+2]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionAmount" withString:[trxnResponse objectAtIndex:j+3]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionState" withString:[trxnResponse objectAtIndex:j+4]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionTime" withString:[trxnResponse objectAtIndex:j+5]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionPANNumber" withString:[trxnResponse objectAtIndex:j+6]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"authCode" withString:[trxnResponse objectAtIndex:j+7]];
-                htmlSummaryReport = [htmlSummaryReport stringByReplacingOccurrencesOfString:@"transactionNumber" withString:[trxnResponse objectAtIndex:j+8]];
+                summaryValues[@"transactionType"] = [trxnResponse objectAtIndex:j];
+                summaryValues[@"transactionDate"] = [trxnResponse objectAtIndex:j+1];
+                summaryValues[@"transactionRRN"] = [trxnResponse objectAtIndex:j+2];
+                summaryValues[@"transactionAmount"] = [trxnResponse objectAtIndex:j+3];
+                summaryValues[@"transactionState"] = [trxnResponse objectAtIndex:j+4];
+                summaryValues[@"transactionTime"] = [trxnResponse objectAtIndex:j+5];
+                summaryValues[@"transactionPANNumber"] = [trxnResponse objectAtIndex:j+6];
+                summaryValues[@"authCode"] = [trxnResponse objectAtIndex:j+7];
+                summaryValues[@"transactionNumber"] = [trxnResponse objectAtIndex:j+8];
 
             }else {
               break;
             }
-            SummaryFinalReport = [NSString stringWithFormat:@"%@%@",SummaryFinalReport,htmlSummaryReport];
-            htmlSummaryReport = [[NSString alloc]initWithString:summaryhtmlString];
+            [SummaryFinalReport appendString:[self renderReceipt:@"Summary" values:summaryValues]];
 
             j = j + 9;
         }
         
-        builder = [builder stringByReplacingOccurrencesOfString:@"no_Transaction" withString:SummaryFinalReport];
-        builder = [builder stringByReplacingOccurrencesOfString:@"currentTime" withString:[self getTime:trxnResponse[4]]];
-        builder = [builder stringByReplacingOccurrencesOfString:@"currentDate" withString:[self getDate:trxnResponse[4]]];
+        values[@"no_Transaction"] = SummaryFinalReport;
+        values[@"currentTime"] = [self getTime:trxnResponse[4]];
+        values[@"currentDate"] = [self getDate:trxnResponse[4]];
         
         NSString *teminalID = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"];
         if (teminalID.length > 9) {
             NSString *terminal = [teminalID substringWithRange:NSMakeRange( 0, 8)];
-            builder = [builder stringByReplacingOccurrencesOfString:@"terminalId" withString:terminal];
+            values[@"terminalId"] = terminal;
         }
-        return builder;
+        return [self renderReceipt:fileName values:values];
     }
 
-    return htmlString;
+    return [self renderReceipt:fileName values:values];
 }
 
 -(NSString*)getDate:(NSString*)inputDate {
@@ -2391,6 +3178,7 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 
 //MARK: - NSStreamDelegate Methods -
 
+// Socket thread only: reads are handed to the decode queue, connection events to the main thread
 - (void)stream:(NSStream *)theStream handleEvent:(NSStreamEvent)streamEvent {
     
     NSLog(@"NSStreamDelegate Stream Event: %@", @(streamEvent));
@@ -2400,26 +3188,35 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             NSLog(@"NSStreamEventNone");
             break;
 
-        case NSStreamEventOpenCompleted:
-            NSLog(@"NSStreamEventOpenCompleted");
-            [self connectSuccess:theStream];
-            break;
-
         case NSStreamEventHasBytesAvailable:
-            NSLog(@"NSStreamEventOpenCompleted");
+            NSLog(@"NSStreamEventHasBytesAvailable");
             if (theStream == self.inputStream) {
 
-                uint8_t buffer[1024];
                 NSInteger len;
 
                 while ([self.inputStream hasBytesAvailable]) {
-                    memset(buffer, 0x00, sizeof(buffer));
-                    len = [self.inputStream read:buffer maxLength:sizeof(buffer)];
+                    // Zero filled like the stack buffer parse() used to get
+                    NSMutableData *buffer = [NSMutableData dataWithLength:RECEIVE_BUFFER_SIZE];
+                    len = [self.inputStream read:[buffer mutableBytes] maxLength:[buffer length]];
                     if (len > 0) {
-                        NSString *output = [[NSString alloc] initWithBytes:buffer length:len encoding:NSASCIIStringEncoding];
+                        [self captureBytes:[buffer bytes] length:len direction:ECR_CAPTURE_INBOUND];
+                        NSString *output = [[NSString alloc] initWithBytes:[buffer bytes] length:len encoding:NSASCIIStringEncoding];
                         if (nil != output) {
                             NSLog(@"Server Output: %@", output);
-                            [self receivedData:buffer];
+                            uint64_t sequence = [SKBCoreServices nextHandoffSequence];
+                            int transactionType = atomic_load(&_sentTransactionType);
+                            SKBReceiptFormat receiptFormat = (SKBReceiptFormat)atomic_load(&_sentReceiptFormat);
+                            int receiptLineWidth = atomic_load(&_sentReceiptLineWidth);
+                            _readThrough = sequence;
+                            dispatch_async(self.decodeQueue, ^{
+                                self.decodeSequence = sequence;
+                                self.decodeTransactionType = transactionType;
+                                self.decodeReceiptFormat = receiptFormat;
+                                self.decodeReceiptLineWidth = receiptLineWidth;
+                                [self receivedData:[buffer mutableBytes]];
+                                atomic_store_explicit(&self->_decodedThrough, sequence, memory_order_release);
+                                [SKBCoreServices scheduleDrain];
+                            });
                         }
                     }
                 }
@@ -2430,6 +3227,31 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             NSLog(@"NSStreamEventHasSpaceAvailable");
             break;
             
+        case NSStreamEventOpenCompleted:
+        case NSStreamEventErrorOccurred:
+        case NSStreamEventEndEncountered:
+            [self postStreamEvent:streamEvent stream:theStream];
+            break;
+
+        default:
+            NSLog(@"Unknown NSStreamEvent");
+    }
+ }
+
+// Main thread only
+- (void)handleStreamEvent:(NSStreamEvent)streamEvent stream:(NSStream *)theStream {
+    
+    // Events of streams torn down in the meantime are stale
+    if (theStream != self.inputStream && theStream != self.outputStream) {
+        return;
+    }
+    
+    switch (streamEvent) {
+        case NSStreamEventOpenCompleted:
+            NSLog(@"NSStreamEventOpenCompleted");
+            [self connectSuccess:theStream];
+            break;
+
         case NSStreamEventErrorOccurred:
             NSLog(@"NSStreamEventErrorOccurred: %@", theStream.streamError);
             [self connectFailure];
@@ -2451,9 +3273,9 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
             break;
 
         default:
-            NSLog(@"Unknown NSStreamEvent");
+            break;
     }
- }
+}
 
 -(NSString *)checkingArabic:(NSString *)inputCommand {
     
@@ -2614,6 +3436,671 @@ static NSTimeInterval kTimeoutTimeInterval = 5;
 
 }
 
+//MARK: - Field Interning -
+
+// Splits a parsed response at ';' as componentsSeparatedByString: did, reusing the
+// connection's instance of every value it has seen before
+- (NSMutableArray *)internedFields:(const char *)ecrResponse {
+    
+    NSMutableArray *fields = [[NSMutableArray alloc] init];
+    const char *field = ecrResponse;
+    
+    for (;;) {
+        const char *end = strchr(field, ';');
+        int length = end ? (int)(end - field) : (int)strlen(field);
+        [fields addObject:[self internedString:(const unsigned char *)field length:length]];
+        if (end == NULL) {
+            break;
+        }
+        field = end + 1;
+    }
+    return fields;
+}
+
+- (NSString *)internedString:(const unsigned char *)bytes length:(int)length {
+    
+    int found = 0;
+    int slot = ecrInternFind(&_internTable, bytes, length, &found);
+    if (slot < 0) {
+        return [[NSString alloc] initWithBytes:bytes length:length encoding:[NSString defaultCStringEncoding]] ?: @"";
+    }
+    if (!found) {
+        _internedFields[slot] = [[NSString alloc] initWithBytes:bytes length:length encoding:[NSString defaultCStringEncoding]] ?: @"";
+        _internedArabic[slot] = nil;
+    }
+    return _internedFields[slot];
+}
+
+// Arabic fields come as ISO 8859-6 in hex; the decoded text is kept in the slot of the hex
+- (NSString *)arabicField:(NSString *)hexString {
+    
+    const char *bytes = [hexString UTF8String];
+    int found = 0;
+    int slot = bytes ? ecrInternFind(&_internTable, (const unsigned char *)bytes, (int)strlen(bytes), &found) : -1;
+    if (slot < 0) {
+        return [self encodingISO_8859_6:[self hexStringToData:hexString]] ?: @"";
+    }
+    if (!found) {
+        _internedFields[slot] = [hexString copy];
+        _internedArabic[slot] = nil;
+    }
+    if (_internedArabic[slot] == nil) {
+        _internedArabic[slot] = [self encodingISO_8859_6:[self hexStringToData:hexString]] ?: @"";
+    }
+    return _internedArabic[slot];
+}
+
+//MARK: - Summary Report Stream -
+
+static NSString * const kReportRowKeys[ECR_REPORT_ROW_FIELDS] = {
+    @"transactionType", @"date", @"rrn", @"amount", @"state", @"time", @"pan", @"authCode", @"transactionNumber"
+};
+
+static void reportRow(void *context, const ECR_REPORT_ROW *row) {
+    
+    NSMutableArray *rows = (__bridge NSMutableArray *)context;
+    NSMutableDictionary *fields = [[NSMutableDictionary alloc]initWithCapacity:ECR_REPORT_ROW_FIELDS];
+    for (int i = 0; i < ECR_REPORT_ROW_FIELDS; i++) {
+        fields[kReportRowKeys[i]] = [[NSString alloc]initWithBytes:row->apszField[i] length:row->aiLength[i] encoding:NSASCIIStringEncoding] ?: @"";
+    }
+    [rows addObject:fields];
+}
+
+- (void)streamSummaryReport:(NSString *)ecrRefNum rows:(void (^)(NSArray<NSDictionary<NSString *, NSString *> *> *rows))rowsHandler completion:(void (^)(NSUInteger rowCount, NSString *error))completion {
+    
+    if (self.reportStreaming) {
+        completion(0, @"Summary report already streaming");
+        return;
+    }
+    // A page request would take over the timer and transaction type of the one in flight
+    if (self.transactionInFlight || self.reconciliationPending || self.probeInFlight || self.probeReconnecting) {
+        completion(0, @"Transaction in flight");
+        return;
+    }
+    if (!self.connected) {
+        completion(0, @"Not connected");
+        return;
+    }
+    self.reportRefNum = ecrRefNum;
+    self.reportRowCount = 0;
+    self.reportRowsHandler = rowsHandler;
+    self.reportCompletion = completion;
+    // Queued ahead of the first page's decode
+    dispatch_async(self.decodeQueue, ^{
+        ecrReportInit(&self->_reportStream);
+    });
+    self.reportStreaming = YES;
+    [self requestReportPage:1];
+}
+
+- (void)requestReportPage:(int)attempt {
+    
+    self.reportAttempt = attempt;
+    NSString *requestData = [NSString stringWithFormat:@"%@;%d;%@!", [self currentDateTimeStamp], attempt, self.reportRefNum];
+    [self doTCPIPTransaction:self.ipAdress portNumber:self.portNumber requestData:requestData transactionType:22 signature:nil];
+}
+
+// Decode queue only
+- (void)decodeReportPage:(const char *)ecrResponse {
+    
+    NSMutableArray *rows = [[NSMutableArray alloc]init];
+    int status = ecrReportDecodePage(&_reportStream, ecrResponse, reportRow, (__bridge void *)rows);
+    
+    NSMutableDictionary *page = [[NSMutableDictionary alloc]init];
+    [page setValue:@(status) forKey:@"reportStatus"];
+    [page setValue:rows forKey:@"rows"];
+    [page setValue:@(_reportStream.szResponseCode) forKey:@"Response Code"];
+    [page setValue:@(_reportStream.szResponseMessage) forKey:@"Response Message"];
+    [self postResponse:page kind:SKBHandoffKindReportPage];
+}
+
+// Main thread only
+- (void)reportPageReceived:(NSDictionary *)page {
+    
+    if (!self.reportStreaming) {
+        return;
+    }
+    int status = [page[@"reportStatus"] intValue];
+    BOOL more = (status == ECR_REPORT_MORE && self.reportAttempt < ECR_REPORT_ATTEMPT_MAX);
+    NSArray *rows = page[@"rows"];
+    
+    // The terminal works on the next page while these rows are handled
+    if (more) {
+        [self requestReportPage:self.reportAttempt + 1];
+    }
+    self.reportRowCount += rows.count;
+    if (rows.count > 0 && self.reportRowsHandler) {
+        self.reportRowsHandler(rows);
+    }
+    if (!more) {
+        NSString *error = nil;
+        if (status == ECR_REPORT_ERROR) {
+            error = [[NSString stringWithFormat:@"%@ %@", page[@"Response Code"], page[@"Response Message"]] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        }
+        [self finishReportStream:error];
+    }
+}
+
+- (void)finishReportStream:(NSString *)error {
+    
+    void (^completion)(NSUInteger rowCount, NSString *error) = self.reportCompletion;
+    NSUInteger rowCount = self.reportRowCount;
+    self.reportStreaming = NO;
+    self.reportRowsHandler = nil;
+    self.reportCompletion = nil;
+    if (completion) {
+        completion(rowCount, error);
+    }
+}
+
+//MARK: - Reconciliation -
+
+- (void)sendReconciliation:(NSString *)ecrRefNum printReceipt:(BOOL)printReceipt signature:(NSString *)signature completion:(void (^)(NSData *reply, NSString *error))completion {
+    
+    if (self.transactionInFlight || self.reconciliationPending || self.reportStreaming) {
+        completion(nil, @"Transaction in flight");
+        return;
+    }
+    if (!self.connected) {
+        completion(nil, @"Not connected");
+        return;
+    }
+    self.reconciliationCompletion = completion;
+    self.reconciliationPending = YES;
+    NSString *requestData = [NSString stringWithFormat:@"%@;%d;%@!", [self currentDateTimeStamp], printReceipt ? 1 : 0, ecrRefNum];
+    [self doTCPIPTransaction:self.ipAdress portNumber:self.portNumber requestData:requestData transactionType:10 signature:signature];
+}
+
+- (void)finishReconciliation:(NSData *)reply error:(NSString *)error {
+    
+    void (^completion)(NSData *reply, NSString *error) = self.reconciliationCompletion;
+    self.reconciliationPending = NO;
+    self.reconciliationCompletion = nil;
+    if (completion) {
+        completion(reply, error);
+    }
+}
+
+//MARK: - Deadline Resolution -
+
+// References of the SDK's own requests (resolution, probes): a full width (REFNUM_SIZE)
+// "9" and a sequence number kept across launches, so they do not repeat and stay apart
+// from the short references apps send
++ (NSString *)nextInternalRefNum {
+    
+    @synchronized (self) {
+        NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+        long long sequence = ([defaults integerForKey:@"SKB_REF_SEQUENCE"] + 1) % 10000000000000LL;
+        [defaults setInteger:(NSInteger)sequence forKey:@"SKB_REF_SEQUENCE"];
+        return [NSString stringWithFormat:@"9%013lld", sequence];
+    }
+}
+
+// Card transactions, whose outcome the terminal can repeat (C2)
+- (BOOL)resolvesByRepeat:(int)transactionType {
+    
+    return transactionType <= 9 || transactionType == 20 || transactionType == 27;
+}
+
+// The ECR reference number is the last field of every request
+- (NSString *)lastRequestField:(NSString *)requestData {
+    
+    NSString *fields = [requestData hasSuffix:@"!"] ? [requestData substringToIndex:requestData.length - 1] : requestData;
+    return [[fields componentsSeparatedByString:@";"] lastObject];
+}
+
+// Repeat asks for the previous ECR number, the last ECRNUM_SIZE digits of the reference
+// number; nil for a reference that is shorter or not all digits, which Repeat cannot name
+- (NSString *)previousEcrNumber:(NSString *)ecrRefNum {
+    
+    NSCharacterSet *nonDigits = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789"] invertedSet];
+    if (ecrRefNum.length < ECRNUM_SIZE || ecrRefNum.length > REFNUM_SIZE || [ecrRefNum rangeOfCharacterFromSet:nonDigits].location != NSNotFound) {
+        return nil;
+    }
+    return [ecrRefNum substringFromIndex:ecrRefNum.length - ECRNUM_SIZE];
+}
+
+// Transaction type and every request field but the leading date-time, so a resend
+// is told apart from another request that reuses its reference
+- (NSString *)requestDigest:(NSString *)requestData transactionType:(int)transactionType {
+    
+    NSString *fields = [requestData hasSuffix:@"!"] ? [requestData substringToIndex:requestData.length - 1] : requestData;
+    NSMutableArray *values = [[fields componentsSeparatedByString:@";"] mutableCopy];
+    [values removeObjectAtIndex:0];
+    return [self computeSha256Hash:[NSString stringWithFormat:@"%d;%@", transactionType, [values componentsJoinedByString:@";"]]];
+}
+
+// The deadline passed without a reply: ask the terminal what became of the transaction,
+// within resolutionTimeout, before the delegate hears anything
+- (void)resolveExpiredTransaction {
+    
+    NSString *ecrRefNum = [SKBCoreServices nextInternalRefNum];
+    NSString *requestData = nil;
+    int transactionType = 0;
+    if ([self resolvesByRepeat:self.deadlineTransactionType]) {
+        // The reference was checked when the transaction was sent
+        NSString *previousEcrNum = [self previousEcrNumber:self.deadlineRefNum];
+        self.resolutionStep = SKBResolutionStepRepeat;
+        [[NSUserDefaults standardUserDefaults]setInteger:self.deadlineTransactionType forKey:@"LAST_TRANSACTON_TYPE"];
+        requestData = [NSString stringWithFormat:@"%@;%@;%@!", [self currentDateTimeStamp], previousEcrNum, ecrRefNum];
+        transactionType = 23;
+    }
+    else {
+        self.resolutionStep = SKBResolutionStepCheckStatus;
+        requestData = [NSString stringWithFormat:@"%@;%@!", [self currentDateTimeStamp], ecrRefNum];
+        transactionType = 24;
+    }
+    NSLog(@"Deadline passed for Trnx:%d, resolving with %d", self.deadlineTransactionType, transactionType);
+    [self doTCPIPTransaction:self.ipAdress portNumber:self.portNumber requestData:requestData transactionType:transactionType signature:nil receiptFormat:self.receiptFormat deadline:self.resolutionTimeout];
+}
+
+// Tags the response of a transaction sent with a deadline with how its outcome was settled
+- (void)settleDeadlineResponse:(NSMutableDictionary *)responseData {
+    
+    SKBResolutionStep step = self.resolutionStep;
+    self.resolutionStep = SKBResolutionStepNone;
+    
+    if (step == SKBResolutionStepArmed) {
+        [responseData setValue:@"completed" forKey:@"deadlineOutcome"];
+        return;
+    }
+    if (step == SKBResolutionStepRepeat && self.lateResponse != nil) {
+        // The transaction's own reply beats whatever the Repeat answered
+        [responseData removeAllObjects];
+        [responseData addEntriesFromDictionary:self.lateResponse];
+        self.lateResponse = nil;
+        [responseData setValue:@"lateReply" forKey:@"resolvedBy"];
+        [responseData setValue:@"resolved" forKey:@"deadlineOutcome"];
+        return;
+    }
+    if (step == SKBResolutionStepRepeat) {
+        NSString *refNum = [responseData[@"ECR Transaction Reference Number"] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        [responseData setValue:@"repeat" forKey:@"resolvedBy"];
+        if (refNum.length > 0 && [refNum isEqualToString:self.deadlineRefNum]) {
+            [responseData setValue:@"resolved" forKey:@"deadlineOutcome"];
+        }
+        else if (refNum.length == 0 && [responseData[@"responseMessage"] isEqual:@"NO DATA FOUND"]) {
+            // The terminal holds no outcome for this transaction
+            [responseData removeAllObjects];
+            [responseData setValue:[NSString stringWithFormat:@"%d", self.deadlineTransactionType] forKey:@"Transaction type"];
+            [responseData setValue:@"Transaction not processed" forKey:@"responseMessage"];
+            [responseData setValue:@"repeat" forKey:@"resolvedBy"];
+            [responseData setValue:@"notProcessed" forKey:@"deadlineOutcome"];
+        }
+        else {
+            // Another transaction's reply, or none: this one may still have gone through
+            [responseData removeAllObjects];
+            [responseData setValue:[NSString stringWithFormat:@"%d", self.deadlineTransactionType] forKey:@"Transaction type"];
+            [responseData setValue:@"Timeout Please try again" forKey:@"responseMessage"];
+            [responseData setValue:@"repeat" forKey:@"resolvedBy"];
+            [responseData setValue:@"unknown" forKey:@"deadlineOutcome"];
+        }
+        return;
+    }
+    // Check Status only tells the terminal is there again; the lane is free, the outcome unknown
+    NSString *status = responseData[@"Response Code"];
+    [responseData removeAllObjects];
+    [responseData setValue:[NSString stringWithFormat:@"%d", self.deadlineTransactionType] forKey:@"Transaction type"];
+    [responseData setValue:@"Timeout Please try again" forKey:@"responseMessage"];
+    [responseData setValue:status forKey:@"Check Status Response Code"];
+    [responseData setValue:@"checkStatus" forKey:@"resolvedBy"];
+    [responseData setValue:@"unknown" forKey:@"deadlineOutcome"];
+}
+
+//MARK: - Idempotent Retries -
+
+// Keeps the reply of the transaction in flight for its reference, or forgets the
+// reference if the outcome is not known; returns the submissions that joined it
+- (NSUInteger)finishIdempotentTransaction:(NSDictionary *)responseData final:(BOOL)final {
+    
+    if (self.idempotencyRefNum == nil) {
+        return 0;
+    }
+    NSUInteger waiters = 0;
+    if (final) {
+        waiters = [self.idempotencyCache completeTransaction:self.idempotencyRefNum terminal:self.idempotencyTerminal response:responseData];
+    }
+    else {
+        waiters = [self.idempotencyCache abandonTransaction:self.idempotencyRefNum terminal:self.idempotencyTerminal];
+    }
+    self.idempotencyRefNum = nil;
+    self.idempotencyTerminal = nil;
+    return waiters;
+}
+
+- (void)deliverJoined:(NSUInteger)waiters response:(NSDictionary *)responseData {
+    
+    for (NSUInteger i = 0; i < waiters; i++) {
+        NSMutableDictionary *joinedResponse = [responseData mutableCopy];
+        [joinedResponse setValue:@"joined" forKey:@"idempotencyReplay"];
+        if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+            [self.delegate socketConnectionStream:self didReceiveData:joinedResponse];
+        }
+    }
+}
+
+//MARK: - Adaptive Timeouts -
+
+- (NSString *)terminalAddress {
+    
+    return [NSString stringWithFormat:@"%@:%@", self.ipAdress, @(self.portNumber)];
+}
+
+// Card transactions wait on the customer (card, PIN) as much as on the terminal, so
+// they keep the fixed timeout; only housekeeping commands adapt
+- (NSTimeInterval)transactionTimeoutForType:(int)transactionType {
+    
+    if (self.adaptiveTimeouts == nil || [self resolvesByRepeat:transactionType]) {
+        return kTransactionTimeInterval;
+    }
+    return [self.adaptiveTimeouts transactionTimeoutForTerminal:[self terminalAddress] transactionType:transactionType fallback:kTransactionTimeInterval];
+}
+
+// transactionType is the one the reply answered, taken as its frame was read
+- (void)recordResponseLatency:(int)transactionType {
+    
+    if (self.transactionStartDate == nil) {
+        return;
+    }
+    if ([self resolvesByRepeat:transactionType]) {
+        self.transactionStartDate = nil;
+        return;
+    }
+    [self.adaptiveTimeouts recordResponseLatency:-[self.transactionStartDate timeIntervalSinceNow] transactionType:transactionType terminal:[self terminalAddress]];
+    self.transactionStartDate = nil;
+}
+
+- (NSDictionary *)currentTimeouts {
+    
+    if (self.adaptiveTimeouts == nil) {
+        return @{
+            @"terminal": [self terminalAddress],
+            @"connect": @{ @"timeout": @(self.timeoutTimeInterval), @"samples": @0 },
+            @"reconnectInterval": @(self.reconnectTimeInterval),
+            @"defaultTransactionTimeout": @(kTransactionTimeInterval),
+            @"transactions": @{}
+        };
+    }
+    return [self.adaptiveTimeouts dictionaryRepresentationForTerminal:[self terminalAddress] connectFallback:self.timeoutTimeInterval reconnectFallback:self.reconnectTimeInterval transactionFallback:kTransactionTimeInterval];
+}
+
+//MARK: - Health Probe -
+
+- (BOOL)sendCheckStatusProbe:(NSTimeInterval)timeout completion:(void (^)(BOOL success, NSTimeInterval latency))completion {
+    
+    if (!self.connected || self.transactionInFlight || self.probeInFlight || self.probeReconnecting) {
+        return NO;
+    }
+    
+    NSString *ecrRefNum = [SKBCoreServices nextInternalRefNum];
+    NSString *terminalId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+    char signature[SHA256_HEX_SIZE + 1] = { 0 };
+    sha256Signature([ecrRefNum UTF8String], [terminalId UTF8String], signature);
+    NSString *requestData = [NSString stringWithFormat:@"%@;%@!", [self currentDateTimeStamp], ecrRefNum];
+    
+    unsigned char ecrBuffer[600];
+    memset(ecrBuffer, 0x00, sizeof(ecrBuffer));
+    int frameLength = ecrFrameCacheEmitRequest(&_frameCache, 24, [requestData UTF8String], signature, ecrBuffer); //CHECK STATUS
+    if (frameLength < 0) {
+        if (pack((char *)[requestData UTF8String], 24, signature, (char *)ecrBuffer) == -1) {
+            return NO;
+        }
+        frameLength = (int)strlen((char *)ecrBuffer);
+    }
+    
+    self.probeInFlight = YES;
+    self.probeCompletion = completion;
+    self.probeStartDate = [NSDate date];
+    self.probeTimer = [NSTimer scheduledTimerWithTimeInterval:timeout target:self selector:@selector(probeTimeout:) userInfo:nil repeats:NO];
+    [self writeToSocket:[NSData dataWithBytes:ecrBuffer length:frameLength]];
+    return YES;
+}
+
+-(void)probeTimeout:(NSTimer *)timer {
+    
+    [self finishProbe:NO];
+}
+
+- (void)finishProbe:(BOOL)success {
+    
+    [self.probeTimer invalidate];
+    self.probeTimer = nil;
+    NSTimeInterval latency = -[self.probeStartDate timeIntervalSinceNow];
+    void (^completion)(BOOL, NSTimeInterval) = self.probeCompletion;
+    self.probeCompletion = nil;
+    self.probeInFlight = NO;
+    
+    if (completion) {
+        completion(success, latency);
+    }
+    
+    // A late Check Status reply would be taken for the next transaction's, so
+    // transactions wait for a fresh connection
+    if (!success) {
+        self.probeReconnecting = YES;
+        [self connect];
+        return;
+    }
+    [self releasePendingTransactions];
+}
+
+// Transactions that arrived while a probe was on the wire, in the order they came
+- (void)releasePendingTransactions {
+    
+    self.probeReconnecting = NO;
+    NSArray<dispatch_block_t> *pendingTransactions = [self.pendingTransactions copy];
+    [self.pendingTransactions removeAllObjects];
+    for (dispatch_block_t pendingTransaction in pendingTransactions) {
+        pendingTransaction();
+    }
+}
+
+//MARK: - Compact Response Record -
+
+#define COMPACT_RECORD_BUFFER_SIZE 8192
+
+typedef struct {
+    __unsafe_unretained NSString *key;
+    int fieldId;
+    BOOL amount;
+} SKBRecordKey;
+
+static const SKBRecordKey kRecordKeys[] = {
+    { @"Transaction type",                  ECR_FLD_TRAN_TYPE,                        NO  },
+    { @"Response Code",                     ECR_FLD_RESPONSE_CODE,                    NO  },
+    { @"Response Message",                  ECR_FLD_RESPONSE_MESSAGE,                 NO  },
+    { @"responseMessage",                   ECR_FLD_RESPONSE_MESSAGE_ALT,             NO  },
+    { @"PAN Number",                        ECR_FLD_PAN_NUMBER,                       NO  },
+    { @"panNo",                             ECR_FLD_PAN_NO,                           NO  },
+    { @"Transaction Amount",                ECR_FLD_TRAN_AMOUNT,                      YES },
+    { @"Cash Back Amount",                  ECR_FLD_CASHBACK_AMOUNT,                  YES },
+    { @"Total Amount",                      ECR_FLD_TOTAL_AMOUNT,                     YES },
+    { @"Buss Code",                         ECR_FLD_BUSS_CODE,                        NO  },
+    { @"Stan No",                           ECR_FLD_STAN_NO,                          NO  },
+    { @"Date & Time ",                      ECR_FLD_DATE_TIME,                        NO  },
+    { @"Date & Time",                       ECR_FLD_DATE_TIME_ALT,                    NO  },
+    { @"Date Time Stamp",                   ECR_FLD_DATE_TIME_STAMP,                  NO  },
+    { @"Card Exp Date",                     ECR_FLD_CARD_EXP_DATE,                    NO  },
+    { @"RRN",                               ECR_FLD_RRN,                              NO  },
+    { @"Auth Code",                         ECR_FLD_AUTH_CODE,                        NO  },
+    { @"TID",                               ECR_FLD_TID,                              NO  },
+    { @"MID",                               ECR_FLD_MID,                              NO  },
+    { @"Batch No",                          ECR_FLD_BATCH_NO,                         NO  },
+    { @"AID",                               ECR_FLD_AID,                              NO  },
+    { @"Application Cryptogram",            ECR_FLD_APP_CRYPTOGRAM,                   NO  },
+    { @"CID",                               ECR_FLD_CID,                              NO  },
+    { @"CVR",                               ECR_FLD_CVR,                              NO  },
+    { @"TVR",                               ECR_FLD_TVR,                              NO  },
+    { @"TSI",                               ECR_FLD_TSI,                              NO  },
+    { @"KERNEL-ID",                         ECR_FLD_KERNEL_ID,                        NO  },
+    { @"PAR",                               ECR_FLD_PAR,                              NO  },
+    { @"PANSUFFIX",                         ECR_FLD_PAN_SUFFIX,                       NO  },
+    { @"Card Entry Mode",                   ECR_FLD_CARD_ENTRY_MODE,                  NO  },
+    { @"Merchant Category Code",            ECR_FLD_MERCHANT_CATEGORY_CODE,           NO  },
+    { @"Terminal Transaction Type",         ECR_FLD_TERM_TRAN_TYPE,                   NO  },
+    { @"Scheme Label",                      ECR_FLD_SCHEME_LABEL,                     NO  },
+    { @"Product Info",                      ECR_FLD_PRODUCT_INFO,                     NO  },
+    { @"Application Version",               ECR_FLD_APP_VERSION,                      NO  },
+    { @"Disclaimer",                        ECR_FLD_DISCLAIMER,                       NO  },
+    { @"Merchant Name",                     ECR_FLD_MERCHANT_NAME,                    NO  },
+    { @"Merchant Address",                  ECR_FLD_MERCHANT_ADDRESS,                 NO  },
+    { @"MerchantName_Arebic",               ECR_FLD_MERCHANT_NAME_ARABIC,             NO  },
+    { @"MerchantAddress_Arebic",            ECR_FLD_MERCHANT_ADDRESS_ARABIC,          NO  },
+    { @"ECR Transaction Reference Number",  ECR_FLD_ECR_REF_NUM,                      NO  },
+    { @"Signature",                         ECR_FLD_SIGNATURE,                        NO  },
+    { @"Terminal id",                       ECR_FLD_TERMINAL_ID,                      NO  },
+    { @"Vendor ID",                         ECR_FLD_VENDOR_ID,                        NO  },
+    { @"Vendor Terminal type",              ECR_FLD_VENDOR_TERM_TYPE,                 NO  },
+    { @"TRSM ID",                           ECR_FLD_TRSM_ID,                          NO  },
+    { @"Vendor Key Index",                  ECR_FLD_VENDOR_KEY_INDEX,                 NO  },
+    { @"SAMA Key Index",                    ECR_FLD_SAMA_KEY_INDEX,                   NO  },
+    { @"VendorID",                          ECR_FLD_VENDOR_ID_ALT,                    NO  },
+    { @"VendorTerminaltype",                ECR_FLD_VENDOR_TERM_TYPE_ALT,             NO  },
+    { @"TRSMID",                            ECR_FLD_TRSM_ID_ALT,                      NO  },
+    { @"VendorKeyIndex",                    ECR_FLD_VENDOR_KEY_INDEX_ALT,             NO  },
+    { @"SAMAKeyIndex",                      ECR_FLD_SAMA_KEY_INDEX_ALT,               NO  },
+    { @"POSTransactionReferenceNumber",     ECR_FLD_POS_REF_NUM,                      NO  },
+    { @"Trace Number",                      ECR_FLD_TRACE_NUMBER,                     NO  },
+    { @"Merchant id",                       ECR_FLD_MERCHANT_ID,                      NO  },
+    { @"Total Scheme Length",               ECR_FLD_TOTAL_SCHEME_LENGTH,              NO  },
+    { @"Schemes",                           ECR_FLD_SCHEMES,                          NO  },
+    { @"deadlineOutcome",                   ECR_FLD_DEADLINE_OUTCOME,                 NO  },
+    { @"resolvedBy",                        ECR_FLD_RESOLVED_BY,                      NO  },
+    { @"Check Status Response Code",        ECR_FLD_CHECK_STATUS_RESPONSE_CODE,       NO  },
+    { @"idempotencyReplay",                 ECR_FLD_IDEMPOTENCY_REPLAY,               NO  },
+    { @"ecrRefNum",                         ECR_FLD_REQUEST_REF_NUM,                  NO  },
+    { @"requestError",                      ECR_FLD_REQUEST_ERROR,                    NO  },
+};
+
+- (NSData *)compactRecordForResponse:(NSDictionary *)responseData {
+    
+    unsigned char recordBuffer[COMPACT_RECORD_BUFFER_SIZE];
+    ECR_RECORD record;
+    int flags = 0;
+    int transactionType = [[responseData valueForKey:@"Transaction type"] intValue];
+    
+    ecrRecordBegin(&record, recordBuffer, sizeof(recordBuffer), transactionType);
+    for (NSString *key in responseData) {
+        id value = responseData[key];
+        if ([key isEqualToString:@"receiptFormat"]) {
+            flags |= ECR_RECORD_FLAG_RECEIPT;
+            continue;
+        }
+        if (![value isKindOfClass:[NSString class]]) {
+            return nil;
+        }
+        const SKBRecordKey *entry = NULL;
+        for (size_t i = 0; i < sizeof(kRecordKeys) / sizeof(kRecordKeys[0]); i++) {
+            if ([kRecordKeys[i].key isEqualToString:key]) {
+                entry = &kRecordKeys[i];
+                break;
+            }
+        }
+        if (entry == NULL) {
+            return nil;
+        }
+        const char *utf8 = [value UTF8String];
+        int length = (int)strlen(utf8);
+        long long amount = 0;
+        if (entry->amount && ecrAmountToMinorUnits(utf8, length, &amount) == 0) {
+            ecrRecordPutAmount(&record, entry->fieldId, amount);
+        }
+        else {
+            ecrRecordPutString(&record, entry->fieldId, utf8, length);
+        }
+    }
+    int length = ecrRecordFinish(&record, flags);
+    if (length < 0) {
+        return nil;
+    }
+    return [NSData dataWithBytes:recordBuffer length:length];
+}
+
+//MARK: - Settlement Totals -
+
+// The columns have a queue of their own, so reading them never waits behind a receipt
+// being rendered on the decode queue
+- (NSUInteger)settlementTotalRows {
+    
+    __block NSUInteger rows = 0;
+    dispatch_sync(self.settlementQueue, ^{
+        rows = self->_settlementColumns.inRows;
+    });
+    return rows;
+}
+
+- (BOOL)exportSettlementTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format {
+    
+    return [self exportSettlementTotalsToPath:path format:format clear:NO] >= 0;
+}
+
+- (NSInteger)exportSettlementTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format clear:(BOOL)clear {
+    
+    __block NSInteger rows = -1;
+    dispatch_sync(self.settlementQueue, ^{
+        int result = -1;
+        if (format == SKBSettlementExportFormatColumnar) {
+            result = ecrSettlementWriteColumnar(&self->_settlementColumns, [path fileSystemRepresentation]);
+        }
+        else {
+            result = ecrSettlementWriteCsv(&self->_settlementColumns, [path fileSystemRepresentation]);
+        }
+        if (result == 0) {
+            rows = self->_settlementColumns.inRows;
+            if (clear) {
+                ecrSettlementFree(&self->_settlementColumns);
+            }
+        }
+    });
+    return rows;
+}
+
+- (void)clearSettlementTotals {
+    
+    dispatch_sync(self.settlementQueue, ^{
+        ecrSettlementFree(&self->_settlementColumns);
+    });
+}
+
+//MARK: - Wire Capture -
+
+// The capture is only touched on the socket thread, next to the reads and writes it records
+- (BOOL)startCaptureToPath:(NSString *)path {
+    
+    NSMutableDictionary *request = [NSMutableDictionary dictionaryWithObject:path forKey:@"path"];
+    [self performSelector:@selector(openCaptureOnSocketThread:) onThread:[SKBCoreServices socketThread] withObject:request waitUntilDone:YES];
+    return [request[@"opened"] boolValue];
+}
+
+- (void)stopCapture {
+    
+    [self performSelector:@selector(closeCaptureOnSocketThread) onThread:[SKBCoreServices socketThread] withObject:nil waitUntilDone:YES];
+}
+
+- (void)openCaptureOnSocketThread:(NSMutableDictionary *)request {
+    
+    ecrCaptureClose(&_capture);
+    BOOL opened = ecrCaptureOpen(&_capture, [request[@"path"] fileSystemRepresentation]) == 0;
+    request[@"opened"] = @(opened);
+}
+
+- (void)closeCaptureOnSocketThread {
+    
+    ecrCaptureClose(&_capture);
+}
+
+- (void)captureBytes:(const void *)bytes length:(NSUInteger)length direction:(int)direction {
+    
+    if (_capture.fp == NULL) {
+        return;
+    }
+    NSString *terminalId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+    if (ecrCaptureWrite(&_capture, direction, atomic_load(&_sentTransactionType), [terminalId UTF8String], bytes, (int)length, ecrCaptureNow()) != 0) {
+        NSLog(@"Wire capture stopped, write failed");
+        ecrCaptureClose(&_capture);
+    }
+}
+
 - (UIViewController *)currentTopViewController {
     UIViewController *topVC = [[[UIApplication sharedApplication] keyWindow] rootViewController];
     while (topVC.presentedViewController)
@@ -0,0 +1,61 @@
+//
+//  SKBHealthMonitor.h
+//  SkyBandECRSDK
+//
+//  Background Check Status (C3) probing of idle terminals.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SKBCoreServices;
+@protocol SKBHealthMonitorDelegate;
+
+typedef NS_ENUM(NSInteger, SKBTerminalReadiness) {
+    SKBTerminalReadinessUnknown = 0,
+    SKBTerminalReadinessReady,
+    SKBTerminalReadinessDegraded,
+    SKBTerminalReadinessUnreachable
+};
+
+@interface SKBTerminalHealth : NSObject
+
+@property (nonatomic, readonly) NSString *terminal;             // "ip:port"
+@property (nonatomic, readonly) SKBTerminalReadiness readiness;
+@property (nonatomic, readonly) NSTimeInterval lastLatency;
+@property (nonatomic, readonly) NSTimeInterval smoothedLatency;
+@property (nonatomic, readonly) NSUInteger consecutiveFailures;
+@property (nonatomic, readonly) NSDate *lastProbeDate;
+@property (nonatomic, readonly) NSTimeInterval nextProbeInterval;
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+@interface SKBHealthMonitor : NSObject
+
+//MARK: - Scheduling Properties -
+
+@property (nonatomic, assign) id<SKBHealthMonitorDelegate> delegate;
+@property (nonatomic) NSTimeInterval minProbeInterval;
+@property (nonatomic) NSTimeInterval maxProbeInterval;
+@property (nonatomic) NSTimeInterval probeTimeout;
+@property (nonatomic) NSTimeInterval degradedLatency;
+@property (nonatomic) NSUInteger unreachableFailures;
+
++ (SKBHealthMonitor *)shareInstance;
+
+//MARK: - Monitoring Methods -
+
+- (void)monitorConnection:(SKBCoreServices *)connection;
+- (void)stopMonitoringConnection:(SKBCoreServices *)connection;
+- (SKBTerminalHealth *)healthForConnection:(SKBCoreServices *)connection;
+- (NSArray<SKBTerminalHealth *> *)allTerminalHealth;
+
+@end
+
+@protocol SKBHealthMonitorDelegate <NSObject>
+
+@optional
+- (void)healthMonitor:(SKBHealthMonitor *)monitor didUpdateHealth:(SKBTerminalHealth *)health forConnection:(SKBCoreServices *)connection;
+
+@end
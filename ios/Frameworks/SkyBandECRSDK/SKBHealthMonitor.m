@@ -0,0 +1,204 @@
+//
+//  SKBHealthMonitor.m
+//  SkyBandECRSDK
+//
+//  Background Check Status (C3) probing of idle terminals.
+//
+
+#import "SKBHealthMonitor.h"
+#import "SKBCoreServices.h"
+
+static NSTimeInterval kMinProbeInterval = 5;
+static NSTimeInterval kMaxProbeInterval = 120;
+static NSTimeInterval kProbeTimeout = 10;
+static NSTimeInterval kDegradedLatency = 2;
+static NSUInteger kUnreachableFailures = 3;
+// Keep probing below ~10% of the lane's time even on a slow link
+static double kLatencyIntervalFactor = 10;
+static double kLatencySmoothing = 0.2;
+
+@interface SKBTerminalHealth ()
+
+@property (nonatomic, weak) SKBCoreServices *connection;
+@property (nonatomic, strong) NSTimer *timer;
+@property (nonatomic, strong) NSString *terminal;
+@property (nonatomic) SKBTerminalReadiness readiness;
+@property (nonatomic) NSTimeInterval lastLatency;
+@property (nonatomic) NSTimeInterval smoothedLatency;
+@property (nonatomic) NSUInteger consecutiveFailures;
+@property (nonatomic, strong) NSDate *lastProbeDate;
+@property (nonatomic) NSTimeInterval nextProbeInterval;
+
+@end
+
+@implementation SKBTerminalHealth
+
+- (NSDictionary *)dictionaryRepresentation {
+
+    NSArray *names = @[@"unknown", @"ready", @"degraded", @"unreachable"];
+    return @{
+        @"terminal": self.terminal ?: @"",
+        @"readiness": names[self.readiness],
+        @"latencyMs": @((NSInteger)(self.lastLatency * 1000)),
+        @"smoothedLatencyMs": @((NSInteger)(self.smoothedLatency * 1000)),
+        @"consecutiveFailures": @(self.consecutiveFailures),
+        @"nextProbeInterval": @(self.nextProbeInterval)
+    };
+}
+
+@end
+
+@interface SKBHealthMonitor ()
+
+@property (nonatomic, strong) NSMapTable<SKBCoreServices *, SKBTerminalHealth *> *healthByConnection;
+
+@end
+
+@implementation SKBHealthMonitor
+
+- (instancetype)init {
+
+    self = [super init];
+    if (self) {
+        self.minProbeInterval = kMinProbeInterval;
+        self.maxProbeInterval = kMaxProbeInterval;
+        self.probeTimeout = kProbeTimeout;
+        self.degradedLatency = kDegradedLatency;
+        self.unreachableFailures = kUnreachableFailures;
+        _healthByConnection = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    return self;
+}
+
++ (SKBHealthMonitor *)shareInstance {
+
+    static dispatch_once_t once;
+    static id healthMonitor;
+    dispatch_once(&once, ^{
+        healthMonitor = [[SKBHealthMonitor alloc]init];
+    });
+    return healthMonitor;
+}
+
+//MARK: - Monitoring -
+
+- (void)monitorConnection:(SKBCoreServices *)connection {
+
+    SKBTerminalHealth *health = [self.healthByConnection objectForKey:connection];
+    if (health == nil) {
+        health = [[SKBTerminalHealth alloc]init];
+        health.connection = connection;
+        [self.healthByConnection setObject:health forKey:connection];
+    }
+    health.terminal = [NSString stringWithFormat:@"%@:%@", connection.ipAdress, @(connection.portNumber)];
+    health.nextProbeInterval = self.minProbeInterval;
+    [self scheduleProbe:health after:health.nextProbeInterval];
+}
+
+- (void)stopMonitoringConnection:(SKBCoreServices *)connection {
+
+    SKBTerminalHealth *health = [self.healthByConnection objectForKey:connection];
+    [health.timer invalidate];
+    health.timer = nil;
+    [self.healthByConnection removeObjectForKey:connection];
+}
+
+- (SKBTerminalHealth *)healthForConnection:(SKBCoreServices *)connection {
+
+    return [self.healthByConnection objectForKey:connection];
+}
+
+- (NSArray<SKBTerminalHealth *> *)allTerminalHealth {
+
+    return [[self.healthByConnection objectEnumerator] allObjects];
+}
+
+//MARK: - Probe Scheduling -
+
+- (void)scheduleProbe:(SKBTerminalHealth *)health after:(NSTimeInterval)interval {
+
+    [health.timer invalidate];
+    health.timer = [NSTimer scheduledTimerWithTimeInterval:interval target:self selector:@selector(probeTimerFired:) userInfo:health repeats:NO];
+}
+
+- (void)probeTimerFired:(NSTimer *)timer {
+
+    SKBTerminalHealth *health = timer.userInfo;
+    SKBCoreServices *connection = health.connection;
+    health.timer = nil;
+
+    if (connection == nil) {
+        return;
+    }
+    if (!connection.connected) {
+        [self recordProbe:health success:NO latency:0];
+        return;
+    }
+    // Real traffic keeps priority; look again shortly
+    if (connection.transactionInFlight || connection.probeInFlight) {
+        [self scheduleProbe:health after:self.minProbeInterval];
+        return;
+    }
+    // A recent reply already proves the lane is alive
+    if (connection.lastResponseDate != nil && -[connection.lastResponseDate timeIntervalSinceNow] < health.nextProbeInterval) {
+        if (health.readiness == SKBTerminalReadinessUnknown || health.readiness == SKBTerminalReadinessUnreachable) {
+            health.readiness = SKBTerminalReadinessReady;
+            health.consecutiveFailures = 0;
+            [self notifyDelegate:health];
+        }
+        [self scheduleProbe:health after:health.nextProbeInterval];
+        return;
+    }
+
+    __weak SKBHealthMonitor *weakSelf = self;
+    BOOL sent = [connection sendCheckStatusProbe:self.probeTimeout completion:^(BOOL success, NSTimeInterval latency) {
+        [weakSelf recordProbe:health success:success latency:latency];
+    }];
+    if (!sent) {
+        [self scheduleProbe:health after:self.minProbeInterval];
+    }
+}
+
+- (void)recordProbe:(SKBTerminalHealth *)health success:(BOOL)success latency:(NSTimeInterval)latency {
+
+    health.lastProbeDate = [NSDate date];
+
+    if (success) {
+        health.lastLatency = latency;
+        health.smoothedLatency = (health.smoothedLatency == 0) ? latency
+            : (1 - kLatencySmoothing) * health.smoothedLatency + kLatencySmoothing * latency;
+        health.consecutiveFailures = 0;
+        if (health.smoothedLatency > self.degradedLatency) {
+            health.readiness = SKBTerminalReadinessDegraded;
+            health.nextProbeInterval = self.minProbeInterval;
+        }
+        else {
+            // Stable lanes are probed less and less often
+            health.readiness = SKBTerminalReadinessReady;
+            health.nextProbeInterval = MIN(self.maxProbeInterval, health.nextProbeInterval * 2);
+        }
+    }
+    else {
+        health.consecutiveFailures++;
+        health.readiness = (health.consecutiveFailures >= self.unreachableFailures) ? SKBTerminalReadinessUnreachable : SKBTerminalReadinessDegraded;
+        health.nextProbeInterval = self.minProbeInterval;
+    }
+    health.nextProbeInterval = MAX(health.nextProbeInterval, health.smoothedLatency * kLatencyIntervalFactor);
+
+    [self notifyDelegate:health];
+    if (health.connection != nil) {
+        [self scheduleProbe:health after:health.nextProbeInterval];
+    }
+}
+
+- (void)notifyDelegate:(SKBTerminalHealth *)health {
+
+    SKBCoreServices *connection = health.connection;
+    if (connection != nil && [self.delegate respondsToSelector:@selector(healthMonitor:didUpdateHealth:forConnection:)]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self.delegate healthMonitor:self didUpdateHealth:health forConnection:connection];
+        });
+    }
+}
+
+@end
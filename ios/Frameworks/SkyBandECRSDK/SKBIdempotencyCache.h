@@ -0,0 +1,44 @@
+//
+//  SKBIdempotencyCache.h
+//  SkyBandECRSDK
+//
+//  Card transaction replies by terminal and ECR reference number, so a resent
+//  transaction is answered locally instead of reaching the terminal again.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, SKBIdempotencyState) {
+    SKBIdempotencyStateNew = 0,         // Not seen: send it, it is pending now
+    SKBIdempotencyStatePending,         // Same reference in flight: joined, its reply is shared
+    SKBIdempotencyStateCompleted,       // Reply known: response holds a copy
+    SKBIdempotencyStateMismatch         // Reference already used for a different request: reject it
+};
+
+// Main thread only
+@interface SKBIdempotencyCache : NSObject
+
+//MARK: - Cache Properties -
+
+@property (nonatomic) NSUInteger capacity;          // Completed replies kept, oldest dropped first
+@property (nonatomic) NSTimeInterval lifetime;      // Completed replies older than this are forgotten
+@property (nonatomic, readonly) NSString *path;
+@property (nonatomic, readonly) NSUInteger count;
+
+// Persisted in Application Support, excluded from backups
++ (SKBIdempotencyCache *)shareInstance;
+// Completed replies are saved to path after each change and loaded back here; nil keeps them in memory only.
+// Only the outcome fields are saved, so after a restart a replay carries no receipt or card data.
+- (instancetype)initWithPath:(NSString *)path;
+
+//MARK: - Transaction Methods -
+
+// digest identifies the request itself; a reference is only answered for the same digest
+- (SKBIdempotencyState)beginTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal digest:(NSString *)digest response:(NSMutableDictionary **)response;
+// Both return the number of submissions that joined the pending one
+- (NSUInteger)completeTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal response:(NSDictionary *)response;
+// The outcome is unknown or nothing was done, so the next submission is sent
+- (NSUInteger)abandonTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal;
+- (void)removeAllResponses;
+
+@end
@@ -0,0 +1,231 @@
+//
+//  SKBIdempotencyCache.m
+//  SkyBandECRSDK
+//
+//  Card transaction replies by terminal and ECR reference number, so a resent
+//  transaction is answered locally instead of reaching the terminal again.
+//
+
+#import "SKBIdempotencyCache.h"
+
+static NSUInteger kCapacity = 128;
+static NSTimeInterval kLifetime = 24 * 60 * 60;
+
+// What a replay needs to tell the outcome; receipts and card data stay in memory
+static NSString * const kPersistedKeys[] = {
+    @"Transaction type", @"Response Code", @"Response Message", @"responseMessage",
+    @"Transaction Amount", @"Cash Back Amount", @"Total Amount", @"Stan No", @"Date & Time ",
+    @"RRN", @"Auth Code", @"TID", @"MID", @"Batch No", @"ECR Transaction Reference Number",
+    @"deadlineOutcome", @"resolvedBy"
+};
+
+@interface SKBIdempotencyEntry : NSObject
+
+@property (nonatomic, strong) NSString *key;
+@property (nonatomic, strong) NSString *digest;
+@property (nonatomic, strong) NSDictionary *response;
+@property (nonatomic, strong) NSDate *date;
+@property (nonatomic) NSUInteger waiters;
+
+@end
+
+@implementation SKBIdempotencyEntry
+@end
+
+@interface SKBIdempotencyCache ()
+
+@property (nonatomic, strong) NSString *path;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SKBIdempotencyEntry *> *entries;
+// Keys of completed entries, oldest first
+@property (nonatomic, strong) NSMutableArray<NSString *> *completedKeys;
+@property (nonatomic, strong) dispatch_queue_t saveQueue;
+
+@end
+
+@implementation SKBIdempotencyCache
+
+- (instancetype)initWithPath:(NSString *)path {
+
+    self = [super init];
+    if (self) {
+        _capacity = kCapacity;
+        _lifetime = kLifetime;
+        _path = [path copy];
+        _entries = [[NSMutableDictionary alloc]init];
+        _completedKeys = [[NSMutableArray alloc]init];
+        _saveQueue = dispatch_queue_create("com.skyband.ecr.idempotency", DISPATCH_QUEUE_SERIAL);
+        [self load];
+    }
+    return self;
+}
+
+- (instancetype)init {
+
+    return [self initWithPath:nil];
+}
+
++ (SKBIdempotencyCache *)shareInstance {
+
+    static dispatch_once_t once;
+    static id idempotencyCache;
+    dispatch_once(&once, ^{
+        NSURL *directory = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] firstObject];
+        [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        NSString *path = [[directory URLByAppendingPathComponent:@"SKBIdempotencyCache.plist"] path];
+        idempotencyCache = [[SKBIdempotencyCache alloc]initWithPath:path];
+    });
+    return idempotencyCache;
+}
+
+- (NSUInteger)count {
+
+    return self.completedKeys.count;
+}
+
+- (NSString *)keyForTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal {
+
+    return [NSString stringWithFormat:@"%@|%@", terminal, ecrRefNum];
+}
+
+//MARK: - Transactions -
+
+- (SKBIdempotencyState)beginTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal digest:(NSString *)digest response:(NSMutableDictionary **)response {
+
+    NSString *key = [self keyForTransaction:ecrRefNum terminal:terminal];
+    SKBIdempotencyEntry *entry = self.entries[key];
+
+    if (entry.response != nil && -[entry.date timeIntervalSinceNow] > self.lifetime) {
+        [self.entries removeObjectForKey:key];
+        [self.completedKeys removeObject:key];
+        entry = nil;
+    }
+    if (entry == nil) {
+        entry = [[SKBIdempotencyEntry alloc]init];
+        entry.key = key;
+        entry.digest = digest;
+        self.entries[key] = entry;
+        return SKBIdempotencyStateNew;
+    }
+    // A refund or another amount under a used reference is never answered with the old reply
+    if (![entry.digest isEqualToString:digest]) {
+        return SKBIdempotencyStateMismatch;
+    }
+    if (entry.response == nil) {
+        entry.waiters++;
+        return SKBIdempotencyStatePending;
+    }
+    if (response) {
+        *response = [entry.response mutableCopy];
+    }
+    return SKBIdempotencyStateCompleted;
+}
+
+- (NSUInteger)completeTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal response:(NSDictionary *)response {
+
+    NSString *key = [self keyForTransaction:ecrRefNum terminal:terminal];
+    SKBIdempotencyEntry *entry = self.entries[key];
+    if (entry == nil || entry.response != nil) {
+        return 0;
+    }
+    NSUInteger waiters = entry.waiters;
+    entry.waiters = 0;
+    entry.response = [response copy];
+    entry.date = [NSDate date];
+    [self.completedKeys addObject:key];
+
+    while (self.completedKeys.count > self.capacity) {
+        [self.entries removeObjectForKey:self.completedKeys.firstObject];
+        [self.completedKeys removeObjectAtIndex:0];
+    }
+    [self save];
+    return waiters;
+}
+
+- (NSUInteger)abandonTransaction:(NSString *)ecrRefNum terminal:(NSString *)terminal {
+
+    NSString *key = [self keyForTransaction:ecrRefNum terminal:terminal];
+    SKBIdempotencyEntry *entry = self.entries[key];
+    if (entry == nil || entry.response != nil) {
+        return 0;
+    }
+    [self.entries removeObjectForKey:key];
+    return entry.waiters;
+}
+
+- (void)removeAllResponses {
+
+    for (NSString *key in self.completedKeys) {
+        [self.entries removeObjectForKey:key];
+    }
+    [self.completedKeys removeAllObjects];
+    [self save];
+}
+
+//MARK: - Persistence -
+
+// Pending transactions are not saved: after a restart their outcome is unknown
+- (void)save {
+
+    if (self.path == nil) {
+        return;
+    }
+    NSMutableArray *records = [[NSMutableArray alloc]init];
+    for (NSString *key in self.completedKeys) {
+        SKBIdempotencyEntry *entry = self.entries[key];
+        NSMutableDictionary *fields = [[NSMutableDictionary alloc]init];
+        for (size_t i = 0; i < sizeof(kPersistedKeys) / sizeof(kPersistedKeys[0]); i++) {
+            if ([entry.response[kPersistedKeys[i]] isKindOfClass:[NSString class]]) {
+                fields[kPersistedKeys[i]] = entry.response[kPersistedKeys[i]];
+            }
+        }
+        [records addObject:@{ @"key": key, @"digest": entry.digest, @"date": entry.date, @"response": fields }];
+    }
+    NSString *path = self.path;
+    dispatch_async(self.saveQueue, ^{
+        NSData *data = [NSPropertyListSerialization dataWithPropertyList:records format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+        if ([data writeToFile:path options:NSDataWritingAtomic | NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication error:nil]) {
+            // The atomic write replaces the file, so the flag is set again each time
+            [[NSURL fileURLWithPath:path] setResourceValue:@YES forKey:NSURLIsExcludedFromBackupKey error:nil];
+        }
+    });
+}
+
+- (void)load {
+
+    if (self.path == nil) {
+        return;
+    }
+    NSData *data = [NSData dataWithContentsOfFile:self.path];
+    if (data == nil) {
+        return;
+    }
+    NSArray *records = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil];
+    if (![records isKindOfClass:[NSArray class]]) {
+        return;
+    }
+    for (NSDictionary *record in records) {
+        if (![record isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        NSString *key = record[@"key"];
+        NSString *digest = record[@"digest"];
+        NSDate *date = record[@"date"];
+        NSDictionary *response = record[@"response"];
+        if (![key isKindOfClass:[NSString class]] || ![digest isKindOfClass:[NSString class]] ||
+            ![date isKindOfClass:[NSDate class]] || ![response isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        if (-[date timeIntervalSinceNow] > self.lifetime || self.entries[key] != nil) {
+            continue;
+        }
+        SKBIdempotencyEntry *entry = [[SKBIdempotencyEntry alloc]init];
+        entry.key = key;
+        entry.digest = digest;
+        entry.response = response;
+        entry.date = date;
+        self.entries[key] = entry;
+        [self.completedKeys addObject:key];
+    }
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  SKBSession.h
+//  SkyBandECRSDK
+//
+//  Start Session (B6) / End Session (B7) scoped transaction batching.
+//
+
+#import <Foundation/Foundation.h>
+#import "SKBCoreServices.h"
+
+@interface SKBSession : NSObject <SocketConnectionDelegate>
+
+//MARK: - Session Properties -
+
+// Receives every connection callback, including the B6/B7 replies. Starts out as the
+// delegate the connection had.
+@property (nonatomic, assign) id<SocketConnectionDelegate> delegate;
+@property (nonatomic, readonly) SKBCoreServices *connection;
+@property (nonatomic, readonly) NSString *cashRegisterNumber;
+@property (nonatomic, readonly, getter=isOpen) BOOL open;
+@property (nonatomic, readonly) NSUInteger pendingTransactions;
+@property (nonatomic) NSTimeInterval idleTimeout;
+
+// Takes over the connection delegate, forwarding to delegate, and keeps the connection
+// reconnecting until invalidate.
+- (instancetype)initWithConnection:(SKBCoreServices *)connection cashRegisterNumber:(NSString *)cashRegisterNumber;
+
+//MARK: - Session Transactions -
+
+// Queues a transaction. Date/time stamp, trailing ECR reference number and
+// signature are filled in by the session; fields holds everything in between.
+// B6 is sent before the first transaction and transactions go out one at a time.
+// If the terminal refuses B6 (any response code but zeros) or does not answer, every
+// queued transaction gets a "responseMessage" error with "requestError":
+// "sessionRefused" and its "ecrRefNum", and nothing of them is sent.
+- (void)submitTransaction:(int)transactionType fields:(NSArray<NSString *> *)fields ecrRefNum:(NSString *)ecrRefNum;
+- (void)submitTransaction:(int)transactionType fields:(NSArray<NSString *> *)fields ecrRefNum:(NSString *)ecrRefNum receiptFormat:(SKBReceiptFormat)receiptFormat;
+- (void)purchase:(long long)amount printReceipt:(BOOL)printReceipt ecrRefNum:(NSString *)ecrRefNum;
+
+// Sends B7 once the queue drains. Also triggered after idleTimeout without traffic.
+- (void)close;
+
+// Fails what is still queued as above and gives the connection delegate back, without
+// sending B7. Releasing the session gives the delegate back too.
+- (void)invalidate;
+
+@end
@@ -0,0 +1,287 @@
+//
+//  SKBSession.m
+//  SkyBandECRSDK
+//
+//  Start Session (B6) / End Session (B7) scoped transaction batching.
+//
+
+#import "SKBSession.h"
+
+static NSTimeInterval kSessionIdleTimeout = 300;
+#define SESSION_SIGNATURE "00000000000000000000000"
+#define CASH_REGISTER_NUMBER_SIZE 8
+
+typedef NS_ENUM(NSInteger, SKBSessionState) {
+    SKBSessionStateClosed = 0,
+    SKBSessionStateOpening,
+    SKBSessionStateOpen,
+    SKBSessionStateClosing
+};
+
+@interface SKBSession ()
+
+@property (nonatomic, strong) SKBCoreServices *connection;
+@property (nonatomic, strong) NSString *cashRegisterNumber;
+@property (nonatomic) SKBSessionState state;
+@property (nonatomic) BOOL busy;
+@property (nonatomic) BOOL closeRequested;
+@property (nonatomic) BOOL reconnecting;
+@property (nonatomic, strong) NSString *sentRefNum;
+@property (nonatomic, strong) NSMutableArray<NSDictionary *> *queue;
+@property (strong, nonatomic) NSTimer *idleTimer;
+
+@end
+
+@implementation SKBSession
+
+- (instancetype)initWithConnection:(SKBCoreServices *)connection cashRegisterNumber:(NSString *)cashRegisterNumber {
+
+    self = [super init];
+    if (self) {
+        _connection = connection;
+        _queue = [[NSMutableArray alloc]init];
+        _idleTimeout = kSessionIdleTimeout;
+
+        // Cash register number is a fixed 8 character field
+        NSString *padded = [NSString stringWithFormat:@"%@%@", [@"" stringByPaddingToLength:CASH_REGISTER_NUMBER_SIZE withString:@"0" startingAtIndex:0], cashRegisterNumber];
+        _cashRegisterNumber = [padded substringFromIndex:padded.length - CASH_REGISTER_NUMBER_SIZE];
+
+        _delegate = connection.delegate;
+        connection.delegate = self;
+        connection.shouldReconnectAutomatically = YES;
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    if (_connection.delegate == self) {
+        _connection.delegate = _delegate;
+    }
+}
+
+- (BOOL)isOpen {
+
+    return self.state == SKBSessionStateOpen;
+}
+
+- (NSUInteger)pendingTransactions {
+
+    return self.queue.count;
+}
+
+//MARK: - Session Transactions -
+
+- (void)submitTransaction:(int)transactionType fields:(NSArray<NSString *> *)fields ecrRefNum:(NSString *)ecrRefNum {
+
+    [self submitTransaction:transactionType fields:fields ecrRefNum:ecrRefNum receiptFormat:SKBReceiptFormatHTML];
+}
+
+- (void)submitTransaction:(int)transactionType fields:(NSArray<NSString *> *)fields ecrRefNum:(NSString *)ecrRefNum receiptFormat:(SKBReceiptFormat)receiptFormat {
+
+    NSMutableArray *requestFields = [[NSMutableArray alloc]initWithObjects:[self.connection currentDateTimeStamp], nil];
+    [requestFields addObjectsFromArray:fields];
+    [requestFields addObject:ecrRefNum];
+    NSString *requestData = [NSString stringWithFormat:@"%@!", [requestFields componentsJoinedByString:@";"]];
+
+    [self.queue addObject:@{
+        @"transactionType": @(transactionType),
+        @"requestData": requestData,
+        @"ecrRefNum": ecrRefNum,
+        @"signature": [self.connection requestSignature:ecrRefNum],
+        @"receiptFormat": @(receiptFormat)
+    }];
+    self.closeRequested = NO;
+    [self pump];
+}
+
+- (void)purchase:(long long)amount printReceipt:(BOOL)printReceipt ecrRefNum:(NSString *)ecrRefNum {
+
+    [self submitTransaction:0 fields:@[[NSString stringWithFormat:@"%lld", amount], printReceipt ? @"1" : @"0"] ecrRefNum:ecrRefNum];
+}
+
+- (void)close {
+
+    self.closeRequested = YES;
+    [self pump];
+}
+
+- (void)invalidate {
+
+    [self stopIdleTimer];
+    [self failQueuedTransactions:@"Session invalidated"];
+    self.state = SKBSessionStateClosed;
+    self.busy = NO;
+    self.sentRefNum = nil;
+    if (self.connection.delegate == self) {
+        self.connection.delegate = self.delegate;
+    }
+}
+
+//MARK: - Session State -
+
+- (void)pump {
+
+    // Transactions sent outside the session pump it again when answered
+    if (self.busy || self.connection.transactionInFlight) {
+        return;
+    }
+    if (!self.connection.connected) {
+        // Picked up again from socketConnectionStreamDidConnect:
+        if (self.queue.count > 0 && !self.reconnecting) {
+            self.reconnecting = YES;
+            [self.connection connectSocket:self.connection.ipAdress portNumber:self.connection.portNumber];
+        }
+        return;
+    }
+
+    if (self.queue.count > 0) {
+        if (self.state != SKBSessionStateOpen) {
+            [self sendSessionCommand:18]; // Start Session
+            self.state = SKBSessionStateOpening;
+            return;
+        }
+        NSDictionary *transaction = self.queue.firstObject;
+        [self.queue removeObjectAtIndex:0];
+        [self stopIdleTimer];
+        self.busy = YES;
+        self.sentRefNum = transaction[@"ecrRefNum"];
+        [self.connection doTCPIPTransaction:self.connection.ipAdress portNumber:self.connection.portNumber requestData:transaction[@"requestData"] transactionType:[transaction[@"transactionType"] intValue] signature:transaction[@"signature"] receiptFormat:[transaction[@"receiptFormat"] integerValue]];
+        return;
+    }
+
+    if (self.state == SKBSessionStateOpen) {
+        if (self.closeRequested) {
+            [self stopIdleTimer];
+            [self sendSessionCommand:19]; // End Session
+            self.state = SKBSessionStateClosing;
+        }
+        else {
+            [self startIdleTimer];
+        }
+    }
+}
+
+- (void)sendSessionCommand:(int)transactionType {
+
+    self.busy = YES;
+    self.sentRefNum = self.cashRegisterNumber;
+    NSString *requestData = [NSString stringWithFormat:@"%@;%@!", [self.connection currentDateTimeStamp], self.cashRegisterNumber];
+    [self.connection doTCPIPTransaction:self.connection.ipAdress portNumber:self.connection.portNumber requestData:requestData transactionType:transactionType signature:@SESSION_SIGNATURE];
+}
+
+- (void)startIdleTimer {
+
+    [self.idleTimer invalidate];
+    self.idleTimer = [NSTimer scheduledTimerWithTimeInterval:self.idleTimeout target:self selector:@selector(idleTimeoutFired:) userInfo:nil repeats:NO];
+}
+
+- (void)stopIdleTimer {
+
+    [self.idleTimer invalidate];
+    self.idleTimer = nil;
+}
+
+-(void)idleTimeoutFired:(NSTimer *)timer {
+
+    self.idleTimer = nil;
+    [self close];
+}
+
+// Answers every queued transaction with an error instead of sending it
+- (void)failQueuedTransactions:(NSString *)message {
+
+    NSArray<NSDictionary *> *transactions = [self.queue copy];
+    [self.queue removeAllObjects];
+    for (NSDictionary *transaction in transactions) {
+        NSMutableDictionary *responseData = [[NSMutableDictionary alloc]init];
+        [responseData setValue:[NSString stringWithFormat:@"%@", transaction[@"transactionType"]] forKey:@"Transaction type"];
+        [responseData setValue:message forKey:@"responseMessage"];
+        [responseData setValue:@"sessionRefused" forKey:@"requestError"];
+        [responseData setValue:transaction[@"ecrRefNum"] forKey:@"ecrRefNum"];
+        if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+            [self.delegate socketConnectionStream:self.connection didReceiveData:responseData];
+        }
+    }
+}
+
+// The terminal answers admin commands with 00, card transactions with 000
+- (BOOL)isSuccessCode:(NSString *)responseCode {
+
+    NSCharacterSet *nonZeros = [[NSCharacterSet characterSetWithCharactersInString:@"0"] invertedSet];
+    return responseCode.length > 0 && [responseCode rangeOfCharacterFromSet:nonZeros].location == NSNotFound;
+}
+
+//MARK: - SocketConnectionDelegate Methods -
+
+- (void)socketConnectionStream:(SKBCoreServices *)connection didReceiveData:(NSMutableDictionary *)responseData {
+
+    NSString *transactionType = [responseData valueForKey:@"Transaction type"];
+    // Replies to transactions sent outside the session leave it as it is
+    BOOL sessionReply = self.busy && [[responseData valueForKey:@"ecrRefNum"] isEqual:self.sentRefNum];
+    BOOL refused = NO;
+    if (sessionReply) {
+        self.busy = NO;
+        self.sentRefNum = nil;
+        if (self.state == SKBSessionStateOpening) {
+            if ([transactionType isEqual:@"18"] && [self isSuccessCode:[responseData valueForKey:@"Response Code"]]) {
+                self.state = SKBSessionStateOpen;
+            }
+            else {
+                // B6 refused or timed out: nothing waiting on it is sent
+                self.state = SKBSessionStateClosed;
+                refused = YES;
+            }
+        }
+        else if (self.state == SKBSessionStateClosing) {
+            self.state = SKBSessionStateClosed;
+            self.closeRequested = NO;
+        }
+    }
+
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didReceiveData:)]) {
+        [self.delegate socketConnectionStream:self.connection didReceiveData:responseData];
+    }
+    if (refused) {
+        [self failQueuedTransactions:@"Session not started"];
+    }
+    [self pump];
+}
+
+- (void)socketConnectionStreamDidConnect:(SKBCoreServices *)connection {
+
+    self.reconnecting = NO;
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStreamDidConnect:)]) {
+        [self.delegate socketConnectionStreamDidConnect:connection];
+    }
+    [self pump];
+}
+
+- (void)socketConnectionStreamDidDisconnect:(SKBCoreServices *)connection willReconnectAutomatically:(BOOL)willReconnectAutomatically {
+
+    // The terminal forgets the session with the socket
+    self.state = SKBSessionStateClosed;
+    self.busy = NO;
+    self.sentRefNum = nil;
+    [self stopIdleTimer];
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStreamDidDisconnect:willReconnectAutomatically:)]) {
+        [self.delegate socketConnectionStreamDidDisconnect:connection willReconnectAutomatically:willReconnectAutomatically];
+    }
+}
+
+- (void)socketConnectionStream:(SKBCoreServices *)connection didSendString:(NSString *)string {
+
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStream:didSendString:)]) {
+        [self.delegate socketConnectionStream:connection didSendString:string];
+    }
+}
+
+- (void)socketConnectionStreamDidFailToConnect:(SKBCoreServices *)connection {
+
+    self.reconnecting = NO;
+    if ([self.delegate respondsToSelector:@selector(socketConnectionStreamDidFailToConnect:)]) {
+        [self.delegate socketConnectionStreamDidFailToConnect:connection];
+    }
+}
+
+@end
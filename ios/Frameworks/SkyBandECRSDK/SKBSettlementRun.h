@@ -0,0 +1,83 @@
+//
+//  SKBSettlementRun.h
+//  SkyBandECRSDK
+//
+//  Reconciliation (B1) of a fleet of terminals in parallel, with the scheme
+//  totals of every terminal merged into one set of columns.
+//
+
+#import <Foundation/Foundation.h>
+#import "SKBCoreServices.h"
+
+@protocol SKBSettlementRunDelegate;
+
+@interface SKBSettlementResult : NSObject
+
+@property (nonatomic, readonly) NSString *terminal;             // "ip:port"
+@property (nonatomic, readonly) BOOL succeeded;
+@property (nonatomic, readonly) NSUInteger attempts;
+@property (nonatomic, readonly) NSString *responseCode;         // nil without a reply
+@property (nonatomic, readonly) NSString *error;                // nil if succeeded
+// B1 was sent but no reply came: the batch may or may not be closed. Never resent;
+// check the terminal before settling it again.
+@property (nonatomic, readonly) BOOL unresolved;
+@property (nonatomic, readonly) NSUInteger rows;                // Scheme total rows merged
+@property (nonatomic, readonly) NSTimeInterval duration;        // First connect to result, retries included
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+@interface SKBSettlementRun : NSObject
+
+//MARK: - Run Properties -
+
+@property (nonatomic, assign) id<SKBSettlementRunDelegate> delegate;
+@property (nonatomic) NSUInteger maxConcurrentTerminals;
+@property (nonatomic) NSUInteger maxAttempts;
+@property (nonatomic) NSTimeInterval retryInterval;
+@property (nonatomic) BOOL printReceipts;
+// Terminal serial numbers by "ip:port", for request signatures and the terminal id
+// column; terminals left out are signed with the terminalSerialNumber user default
+@property (nonatomic, copy) NSDictionary<NSString *, NSString *> *terminalIds;
+
+@property (nonatomic, readonly) NSArray<NSString *> *terminals;
+@property (nonatomic, readonly) NSString *ecrRefNum;
+@property (nonatomic, readonly) BOOL running;
+@property (nonatomic, readonly) NSUInteger completedCount;
+@property (nonatomic, readonly) NSArray<SKBSettlementResult *> *results;        // In completion order
+@property (nonatomic, readonly) NSArray<SKBSettlementResult *> *failedResults;
+
+- (instancetype)initWithTerminals:(NSArray<NSString *> *)terminals ecrRefNum:(NSString *)ecrRefNum;
+
+//MARK: - Run Methods -
+
+// Settles up to maxConcurrentTerminals terminals at a time, each over its own
+// connection. Only failures before B1 is written (connect failure, not connected) are
+// retried, up to maxAttempts per terminal. B1 closes the batch, so a timeout or lost
+// connection after it was sent leaves the terminal unresolved instead. A terminal
+// error reply is final. completion runs on the main thread once every terminal has a
+// result. An ecrRefNum pack() cannot carry (empty, over 14 bytes, or holding ';' or
+// '!') fails every terminal with "Invalid ECR reference number" before any connect.
+- (void)startWithCompletion:(void (^)(NSArray<SKBSettlementResult *> *results))completion;
+// Terminals still waiting or in flight fail with "Cancelled"
+- (void)cancel;
+
+//MARK: - Merged Totals -
+
+// One dictionary per scheme, source and kind summed over all settled terminals:
+// "scheme", "source", "kind", "count" and "amount" (minor units)
+- (NSArray<NSDictionary *> *)aggregateTotals;
+@property (nonatomic, readonly) NSUInteger totalRows;
+// Writes every terminal's rows, or with aggregate one "ALL" settlement of summed rows
+- (BOOL)exportTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format aggregate:(BOOL)aggregate;
+
+@end
+
+@protocol SKBSettlementRunDelegate <NSObject>
+
+@optional
+- (void)settlementRun:(SKBSettlementRun *)run didStartTerminal:(NSString *)terminal attempt:(NSUInteger)attempt;
+- (void)settlementRun:(SKBSettlementRun *)run didFinishTerminal:(SKBSettlementResult *)result;
+
+@end
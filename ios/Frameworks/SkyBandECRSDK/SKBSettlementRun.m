@@ -0,0 +1,476 @@
+//
+//  SKBSettlementRun.m
+//  SkyBandECRSDK
+//
+//  Reconciliation (B1) of a fleet of terminals in parallel, with the scheme
+//  totals of every terminal merged into one set of columns.
+//
+
+#import "SKBSettlementRun.h"
+#include "ECRSrc.h"
+#include "ECRSettlement.h"
+#include "ECRSha256.h"
+
+static NSUInteger kMaxConcurrentTerminals = 16;
+static NSUInteger kMaxAttempts = 3;
+static NSTimeInterval kRetryInterval = 5;
+
+@interface SKBSettlementResult ()
+
+@property (nonatomic, strong) NSString *terminal;
+@property (nonatomic) BOOL succeeded;
+@property (nonatomic) NSUInteger attempts;
+@property (nonatomic, strong) NSString *responseCode;
+@property (nonatomic, strong) NSString *error;
+@property (nonatomic) NSUInteger rows;
+@property (nonatomic) NSTimeInterval duration;
+@property (nonatomic) BOOL unresolved;
+
+@end
+
+@implementation SKBSettlementResult
+
+- (NSDictionary *)dictionaryRepresentation {
+
+    return @{
+        @"terminal": self.terminal ?: @"",
+        @"succeeded": @(self.succeeded),
+        @"attempts": @(self.attempts),
+        @"responseCode": self.responseCode ?: @"",
+        @"error": self.error ?: @"",
+        @"rows": @(self.rows),
+        @"unresolved": @(self.unresolved),
+        @"durationMs": @((NSInteger)(self.duration * 1000))
+    };
+}
+
+@end
+
+// One terminal of the run; touched on the main thread only
+@interface SKBSettlementTask : NSObject
+
+@property (nonatomic, strong) NSString *terminal;
+@property (nonatomic, strong) NSString *host;
+@property (nonatomic) NSUInteger port;
+@property (nonatomic, strong) NSString *terminalId;
+@property (nonatomic, strong) NSString *signature;
+@property (nonatomic, strong) SKBCoreServices *connection;
+@property (nonatomic) NSUInteger attempts;
+@property (nonatomic, strong) NSDate *startDate;
+@property (nonatomic) BOOL requestSent;                 // B1 of the current attempt handed to the socket
+@property (nonatomic) BOOL finished;
+
+@end
+
+@implementation SKBSettlementTask
+@end
+
+@interface SKBSettlementRun () <SocketConnectionDelegate> {
+    // Merged scheme totals, only touched on mergeQueue
+    ECR_SETTLEMENT_COLUMNS _columns;
+}
+
+@property (nonatomic, strong) NSArray<NSString *> *terminals;
+@property (nonatomic, strong) NSString *ecrRefNum;
+@property (nonatomic) BOOL running;
+@property (nonatomic) BOOL cancelled;
+@property (nonatomic) NSUInteger completedCount;
+@property (nonatomic, strong) NSMutableArray<SKBSettlementResult *> *finishedResults;
+@property (nonatomic, strong) NSMutableArray<SKBSettlementTask *> *queuedTasks;
+@property (nonatomic, strong) NSMutableArray<SKBSettlementTask *> *activeTasks;
+@property (nonatomic, strong) NSMutableArray<SKBSettlementTask *> *retryingTasks;
+@property (nonatomic, copy) void (^completion)(NSArray<SKBSettlementResult *> *results);
+@property (nonatomic, strong) dispatch_queue_t mergeQueue;
+
+@end
+
+@implementation SKBSettlementRun
+
+- (instancetype)initWithTerminals:(NSArray<NSString *> *)terminals ecrRefNum:(NSString *)ecrRefNum {
+
+    self = [super init];
+    if (self) {
+        self.maxConcurrentTerminals = kMaxConcurrentTerminals;
+        self.maxAttempts = kMaxAttempts;
+        self.retryInterval = kRetryInterval;
+        _terminals = [terminals copy];
+        _ecrRefNum = [ecrRefNum copy];
+        _finishedResults = [[NSMutableArray alloc]init];
+        _queuedTasks = [[NSMutableArray alloc]init];
+        _activeTasks = [[NSMutableArray alloc]init];
+        _retryingTasks = [[NSMutableArray alloc]init];
+        _mergeQueue = dispatch_queue_create("com.skyband.ecr.settlement.merge", DISPATCH_QUEUE_SERIAL);
+        ecrSettlementInit(&_columns);
+    }
+    return self;
+}
+
+- (void)dealloc {
+
+    for (SKBSettlementTask *task in self.activeTasks) {
+        task.connection.delegate = nil;
+        [task.connection disConnectSocket];
+    }
+    ecrSettlementFree(&_columns);
+}
+
+- (NSArray<SKBSettlementResult *> *)results {
+
+    return [self.finishedResults copy];
+}
+
+- (NSArray<SKBSettlementResult *> *)failedResults {
+
+    return [self.finishedResults filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"succeeded == NO"]];
+}
+
+//MARK: - Run -
+
+- (void)startWithCompletion:(void (^)(NSArray<SKBSettlementResult *> *results))completion {
+
+    if (self.running) {
+        return;
+    }
+    self.running = YES;
+    self.cancelled = NO;
+    self.completion = completion;
+    [self.finishedResults removeAllObjects];
+    self.completedCount = 0;
+    dispatch_sync(self.mergeQueue, ^{
+        ecrSettlementFree(&self->_columns);
+    });
+
+    // pack() takes the reference as it is, so a bad one would fail on every terminal
+    NSCharacterSet *separators = [NSCharacterSet characterSetWithCharactersInString:@";!"];
+    NSUInteger refNumLength = [self.ecrRefNum lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    BOOL validRefNum = refNumLength > 0 && refNumLength <= REFNUM_SIZE && [self.ecrRefNum rangeOfCharacterFromSet:separators].location == NSNotFound;
+
+    NSMutableArray<SKBSettlementTask *> *invalidTasks = [[NSMutableArray alloc]init];
+    for (NSString *terminal in self.terminals) {
+        SKBSettlementTask *task = [[SKBSettlementTask alloc]init];
+        task.terminal = terminal;
+        task.terminalId = self.terminalIds[terminal];
+        NSRange colon = [terminal rangeOfString:@":" options:NSBackwardsSearch];
+        if (colon.location != NSNotFound) {
+            task.host = [terminal substringToIndex:colon.location];
+            task.port = (NSUInteger)[[terminal substringFromIndex:colon.location + 1] integerValue];
+        }
+        if (!validRefNum || task.host.length == 0 || task.port == 0 || task.port > 65535) {
+            [invalidTasks addObject:task];
+        }
+        else {
+            [self.queuedTasks addObject:task];
+        }
+    }
+    [self signTasks:self.queuedTasks];
+    for (SKBSettlementTask *task in invalidTasks) {
+        [self finishTask:task responseCode:nil rows:0 error:validRefNum ? @"Invalid terminal" : @"Invalid ECR reference number"];
+    }
+    if (self.terminals.count == 0) {
+        [self finishRun];
+        return;
+    }
+    [self startQueuedTasks];
+}
+
+// Every terminal gets the same reference, so the whole fleet is signed in one call
+- (void)signTasks:(NSArray<SKBSettlementTask *> *)tasks {
+
+    if (tasks.count == 0) {
+        return;
+    }
+    NSString *registeredId = [[NSUserDefaults standardUserDefaults]valueForKey:@"terminalSerialNumber"] ?: @"";
+    const char **terminalIds = calloc(tasks.count, sizeof(char *));
+    char *signatures = calloc(tasks.count, SHA256_HEX_SIZE);
+    for (NSUInteger i = 0; i < tasks.count; i++) {
+        terminalIds[i] = [(tasks[i].terminalId ?: registeredId) UTF8String];
+    }
+    sha256SignatureBatch([self.ecrRefNum UTF8String], terminalIds, (int)tasks.count, signatures);
+    for (NSUInteger i = 0; i < tasks.count; i++) {
+        tasks[i].signature = [[NSString alloc]initWithBytes:&signatures[i * SHA256_HEX_SIZE] length:SHA256_HEX_SIZE encoding:NSASCIIStringEncoding];
+    }
+    free(terminalIds);
+    free(signatures);
+}
+
+- (void)cancel {
+
+    if (!self.running) {
+        return;
+    }
+    self.cancelled = YES;
+    NSMutableArray<SKBSettlementTask *> *tasks = [[NSMutableArray alloc]init];
+    [tasks addObjectsFromArray:self.queuedTasks];
+    [tasks addObjectsFromArray:self.retryingTasks];
+    [tasks addObjectsFromArray:self.activeTasks];
+    [self.queuedTasks removeAllObjects];
+    [self.retryingTasks removeAllObjects];
+    for (SKBSettlementTask *task in tasks) {
+        [self endAttempt:task];
+        [self finishTask:task responseCode:nil rows:0 error:@"Cancelled"];
+    }
+}
+
+- (void)startQueuedTasks {
+
+    while (!self.cancelled && self.queuedTasks.count > 0 && self.activeTasks.count < MAX(self.maxConcurrentTerminals, 1)) {
+        SKBSettlementTask *task = self.queuedTasks.firstObject;
+        [self.queuedTasks removeObjectAtIndex:0];
+        [self startAttempt:task];
+    }
+}
+
+- (void)startAttempt:(SKBSettlementTask *)task {
+
+    task.attempts++;
+    if (task.startDate == nil) {
+        task.startDate = [NSDate date];
+    }
+    SKBCoreServices *connection = [[SKBCoreServices alloc]init];
+    connection.shouldReconnectAutomatically = NO;
+    connection.delegate = self;
+    task.connection = connection;
+    [self.activeTasks addObject:task];
+
+    if ([self.delegate respondsToSelector:@selector(settlementRun:didStartTerminal:attempt:)]) {
+        [self.delegate settlementRun:self didStartTerminal:task.terminal attempt:task.attempts];
+    }
+    [connection connectSocket:task.host portNumber:task.port];
+}
+
+// Drops the attempt's connection; late callbacks from it find no task
+- (void)endAttempt:(SKBSettlementTask *)task {
+
+    SKBCoreServices *connection = task.connection;
+    task.connection = nil;
+    [self.activeTasks removeObject:task];
+    connection.delegate = nil;
+    [connection disConnectSocket];
+}
+
+- (void)attemptFailed:(SKBSettlementTask *)task error:(NSString *)error {
+
+    [self endAttempt:task];
+    // A second B1 would settle an empty batch if the first one was processed
+    if (task.requestSent) {
+        [self finishTask:task responseCode:nil rows:0 error:error unresolved:YES];
+        [self startQueuedTasks];
+        return;
+    }
+    if (task.attempts >= MAX(self.maxAttempts, 1)) {
+        [self finishTask:task responseCode:nil rows:0 error:error];
+    }
+    else {
+        // The slot goes to the next terminal while this one waits
+        [self.retryingTasks addObject:task];
+        __weak SKBSettlementRun *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.retryInterval * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            SKBSettlementRun *run = weakSelf;
+            if (run == nil || ![run.retryingTasks containsObject:task]) {
+                return;
+            }
+            [run.retryingTasks removeObject:task];
+            [run.queuedTasks addObject:task];
+            [run startQueuedTasks];
+        });
+    }
+    [self startQueuedTasks];
+}
+
+- (SKBSettlementTask *)taskForConnection:(SKBCoreServices *)connection {
+
+    for (SKBSettlementTask *task in self.activeTasks) {
+        if (task.connection == connection) {
+            return task;
+        }
+    }
+    return nil;
+}
+
+//MARK: - Reply Decoding -
+
+// Decoding runs on the worker pool, one terminal's reply into its own columns, and only
+// the append into the merged columns is serialized
+- (void)decodeReply:(NSData *)reply task:(SKBSettlementTask *)task {
+
+    NSString *terminalId = task.terminalId ?: task.terminal;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        ECR_SETTLEMENT_COLUMNS columns;
+        ecrSettlementInit(&columns);
+        int rows = ecrSettlementDecode(&columns, [terminalId UTF8String], (const char *)[reply bytes]);
+
+        NSString *response = [[NSString alloc]initWithBytes:[reply bytes] length:strlen((const char *)[reply bytes]) encoding:NSUTF8StringEncoding];
+        NSArray *fields = [response componentsSeparatedByString:@";"];
+        NSString *responseCode = fields.count > 2 ? fields[2] : nil;
+
+        dispatch_async(self.mergeQueue, ^{
+            int merged = rows;
+            if (rows > 0 && ecrSettlementAppend(&self->_columns, &columns) < 0) {
+                merged = -1;
+            }
+            ecrSettlementFree(&columns);
+
+            dispatch_async(dispatch_get_main_queue(), ^{
+                NSString *error = nil;
+                if (rows < 0) {
+                    error = responseCode.length > 0 ? [NSString stringWithFormat:@"Response code %@", responseCode] : @"Invalid reply";
+                }
+                else if (merged < 0) {
+                    error = @"Out of memory";
+                }
+                [self finishTask:task responseCode:responseCode rows:merged < 0 ? 0 : merged error:error];
+            });
+        });
+    });
+}
+
+- (void)finishTask:(SKBSettlementTask *)task responseCode:(NSString *)responseCode rows:(NSUInteger)rows error:(NSString *)error {
+
+    [self finishTask:task responseCode:responseCode rows:rows error:error unresolved:NO];
+}
+
+- (void)finishTask:(SKBSettlementTask *)task responseCode:(NSString *)responseCode rows:(NSUInteger)rows error:(NSString *)error unresolved:(BOOL)unresolved {
+
+    if (task.finished) {
+        return;
+    }
+    task.finished = YES;
+
+    SKBSettlementResult *result = [[SKBSettlementResult alloc]init];
+    result.terminal = task.terminal;
+    result.succeeded = error == nil;
+    result.attempts = task.attempts;
+    result.responseCode = responseCode;
+    result.error = error;
+    result.rows = rows;
+    result.unresolved = unresolved;
+    result.duration = task.startDate ? -[task.startDate timeIntervalSinceNow] : 0;
+    [self.finishedResults addObject:result];
+    self.completedCount++;
+
+    if ([self.delegate respondsToSelector:@selector(settlementRun:didFinishTerminal:)]) {
+        [self.delegate settlementRun:self didFinishTerminal:result];
+    }
+    if (self.completedCount == self.terminals.count) {
+        [self finishRun];
+    }
+}
+
+- (void)finishRun {
+
+    void (^completion)(NSArray<SKBSettlementResult *> *results) = self.completion;
+    self.completion = nil;
+    self.running = NO;
+    if (completion) {
+        completion([self.finishedResults copy]);
+    }
+}
+
+//MARK: - SocketConnectionDelegate -
+
+- (void)socketConnectionStreamDidConnect:(SKBCoreServices *)connection {
+
+    SKBSettlementTask *task = [self taskForConnection:connection];
+    if (task == nil) {
+        return;
+    }
+    task.requestSent = NO;
+    [connection sendReconciliation:self.ecrRefNum printReceipt:self.printReceipts signature:task.signature completion:^(NSData *reply, NSString *error) {
+        if (task.connection != connection) {
+            return;
+        }
+        if (reply == nil) {
+            [self attemptFailed:task error:error];
+            return;
+        }
+        [self endAttempt:task];
+        [self startQueuedTasks];
+        [self decodeReply:reply task:task];
+    }];
+    // Refusals (not connected, busy) complete above; once this returns B1 is on its way
+    if (task.connection == connection) {
+        task.requestSent = YES;
+    }
+}
+
+- (void)socketConnectionStreamDidFailToConnect:(SKBCoreServices *)connection {
+
+    SKBSettlementTask *task = [self taskForConnection:connection];
+    if (task != nil) {
+        [self attemptFailed:task error:@"Connection failed"];
+    }
+}
+
+- (void)socketConnectionStreamDidDisconnect:(SKBCoreServices *)connection willReconnectAutomatically:(BOOL)willReconnectAutomatically {
+
+    SKBSettlementTask *task = [self taskForConnection:connection];
+    if (task != nil) {
+        [self attemptFailed:task error:@"Disconnected"];
+    }
+}
+
+- (void)socketConnectionStream:(SKBCoreServices *)connection didReceiveData:(NSMutableDictionary *)responseData {
+}
+
+- (void)socketConnectionStream:(SKBCoreServices *)connection didSendString:(NSString *)string {
+}
+
+//MARK: - Merged Totals -
+
+- (NSUInteger)totalRows {
+
+    __block NSUInteger rows = 0;
+    dispatch_sync(self.mergeQueue, ^{
+        rows = self->_columns.inRows;
+    });
+    return rows;
+}
+
+- (NSArray<NSDictionary *> *)aggregateTotals {
+
+    NSMutableArray<NSDictionary *> *totals = [[NSMutableArray alloc]init];
+    dispatch_sync(self.mergeQueue, ^{
+        ECR_SETTLEMENT_COLUMNS aggregate;
+        ecrSettlementInit(&aggregate);
+        if (ecrSettlementAggregate(&aggregate, &self->_columns, "ALL", "") >= 0) {
+            for (int i = 0; i < aggregate.inRows; i++) {
+                [totals addObject:@{
+                    @"scheme": [NSString stringWithUTF8String:aggregate.pszSchemes[aggregate.pusScheme[i]]] ?: @"",
+                    @"source": @(ecrSettlementSourceName(aggregate.pucSource[i])),
+                    @"kind": @(ecrSettlementKindName(aggregate.pucKind[i])),
+                    @"count": @(aggregate.pulCount[i]),
+                    @"amount": @(aggregate.pllAmount[i])
+                }];
+            }
+        }
+        ecrSettlementFree(&aggregate);
+    });
+    return totals;
+}
+
+- (BOOL)exportTotalsToPath:(NSString *)path format:(SKBSettlementExportFormat)format aggregate:(BOOL)aggregate {
+
+    __block int result = -1;
+    dispatch_sync(self.mergeQueue, ^{
+        ECR_SETTLEMENT_COLUMNS summed;
+        ecrSettlementInit(&summed);
+        const ECR_SETTLEMENT_COLUMNS *columns = &self->_columns;
+        if (aggregate) {
+            if (ecrSettlementAggregate(&summed, &self->_columns, "ALL", "") < 0) {
+                ecrSettlementFree(&summed);
+                return;
+            }
+            columns = &summed;
+        }
+        if (format == SKBSettlementExportFormatColumnar) {
+            result = ecrSettlementWriteColumnar(columns, [path fileSystemRepresentation]);
+        }
+        else {
+            result = ecrSettlementWriteCsv(columns, [path fileSystemRepresentation]);
+        }
+        ecrSettlementFree(&summed);
+    });
+    return result == 0;
+}
+
+@end
@@ -1,20 +0,0 @@
-//
-//  SkyBandECRSDK.h
-//  SkyBandECRSDK
-//
-//  Created by vijayasimhareddy on 13/02/20.
-//  Copyright © 2020 GirmitiSoftwares. All rights reserved.
-//
-
-#import <Foundation/Foundation.h>
-
-//! Project version number for SkyBandECRSDK.
-FOUNDATION_EXPORT double SkyBandECRSDKVersionNumber;
-
-//! Project version string for SkyBandECRSDK.
-FOUNDATION_EXPORT const unsigned char SkyBandECRSDKVersionString[];
-
-// In this header, you should import all the public headers of your framework using statements like #import <SkyBandECRSDK/PublicHeader.h>
-
-#import <SkyBandECRSDK/SBCoreECR.h>
-#import <SkyBandECRSDK/SKBCoreServices.h>
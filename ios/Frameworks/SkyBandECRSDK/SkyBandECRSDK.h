@@ -17,3 +17,8 @@ FOUNDATION_EXPORT const unsigned char SkyBandECRSDKVersionString[];
 // In this header, you should import all the public headers of your framework using statements like #import <SkyBandECRSDK/PublicHeader.h>
 
 #import <SkyBandECRSDK/SKBCoreServices.h>
+#import <SkyBandECRSDK/SKBHealthMonitor.h>
+#import <SkyBandECRSDK/SKBSession.h>
+#import <SkyBandECRSDK/SKBSettlementRun.h>
+#import <SkyBandECRSDK/SKBIdempotencyCache.h>
+#import <SkyBandECRSDK/SKBAdaptiveTimeouts.h>
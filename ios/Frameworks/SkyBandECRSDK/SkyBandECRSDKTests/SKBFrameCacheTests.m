@@ -0,0 +1,70 @@
+//
+//  SKBFrameCacheTests.m
+//  SkyBandECRSDKTests
+//
+//  Frames emitted from the template cache against the ones pack() builds.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRFrameCache.h"
+
+@interface SKBFrameCacheTests : XCTestCase
+
+@end
+
+@implementation SKBFrameCacheTests
+
+- (void)testCachedFramesMatchPack {
+
+    static ECR_FRAME_CACHE cache;
+    static const int types[] = { TYPE_PARAM_DOWNLOAD, TYPE_GET_PARAM, TYPE_CHECK_STATUS, TYPE_PARTIAL_DOWNLOAD, TYPE_SNAPSHOT_TOTAL };
+    ecrFrameCacheInit(&cache);
+    srand(1);
+    for (int i = 0; i < 2000; i++) {
+        int transactionType = types[rand() % 5];
+        int refNumLength = 1 + rand() % REFNUM_SIZE;
+        char dateTime[DATETIME_SIZE + 1];
+        char refNum[REFNUM_SIZE + 1];
+        char signature[SIGNATURE_SIZE + 1];
+        char request[64];
+        for (int j = 0; j < DATETIME_SIZE; j++) {
+            dateTime[j] = '0' + rand() % 10;
+        }
+        dateTime[DATETIME_SIZE] = 0;
+        for (int j = 0; j < refNumLength; j++) {
+            refNum[j] = '0' + rand() % 10;
+        }
+        refNum[refNumLength] = 0;
+        for (int j = 0; j < SIGNATURE_SIZE; j++) {
+            signature[j] = "0123456789abcdef"[rand() % 16];
+        }
+        signature[SIGNATURE_SIZE] = 0;
+        snprintf(request, sizeof(request), "%s;%s!", dateTime, refNum);
+
+        char packed[600];
+        unsigned char cached[600];
+        memset(packed, 0x00, sizeof(packed));
+        memset(cached, 0x00, sizeof(cached));
+        pack(request, transactionType, signature, packed);
+        int length = ecrFrameCacheEmitRequest(&cache, transactionType, request, signature, cached);
+
+        XCTAssertGreaterThan(length, 0, @"%d %s", transactionType, request);
+        XCTAssertEqual(memcmp(packed, cached, sizeof(packed)), 0, @"%d %s", transactionType, request);
+    }
+}
+
+- (void)testUncachedInputFallsBackToPack {
+
+    static ECR_FRAME_CACHE cache;
+    unsigned char frame[ECR_FRAME_TEMPLATE_MAX];
+    char signature[SIGNATURE_SIZE + 1];
+    memset(signature, 'a', SIGNATURE_SIZE);
+    signature[SIGNATURE_SIZE] = 0;
+    ecrFrameCacheInit(&cache);
+
+    XCTAssertEqual(ecrFrameCacheEmitRequest(&cache, TYPE_RECONCILATION, "202401011200;1!", signature, frame), -1);
+    XCTAssertEqual(ecrFrameCacheEmitRequest(&cache, TYPE_CHECK_STATUS, "2024;1!", signature, frame), -1);
+    XCTAssertEqual(ecrFrameCacheEmitRequest(&cache, TYPE_CHECK_STATUS, "202401011200;123456789012345!", signature, frame), -1);
+}
+
+@end
@@ -0,0 +1,99 @@
+//
+//  SKBInternTests.m
+//  SkyBandECRSDKTests
+//
+//  Replacement in the response field intern table.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRIntern.h"
+
+// Writes the n-th value that falls into the same set as value
+static int valueInSetOf(const char *value, int n, char *output, int size) {
+    
+    unsigned long set = ecrInternHash((const unsigned char *)value, (int)strlen(value)) % ECR_INTERN_SETS;
+    for (int i = 0; ; i++) {
+        int length = snprintf(output, size, "%06d", i);
+        if (ecrInternHash((const unsigned char *)output, length) % ECR_INTERN_SETS == set && n-- == 0) {
+            return length;
+        }
+    }
+}
+
+@interface SKBInternTests : XCTestCase
+
+@end
+
+@implementation SKBInternTests
+
+- (void)testRepeatedValueKeepsItsSlot {
+
+    static ECR_INTERN_TABLE table;
+    const char *terminalId = "12345678";
+    int found = 0;
+    ecrInternInit(&table);
+
+    int slot = ecrInternFind(&table, (const unsigned char *)terminalId, 8, &found);
+    XCTAssertGreaterThanOrEqual(slot, 0);
+    XCTAssertEqual(found, 0);
+    XCTAssertEqual(ecrInternFind(&table, (const unsigned char *)terminalId, 8, &found), slot);
+    XCTAssertEqual(found, 1);
+    XCTAssertEqual(table.ulLookups, 2UL);
+    XCTAssertEqual(table.ulHits, 1UL);
+}
+
+// A value that changes every transaction takes the other way and leaves the constant alone
+- (void)testChangingValuesDoNotEvictConstants {
+
+    static ECR_INTERN_TABLE table;
+    const char *terminalId = "12345678";
+    char value[16];
+    int found = 0, misses = 0;
+    ecrInternInit(&table);
+
+    for (int i = 0; i < 200; i++) {
+        ecrInternFind(&table, (const unsigned char *)terminalId, 8, &found);
+        if (i > 0 && !found) {
+            misses++;
+        }
+        int length = valueInSetOf(terminalId, i, value, sizeof(value));
+        ecrInternFind(&table, (const unsigned char *)value, length, &found);
+        XCTAssertEqual(found, 0);
+    }
+    XCTAssertEqual(misses, 0);
+}
+
+// Each miss halves the hits of the surviving way, so a constant that stops repeating goes
+- (void)testStaleConstantIsReplaced {
+
+    static ECR_INTERN_TABLE table;
+    const char *terminalId = "12345678";
+    char value[16];
+    int found = 0;
+    ecrInternInit(&table);
+
+    for (int i = 0; i < 8; i++) {
+        ecrInternFind(&table, (const unsigned char *)terminalId, 8, &found);
+    }
+    for (int i = 0; i < 8; i++) {
+        int length = valueInSetOf(terminalId, i, value, sizeof(value));
+        ecrInternFind(&table, (const unsigned char *)value, length, &found);
+    }
+    ecrInternFind(&table, (const unsigned char *)terminalId, 8, &found);
+    XCTAssertEqual(found, 0);
+}
+
+- (void)testLongValuesAreNotInterned {
+
+    static ECR_INTERN_TABLE table;
+    unsigned char value[ECR_INTERN_VALUE_MAX + 1];
+    int found = 1;
+    memset(value, 'A', sizeof(value));
+    ecrInternInit(&table);
+
+    XCTAssertEqual(ecrInternFind(&table, value, ECR_INTERN_VALUE_MAX + 1, &found), -1);
+    XCTAssertEqual(found, 0);
+    XCTAssertGreaterThanOrEqual(ecrInternFind(&table, value, ECR_INTERN_VALUE_MAX, &found), 0);
+}
+
+@end
@@ -0,0 +1,90 @@
+//
+//  SKBLatencyTests.m
+//  SkyBandECRSDKTests
+//
+//  Latency percentiles, derived timeouts and reconnect backoff.
+//
+
+#import <XCTest/XCTest.h>
+#import <SkyBandECRSDK/SKBAdaptiveTimeouts.h>
+#include "ECRLatency.h"
+
+@interface SKBLatencyTests : XCTestCase
+
+@end
+
+@implementation SKBLatencyTests
+
+- (void)testEmptyWindowUsesDefault {
+
+    ECR_LATENCY_WINDOW window;
+    ecrLatencyInit(&window);
+
+    XCTAssertEqual(ecrLatencyPercentile(&window, 0.5), -1);
+    XCTAssertEqualWithAccuracy(ecrLatencyTimeout(&window, 0.95, 2, 1, 10, 5, 8), 5, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyTimeout(&window, 0.95, 2, 1, 10, 50, 8), 10, 1e-9);
+    for (int i = 0; i < 7; i++) {
+        ecrLatencyAdd(&window, 0.1);
+    }
+    XCTAssertEqualWithAccuracy(ecrLatencyTimeout(&window, 0.95, 2, 1, 10, 5, 8), 5, 1e-9);
+}
+
+// 100 samples of 0.01 to 1.00 s: the window keeps the last 64, 0.37 to 1.00 s
+- (void)testNearestRankOverLastSamples {
+
+    ECR_LATENCY_WINDOW window;
+    ecrLatencyInit(&window);
+    for (int i = 1; i <= 100; i++) {
+        ecrLatencyAdd(&window, i / 100.0);
+    }
+
+    XCTAssertEqual(window.inCount, ECR_LATENCY_SAMPLES);
+    XCTAssertEqualWithAccuracy(ecrLatencyPercentile(&window, 0), 0.37, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyPercentile(&window, 0.5), 0.68, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyPercentile(&window, 0.95), 0.97, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyPercentile(&window, 1), 1.00, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyTimeout(&window, 0.95, 2, 1, 10, 5, 8), 1.94, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyTimeout(&window, 0.95, 2, 3, 10, 5, 8), 3, 1e-9);
+}
+
+- (void)testBackoffDoublesUpToMax {
+
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 0, 1, 30, 0.5, 0), 3, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 1, 1, 30, 0.5, 0), 3, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 2, 1, 30, 0.5, 0), 6, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 4, 1, 30, 0.5, 0), 24, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 5, 1, 30, 0.5, 0), 30, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(3, 60, 1, 30, 0.5, 0), 30, 1e-9);
+}
+
+- (void)testBackoffJitterStaysInBounds {
+
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(4, 1, 1, 30, 0.5, 0.5), 3, 1e-9);
+    XCTAssertEqualWithAccuracy(ecrLatencyBackoff(1, 1, 1, 30, 0.5, 0.999), 1, 1e-9);
+    for (int i = 0; i < 100; i++) {
+        double delay = ecrLatencyBackoff(3, 3, 1, 30, 0.5, i / 100.0);
+        XCTAssertGreaterThan(delay, 6);
+        XCTAssertLessThanOrEqual(delay, 12);
+    }
+}
+
+- (void)testTransactionTimeoutFollowsSamples {
+
+    SKBAdaptiveTimeouts *timeouts = [[SKBAdaptiveTimeouts alloc]init];
+    NSString *terminal = @"10.0.0.1:6000";
+
+    XCTAssertEqualWithAccuracy([timeouts transactionTimeoutForTerminal:terminal transactionType:10 fallback:150], 150, 1e-9);
+    for (int i = 0; i < 8; i++) {
+        [timeouts recordResponseLatency:20 transactionType:10 terminal:terminal];
+    }
+    XCTAssertEqualWithAccuracy([timeouts transactionTimeoutForTerminal:terminal transactionType:10 fallback:150], 40, 1e-9);
+    // Other types and terminals keep the fallback
+    XCTAssertEqualWithAccuracy([timeouts transactionTimeoutForTerminal:terminal transactionType:11 fallback:150], 150, 1e-9);
+    XCTAssertEqualWithAccuracy([timeouts transactionTimeoutForTerminal:@"10.0.0.2:6000" transactionType:10 fallback:150], 150, 1e-9);
+    for (int i = 0; i < ECR_LATENCY_SAMPLES; i++) {
+        [timeouts recordResponseLatency:1 transactionType:10 terminal:terminal];
+    }
+    XCTAssertEqualWithAccuracy([timeouts transactionTimeoutForTerminal:terminal transactionType:10 fallback:150], timeouts.minTransactionTimeout, 1e-9);
+}
+
+@end
@@ -0,0 +1,114 @@
+//
+//  SKBReceiptBundleTests.m
+//  SkyBandECRSDKTests
+//
+//  Receipts.skbrb, as the "Compile Receipt Bundle" phase builds it, against the
+//  SKBTransactionRecipts HTML files it was built from.
+//
+
+#import <XCTest/XCTest.h>
+#import <SkyBandECRSDK/SKBCoreServices.h>
+#include "ECRReceiptBundle.h"
+
+static const char *placeholderValue(void *context, int placeholder, int *length) {
+
+    char *value = (char *)context;
+    *length = snprintf(value, 16, "{%d}", placeholder);
+    return value;
+}
+
+@interface SKBReceiptBundleTests : XCTestCase {
+    ECR_RECEIPT_BUNDLE _bundle;
+}
+
+@property (nonatomic, strong) NSBundle *sdkBundle;
+@property (nonatomic, copy) NSString *bundlePath;
+
+@end
+
+@implementation SKBReceiptBundleTests
+
+- (void)setUp {
+
+    self.sdkBundle = [NSBundle bundleForClass:[SKBCoreServices class]];
+    self.bundlePath = [self.sdkBundle pathForResource:@"Receipts" ofType:@"skbrb"];
+    XCTAssertNotNil(self.bundlePath);
+    XCTAssertEqual(ecrReceiptBundleOpen(&_bundle, self.bundlePath.fileSystemRepresentation), 0);
+}
+
+- (void)tearDown {
+
+    ecrReceiptBundleClose(&_bundle);
+}
+
+- (void)testEveryTemplateMatchesItsHtml {
+
+    NSArray<NSURL *> *htmlFiles = [self.sdkBundle URLsForResourcesWithExtension:@"html" subdirectory:nil];
+    XCTAssertGreaterThan(htmlFiles.count, 0);
+    XCTAssertEqual(_bundle.inTemplates, (int)htmlFiles.count);
+    for (NSURL *htmlFile in htmlFiles) {
+        NSString *name = [[htmlFile lastPathComponent] stringByDeletingPathExtension];
+        NSData *html = [NSData dataWithContentsOfURL:htmlFile];
+        int template = ecrReceiptBundleFind(&_bundle, name.UTF8String);
+        XCTAssertGreaterThanOrEqual(template, 0, @"%@", name);
+        if (template < 0) {
+            continue;
+        }
+        int length = 0;
+        const char *text = ecrReceiptBundleText(&_bundle, template, &length);
+        XCTAssertEqual(length, (int)html.length, @"%@", name);
+        XCTAssertEqual(memcmp(text, html.bytes, MIN((NSUInteger)length, html.length)), 0, @"%@", name);
+
+        // Without values every placeholder keeps its text
+        NSMutableData *rendered = [NSMutableData dataWithLength:html.length + 1];
+        XCTAssertEqual(ecrReceiptBundleRender(&_bundle, template, NULL, NULL, rendered.mutableBytes, (int)rendered.length), (int)html.length, @"%@", name);
+        XCTAssertEqual(memcmp(rendered.bytes, html.bytes, html.length), 0, @"%@", name);
+        XCTAssertEqual(ecrReceiptBundleRender(&_bundle, template, NULL, NULL, rendered.mutableBytes, (int)html.length), -1, @"%@", name);
+    }
+}
+
+- (void)testSegmentsRenderInOrder {
+
+    char value[16];
+    for (int template = 0; template < _bundle.inTemplates; template++) {
+        int length = 0;
+        const char *text = ecrReceiptBundleText(&_bundle, template, &length);
+        NSMutableString *expected = [[NSMutableString alloc]init];
+        int covered = 0;
+        for (int i = 0; i < ecrReceiptBundleSegmentCount(&_bundle, template); i++) {
+            ECR_RECEIPT_SEGMENT segment;
+            ecrReceiptBundleSegment(&_bundle, template, i, &segment);
+            XCTAssertEqual(segment.inStart, covered);
+            covered += segment.inLength;
+            if (segment.inPlaceholder == ECR_RECEIPT_LITERAL) {
+                [expected appendString:[[NSString alloc]initWithBytes:text + segment.inStart length:segment.inLength encoding:NSUTF8StringEncoding] ?: @""];
+            }
+            else {
+                [expected appendFormat:@"{%d}", segment.inPlaceholder];
+            }
+        }
+        XCTAssertEqual(covered, length);
+
+        NSMutableData *rendered = [NSMutableData dataWithLength:length * 4 + 1];
+        int renderedLength = ecrReceiptBundleRender(&_bundle, template, placeholderValue, value, rendered.mutableBytes, (int)rendered.length);
+        XCTAssertGreaterThanOrEqual(renderedLength, 0);
+        XCTAssertEqualObjects([[NSString alloc]initWithBytes:rendered.bytes length:MAX(renderedLength, 0) encoding:NSUTF8StringEncoding], expected, @"%s", ecrReceiptBundleName(&_bundle, template));
+    }
+}
+
+- (void)testDamagedBundleIsRejected {
+
+    NSMutableData *data = [NSMutableData dataWithContentsOfFile:self.bundlePath];
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SKBReceiptBundleTests.skbrb"];
+    ECR_RECEIPT_BUNDLE damaged;
+
+    [[data subdataWithRange:NSMakeRange(0, data.length / 2)] writeToFile:path atomically:YES];
+    XCTAssertEqual(ecrReceiptBundleOpen(&damaged, path.fileSystemRepresentation), -1);
+    ((unsigned char *)data.mutableBytes)[0] = 'X';
+    [data writeToFile:path atomically:YES];
+    XCTAssertEqual(ecrReceiptBundleOpen(&damaged, path.fileSystemRepresentation), -1);
+    XCTAssertEqual(ecrReceiptBundleFind(&_bundle, "Missing template"), -1);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+@end
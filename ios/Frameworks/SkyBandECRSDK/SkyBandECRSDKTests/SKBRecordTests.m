@@ -0,0 +1,86 @@
+//
+//  SKBRecordTests.m
+//  SkyBandECRSDKTests
+//
+//  Compact response records against the layout EcrResponseRecord.decode reads
+//  (lib/skyband_ecr_plugin.dart).
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRRecord.h"
+
+// The record test/skyband_ecr_plugin_response_record_test.dart decodes: Purchase with a
+// receipt, response code, message, amount 10.50, TID and an Arabic merchant name
+static const unsigned char kDartRecord[] = {
+    0x53, 0x42, 0x01, 0x01, 0x00, 0x00, 0x06, 0x00,
+    0x01, 0x00, 0x01, 0x00, 0x30,
+    0x02, 0x00, 0x03, 0x00, 0x30, 0x30, 0x30,
+    0x03, 0x00, 0x08, 0x00, 0x41, 0x50, 0x50, 0x52, 0x4F, 0x56, 0x45, 0x44,
+    0x07, 0x01, 0x1A, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x12, 0x00, 0x08, 0x00, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
+    0x27, 0x00, 0x08, 0x00, 0xD9, 0x85, 0xD8, 0xAA, 0xD8, 0xAC, 0xD8, 0xB1
+};
+
+@interface SKBRecordTests : XCTestCase
+
+@end
+
+@implementation SKBRecordTests
+
+- (void)testEncodingMatchesDartDecoder {
+
+    unsigned char buffer[256];
+    const char *merchantName = "\xD9\x85\xD8\xAA\xD8\xAC\xD8\xB1";
+    long long amount = 0;
+    ECR_RECORD record;
+
+    XCTAssertEqual(ecrAmountToMinorUnits("000000001050", 12, &amount), 0);
+    ecrRecordBegin(&record, buffer, sizeof(buffer), 0);
+    ecrRecordPutString(&record, ECR_FLD_TRAN_TYPE, "0", 1);
+    ecrRecordPutString(&record, ECR_FLD_RESPONSE_CODE, "000", 3);
+    ecrRecordPutString(&record, ECR_FLD_RESPONSE_MESSAGE, "APPROVED", 8);
+    ecrRecordPutAmount(&record, ECR_FLD_TRAN_AMOUNT, amount);
+    ecrRecordPutString(&record, ECR_FLD_TID, "12345678", 8);
+    ecrRecordPutString(&record, ECR_FLD_MERCHANT_NAME_ARABIC, merchantName, (int)strlen(merchantName));
+    int length = ecrRecordFinish(&record, ECR_RECORD_FLAG_RECEIPT);
+
+    XCTAssertEqual(length, (int)sizeof(kDartRecord));
+    XCTAssertEqual(memcmp(buffer, kDartRecord, sizeof(kDartRecord)), 0);
+}
+
+// EcrResponseRecord.fieldNames is indexed by these ids
+- (void)testFieldIdsMatchDartNames {
+
+    XCTAssertEqual(ECR_FLD_TRAN_TYPE, 1);
+    XCTAssertEqual(ECR_FLD_TRAN_AMOUNT, 7);
+    XCTAssertEqual(ECR_FLD_TID, 18);
+    XCTAssertEqual(ECR_FLD_MERCHANT_NAME_ARABIC, 39);
+    XCTAssertEqual(ECR_FLD_ECR_REF_NUM, 41);
+    XCTAssertEqual(ECR_FLD_IDEMPOTENCY_REPLAY, 62);
+    XCTAssertEqual(ECR_FLD_REQUEST_REF_NUM, 63);
+    XCTAssertEqual(ECR_FLD_REQUEST_ERROR, 64);
+}
+
+// A field that does not fit fails the record, even if later ones would fit
+- (void)testOverflowFailsTheRecord {
+
+    unsigned char buffer[ECR_RECORD_HEADER_SIZE + 8];
+    ECR_RECORD record;
+
+    ecrRecordBegin(&record, buffer, sizeof(buffer), 0);
+    XCTAssertEqual(ecrRecordPutAmount(&record, ECR_FLD_TRAN_AMOUNT, 1050), -1);
+    XCTAssertEqual(ecrRecordPutString(&record, ECR_FLD_TID, "1234", 4), -1);
+    XCTAssertEqual(ecrRecordFinish(&record, 0), -1);
+}
+
+- (void)testAmountsMustBeDigits {
+
+    long long amount = 0;
+
+    XCTAssertEqual(ecrAmountToMinorUnits("000000000000", 12, &amount), 0);
+    XCTAssertEqual(amount, 0);
+    XCTAssertEqual(ecrAmountToMinorUnits("10.50", 5, &amount), -1);
+    XCTAssertEqual(ecrAmountToMinorUnits("", 0, &amount), -1);
+}
+
+@end
@@ -0,0 +1,110 @@
+//
+//  SKBReportTests.m
+//  SkyBandECRSDKTests
+//
+//  Summary report (C1) pages: how many rows a page holds and where the report ends.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRReport.h"
+
+typedef struct {
+    int rows;
+    char lastRrn[16];
+} SKBReportRows;
+
+static void countRow(void *context, const ECR_REPORT_ROW *row) {
+
+    SKBReportRows *rows = (SKBReportRows *)context;
+    rows->rows++;
+    snprintf(rows->lastRrn, sizeof(rows->lastRrn), "%.*s", row->aiLength[ECR_REPORT_RRN], row->apszField[ECR_REPORT_RRN]);
+}
+
+// parse() output of a C1 page: rowsField in the row count place, then count rows
+// numbered from first, then a trailing field
+static NSString *reportPage(NSString *rowsField, int first, int count) {
+
+    NSMutableString *page = [NSMutableString stringWithFormat:@"\x02;C1;000;APPROVED;%@", rowsField];
+    for (int i = first; i < first + count; i++) {
+        [page appendFormat:@";0;010124;RRN%06d;000000001000;A;120000;588845******1234;AUTH%02d;%06d", i, i % 100, i];
+    }
+    [page appendString:@";END"];
+    return page;
+}
+
+@interface SKBReportTests : XCTestCase
+
+@end
+
+@implementation SKBReportTests
+
+- (void)testDeclaredCountLimitsRows {
+
+    ECR_REPORT_STREAM stream;
+    SKBReportRows rows = { 0 };
+    ecrReportInit(&stream);
+
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"2", 1, 3).UTF8String, countRow, &rows), ECR_REPORT_MORE);
+    XCTAssertEqual(rows.rows, 2);
+    XCTAssertEqual(strcmp(rows.lastRrn, "RRN000002"), 0);
+    XCTAssertEqual(stream.inRows, 2);
+    XCTAssertEqual(strcmp(stream.szResponseCode, "000"), 0);
+    XCTAssertEqual(strcmp(stream.szLastNumber, "000002"), 0);
+}
+
+// Some terminals put the date time where the count goes; the rows then come from the field count
+- (void)testDateTimeInCountFieldIsIgnored {
+
+    ECR_REPORT_STREAM stream;
+    SKBReportRows rows = { 0 };
+    ecrReportInit(&stream);
+
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"010124120000", 1, 3).UTF8String, countRow, &rows), ECR_REPORT_MORE);
+    XCTAssertEqual(rows.rows, 3);
+    XCTAssertEqual(strcmp(rows.lastRrn, "RRN000003"), 0);
+    // A count larger than the rows present does not make rows up
+    rows.rows = 0;
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"9", 4, 2).UTF8String, countRow, &rows), ECR_REPORT_MORE);
+    XCTAssertEqual(rows.rows, 2);
+    XCTAssertEqual(stream.lnTotalRows, 5);
+}
+
+// An attempt past the end gets the last page again, which ends the report without rows
+- (void)testRepeatedPageEndsReport {
+
+    ECR_REPORT_STREAM stream;
+    SKBReportRows rows = { 0 };
+    ecrReportInit(&stream);
+
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"3", 1, 3).UTF8String, countRow, &rows), ECR_REPORT_MORE);
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"3", 4, 3).UTF8String, countRow, &rows), ECR_REPORT_MORE);
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"3", 4, 3).UTF8String, countRow, &rows), ECR_REPORT_END);
+    XCTAssertEqual(rows.rows, 6);
+    XCTAssertEqual(stream.lnTotalRows, 6);
+    XCTAssertEqual(stream.inRows, 0);
+}
+
+- (void)testEmptyPageEndsReport {
+
+    ECR_REPORT_STREAM stream;
+    SKBReportRows rows = { 0 };
+    ecrReportInit(&stream);
+
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"0", 1, 0).UTF8String, countRow, &rows), ECR_REPORT_END);
+    XCTAssertEqual(ecrReportDecodePage(&stream, reportPage(@"0", 1, 2).UTF8String, countRow, &rows), ECR_REPORT_END);
+    XCTAssertEqual(rows.rows, 0);
+}
+
+- (void)testErrorReplyKeepsResponse {
+
+    ECR_REPORT_STREAM stream;
+    SKBReportRows rows = { 0 };
+    ecrReportInit(&stream);
+
+    XCTAssertEqual(ecrReportDecodePage(&stream, "\x02;C1;400;NO DATA FOUND", countRow, &rows), ECR_REPORT_ERROR);
+    XCTAssertEqual(strcmp(stream.szResponseCode, "400"), 0);
+    XCTAssertEqual(strcmp(stream.szResponseMessage, "NO DATA FOUND"), 0);
+    XCTAssertEqual(rows.rows, 0);
+}
+
+@end
@@ -0,0 +1,159 @@
+//
+//  SKBSessionTests.m
+//  SkyBandECRSDKTests
+//
+//  Start Session (B6) / End Session (B7) batching against a connection that records
+//  what it is asked to send.
+//
+
+#import <XCTest/XCTest.h>
+#import <SkyBandECRSDK/SKBSession.h>
+
+@interface SKBRecordingConnection : SKBCoreServices
+
+@property (nonatomic, strong) NSMutableArray<NSDictionary *> *sent;
+
+@end
+
+@implementation SKBRecordingConnection
+
+- (BOOL)connected {
+
+    return YES;
+}
+
+- (BOOL)transactionInFlight {
+
+    return NO;
+}
+
+- (void)doTCPIPTransaction:(NSString *)ipAddress portNumber:(NSUInteger)portNumber requestData:(NSString *)requestData transactionType:(int)transactionType signature:(NSString*)signature receiptFormat:(SKBReceiptFormat)receiptFormat deadline:(NSTimeInterval)deadline {
+
+    if (self.sent == nil) {
+        self.sent = [[NSMutableArray alloc]init];
+    }
+    NSString *fields = [requestData substringToIndex:requestData.length - 1];
+    [self.sent addObject:@{
+        @"transactionType": @(transactionType),
+        @"ecrRefNum": [[fields componentsSeparatedByString:@";"] lastObject],
+        @"receiptFormat": @(receiptFormat)
+    }];
+}
+
+@end
+
+@interface SKBRecordingDelegate : NSObject <SocketConnectionDelegate>
+
+@property (nonatomic, strong) NSMutableArray<NSDictionary *> *responses;
+
+@end
+
+@implementation SKBRecordingDelegate
+
+- (void)socketConnectionStream:(SKBCoreServices *)connection didReceiveData:(NSMutableDictionary *)responseData {
+
+    if (self.responses == nil) {
+        self.responses = [[NSMutableArray alloc]init];
+    }
+    [self.responses addObject:[responseData copy]];
+}
+
+@end
+
+// A decoded reply as the connection hands it over, tagged with its request's reference
+static NSMutableDictionary *reply(NSString *transactionType, NSString *responseCode, NSString *ecrRefNum) {
+
+    return [@{ @"Transaction type": transactionType, @"Response Code": responseCode, @"ecrRefNum": ecrRefNum } mutableCopy];
+}
+
+@interface SKBSessionTests : XCTestCase {
+    SKBRecordingConnection *_connection;
+    SKBRecordingDelegate *_recorder;
+    SKBSession *_session;
+}
+
+@end
+
+@implementation SKBSessionTests
+
+- (void)setUp {
+
+    _connection = [[SKBRecordingConnection alloc]init];
+    _recorder = [[SKBRecordingDelegate alloc]init];
+    _connection.delegate = _recorder;
+    _session = [[SKBSession alloc]initWithConnection:_connection cashRegisterNumber:@"42"];
+}
+
+- (void)tearDown {
+
+    [_session invalidate];
+}
+
+- (void)testForwardsToTheConnectionsDelegateAndGivesItBack {
+
+    XCTAssertEqual(_session.delegate, _recorder);
+    XCTAssertEqual(_connection.delegate, _session);
+    XCTAssertEqualObjects(_session.cashRegisterNumber, @"00000042");
+
+    [_session invalidate];
+    XCTAssertEqual(_connection.delegate, _recorder);
+}
+
+- (void)testRefusedStartSessionFailsQueuedTransactions {
+
+    [_session purchase:1000 printReceipt:NO ecrRefNum:@"000000000001"];
+    [_session purchase:2000 printReceipt:NO ecrRefNum:@"000000000002"];
+    XCTAssertEqual(_connection.sent.count, 1);
+    XCTAssertEqualObjects(_connection.sent[0][@"transactionType"], @18);
+    XCTAssertEqualObjects(_connection.sent[0][@"ecrRefNum"], @"00000042");
+
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"18", @"12", @"00000042")];
+
+    XCTAssertFalse(_session.isOpen);
+    XCTAssertEqual(_session.pendingTransactions, 0);
+    XCTAssertEqual(_connection.sent.count, 1);
+    XCTAssertEqual(_recorder.responses.count, 3);
+    XCTAssertEqualObjects(_recorder.responses[0][@"Response Code"], @"12");
+    XCTAssertEqualObjects(_recorder.responses[1][@"requestError"], @"sessionRefused");
+    XCTAssertEqualObjects(_recorder.responses[1][@"ecrRefNum"], @"000000000001");
+    XCTAssertEqualObjects(_recorder.responses[2][@"ecrRefNum"], @"000000000002");
+}
+
+- (void)testTransactionsGoOutOneAtATime {
+
+    [_session submitTransaction:0 fields:@[@"1000", @"0"] ecrRefNum:@"000000000001" receiptFormat:SKBReceiptFormatText];
+    [_session purchase:2000 printReceipt:NO ecrRefNum:@"000000000002"];
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"18", @"00", @"00000042")];
+
+    XCTAssertTrue(_session.isOpen);
+    XCTAssertEqual(_connection.sent.count, 2);
+    XCTAssertEqualObjects(_connection.sent[1][@"ecrRefNum"], @"000000000001");
+    XCTAssertEqualObjects(_connection.sent[1][@"receiptFormat"], @(SKBReceiptFormatText));
+
+    // A reply to a transaction sent outside the session does not free it
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"0", @"000", @"REF12345")];
+    XCTAssertEqual(_connection.sent.count, 2);
+
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"0", @"000", @"000000000001")];
+    XCTAssertEqual(_connection.sent.count, 3);
+    XCTAssertEqualObjects(_connection.sent[2][@"ecrRefNum"], @"000000000002");
+    XCTAssertEqual(_recorder.responses.count, 3);
+}
+
+- (void)testCloseSendsEndSessionOnceDrained {
+
+    [_session purchase:1000 printReceipt:NO ecrRefNum:@"000000000001"];
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"18", @"00", @"00000042")];
+    [_session close];
+    XCTAssertEqual(_connection.sent.count, 2);
+
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"0", @"000", @"000000000001")];
+    XCTAssertEqual(_connection.sent.count, 3);
+    XCTAssertEqualObjects(_connection.sent[2][@"transactionType"], @19);
+
+    [_session socketConnectionStream:_connection didReceiveData:reply(@"19", @"00", @"00000042")];
+    XCTAssertFalse(_session.isOpen);
+    XCTAssertEqual(_connection.sent.count, 3);
+}
+
+@end
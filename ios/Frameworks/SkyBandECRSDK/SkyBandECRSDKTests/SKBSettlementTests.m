@@ -0,0 +1,120 @@
+//
+//  SKBSettlementTests.m
+//  SkyBandECRSDKTests
+//
+//  Reconciliation (B1) scheme totals decoded into columns.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRSettlement.h"
+
+// parse() output of a B1 reply: mada with all six host totals, VISA with one of each
+static const char *kReplyMadaVisa = "\x02;B1;500;APPROVED;010124120000;f5;f6;f7;f8;2;"
+    "mada;1;HOST;1;100;2;200;3;300;4;400;5;500;6;600;"
+    "VISA;1;HOST;1;10;1;10;1;10;1;10;1;10;1;10;x;y";
+static const char *kReplyVisa = "\x02;B1;500;APPROVED;010124120500;f5;f6;f7;f8;1;"
+    "VISA;1;HOST;2;20;2;20;2;20;2;20;2;20;2;20;x;y";
+
+@interface SKBSettlementTests : XCTestCase
+
+@end
+
+@implementation SKBSettlementTests
+
+- (void)testDecodeSchemeTotals {
+
+    ECR_SETTLEMENT_COLUMNS columns;
+    long long count = 0, amount = 0;
+    ecrSettlementInit(&columns);
+
+    XCTAssertEqual(ecrSettlementDecode(&columns, "T1", kReplyMadaVisa), 12);
+    XCTAssertEqual(columns.inSettlements, 1);
+    XCTAssertEqual(columns.inSchemes, 2);
+    XCTAssertEqual(strcmp(columns.pSettlements[0].szTerminalId, "T1"), 0);
+    XCTAssertEqual(strcmp(columns.pSettlements[0].szDateTime, "010124120000"), 0);
+
+    XCTAssertEqual(ecrSettlementSum(&columns, ECR_SOURCE_HOST, ECR_KIND_CADV, &count, &amount), 2);
+    XCTAssertEqual(count, 5);
+    XCTAssertEqual(amount, 410);
+    XCTAssertEqual(ecrSettlementSum(&columns, ECR_SETTLEMENT_ANY, ECR_SETTLEMENT_ANY, &count, &amount), 12);
+    XCTAssertEqual(count, 27);
+    XCTAssertEqual(amount, 2160);
+    XCTAssertEqual(ecrSettlementSum(&columns, ECR_SOURCE_POS, ECR_SETTLEMENT_ANY, &count, &amount), 0);
+    ecrSettlementFree(&columns);
+}
+
+- (void)testRejectsFailedReconciliation {
+
+    ECR_SETTLEMENT_COLUMNS columns;
+    ecrSettlementInit(&columns);
+
+    XCTAssertEqual(ecrSettlementDecode(&columns, "T1", "\x02;B1;400;DECLINED;010124120000;f5;f6;f7;f8;0"), -1);
+    XCTAssertEqual(ecrSettlementDecode(&columns, "T1", "\x02;B1;500"), -1);
+    XCTAssertEqual(columns.inRows, 0);
+    ecrSettlementFree(&columns);
+}
+
+- (void)testColumnarRoundTrip {
+
+    ECR_SETTLEMENT_COLUMNS written, read;
+    long long count = 0, amount = 0;
+    const char *path = [[NSTemporaryDirectory() stringByAppendingPathComponent:@"SKBSettlementTests.sbst"] fileSystemRepresentation];
+    ecrSettlementInit(&written);
+    ecrSettlementInit(&read);
+
+    XCTAssertEqual(ecrSettlementDecode(&written, "T1", kReplyMadaVisa), 12);
+    XCTAssertEqual(ecrSettlementWriteColumnar(&written, path), 0);
+    XCTAssertEqual(ecrSettlementReadColumnar(&read, path), 12);
+    XCTAssertEqual(read.inSettlements, 1);
+    XCTAssertEqual(read.inSchemes, 2);
+    for (int i = 0; i < written.inRows; i++) {
+        XCTAssertEqual(read.pllAmount[i], written.pllAmount[i]);
+        XCTAssertEqual(read.pulCount[i], written.pulCount[i]);
+        XCTAssertEqual(strcmp(read.pszSchemes[read.pusScheme[i]], written.pszSchemes[written.pusScheme[i]]), 0);
+        XCTAssertEqual(read.pucSource[i], written.pucSource[i]);
+        XCTAssertEqual(read.pucKind[i], written.pucKind[i]);
+    }
+    XCTAssertEqual(ecrSettlementSum(&read, ECR_SETTLEMENT_ANY, ECR_KIND_TOTAL, &count, &amount), 2);
+    XCTAssertEqual(count, 7);
+    XCTAssertEqual(amount, 610);
+    unlink(path);
+    ecrSettlementFree(&written);
+    ecrSettlementFree(&read);
+}
+
+// Terminals settled in parallel are decoded apart, then merged as SKBSettlementRun does
+- (void)testMergeTerminals {
+
+    ECR_SETTLEMENT_COLUMNS first, second, fleet, merged;
+    long long count = 0, amount = 0, mergedCount = 0, mergedAmount = 0;
+    ecrSettlementInit(&first);
+    ecrSettlementInit(&second);
+    ecrSettlementInit(&fleet);
+    ecrSettlementInit(&merged);
+
+    XCTAssertEqual(ecrSettlementDecode(&first, "T1", kReplyMadaVisa), 12);
+    XCTAssertEqual(ecrSettlementDecode(&second, "T2", kReplyVisa), 6);
+    XCTAssertEqual(ecrSettlementAppend(&fleet, &first), 12);
+    XCTAssertEqual(ecrSettlementAppend(&fleet, &second), 6);
+    XCTAssertEqual(fleet.inSettlements, 2);
+    XCTAssertEqual(fleet.inSchemes, 2);
+    XCTAssertEqual(strcmp(fleet.pSettlements[fleet.pulSettlement[fleet.inRows - 1]].szTerminalId, "T2"), 0);
+
+    XCTAssertEqual(ecrSettlementAggregate(&merged, &fleet, "fleet", "010124"), 12);
+    XCTAssertEqual(merged.inSettlements, 1);
+    XCTAssertEqual(ecrSettlementSum(&fleet, ECR_SETTLEMENT_ANY, ECR_SETTLEMENT_ANY, &count, &amount), 18);
+    XCTAssertEqual(ecrSettlementSum(&merged, ECR_SETTLEMENT_ANY, ECR_SETTLEMENT_ANY, &mergedCount, &mergedAmount), 12);
+    XCTAssertEqual(mergedCount, count);
+    XCTAssertEqual(mergedAmount, amount);
+    XCTAssertEqual(amount, 2280);
+    // VISA totals of both terminals end up in one row
+    XCTAssertEqual(ecrSettlementSum(&merged, ECR_SOURCE_HOST, ECR_KIND_DEBIT, &count, &amount), 2);
+    XCTAssertEqual(count, 4);
+    XCTAssertEqual(amount, 130);
+    ecrSettlementFree(&first);
+    ecrSettlementFree(&second);
+    ecrSettlementFree(&fleet);
+    ecrSettlementFree(&merged);
+}
+
+@end
@@ -0,0 +1,108 @@
+//
+//  SKBSha256Tests.m
+//  SkyBandECRSDKTests
+//
+//  SHA-256 known answers on every block function this build and CPU can run, and
+//  request signatures.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRSha256.h"
+
+typedef struct {
+    int length;                 // Of 'a' repeated
+    const char *digest;
+} SKBSha256Vector;
+
+// Lengths either side of where padding spills into a second block and of block ends
+static const SKBSha256Vector kVectors[] = {
+    { 0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { 1, "ca978112ca1bbdcafac231b39a23dc4da786eff8147c4e72b9807785afee48bb" },
+    { 55, "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318" },
+    { 56, "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a" },
+    { 63, "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34" },
+    { 64, "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb" },
+    { 65, "635361c48bb9eab14198e76ea8ab7f1a41685d6ad62aa9146d301d4f17eb0ae0" },
+    { 119, "31eba51c313a5c08226adf18d4a359cfdfd8d2e816b13f4af952f7ea6584dcfb" },
+    { 120, "2f3d335432c70b580af0e8e1b3674a7c020d683aa5f73aaaedfdc55af904c21c" },
+    { 127, "c57e9278af78fa3cab38667bef4ce29d783787a2f731d4e12200270f0c32320a" },
+    { 128, "6836cf13bac400e9105071cd6af47084dfacad4e5e302c94bfed24e013afb73e" },
+    { 129, "c12cb024a2e5551cca0e08fce8f1c5e314555cc3fef6329ee994a3db752166ae" }
+};
+
+static const char *kBackends[] = { "portable", "sha-ni", "armv8" };
+
+// Lower case hex of data hashed in pieces of chunk bytes (0 for one update)
+static NSString *sha256Hex(const char *data, size_t length, size_t chunk) {
+
+    SHA256_CTX ctx;
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char hex[SHA256_HEX_SIZE];
+    sha256Init(&ctx);
+    if (chunk == 0) {
+        sha256Update(&ctx, data, length);
+    }
+    else {
+        for (size_t offset = 0; offset < length; offset += chunk) {
+            sha256Update(&ctx, data + offset, MIN(chunk, length - offset));
+        }
+    }
+    sha256Final(&ctx, digest);
+    sha256ToHex(digest, hex);
+    return [[NSString alloc]initWithBytes:hex length:SHA256_HEX_SIZE encoding:NSASCIIStringEncoding];
+}
+
+@interface SKBSha256Tests : XCTestCase
+
+@end
+
+@implementation SKBSha256Tests
+
+- (void)tearDown {
+
+    sha256SelectBackend(NULL);
+}
+
+- (void)testKnownAnswersOnEveryBackend {
+
+    char data[130];
+    memset(data, 'a', sizeof(data));
+    int backends = 0;
+    for (int i = 0; i < 3; i++) {
+        if (sha256SelectBackend(kBackends[i]) != 0) {
+            continue;
+        }
+        backends++;
+        XCTAssertEqual(strcmp(sha256Backend(), kBackends[i]), 0);
+        for (size_t v = 0; v < sizeof(kVectors) / sizeof(kVectors[0]); v++) {
+            NSString *expected = @(kVectors[v].digest);
+            XCTAssertEqualObjects(sha256Hex(data, kVectors[v].length, 0), expected, @"%s, %d bytes", kBackends[i], kVectors[v].length);
+            XCTAssertEqualObjects(sha256Hex(data, kVectors[v].length, 1), expected, @"%s, %d bytes a byte at a time", kBackends[i], kVectors[v].length);
+            XCTAssertEqualObjects(sha256Hex(data, kVectors[v].length, 63), expected, @"%s, %d bytes in 63 byte pieces", kBackends[i], kVectors[v].length);
+        }
+        XCTAssertEqualObjects(sha256Hex("abc", 3, 0), @"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        XCTAssertEqualObjects(sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, 0), @"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    }
+    XCTAssertGreaterThanOrEqual(backends, 1);
+    XCTAssertEqual(sha256SelectBackend("none"), -1);
+}
+
+- (void)testSignatureIsReferenceThenTerminalId {
+
+    char signature[SHA256_HEX_SIZE + 1] = { 0 };
+    sha256Signature("000000000001", "1234567890123456", signature);
+    XCTAssertEqual(strcmp(signature, "eb2b1e37e3bed5d6890765c5f63dab47d3ea5d42f554ff50d7b9aac536f4cf1c"), 0);
+}
+
+- (void)testBatchSignsEveryTerminal {
+
+    const char *terminalIds[] = { "1234567890123456", "6543210987654321", "1234567890123456" };
+    char signatures[3 * SHA256_HEX_SIZE + 1] = { 0 };
+    sha256SignatureBatch("000000000001", terminalIds, 3, signatures);
+
+    XCTAssertEqual(memcmp(&signatures[0], "eb2b1e37e3bed5d6890765c5f63dab47d3ea5d42f554ff50d7b9aac536f4cf1c", SHA256_HEX_SIZE), 0);
+    XCTAssertEqual(memcmp(&signatures[SHA256_HEX_SIZE], "070cc0bdf84a095d9565409dbd2ddd9f76875daf7a5824c3f78461a2fac91751", SHA256_HEX_SIZE), 0);
+    XCTAssertEqual(memcmp(&signatures[2 * SHA256_HEX_SIZE], &signatures[0], SHA256_HEX_SIZE), 0);
+}
+
+@end
@@ -0,0 +1,107 @@
+//
+//  SKBTextReceiptTests.m
+//  SkyBandECRSDKTests
+//
+//  Plain text and ESC/POS card receipts.
+//
+
+#import <XCTest/XCTest.h>
+#include "ECRSrc.h"
+#include "ECRTextReceipt.h"
+
+static const unsigned char kEscPosSetup[] = { 0x1B, 0x40, 0x1B, 0x74, ECR_ESCPOS_CODEPAGE_WPC1256 };
+static const unsigned char kEscPosCut[] = { 0x1B, 0x64, 0x03, 0x1D, 0x56, 0x42, 0x00 };
+
+// The widest line in characters; none of the test fields has combining marks
+static int widestLine(const unsigned char *text, int length) {
+
+    int widest = 0, width = 0;
+    for (int i = 0; i < length; i++) {
+        if (text[i] == '\n') {
+            widest = MAX(widest, width);
+            width = 0;
+        }
+        else if ((text[i] & 0xC0) != 0x80) {
+            width++;
+        }
+    }
+    return MAX(widest, width);
+}
+
+static BOOL containsText(const unsigned char *text, int length, const char *value) {
+
+    int valueLength = (int)strlen(value);
+    for (int i = 0; i + valueLength <= length; i++) {
+        if (memcmp(text + i, value, valueLength) == 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@interface SKBTextReceiptTests : XCTestCase {
+    const char *_fields[ECR_TEXT_FIELDS];
+    unsigned char _output[ECR_TEXT_RECEIPT_BUFFER_SIZE];
+}
+
+@end
+
+@implementation SKBTextReceiptTests
+
+- (void)setUp {
+
+    memset(_fields, 0, sizeof(_fields));
+    _fields[ECR_TEXT_FIELD_MERCHANT_NAME] = "SKYBAND TEST MERCHANT";
+    _fields[ECR_TEXT_FIELD_MERCHANT_ADDRESS] = "KING KHALID ROAD, BURAIDAH, QASSIM REGION, KINGDOM OF SAUDI ARABIA";
+    _fields[ECR_TEXT_FIELD_MERCHANT_NAME_AR] = "\xD9\x85\xD8\xAA\xD8\xAC\xD8\xB1";
+    _fields[ECR_TEXT_FIELD_DATE] = "19/10/2026";
+    _fields[ECR_TEXT_FIELD_TIME] = "10:42:07";
+    _fields[ECR_TEXT_FIELD_MID] = "600000000012";
+    _fields[ECR_TEXT_FIELD_TID] = "1234567890123456";
+    _fields[ECR_TEXT_FIELD_STAN] = "000123";
+    _fields[ECR_TEXT_FIELD_RRN] = "229112345678";
+    _fields[ECR_TEXT_FIELD_SCHEME] = "mada";
+    _fields[ECR_TEXT_FIELD_PAN] = "588845******1234";
+    _fields[ECR_TEXT_FIELD_EXPIRY] = "12/28";
+    _fields[ECR_TEXT_FIELD_AMOUNT] = "150.00";
+    _fields[ECR_TEXT_FIELD_RESULT] = "APPROVED";
+    _fields[ECR_TEXT_FIELD_AUTH_CODE] = "A1B2C3";
+    _fields[ECR_TEXT_FIELD_RESPONSE_CODE] = "000";
+}
+
+- (void)testTextLinesFitTheWidth {
+
+    int widths[] = { 32, ECR_TEXT_RECEIPT_WIDTH, ECR_TEXT_RECEIPT_WIDTH_MAX };
+    for (int i = 0; i < 3; i++) {
+        int length = ecrTextReceiptCard(TYPE_PURCHASE, _fields, ECR_RECEIPT_FORMAT_TEXT, widths[i], _output, sizeof(_output));
+        XCTAssertGreaterThan(length, 0);
+        XCTAssertLessThanOrEqual(widestLine(_output, length), widths[i]);
+        XCTAssertEqual(_output[length - 1], '\n');
+        XCTAssertTrue(containsText(_output, length, "SKYBAND TEST MERCHANT"));
+        XCTAssertTrue(containsText(_output, length, "150.00"));
+        XCTAssertTrue(containsText(_output, length, "APPROVED"));
+    }
+    // Too narrow a width is clamped
+    int length = ecrTextReceiptCard(TYPE_PURCHASE, _fields, ECR_RECEIPT_FORMAT_TEXT, 8, _output, sizeof(_output));
+    XCTAssertGreaterThan(length, 0);
+    XCTAssertLessThanOrEqual(widestLine(_output, length), ECR_TEXT_RECEIPT_WIDTH_MIN);
+}
+
+- (void)testEscPosSetsUpAndCuts {
+
+    int length = ecrTextReceiptCard(TYPE_PURCHASE, _fields, ECR_RECEIPT_FORMAT_ESCPOS, ECR_TEXT_RECEIPT_WIDTH, _output, sizeof(_output));
+
+    XCTAssertGreaterThan(length, (int)(sizeof(kEscPosSetup) + sizeof(kEscPosCut)));
+    XCTAssertEqual(memcmp(_output, kEscPosSetup, sizeof(kEscPosSetup)), 0);
+    XCTAssertEqual(memcmp(_output + length - sizeof(kEscPosCut), kEscPosCut, sizeof(kEscPosCut)), 0);
+    XCTAssertTrue(containsText(_output, length, "150.00"));
+}
+
+- (void)testRejectsOverflowAndOtherTypes {
+
+    XCTAssertEqual(ecrTextReceiptCard(TYPE_PURCHASE, _fields, ECR_RECEIPT_FORMAT_TEXT, ECR_TEXT_RECEIPT_WIDTH, _output, 200), -1);
+    XCTAssertEqual(ecrTextReceiptCard(TYPE_PURCHASE, _fields, ECR_RECEIPT_FORMAT_ESCPOS, ECR_TEXT_RECEIPT_WIDTH, _output, 200), -1);
+    XCTAssertEqual(ecrTextReceiptCard(TYPE_RECONCILATION, _fields, ECR_RECEIPT_FORMAT_TEXT, ECR_TEXT_RECEIPT_WIDTH, _output, sizeof(_output)), -1);
+}
+
+@end
@@ -1,4 +1,6 @@
 import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
 
 import 'package:flutter/services.dart';
 
@@ -18,11 +20,36 @@ class SkybandEcrPlugin {
       _deviceStatusController.stream;
 
   // Initialize the plugin
-  Future<void> initialize() async {
+  //
+  // With [compactResponses] the native side sends responses as a binary
+  // [EcrResponseRecord] and keeps the HTML receipt until [fetchReceipt].
+  //
+  // With [idempotentRetries] a card transaction resent with the same
+  // ecrRefNum is answered with the terminal's earlier reply, kept across
+  // restarts, or waits for the one still in flight; such responses carry
+  // 'idempotencyReplay' (cached or joined). An ecrRefNum reused for a
+  // different request fails the payment call and is not sent.
+  //
+  // With [adaptiveTimeouts] connect and transaction timeouts and reconnect
+  // delays follow each terminal's recent latencies; see [getTimeouts]. Card
+  // transactions keep the fixed 150 s timeout.
+  Future<void> initialize(
+      {bool compactResponses = false,
+      bool idempotentRetries = false,
+      bool adaptiveTimeouts = false}) async {
     try {
-      await _channel.invokeMethod('initEcr');
+      await _channel.invokeMethod('initEcr', {
+        'compactResponses': compactResponses,
+        'idempotentRetries': idempotentRetries,
+        'adaptiveTimeouts': adaptiveTimeouts,
+      });
       _eventChannel.receiveBroadcastStream().listen((event) {
-        _deviceStatusController.add(Map<String, dynamic>.from(event));
+        final status = Map<String, dynamic>.from(event);
+        final record = status.remove('responseRecord');
+        if (record is Uint8List) {
+          status['response'] = EcrResponseRecord.decode(record).toMap();
+        }
+        _deviceStatusController.add(status);
       });
     } catch (e) {
       throw Exception('Failed to initialize Skyband ECR: $e');
@@ -62,6 +89,20 @@ class SkybandEcrPlugin {
   }
 
   // Initiate payment
+  //
+  // With a [deadline] the terminal is given that long less 3 s (whole
+  // seconds) instead of the default, and if no reply comes in time the
+  // outcome is settled with Repeat (C2) or Check Status (C3) before the call
+  // completes. The response then carries 'deadlineOutcome': completed,
+  // resolved, notProcessed or unknown. Card transactions with a deadline need
+  // an [ecrRefNum] of 6 to 14 digits, and the deadline must be at least 4 s.
+  //
+  // Replies are matched to calls by [ecrRefNum], which the response carries
+  // as 'ecrRefNum', so give every call in flight its own reference. A request
+  // the terminal is never sent fails the call: INVALID_REQUEST for fields the
+  // frame cannot carry, INVALID_DEADLINE for the deadline rules above and
+  // NOT_INITIALIZED before [initialize]. A response goes to its call only;
+  // replies no call is waiting for arrive on deviceStatusStream as 'response'.
   Future<Map<String, dynamic>> initiatePayment({
     required String dateFormat,
     required double amount,
@@ -69,20 +110,259 @@ class SkybandEcrPlugin {
     required String ecrRefNum,
     required int transactionType,
     required bool signature,
+    EcrReceiptFormat receiptFormat = EcrReceiptFormat.html,
+    Duration? deadline,
   }) async {
     try {
-      final Map<dynamic, dynamic> result =
-          await _channel.invokeMethod('initiatePayment', {
-        'dateFormat': dateFormat,
-        'amount': amount,
-        'printReceipt': printReceipt,
+      final dynamic result = await _channel.invokeMethod(
+          'initiatePayment',
+          _paymentArguments(dateFormat, amount, printReceipt, ecrRefNum,
+              transactionType, signature, receiptFormat, deadline));
+      if (result is Uint8List) {
+        return EcrResponseRecord.decode(result).toMap();
+      }
+      return Map<String, dynamic>.from(result);
+    } catch (e) {
+      throw Exception('Failed to initiate payment: $e');
+    }
+  }
+
+  // Initiate payment and return the compact record without building a map.
+  // Requires initialize(compactResponses: true).
+  Future<EcrResponseRecord> initiatePaymentRecord({
+    required String dateFormat,
+    required double amount,
+    required bool printReceipt,
+    required String ecrRefNum,
+    required int transactionType,
+    required bool signature,
+    EcrReceiptFormat receiptFormat = EcrReceiptFormat.html,
+    Duration? deadline,
+  }) async {
+    try {
+      final Uint8List? result = await _channel.invokeMethod<Uint8List>(
+          'initiatePayment',
+          _paymentArguments(dateFormat, amount, printReceipt, ecrRefNum,
+              transactionType, signature, receiptFormat, deadline));
+      return EcrResponseRecord.decode(result!);
+    } catch (e) {
+      throw Exception('Failed to initiate payment: $e');
+    }
+  }
+
+  // Arguments of the native initiatePayment call
+  Map<String, dynamic> _paymentArguments(
+      String dateFormat,
+      double amount,
+      bool printReceipt,
+      String ecrRefNum,
+      int transactionType,
+      bool signature,
+      EcrReceiptFormat receiptFormat,
+      Duration? deadline) {
+    return {
+      'dateFormat': dateFormat,
+      'amount': amount,
+      'printReceipt': printReceipt,
+      'ecrRefNum': ecrRefNum,
+      'transactionType': transactionType,
+      'signature': signature,
+      'receiptFormat': receiptFormat.index,
+      'deadlineSeconds':
+          deadline == null ? null : deadline.inMilliseconds / 1000,
+    };
+  }
+
+  // Send the payments that follow inside one Start Session (B6) / End Session
+  // (B7) with [cashRegisterNumber]. B6 goes out before the first payment,
+  // payments go one at a time, and B7 follows [endSession] or [idleTimeout]
+  // without traffic; the next payment starts a new session. Payments with a
+  // deadline are sent outside the session. Inside it the frame's date and
+  // signature are filled in natively, so dateFormat and signature are not
+  // used. If the terminal refuses B6, the payments waiting on it fail with
+  // SESSION_REFUSED without being sent. B6 and B7 replies arrive on
+  // deviceStatusStream. Fails with SESSION_ACTIVE while an earlier session is
+  // still open. Needs [initialize] first.
+  Future<bool> startSession(String cashRegisterNumber,
+      {Duration idleTimeout = const Duration(minutes: 5)}) async {
+    try {
+      final bool? started =
+          await _channel.invokeMethod<bool>('startSession', {
+        'cashRegisterNumber': cashRegisterNumber,
+        'idleTimeoutSeconds': idleTimeout.inMilliseconds / 1000,
+      });
+      return started ?? false;
+    } catch (e) {
+      throw Exception('Failed to start session: $e');
+    }
+  }
+
+  // Send End Session (B7) once the payments already submitted are answered.
+  Future<void> endSession() async {
+    try {
+      await _channel.invokeMethod('endSession');
+    } catch (e) {
+      throw Exception('Failed to end session: $e');
+    }
+  }
+
+  // Get the latest health probe result of the connected terminal.
+  // Readiness is one of unknown, ready, degraded or unreachable; updates are
+  // also pushed on deviceStatusStream under the 'health' key.
+  Future<Map<String, dynamic>> getTerminalHealth() async {
+    try {
+      final Map<dynamic, dynamic> health =
+          await _channel.invokeMethod('getTerminalHealth');
+      return Map<String, dynamic>.from(health);
+    } catch (e) {
+      throw Exception('Failed to get terminal health: $e');
+    }
+  }
+
+  // Get the timeouts in seconds the connected terminal gets next: 'connect'
+  // and each of 'transactions' by type hold timeout, samples, p50Ms and p95Ms;
+  // 'reconnectInterval' is the delay before jitter.
+  Future<Map<String, dynamic>> getTimeouts() async {
+    try {
+      final Map<dynamic, dynamic> timeouts =
+          await _channel.invokeMethod('getTimeouts');
+      return Map<String, dynamic>.from(timeouts);
+    } catch (e) {
+      throw Exception('Failed to get timeouts: $e');
+    }
+  }
+
+  // Fetch the HTML or text receipt of the last compact response, if it had one.
+  Future<String?> fetchReceipt() async {
+    try {
+      final dynamic receipt = await _channel.invokeMethod('fetchReceipt');
+      return receipt is String ? receipt : null;
+    } catch (e) {
+      throw Exception('Failed to fetch receipt: $e');
+    }
+  }
+
+  // Fetch the ESC/POS receipt of the last compact response, if it had one.
+  Future<Uint8List?> fetchReceiptBytes() async {
+    try {
+      final dynamic receipt = await _channel.invokeMethod('fetchReceipt');
+      return receipt is Uint8List ? receipt : null;
+    } catch (e) {
+      throw Exception('Failed to fetch receipt: $e');
+    }
+  }
+
+  // Write the scheme totals of the reconciliations (B1) received so far to
+  // [path], as 'csv' or 'columnar' (binary, see ECRSettlement.h). Returns the
+  // number of rows written; [clear] starts a fresh set afterwards.
+  Future<int> exportSettlementTotals(String path,
+      {String format = 'csv', bool clear = false}) async {
+    try {
+      final int? rows = await _channel.invokeMethod<int>(
+          'exportSettlementTotals', {
+        'path': path,
+        'format': format,
+        'clear': clear,
+      });
+      return rows ?? 0;
+    } catch (e) {
+      throw Exception('Failed to export settlement totals: $e');
+    }
+  }
+
+  // Stream the Print Summary Report (C1) row by row. The native side requests
+  // the report page by page and pushes each page as soon as it is decoded, so
+  // rows arrive while later pages are still on their way and the report is
+  // never held in full. Rows carry transactionType, date, rrn, amount, state,
+  // time, pan, authCode and transactionNumber. Needs [initialize] first.
+  Stream<Map<String, String>> summaryReportRows(String ecrRefNum) {
+    final controller = StreamController<Map<String, String>>();
+    StreamSubscription<Map<String, dynamic>>? pages;
+    controller.onListen = () {
+      pages = deviceStatusStream.listen((event) {
+        final rows = event['reportRows'];
+        if (rows is List) {
+          for (final row in rows) {
+            controller.add(Map<String, String>.from(row));
+          }
+        }
+      });
+      _channel
+          .invokeMethod('streamSummaryReport', {'ecrRefNum': ecrRefNum})
+          .catchError((e) {
+        controller.addError(Exception('Failed to stream summary report: $e'));
+      }).whenComplete(() {
+        pages?.cancel();
+        controller.close();
+      });
+    };
+    controller.onCancel = () => pages?.cancel();
+    return controller.stream;
+  }
+
+  // Reconcile (B1) every terminal in [terminals] ('ip:port') in parallel, at
+  // most [maxConcurrent] at a time, retrying failed connects up to
+  // [maxAttempts] per terminal. A terminal that got B1 but never answered is
+  // not retried and is marked 'unresolved'. The result holds 'terminals',
+  // 'succeeded', 'failed' (one map per failed terminal with its error) and
+  // 'totals', the scheme totals summed over the fleet. [exportPath] also
+  // writes the merged rows as 'csv' or 'columnar', summed into one settlement
+  // with [aggregate]. Progress arrives on [settlementProgress]. Needs
+  // [initialize] first.
+  Future<Map<String, dynamic>> settleTerminals(
+    List<String> terminals,
+    String ecrRefNum, {
+    int maxConcurrent = 16,
+    int maxAttempts = 3,
+    bool printReceipt = false,
+    Map<String, String>? terminalIds,
+    String? exportPath,
+    String format = 'csv',
+    bool aggregate = false,
+  }) async {
+    try {
+      final result = await _channel.invokeMethod('settleTerminals', {
+        'terminals': terminals,
         'ecrRefNum': ecrRefNum,
-        'transactionType': transactionType,
-        'signature': signature,
+        'maxConcurrent': maxConcurrent,
+        'maxAttempts': maxAttempts,
+        'printReceipt': printReceipt,
+        'terminalIds': terminalIds,
+        'exportPath': exportPath,
+        'format': format,
+        'aggregate': aggregate,
       });
       return Map<String, dynamic>.from(result);
     } catch (e) {
-      throw Exception('Failed to initiate payment: $e');
+      throw Exception('Failed to settle terminals: $e');
+    }
+  }
+
+  // One event per terminal of a running [settleTerminals]: 'completed',
+  // 'total' and the terminal's 'result'.
+  Stream<Map<String, dynamic>> get settlementProgress => deviceStatusStream
+      .where((event) => event['settlementProgress'] is Map)
+      .map((event) => Map<String, dynamic>.from(event['settlementProgress']));
+
+  // Record every frame exchanged with the terminal to the capture file at
+  // [path] (see CoreECR/ECRCapture.h), appending to an existing capture.
+  // Replay captures with tool/ecr_replay.c.
+  Future<bool> startCapture(String path) async {
+    try {
+      final bool? started =
+          await _channel.invokeMethod<bool>('startCapture', {'path': path});
+      return started ?? false;
+    } catch (e) {
+      throw Exception('Failed to start capture: $e');
+    }
+  }
+
+  // Stop recording and close the capture file.
+  Future<void> stopCapture() async {
+    try {
+      await _channel.invokeMethod('stopCapture');
+    } catch (e) {
+      throw Exception('Failed to stop capture: $e');
     }
   }
 
@@ -121,3 +401,183 @@ class SkybandEcrPlugin {
     }
   }
 }
+
+/// Format of the 'receiptFormat' value of card transactions. Reports are
+/// always HTML.
+enum EcrReceiptFormat {
+  /// HTML document, as a String.
+  html,
+
+  /// Fixed width UTF-8 lines, as a String.
+  text,
+
+  /// ESC/POS printer commands, as a Uint8List (see CoreECR/ECRTextReceipt.h).
+  escPos,
+}
+
+/// Decoded view over the compact binary response record produced by the
+/// native core (see CoreECR/ECRRecord.h for the layout).
+///
+/// Decoding only indexes field offsets; values are read from the original
+/// bytes on access.
+class EcrResponseRecord {
+  static const int version = 1;
+  static const int headerSize = 8;
+  static const int flagReceipt = 0x01;
+  static const int kindString = 0;
+  static const int kindAmount = 1;
+
+  /// Response keys by field id, matching ECR_RECORD_FIELD.
+  static const List<String?> fieldNames = [
+    null,
+    'Transaction type',
+    'Response Code',
+    'Response Message',
+    'responseMessage',
+    'PAN Number',
+    'panNo',
+    'Transaction Amount',
+    'Cash Back Amount',
+    'Total Amount',
+    'Buss Code',
+    'Stan No',
+    'Date & Time ',
+    'Date & Time',
+    'Date Time Stamp',
+    'Card Exp Date',
+    'RRN',
+    'Auth Code',
+    'TID',
+    'MID',
+    'Batch No',
+    'AID',
+    'Application Cryptogram',
+    'CID',
+    'CVR',
+    'TVR',
+    'TSI',
+    'KERNEL-ID',
+    'PAR',
+    'PANSUFFIX',
+    'Card Entry Mode',
+    'Merchant Category Code',
+    'Terminal Transaction Type',
+    'Scheme Label',
+    'Product Info',
+    'Application Version',
+    'Disclaimer',
+    'Merchant Name',
+    'Merchant Address',
+    'MerchantName_Arebic',
+    'MerchantAddress_Arebic',
+    'ECR Transaction Reference Number',
+    'Signature',
+    'Terminal id',
+    'Vendor ID',
+    'Vendor Terminal type',
+    'TRSM ID',
+    'Vendor Key Index',
+    'SAMA Key Index',
+    'VendorID',
+    'VendorTerminaltype',
+    'TRSMID',
+    'VendorKeyIndex',
+    'SAMAKeyIndex',
+    'POSTransactionReferenceNumber',
+    'Trace Number',
+    'Merchant id',
+    'Total Scheme Length',
+    'Schemes',
+    'deadlineOutcome',
+    'resolvedBy',
+    'Check Status Response Code',
+    'idempotencyReplay',
+    'ecrRefNum',
+    'requestError',
+  ];
+
+  final Uint8List _bytes;
+  final ByteData _data;
+  final Map<int, int> _offsets;
+
+  /// Transaction type the response belongs to.
+  final int transactionType;
+
+  /// Whether a receipt can be fetched with `fetchReceipt` or `fetchReceiptBytes`.
+  final bool hasReceipt;
+
+  EcrResponseRecord._(this._bytes, this._data, this._offsets,
+      this.transactionType, this.hasReceipt);
+
+  factory EcrResponseRecord.decode(Uint8List bytes) {
+    final data = ByteData.sublistView(bytes);
+    if (bytes.length < headerSize ||
+        bytes[0] != 0x53 ||
+        bytes[1] != 0x42 ||
+        bytes[2] != version) {
+      throw const FormatException('Not a compact ECR response record');
+    }
+    final flags = bytes[3];
+    final transactionType = data.getUint16(4, Endian.little);
+    final count = data.getUint16(6, Endian.little);
+    final offsets = <int, int>{};
+    var offset = headerSize;
+    for (var i = 0; i < count; i++) {
+      if (offset + 4 > bytes.length) {
+        throw const FormatException('Truncated compact ECR response record');
+      }
+      offsets[bytes[offset]] = offset;
+      final size = bytes[offset + 1] == kindAmount
+          ? 10
+          : 4 + data.getUint16(offset + 2, Endian.little);
+      offset += size;
+      if (offset > bytes.length) {
+        throw const FormatException('Truncated compact ECR response record');
+      }
+    }
+    return EcrResponseRecord._(bytes, data, offsets, transactionType,
+        (flags & flagReceipt) != 0);
+  }
+
+  /// Field ids present in the record.
+  Iterable<int> get fieldIds => _offsets.keys;
+
+  /// String value of [fieldId]; amounts are returned as their digit string.
+  String? string(int fieldId) {
+    final offset = _offsets[fieldId];
+    if (offset == null) {
+      return null;
+    }
+    if (_bytes[offset + 1] == kindAmount) {
+      return _data.getInt64(offset + 2, Endian.little).toString();
+    }
+    final length = _data.getUint16(offset + 2, Endian.little);
+    return utf8.decode(
+        Uint8List.sublistView(_bytes, offset + 4, offset + 4 + length));
+  }
+
+  /// Amount of [fieldId] in minor units, or null if absent or not numeric.
+  int? amount(int fieldId) {
+    final offset = _offsets[fieldId];
+    if (offset == null || _bytes[offset + 1] != kindAmount) {
+      return null;
+    }
+    return _data.getInt64(offset + 2, Endian.little);
+  }
+
+  /// Same keys the dictionary response used to carry, with string values.
+  ///
+  /// Amounts differ: they come back as plain digits without the zero padding
+  /// of the dictionary response ('1050', not '000000001050'). Parse them as
+  /// integers rather than comparing the strings.
+  Map<String, dynamic> toMap() {
+    final map = <String, dynamic>{};
+    for (final id in _offsets.keys) {
+      final name = id < fieldNames.length ? fieldNames[id] : null;
+      if (name != null) {
+        map[name] = string(id);
+      }
+    }
+    return map;
+  }
+}
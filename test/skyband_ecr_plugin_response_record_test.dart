@@ -0,0 +1,126 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:skyband_ecr_plugin/skyband_ecr_plugin.dart';
+
+// Mirrors ecrRecordPutString / ecrRecordPutAmount in CoreECR/ECRRecord.c.
+Uint8List encodeRecord(int transactionType, Map<int, Object> fields,
+    {bool receipt = false}) {
+  final builder = BytesBuilder();
+  final header = ByteData(8)
+    ..setUint8(0, 0x53)
+    ..setUint8(1, 0x42)
+    ..setUint8(2, 1)
+    ..setUint8(3, receipt ? 1 : 0)
+    ..setUint16(4, transactionType, Endian.little)
+    ..setUint16(6, fields.length, Endian.little);
+  builder.add(header.buffer.asUint8List());
+  fields.forEach((id, value) {
+    if (value is int) {
+      final entry = ByteData(10)
+        ..setUint8(0, id)
+        ..setUint8(1, 1)
+        ..setInt64(2, value, Endian.little);
+      builder.add(entry.buffer.asUint8List());
+    } else {
+      final bytes = utf8.encode(value as String);
+      final entry = ByteData(4)
+        ..setUint8(0, id)
+        ..setUint8(1, 0)
+        ..setUint16(2, bytes.length, Endian.little);
+      builder.add(entry.buffer.asUint8List());
+      builder.add(bytes);
+    }
+  });
+  return builder.toBytes();
+}
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  const MethodChannel channel = MethodChannel('skyband_ecr_plugin');
+  final record = encodeRecord(
+    0,
+    {
+      1: '0',
+      2: '000',
+      3: 'APPROVED',
+      7: 1050,
+      18: '12345678',
+      39: 'متجر',
+    },
+    receipt: true,
+  );
+
+  setUp(() {
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(
+      channel,
+      (MethodCall methodCall) async {
+        switch (methodCall.method) {
+          case 'initiatePayment':
+            return record;
+          case 'fetchReceipt':
+            return '<html></html>';
+        }
+        return null;
+      },
+    );
+  });
+
+  tearDown(() {
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+        .setMockMethodCallHandler(channel, null);
+  });
+
+  test('decode reads header and fields', () {
+    final decoded = EcrResponseRecord.decode(record);
+    expect(decoded.transactionType, 0);
+    expect(decoded.hasReceipt, isTrue);
+    expect(decoded.string(3), 'APPROVED');
+    expect(decoded.amount(7), 1050);
+    expect(decoded.string(39), 'متجر');
+    expect(decoded.string(40), isNull);
+  });
+
+  test('decode rejects foreign bytes', () {
+    expect(() => EcrResponseRecord.decode(Uint8List.fromList([1, 2, 3])),
+        throwsFormatException);
+    expect(() => EcrResponseRecord.decode(record.sublist(0, record.length - 1)),
+        throwsFormatException);
+    // Field header cut after its id and kind, before the length
+    final cut = encodeRecord(0, {3: 'APPROVED'});
+    expect(() => EcrResponseRecord.decode(cut.sublist(0, 10)),
+        throwsFormatException);
+  });
+
+  test('initiatePayment maps a compact record to the response keys', () async {
+    final result = await SkybandEcrPlugin().initiatePayment(
+      dateFormat: '101912000000',
+      amount: 10.50,
+      printReceipt: true,
+      ecrRefNum: 'REF123',
+      transactionType: 0,
+      signature: true,
+    );
+    expect(result['Response Message'], 'APPROVED');
+    expect(result['Transaction Amount'], '1050');
+    expect(result['TID'], '12345678');
+  });
+
+  test('initiatePaymentRecord and fetchReceipt', () async {
+    final plugin = SkybandEcrPlugin();
+    final result = await plugin.initiatePaymentRecord(
+      dateFormat: '101912000000',
+      amount: 10.50,
+      printReceipt: true,
+      ecrRefNum: 'REF123',
+      transactionType: 0,
+      signature: true,
+    );
+    expect(result.amount(7), 1050);
+    expect(await plugin.fetchReceipt(), '<html></html>');
+  });
+}
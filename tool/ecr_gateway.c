@@ -0,0 +1,888 @@
+/*
+ * ecr_gateway.c
+ *
+ *  Headless gateway that owns the terminal connections of a site. Clients on
+ *  the same host send transactions over a Unix socket or loopback TCP (protocol
+ *  in tool/ecr_gateway.h); the gateway packs them with pack(), queues them per
+ *  terminal, sends them one at a time on each terminal connection and returns
+ *  the reply after parse().
+ *
+ *  Build from the repository root on Linux:
+ *    cc -O2 -std=c11 -I ios/Frameworks/SkyBandECRSDK/CoreECR -o ecr_gateway tool/ecr_gateway.c \
+ *       ios/Frameworks/SkyBandECRSDK/CoreECR/{SBCoreECR,ECRSrc,Utilities,ECRCapture}.c
+ *
+ *  Usage:
+ *    ecr_gateway [-u socket path] [-p port] [-T timeout seconds] [-v] -t NAME=address:port...
+ *
+ *  Terminals are kept connected and reconnected with backoff. A request whose
+ *  connection drops after it was sent fails with ECR_GW_TERMINAL_DOWN and is not
+ *  sent again, since the terminal may have carried it out; requests still queued
+ *  for a terminal that stays down fail once they are older than the timeout.
+ *  Requests of a client that disconnects are dropped unsent. pack() reports on
+ *  stdout, which is discarded unless -v is given. tool/ecr_gateway_load.c runs
+ *  the gateway against local stand-in terminals.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "SBCoreECR.h"
+#include "ECRSrc.h"
+#include "ECRCapture.h"
+#include "ecr_gateway.h"
+
+#define GW_MAX_TERMINALS				64
+#define GW_MAX_CLIENTS					1000
+#define GW_QUEUE_SIZE					64		// Requests waiting per terminal
+#define GW_NAME_SIZE					32
+#define GW_REQUEST_FIELDS				10		// pack() parses into ten fields
+#define GW_REQUEST_SIZE					256
+#define GW_PACKET_SIZE					600		// As SKBCoreServices packs into
+#define GW_CLIENT_INPUT_SIZE			1024	// Longer messages close the client
+#define GW_CLIENT_OUTPUT_MAX			(1 << 20)	// A client this far behind is closed
+#define GW_STATUS_SIZE					(ECR_GW_RESULT_SIZE + GW_MAX_TERMINALS * (GW_NAME_SIZE + 12))
+#define GW_TIMEOUT_MS					150000	// As the SDK's transaction timer
+#define GW_CONNECT_TIMEOUT_MS			10000
+#define GW_BACKOFF_MIN_MS				1000
+#define GW_BACKOFF_MAX_MS				30000
+#define GW_TICK_MS						1000
+
+typedef struct
+{
+	int inClient;
+	unsigned long ulGeneration;			// Of the client when it sent the request
+	unsigned long ulTag;
+	long long llQueuedMs;
+	int inLength;
+	unsigned char aucPacket[GW_PACKET_SIZE];
+} GW_REQUEST;
+
+typedef struct
+{
+	char szName[GW_NAME_SIZE];
+	struct sockaddr_in address;
+	int fd;
+	int inState;
+	long long llDeadlineMs;				// Connecting or busy
+	long long llRetryMs;				// Down
+	int inBackoffMs;
+	GW_REQUEST aQueue[GW_QUEUE_SIZE];
+	int inHead;
+	int inQueued;
+	GW_REQUEST current;					// Busy
+	ECR_REASSEMBLER reassembler;
+	unsigned long ulDelivered;
+	unsigned long ulFailures;
+} GW_TERMINAL;
+
+typedef struct
+{
+	int fd;								// -1 when the slot is free
+	unsigned long ulGeneration;
+	unsigned char aucInput[GW_CLIENT_INPUT_SIZE];
+	int inInput;
+	unsigned char *pucOutput;
+	size_t ulOutput;
+	size_t ulOutputCapacity;
+} GW_CLIENT;
+
+typedef struct
+{
+	GW_TERMINAL aTerminals[GW_MAX_TERMINALS];
+	int inTerminals;
+	GW_CLIENT aClients[GW_MAX_CLIENTS];
+	unsigned long ulGenerations;
+	int fdUnix;
+	int fdTcp;
+	const char *pszUnixPath;
+	int inTimeoutMs;
+	int inVerbose;
+} GATEWAY;
+
+static GATEWAY gateway;
+static volatile sig_atomic_t inStop = 0;
+
+static long long llNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void vdLog(const char *pszFormat, ...)
+{
+	va_list args;
+
+	fputs("ecr_gateway: ", stderr);
+	va_start(args, pszFormat);
+	vfprintf(stderr, pszFormat, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+static void vdStop(int inSignal)
+{
+	(void)inSignal;
+	inStop = 1;
+}
+
+static int inNonBlocking(int fd)
+{
+	int inFlags = fcntl(fd, F_GETFL, 0);
+
+	return inFlags < 0 ? -1 : fcntl(fd, F_SETFL, inFlags | O_NONBLOCK);
+}
+
+static void vdNoDelay(int fd)
+{
+	int inOn = 1;
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &inOn, sizeof(inOn));
+}
+
+//MARK: - Clients -
+
+static void vdClientClose(GW_CLIENT *pClient)
+{
+	close(pClient->fd);
+	pClient->fd = -1;
+	pClient->inInput = 0;
+	free(pClient->pucOutput);
+	pClient->pucOutput = NULL;
+	pClient->ulOutput = 0;
+	pClient->ulOutputCapacity = 0;
+}
+
+static void vdClientFlush(GW_CLIENT *pClient)
+{
+	ssize_t lnSent = 0;
+
+	while(pClient->ulOutput > 0)
+	{
+		lnSent = send(pClient->fd, pClient->pucOutput, pClient->ulOutput, MSG_NOSIGNAL);
+		if(lnSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return;
+		if(lnSent <= 0)
+		{
+			vdClientClose(pClient);
+			return;
+		}
+		pClient->ulOutput -= (size_t)lnSent;
+		memmove(pClient->pucOutput, pClient->pucOutput + lnSent, pClient->ulOutput);
+	}
+}
+
+static void vdClientSend(GW_CLIENT *pClient, int inType, const unsigned char *pucBody, int inLength)
+{
+	unsigned char *pucOutput = NULL;
+	size_t ulNeeded = pClient->ulOutput + ECR_GW_HEADER_SIZE + (size_t)inLength;
+	size_t ulCapacity = pClient->ulOutputCapacity ? pClient->ulOutputCapacity : 4096;
+
+	if(ulNeeded > GW_CLIENT_OUTPUT_MAX)
+	{
+		vdLog("client not reading, closed");
+		vdClientClose(pClient);
+		return;
+	}
+	if(ulNeeded > pClient->ulOutputCapacity)
+	{
+		while(ulCapacity < ulNeeded)
+			ulCapacity *= 2;
+		pucOutput = realloc(pClient->pucOutput, ulCapacity);
+		if(pucOutput == NULL)
+		{
+			vdClientClose(pClient);
+			return;
+		}
+		pClient->pucOutput = pucOutput;
+		pClient->ulOutputCapacity = ulCapacity;
+	}
+	pucOutput = pClient->pucOutput + pClient->ulOutput;
+	ECR_GW_PUT16(pucOutput, inLength);
+	pucOutput[2] = (unsigned char)inType;
+	pucOutput[3] = 0;
+	memcpy(pucOutput + ECR_GW_HEADER_SIZE, pucBody, (size_t)inLength);
+	pClient->ulOutput = ulNeeded;
+	vdClientFlush(pClient);
+}
+
+static GW_CLIENT *pRequestClient(const GW_REQUEST *pRequest)
+{
+	GW_CLIENT *pClient = &gateway.aClients[pRequest->inClient];
+
+	return (pClient->fd >= 0 && pClient->ulGeneration == pRequest->ulGeneration) ? pClient : NULL;
+}
+
+static void vdReply(const GW_REQUEST *pRequest, int inStatus, const char *pszResponse, int inLength)
+{
+	unsigned char aucBody[ECR_GW_RESULT_SIZE + ECR_CAPTURE_FRAME_MAX];
+	GW_CLIENT *pClient = pRequestClient(pRequest);
+
+	if(pClient == NULL)
+		return;
+	ECR_GW_PUT32(aucBody, pRequest->ulTag);
+	aucBody[4] = (unsigned char)inStatus;
+	aucBody[5] = 0;
+	ECR_GW_PUT16(aucBody + 6, inLength);
+	if(inLength > 0)
+		memcpy(aucBody + ECR_GW_RESULT_SIZE, pszResponse, (size_t)inLength);
+	vdClientSend(pClient, ECR_GW_RESULT, aucBody, ECR_GW_RESULT_SIZE + inLength);
+}
+
+//MARK: - Terminals -
+
+static void vdTerminalDown(GW_TERMINAL *pTerminal, const char *pszReason)
+{
+	if(pTerminal->fd >= 0)
+		close(pTerminal->fd);
+	pTerminal->fd = -1;
+	if(pTerminal->inState == ECR_GW_TERMINAL_BUSY)
+	{
+		vdReply(&pTerminal->current, ECR_GW_TERMINAL_DOWN, NULL, 0);
+		pTerminal->ulFailures++;
+	}
+	if(pTerminal->inState != ECR_GW_TERMINAL_DOWN_STATE)
+		vdLog("%s: %s, retrying in %d ms", pTerminal->szName, pszReason, pTerminal->inBackoffMs);
+	pTerminal->inState = ECR_GW_TERMINAL_DOWN_STATE;
+	pTerminal->llRetryMs = llNowMs() + pTerminal->inBackoffMs;
+	pTerminal->inBackoffMs = pTerminal->inBackoffMs * 2 > GW_BACKOFF_MAX_MS ? GW_BACKOFF_MAX_MS : pTerminal->inBackoffMs * 2;
+}
+
+static void vdTerminalUp(GW_TERMINAL *pTerminal)
+{
+	pTerminal->inState = ECR_GW_TERMINAL_IDLE;
+	pTerminal->inBackoffMs = GW_BACKOFF_MIN_MS;
+	vdLog("%s: connected", pTerminal->szName);
+}
+
+static void vdTerminalConnect(GW_TERMINAL *pTerminal)
+{
+	pTerminal->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(pTerminal->fd < 0 || inNonBlocking(pTerminal->fd) < 0)
+	{
+		vdTerminalDown(pTerminal, strerror(errno));
+		return;
+	}
+	vdNoDelay(pTerminal->fd);
+	if(connect(pTerminal->fd, (struct sockaddr *)&pTerminal->address, sizeof(pTerminal->address)) == 0)
+		vdTerminalUp(pTerminal);
+	else if(errno == EINPROGRESS)
+	{
+		pTerminal->inState = ECR_GW_TERMINAL_CONNECTING;
+		pTerminal->llDeadlineMs = llNowMs() + GW_CONNECT_TIMEOUT_MS;
+	}
+	else
+	{
+		pTerminal->inState = ECR_GW_TERMINAL_CONNECTING;
+		vdTerminalDown(pTerminal, strerror(errno));
+	}
+}
+
+/* Sends the next queued request if the terminal is free. Requests of clients
+   that have gone are dropped here rather than sent. */
+static void vdTerminalSend(GW_TERMINAL *pTerminal)
+{
+	GW_REQUEST *pRequest = NULL;
+	ssize_t lnSent = 0;
+
+	while(pTerminal->inState == ECR_GW_TERMINAL_IDLE && pTerminal->inQueued > 0)
+	{
+		pRequest = &pTerminal->aQueue[pTerminal->inHead];
+		pTerminal->inHead = (pTerminal->inHead + 1) % GW_QUEUE_SIZE;
+		pTerminal->inQueued--;
+		if(pRequestClient(pRequest) == NULL)
+			continue;
+
+		pTerminal->current = *pRequest;
+		pTerminal->inState = ECR_GW_TERMINAL_BUSY;
+		pTerminal->llDeadlineMs = llNowMs() + gateway.inTimeoutMs;
+		ecrReassemblerInit(&pTerminal->reassembler);
+		lnSent = send(pTerminal->fd, pTerminal->current.aucPacket, (size_t)pTerminal->current.inLength, MSG_NOSIGNAL);
+		if(lnSent != pTerminal->current.inLength)
+			vdTerminalDown(pTerminal, lnSent < 0 ? strerror(errno) : "short write");
+	}
+}
+
+static void vdTerminalFrame(void *pvContext, const unsigned char *pucFrame, int inLength)
+{
+	GW_TERMINAL *pTerminal = pvContext;
+	char szResponse[ECR_CAPTURE_FRAME_MAX + 1];
+	char szParsed[ECR_CAPTURE_FRAME_MAX + 1];
+
+	if(pTerminal->inState != ECR_GW_TERMINAL_BUSY)
+	{
+		vdLog("%s: %d bytes without a request, dropped", pTerminal->szName, inLength);
+		return;
+	}
+	if(inLength > ECR_CAPTURE_FRAME_MAX)
+		inLength = ECR_CAPTURE_FRAME_MAX;
+	memcpy(szResponse, pucFrame, (size_t)inLength);
+	szResponse[inLength] = 0x00;
+	memset(szParsed, 0x00, sizeof(szParsed));
+	parse(szResponse, szParsed);
+	vdReply(&pTerminal->current, ECR_GW_OK, szParsed, (int)strlen(szParsed));
+	pTerminal->ulDelivered++;
+	pTerminal->inState = ECR_GW_TERMINAL_IDLE;
+}
+
+static void vdTerminalRead(GW_TERMINAL *pTerminal)
+{
+	unsigned char aucData[4096];
+	ssize_t lnRead = recv(pTerminal->fd, aucData, sizeof(aucData), 0);
+
+	if(lnRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return;
+	if(lnRead <= 0)
+	{
+		vdTerminalDown(pTerminal, lnRead == 0 ? "closed by the terminal" : strerror(errno));
+		return;
+	}
+	ecrReassemblerPush(&pTerminal->reassembler, aucData, (int)lnRead, vdTerminalFrame, pTerminal);
+	vdTerminalSend(pTerminal);
+}
+
+static void vdTerminalConnected(GW_TERMINAL *pTerminal)
+{
+	int inError = 0;
+	socklen_t inSize = sizeof(inError);
+
+	if(getsockopt(pTerminal->fd, SOL_SOCKET, SO_ERROR, &inError, &inSize) < 0)
+		inError = errno;
+	if(inError != 0)
+	{
+		vdTerminalDown(pTerminal, strerror(inError));
+		return;
+	}
+	vdTerminalUp(pTerminal);
+	vdTerminalSend(pTerminal);
+}
+
+/* Timers of one terminal; returns the milliseconds until it needs a look again */
+static long long llTerminalTick(GW_TERMINAL *pTerminal, long long llNow)
+{
+	GW_REQUEST *pRequest = NULL;
+	long long llWait = GW_TICK_MS;
+
+	switch(pTerminal->inState)
+	{
+		case ECR_GW_TERMINAL_BUSY:
+			if(llNow < pTerminal->llDeadlineMs)
+				return pTerminal->llDeadlineMs - llNow;
+			vdReply(&pTerminal->current, ECR_GW_TIMEOUT, NULL, 0);
+			pTerminal->ulFailures++;
+			pTerminal->inState = ECR_GW_TERMINAL_IDLE;
+			pTerminal->inBackoffMs = GW_BACKOFF_MIN_MS;
+			vdTerminalDown(pTerminal, "no reply in time");
+			return 0;
+
+		case ECR_GW_TERMINAL_CONNECTING:
+			if(llNow >= pTerminal->llDeadlineMs)
+				vdTerminalDown(pTerminal, "connect timed out");
+			break;
+
+		case ECR_GW_TERMINAL_DOWN_STATE:
+			if(llNow >= pTerminal->llRetryMs)
+			{
+				vdTerminalConnect(pTerminal);
+				vdTerminalSend(pTerminal);
+			}
+			else if(pTerminal->llRetryMs - llNow < llWait)
+				llWait = pTerminal->llRetryMs - llNow;
+			break;
+
+		default:
+			return llWait;
+	}
+
+	// Not connected: what waited too long fails, oldest first
+	while(pTerminal->inState != ECR_GW_TERMINAL_IDLE && pTerminal->inQueued > 0)
+	{
+		pRequest = &pTerminal->aQueue[pTerminal->inHead];
+		if(llNow - pRequest->llQueuedMs < gateway.inTimeoutMs)
+			break;
+		vdReply(pRequest, ECR_GW_TERMINAL_DOWN, NULL, 0);
+		if(pRequestClient(pRequest) != NULL)
+			pTerminal->ulFailures++;
+		pTerminal->inHead = (pTerminal->inHead + 1) % GW_QUEUE_SIZE;
+		pTerminal->inQueued--;
+	}
+	return llWait;
+}
+
+//MARK: - Requests -
+
+static GW_TERMINAL *pFindTerminal(const unsigned char *pucName, int inLength)
+{
+	int i = 0;
+
+	for(i = 0; i < gateway.inTerminals; i++)
+	{
+		if((int)strlen(gateway.aTerminals[i].szName) == inLength
+				&& memcmp(gateway.aTerminals[i].szName, pucName, (size_t)inLength) == 0)
+			return &gateway.aTerminals[i];
+	}
+	return NULL;
+}
+
+/* pack() copies fields into fixed buffers without checking; only requests that
+   fit them are handed over */
+static int inRequestFits(const unsigned char *pucRequest, int inLength)
+{
+	int inFields = 1;
+	int inFieldLength = 0;
+	int i = 0;
+
+	if(inLength < 2 || inLength >= GW_REQUEST_SIZE || pucRequest[inLength - 1] != ENDMSG_CHAR)
+		return 0;
+	for(i = 0; i < inLength - 1; i++)
+	{
+		if(pucRequest[i] < 0x20 || pucRequest[i] > 0x7E || pucRequest[i] == ENDMSG_CHAR)
+			return 0;
+		if(pucRequest[i] == DELIMITOR_CHAR)
+		{
+			inFields++;
+			inFieldLength = 0;
+		}
+		else if(++inFieldLength > REQFIELD_SIZE)
+			return 0;
+	}
+	return inFields <= GW_REQUEST_FIELDS;
+}
+
+static void vdTransact(GW_CLIENT *pClient, const unsigned char *pucBody, int inLength)
+{
+	GW_REQUEST request;
+	GW_REQUEST *pSlot = NULL;
+	GW_TERMINAL *pTerminal = NULL;
+	const unsigned char *pucName = pucBody + ECR_GW_TRANSACT_SIZE;
+	const unsigned char *pucRequest = NULL;
+	const unsigned char *pucSignature = NULL;
+	const unsigned char *pucEtx = NULL;
+	char szRequest[GW_REQUEST_SIZE];
+	char szSignature[SIGNATURE_SIZE + 1];
+	int transactionType = pucBody[4];
+	int inNameLength = pucBody[5];
+	int inRequestLength = (int)ECR_GW_GET16(pucBody + 6);
+	int inSignatureLength = pucBody[8];
+	int i = 0;
+
+	if(ECR_GW_TRANSACT_SIZE + inNameLength + inRequestLength + inSignatureLength != inLength)
+	{
+		vdLog("malformed request, client closed");
+		vdClientClose(pClient);
+		return;
+	}
+	pucRequest = pucName + inNameLength;
+	pucSignature = pucRequest + inRequestLength;
+
+	request.inClient = (int)(pClient - gateway.aClients);
+	request.ulGeneration = pClient->ulGeneration;
+	request.ulTag = ECR_GW_GET32(pucBody);
+	pTerminal = pFindTerminal(pucName, inNameLength);
+	if(pTerminal == NULL)
+	{
+		vdReply(&request, ECR_GW_UNKNOWN_TERMINAL, NULL, 0);
+		return;
+	}
+	if(pTerminal->inQueued == GW_QUEUE_SIZE)
+	{
+		vdReply(&request, ECR_GW_QUEUE_FULL, NULL, 0);
+		return;
+	}
+	if(!inRequestFits(pucRequest, inRequestLength) || inSignatureLength > SIGNATURE_SIZE)
+	{
+		vdReply(&request, ECR_GW_BAD_REQUEST, NULL, 0);
+		return;
+	}
+	for(i = 0; i < inSignatureLength; i++)
+	{
+		if(pucSignature[i] < 0x20 || pucSignature[i] > 0x7E)
+		{
+			vdReply(&request, ECR_GW_BAD_REQUEST, NULL, 0);
+			return;
+		}
+	}
+
+	// Short signatures are padded with '0'; session commands carry none
+	memcpy(szRequest, pucRequest, (size_t)inRequestLength);
+	szRequest[inRequestLength] = 0x00;
+	memset(szSignature, '0', SIGNATURE_SIZE);
+	memcpy(szSignature, pucSignature, (size_t)inSignatureLength);
+	szSignature[SIGNATURE_SIZE] = 0x00;
+
+	pSlot = &pTerminal->aQueue[(pTerminal->inHead + pTerminal->inQueued) % GW_QUEUE_SIZE];
+	memset(pSlot->aucPacket, 0x00, sizeof(pSlot->aucPacket));
+	if(pack(szRequest, transactionType, szSignature, (char *)pSlot->aucPacket) < 0
+			|| (pucEtx = memchr(pSlot->aucPacket, ETX[0], sizeof(pSlot->aucPacket) - LCR_SIZE)) == NULL)
+	{
+		vdReply(&request, ECR_GW_BAD_REQUEST, NULL, 0);
+		return;
+	}
+	pSlot->inClient = request.inClient;
+	pSlot->ulGeneration = request.ulGeneration;
+	pSlot->ulTag = request.ulTag;
+	pSlot->llQueuedMs = llNowMs();
+	pSlot->inLength = (int)(pucEtx - pSlot->aucPacket) + ETX_SIZE + LCR_SIZE;
+	pTerminal->inQueued++;
+	if(gateway.inVerbose)
+		vdLog("%s: request %lu queued (%d waiting)", pTerminal->szName, request.ulTag, pTerminal->inQueued);
+	vdTerminalSend(pTerminal);
+}
+
+static void vdStatus(GW_CLIENT *pClient, const unsigned char *pucBody)
+{
+	unsigned char aucReply[GW_STATUS_SIZE];
+	GW_TERMINAL *pTerminal = NULL;
+	int inLength = 5;
+	int inNameLength = 0;
+	int i = 0;
+
+	memcpy(aucReply, pucBody, 4);
+	aucReply[4] = (unsigned char)gateway.inTerminals;
+	for(i = 0; i < gateway.inTerminals; i++)
+	{
+		pTerminal = &gateway.aTerminals[i];
+		inNameLength = (int)strlen(pTerminal->szName);
+		aucReply[inLength++] = (unsigned char)inNameLength;
+		memcpy(aucReply + inLength, pTerminal->szName, (size_t)inNameLength);
+		inLength += inNameLength;
+		aucReply[inLength++] = (unsigned char)pTerminal->inState;
+		ECR_GW_PUT16(aucReply + inLength, pTerminal->inQueued);
+		ECR_GW_PUT32(aucReply + inLength + 2, pTerminal->ulDelivered);
+		ECR_GW_PUT32(aucReply + inLength + 6, pTerminal->ulFailures);
+		inLength += 10;
+	}
+	vdClientSend(pClient, ECR_GW_STATUS_REPLY, aucReply, inLength);
+}
+
+static void vdClientRead(GW_CLIENT *pClient)
+{
+	ssize_t lnRead = recv(pClient->fd, pClient->aucInput + pClient->inInput,
+			sizeof(pClient->aucInput) - (size_t)pClient->inInput, 0);
+	const unsigned char *pucMessage = pClient->aucInput;
+	int inBody = 0;
+	int inOffset = 0;
+
+	if(lnRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return;
+	if(lnRead <= 0)
+	{
+		vdClientClose(pClient);
+		return;
+	}
+	pClient->inInput += (int)lnRead;
+
+	while(pClient->inInput - inOffset >= ECR_GW_HEADER_SIZE)
+	{
+		pucMessage = pClient->aucInput + inOffset;
+		inBody = (int)ECR_GW_GET16(pucMessage);
+		if(ECR_GW_HEADER_SIZE + inBody > GW_CLIENT_INPUT_SIZE)
+		{
+			vdLog("message of %d bytes, client closed", inBody);
+			vdClientClose(pClient);
+			return;
+		}
+		if(pClient->inInput - inOffset < ECR_GW_HEADER_SIZE + inBody)
+			break;
+		if(pucMessage[2] == ECR_GW_TRANSACT && inBody >= ECR_GW_TRANSACT_SIZE)
+			vdTransact(pClient, pucMessage + ECR_GW_HEADER_SIZE, inBody);
+		else if(pucMessage[2] == ECR_GW_STATUS && inBody >= 4)
+			vdStatus(pClient, pucMessage + ECR_GW_HEADER_SIZE);
+		else
+		{
+			vdLog("unknown message %d, client closed", pucMessage[2]);
+			vdClientClose(pClient);
+		}
+		if(pClient->fd < 0)
+			return;
+		inOffset += ECR_GW_HEADER_SIZE + inBody;
+	}
+	pClient->inInput -= inOffset;
+	memmove(pClient->aucInput, pClient->aucInput + inOffset, (size_t)pClient->inInput);
+}
+
+//MARK: - Listeners -
+
+static int inListenUnix(const char *pszPath)
+{
+	struct sockaddr_un address;
+	int fd = -1;
+
+	memset(&address, 0x00, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(strlen(pszPath) >= sizeof(address.sun_path))
+		return -1;
+	strcpy(address.sun_path, pszPath);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+		return -1;
+	unlink(pszPath);
+	if(bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 128) < 0 || inNonBlocking(fd) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int inListenTcp(int inPort)
+{
+	struct sockaddr_in address;
+	int inOn = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if(fd < 0)
+		return -1;
+	memset(&address, 0x00, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((unsigned short)inPort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &inOn, sizeof(inOn));
+	if(bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 128) < 0 || inNonBlocking(fd) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void vdAccept(int fdListen)
+{
+	GW_CLIENT *pClient = NULL;
+	int fd = -1;
+	int i = 0;
+
+	while((fd = accept(fdListen, NULL, NULL)) >= 0)
+	{
+		for(i = 0, pClient = NULL; i < GW_MAX_CLIENTS && pClient == NULL; i++)
+		{
+			if(gateway.aClients[i].fd < 0)
+				pClient = &gateway.aClients[i];
+		}
+		if(pClient == NULL || inNonBlocking(fd) < 0)
+		{
+			vdLog("client refused, %d connected", GW_MAX_CLIENTS);
+			close(fd);
+			continue;
+		}
+		if(fdListen == gateway.fdTcp)
+			vdNoDelay(fd);
+		pClient->fd = fd;
+		pClient->ulGeneration = ++gateway.ulGenerations;
+	}
+}
+
+//MARK: - Main -
+
+static int inAddTerminal(const char *pszSpec)
+{
+	GW_TERMINAL *pTerminal = &gateway.aTerminals[gateway.inTerminals];
+	const char *pszAddress = strchr(pszSpec, '=');
+	const char *pszPort = strrchr(pszSpec, ':');
+	char szAddress[INET_ADDRSTRLEN];
+	int inNameLength = pszAddress ? (int)(pszAddress - pszSpec) : 0;
+	int inPort = pszPort ? atoi(pszPort + 1) : 0;
+
+	if(gateway.inTerminals == GW_MAX_TERMINALS || inNameLength <= 0 || inNameLength >= GW_NAME_SIZE
+			|| pszPort < pszAddress || pszPort - pszAddress - 1 >= (long)sizeof(szAddress)
+			|| inPort <= 0 || inPort > 65535 || pFindTerminal((const unsigned char *)pszSpec, inNameLength) != NULL)
+		return -1;
+	memcpy(szAddress, pszAddress + 1, (size_t)(pszPort - pszAddress - 1));
+	szAddress[pszPort - pszAddress - 1] = 0x00;
+
+	memset(pTerminal, 0x00, sizeof(GW_TERMINAL));
+	memcpy(pTerminal->szName, pszSpec, (size_t)inNameLength);
+	pTerminal->address.sin_family = AF_INET;
+	pTerminal->address.sin_port = htons((unsigned short)inPort);
+	if(inet_pton(AF_INET, szAddress, &pTerminal->address.sin_addr) != 1)
+		return -1;
+	pTerminal->fd = -1;
+	pTerminal->inState = ECR_GW_TERMINAL_DOWN_STATE;
+	pTerminal->inBackoffMs = GW_BACKOFF_MIN_MS;
+	gateway.inTerminals++;
+	return 0;
+}
+
+static void vdUsage(void)
+{
+	fprintf(stderr, "usage: ecr_gateway [-u socket path] [-p port] [-T timeout seconds] [-v] -t NAME=address:port...\n");
+}
+
+int main(int argc, char **argv)
+{
+	static struct pollfd aPoll[2 + GW_MAX_TERMINALS + GW_MAX_CLIENTS];
+	static int aiOwner[2 + GW_MAX_TERMINALS + GW_MAX_CLIENTS];	// Listener -1, terminal, or GW_MAX_TERMINALS + client
+	struct sigaction action;
+	GW_TERMINAL *pTerminal = NULL;
+	GW_CLIENT *pClient = NULL;
+	long long llNow = 0;
+	long long llWait = 0;
+	int inPort = 0;
+	int inPolled = 0;
+	int inOption = 0;
+	int i = 0;
+
+	gateway.fdUnix = -1;
+	gateway.fdTcp = -1;
+	gateway.inTimeoutMs = GW_TIMEOUT_MS;
+	for(i = 0; i < GW_MAX_CLIENTS; i++)
+		gateway.aClients[i].fd = -1;
+	while((inOption = getopt(argc, argv, "u:p:t:T:v")) != -1)
+	{
+		switch(inOption)
+		{
+			case 'u': gateway.pszUnixPath = optarg; break;
+			case 'p': inPort = atoi(optarg); break;
+			case 'T': gateway.inTimeoutMs = atoi(optarg) * 1000; break;
+			case 'v': gateway.inVerbose = 1; break;
+			case 't':
+				if(inAddTerminal(optarg) < 0)
+				{
+					fprintf(stderr, "ecr_gateway: bad terminal %s\n", optarg);
+					return 2;
+				}
+				break;
+			default: vdUsage(); return 2;
+		}
+	}
+	if(gateway.inTerminals == 0 || (gateway.pszUnixPath == NULL && inPort == 0) || gateway.inTimeoutMs <= 0)
+	{
+		vdUsage();
+		return 2;
+	}
+	if(gateway.pszUnixPath != NULL && (gateway.fdUnix = inListenUnix(gateway.pszUnixPath)) < 0)
+	{
+		fprintf(stderr, "ecr_gateway: cannot listen on %s: %s\n", gateway.pszUnixPath, strerror(errno));
+		return 1;
+	}
+	if(inPort != 0 && (gateway.fdTcp = inListenTcp(inPort)) < 0)
+	{
+		fprintf(stderr, "ecr_gateway: cannot listen on 127.0.0.1:%d: %s\n", inPort, strerror(errno));
+		return 1;
+	}
+	if(!gateway.inVerbose && freopen("/dev/null", "w", stdout) == NULL)
+		vdLog("stdout left open: %s", strerror(errno));
+
+	memset(&action, 0x00, sizeof(action));
+	action.sa_handler = vdStop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	while(!inStop)
+	{
+		llNow = llNowMs();
+		llWait = GW_TICK_MS;
+		for(i = 0; i < gateway.inTerminals; i++)
+		{
+			long long llTerminalWait = llTerminalTick(&gateway.aTerminals[i], llNow);
+
+			if(llTerminalWait < llWait)
+				llWait = llTerminalWait;
+		}
+
+		inPolled = 0;
+		if(gateway.fdUnix >= 0)
+		{
+			aPoll[inPolled] = (struct pollfd){ gateway.fdUnix, POLLIN, 0 };
+			aiOwner[inPolled++] = -1;
+		}
+		if(gateway.fdTcp >= 0)
+		{
+			aPoll[inPolled] = (struct pollfd){ gateway.fdTcp, POLLIN, 0 };
+			aiOwner[inPolled++] = -1;
+		}
+		for(i = 0; i < gateway.inTerminals; i++)
+		{
+			pTerminal = &gateway.aTerminals[i];
+			if(pTerminal->fd < 0)
+				continue;
+			aPoll[inPolled] = (struct pollfd){ pTerminal->fd,
+					pTerminal->inState == ECR_GW_TERMINAL_CONNECTING ? POLLOUT : POLLIN, 0 };
+			aiOwner[inPolled++] = i;
+		}
+		for(i = 0; i < GW_MAX_CLIENTS; i++)
+		{
+			pClient = &gateway.aClients[i];
+			if(pClient->fd < 0)
+				continue;
+			aPoll[inPolled] = (struct pollfd){ pClient->fd, (short)(POLLIN | (pClient->ulOutput ? POLLOUT : 0)), 0 };
+			aiOwner[inPolled++] = GW_MAX_TERMINALS + i;
+		}
+
+		if(poll(aPoll, (nfds_t)inPolled, (int)(llWait > 0 ? llWait : 0)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			vdLog("poll: %s", strerror(errno));
+			break;
+		}
+
+		// Owners are checked against the descriptor polled, since handling one
+		// entry can close another; listeners go last so no descriptor is reused
+		for(i = 0; i < inPolled; i++)
+		{
+			if(aPoll[i].revents == 0 || aiOwner[i] < 0)
+				continue;
+			if(aiOwner[i] < GW_MAX_TERMINALS)
+			{
+				pTerminal = &gateway.aTerminals[aiOwner[i]];
+				if(pTerminal->fd != aPoll[i].fd)
+					continue;
+				if(pTerminal->inState == ECR_GW_TERMINAL_CONNECTING)
+					vdTerminalConnected(pTerminal);
+				else
+					vdTerminalRead(pTerminal);
+			}
+			else
+			{
+				pClient = &gateway.aClients[aiOwner[i] - GW_MAX_TERMINALS];
+				if(pClient->fd != aPoll[i].fd)
+					continue;
+				if(aPoll[i].revents & POLLOUT)
+					vdClientFlush(pClient);
+				if(pClient->fd >= 0 && (aPoll[i].revents & (POLLIN | POLLHUP | POLLERR)))
+					vdClientRead(pClient);
+			}
+		}
+		for(i = 0; i < inPolled; i++)
+		{
+			if(aPoll[i].revents != 0 && aiOwner[i] < 0)
+				vdAccept(aPoll[i].fd);
+		}
+	}
+
+	for(i = 0; i < GW_MAX_CLIENTS; i++)
+	{
+		if(gateway.aClients[i].fd >= 0)
+			vdClientClose(&gateway.aClients[i]);
+	}
+	for(i = 0; i < gateway.inTerminals; i++)
+	{
+		if(gateway.aTerminals[i].fd >= 0)
+			close(gateway.aTerminals[i].fd);
+	}
+	if(gateway.fdUnix >= 0)
+	{
+		close(gateway.fdUnix);
+		unlink(gateway.pszUnixPath);
+	}
+	if(gateway.fdTcp >= 0)
+		close(gateway.fdTcp);
+	vdLog("stopped");
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * ecr_gateway.h
+ *
+ *  Client protocol of tool/ecr_gateway.c, over its Unix socket or loopback TCP.
+ *  Every message is a 4 byte header and a body, integers big endian:
+ *    [0..1]  body length
+ *    [2]     message type
+ *    [3]     reserved, 0
+ *
+ *  ECR_GW_TRANSACT, client to gateway:
+ *    [0..3]  tag, echoed in the result; any value
+ *    [4]     transaction type (TYPE_ in ECRSrc.h)
+ *    [5]     terminal name length n
+ *    [6..7]  request length m
+ *    [8]     signature length s, up to SIGNATURE_SIZE
+ *    name[n], request[m] as pack() takes it ("datetime;...;refnum!"), signature[s]
+ *
+ *  ECR_GW_RESULT, gateway to client:
+ *    [0..3]  tag
+ *    [4]     status (ECR_GW_OK ...)
+ *    [5]     reserved
+ *    [6..7]  response length m
+ *    response[m], the terminal's reply after parse(); empty unless ECR_GW_OK
+ *
+ *  ECR_GW_STATUS, client to gateway: [0..3] tag. ECR_GW_STATUS_REPLY:
+ *    [0..3]  tag
+ *    [4]     terminal count, then per terminal:
+ *    [0]     name length n, name[n]
+ *    [+0]    state (ECR_GW_TERMINAL_...)
+ *    [+1..2] requests queued
+ *    [+3..6] replies delivered
+ *    [+7..10] failures (timeouts and lost connections)
+ *
+ *  A client may send any number of requests without waiting; results come in
+ *  the order each terminal completes them. Requests to one terminal go out one
+ *  at a time, in arrival order.
+ */
+
+#ifndef TOOL_ECR_GATEWAY_H_
+#define TOOL_ECR_GATEWAY_H_
+
+#define ECR_GW_HEADER_SIZE				4
+#define ECR_GW_BODY_MAX					65535
+
+#define ECR_GW_TRANSACT					1
+#define ECR_GW_STATUS					2
+#define ECR_GW_RESULT					0x81
+#define ECR_GW_STATUS_REPLY				0x82
+
+#define ECR_GW_TRANSACT_SIZE			9		// Fixed part of an ECR_GW_TRANSACT body
+#define ECR_GW_RESULT_SIZE				8		// Fixed part of an ECR_GW_RESULT body
+
+#define ECR_GW_OK						0
+#define ECR_GW_UNKNOWN_TERMINAL			1
+#define ECR_GW_QUEUE_FULL				2
+#define ECR_GW_BAD_REQUEST				3		// pack() refused the request
+#define ECR_GW_TIMEOUT					4		// No reply in time; the terminal connection is reset
+#define ECR_GW_TERMINAL_DOWN			5		// Connection lost with the request sent, or never made
+
+#define ECR_GW_TERMINAL_DOWN_STATE		0
+#define ECR_GW_TERMINAL_CONNECTING		1
+#define ECR_GW_TERMINAL_IDLE			2
+#define ECR_GW_TERMINAL_BUSY			3
+
+#define ECR_GW_PUT16(p, v)				((p)[0] = (unsigned char)((v) >> 8), (p)[1] = (unsigned char)(v))
+#define ECR_GW_PUT32(p, v)				((p)[0] = (unsigned char)((v) >> 24), (p)[1] = (unsigned char)((v) >> 16), \
+											(p)[2] = (unsigned char)((v) >> 8), (p)[3] = (unsigned char)(v))
+#define ECR_GW_GET16(p)					((unsigned int)(p)[0] << 8 | (unsigned int)(p)[1])
+#define ECR_GW_GET32(p)					((unsigned long)(p)[0] << 24 | (unsigned long)(p)[1] << 16 | \
+											(unsigned long)(p)[2] << 8 | (unsigned long)(p)[3])
+
+#endif /* TOOL_ECR_GATEWAY_H_ */
@@ -0,0 +1,539 @@
+/*
+ * ecr_gateway_load.c
+ *
+ *  End to end load test of tool/ecr_gateway.c. Starts stand-in terminals on
+ *  loopback, runs the gateway against them and drives it from many clients at
+ *  once over both its Unix socket and TCP.
+ *
+ *  Build from the repository root on Linux, next to ecr_gateway:
+ *    cc -O2 -std=c11 -pthread -I ios/Frameworks/SkyBandECRSDK/CoreECR -o ecr_gateway_load tool/ecr_gateway_load.c \
+ *       ios/Frameworks/SkyBandECRSDK/CoreECR/ECRCapture.c
+ *
+ *  Usage:
+ *    ecr_gateway_load [-g ./ecr_gateway] [-t terminals] [-c clients] [-n requests per client] [-d reply delay ms] [-v]
+ *
+ *  Every client sends purchases one after another, spread over the terminals.
+ *  A stand-in answers after the delay with the terminal name and the request
+ *  fields, so each result is checked against the request it answers. A request
+ *  reaching a stand-in before its previous reply went out is counted as an
+ *  overlap. Reports requests/s and latency percentiles; the exit status is 1 on
+ *  any wrong, missing or overlapping reply.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "ECRSrc.h"
+#include "ECRCapture.h"
+#include "ecr_gateway.h"
+
+#define LOAD_MAX_TERMINALS				64
+#define LOAD_MAX_CLIENTS				512
+#define LOAD_NAME_SIZE					16
+#define LOAD_READY_MS					10000
+#define LOAD_SIGNATURE					"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"
+
+typedef struct
+{
+	char szName[LOAD_NAME_SIZE];
+	int fdListen;
+	int inPort;
+	int inDelayMs;
+	long lnRequests;
+	long lnOverlaps;
+	int fd;								// Current gateway connection
+	ECR_REASSEMBLER reassembler;
+} LOAD_TERMINAL;
+
+typedef struct
+{
+	int inIndex;
+	int inRequests;
+	long lnErrors;
+	double *pdbLatencies;
+} LOAD_CLIENT;
+
+static LOAD_TERMINAL aTerminals[LOAD_MAX_TERMINALS];
+static int inTerminals = 4;
+static char szUnixPath[108];
+static int inGatewayPort = 0;
+static int inVerbose = 0;
+
+static double dbNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void vdSleepMs(int inMs)
+{
+	struct timespec ts = { inMs / 1000, (long)(inMs % 1000) * 1000000L };
+
+	nanosleep(&ts, NULL);
+}
+
+static int inWriteAll(int fd, const unsigned char *pucData, int inLength)
+{
+	ssize_t lnSent = 0;
+
+	while(inLength > 0)
+	{
+		lnSent = send(fd, pucData, (size_t)inLength, MSG_NOSIGNAL);
+		if(lnSent < 0 && errno == EINTR)
+			continue;
+		if(lnSent <= 0)
+			return -1;
+		pucData += lnSent;
+		inLength -= (int)lnSent;
+	}
+	return 0;
+}
+
+static int inReadAll(int fd, unsigned char *pucData, int inLength)
+{
+	ssize_t lnRead = 0;
+
+	while(inLength > 0)
+	{
+		lnRead = recv(fd, pucData, (size_t)inLength, 0);
+		if(lnRead < 0 && errno == EINTR)
+			continue;
+		if(lnRead <= 0)
+			return -1;
+		pucData += lnRead;
+		inLength -= (int)lnRead;
+	}
+	return 0;
+}
+
+//MARK: - Stand-in Terminals -
+
+/* Replies STX FS cmd FS 000 FS APPROVED FS name FS <request fields> ETX LRC */
+static void vdStandInFrame(void *pvContext, const unsigned char *pucFrame, int inLength)
+{
+	LOAD_TERMINAL *pTerminal = pvContext;
+	unsigned char aucReply[ECR_CAPTURE_FRAME_MAX + 64];
+	unsigned char ucPeek = 0;
+	int inReply = 0;
+	int inFields = 0;
+	int i = 0;
+
+	if(inLength < 6 || pucFrame[0] != STX[0] || pucFrame[inLength - 2] != ETX[0])
+		return;
+	pTerminal->lnRequests++;
+	if(pTerminal->inDelayMs > 0)
+		vdSleepMs(pTerminal->inDelayMs);
+	if(recv(pTerminal->fd, &ucPeek, 1, MSG_PEEK | MSG_DONTWAIT) > 0)
+		pTerminal->lnOverlaps++;
+
+	inFields = 4;				// STX FS and the command
+	memcpy(aucReply, pucFrame, (size_t)inFields);
+	inReply = inFields;
+	inReply += sprintf((char *)aucReply + inReply, "%s000%sAPPROVED%s%s", FIELD_SEPERATOR, FIELD_SEPERATOR,
+			FIELD_SEPERATOR, pTerminal->szName);
+	memcpy(aucReply + inReply, pucFrame + 4, (size_t)(inLength - 5));	// From the FS after the command to ETX
+	inReply += inLength - 5;
+	aucReply[inReply] = 0x00;
+	for(i = 0; i < inReply; i++)
+		aucReply[inReply] ^= aucReply[i];
+	inReply++;
+	if(inWriteAll(pTerminal->fd, aucReply, inReply) < 0)
+		return;
+}
+
+static void *pvStandIn(void *pvContext)
+{
+	LOAD_TERMINAL *pTerminal = pvContext;
+	unsigned char aucData[4096];
+	ssize_t lnRead = 0;
+
+	for(;;)
+	{
+		pTerminal->fd = accept(pTerminal->fdListen, NULL, NULL);
+		if(pTerminal->fd < 0)
+			continue;
+		ecrReassemblerInit(&pTerminal->reassembler);
+		while((lnRead = recv(pTerminal->fd, aucData, sizeof(aucData), 0)) > 0)
+			ecrReassemblerPush(&pTerminal->reassembler, aucData, (int)lnRead, vdStandInFrame, pTerminal);
+		close(pTerminal->fd);
+	}
+	return NULL;
+}
+
+static int inListenLoopback(int *pinPort)
+{
+	struct sockaddr_in address;
+	socklen_t inSize = sizeof(address);
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	memset(&address, 0x00, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 16) < 0
+			|| getsockname(fd, (struct sockaddr *)&address, &inSize) < 0)
+		return -1;
+	*pinPort = ntohs(address.sin_port);
+	return fd;
+}
+
+//MARK: - Gateway Clients -
+
+static int inConnectGateway(int inUnix)
+{
+	struct sockaddr_un unixAddress;
+	struct sockaddr_in tcpAddress;
+	int inOn = 1;
+	int fd = socket(inUnix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+
+	if(fd < 0)
+		return -1;
+	if(inUnix)
+	{
+		memset(&unixAddress, 0x00, sizeof(unixAddress));
+		unixAddress.sun_family = AF_UNIX;
+		strcpy(unixAddress.sun_path, szUnixPath);
+		if(connect(fd, (struct sockaddr *)&unixAddress, sizeof(unixAddress)) == 0)
+			return fd;
+	}
+	else
+	{
+		memset(&tcpAddress, 0x00, sizeof(tcpAddress));
+		tcpAddress.sin_family = AF_INET;
+		tcpAddress.sin_port = htons((unsigned short)inGatewayPort);
+		tcpAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &inOn, sizeof(inOn));
+		if(connect(fd, (struct sockaddr *)&tcpAddress, sizeof(tcpAddress)) == 0)
+			return fd;
+	}
+	close(fd);
+	return -1;
+}
+
+static int inSendTransact(int fd, unsigned long ulTag, int transactionType, const char *pszTerminal, const char *pszRequest)
+{
+	unsigned char aucMessage[ECR_GW_HEADER_SIZE + ECR_GW_TRANSACT_SIZE + 512];
+	int inName = (int)strlen(pszTerminal);
+	int inRequest = (int)strlen(pszRequest);
+	int inBody = ECR_GW_TRANSACT_SIZE + inName + inRequest + SIGNATURE_SIZE;
+
+	ECR_GW_PUT16(aucMessage, inBody);
+	aucMessage[2] = ECR_GW_TRANSACT;
+	aucMessage[3] = 0;
+	ECR_GW_PUT32(aucMessage + 4, ulTag);
+	aucMessage[8] = (unsigned char)transactionType;
+	aucMessage[9] = (unsigned char)inName;
+	ECR_GW_PUT16(aucMessage + 10, inRequest);
+	aucMessage[12] = SIGNATURE_SIZE;
+	memcpy(aucMessage + 13, pszTerminal, (size_t)inName);
+	memcpy(aucMessage + 13 + inName, pszRequest, (size_t)inRequest);
+	memcpy(aucMessage + 13 + inName + inRequest, LOAD_SIGNATURE, SIGNATURE_SIZE);
+	return inWriteAll(fd, aucMessage, ECR_GW_HEADER_SIZE + inBody);
+}
+
+/* Reads one message; returns its type and body length through pinLength, -1 on error */
+static int inReadMessage(int fd, unsigned char *pucBody, int inSize, int *pinLength)
+{
+	unsigned char aucHeader[ECR_GW_HEADER_SIZE];
+
+	if(inReadAll(fd, aucHeader, ECR_GW_HEADER_SIZE) < 0)
+		return -1;
+	*pinLength = (int)ECR_GW_GET16(aucHeader);
+	if(*pinLength >= inSize || inReadAll(fd, pucBody, *pinLength) < 0)
+		return -1;
+	pucBody[*pinLength] = 0x00;
+	return aucHeader[2];
+}
+
+static int inResultStatus(int fd, unsigned long ulTag, char **ppszResponse)
+{
+	static _Thread_local unsigned char aucBody[ECR_GW_RESULT_SIZE + ECR_CAPTURE_FRAME_MAX + 1];
+	int inLength = 0;
+
+	if(inReadMessage(fd, aucBody, sizeof(aucBody), &inLength) != ECR_GW_RESULT || inLength < ECR_GW_RESULT_SIZE
+			|| ECR_GW_GET32(aucBody) != ulTag)
+		return -1;
+	*ppszResponse = (char *)aucBody + ECR_GW_RESULT_SIZE;
+	return aucBody[4];
+}
+
+static void *pvClient(void *pvContext)
+{
+	LOAD_CLIENT *pClient = pvContext;
+	LOAD_TERMINAL *pTerminal = NULL;
+	char szRequest[128];
+	char szDateTime[DATETIME_SIZE + 1];
+	char szExpect[64];
+	char *pszResponse = NULL;
+	double dbStart = 0;
+	int inStatus = 0;
+	int fd = inConnectGateway(pClient->inIndex % 2 == 0);
+	int i = 0;
+
+	if(fd < 0)
+	{
+		pClient->lnErrors = pClient->inRequests;
+		return NULL;
+	}
+	for(i = 0; i < pClient->inRequests; i++)
+	{
+		pTerminal = &aTerminals[(pClient->inIndex + i) % inTerminals];
+		snprintf(szDateTime, sizeof(szDateTime), "%04u%08u", (unsigned int)pClient->inIndex % 10000u, (unsigned int)i % 100000000u);
+		snprintf(szRequest, sizeof(szRequest), "%s;%d;1;LD%04d%08d!", szDateTime, 100 + i, pClient->inIndex, i);
+		snprintf(szExpect, sizeof(szExpect), ";%s;", pTerminal->szName);
+
+		dbStart = dbNow();
+		if(inSendTransact(fd, (unsigned long)i, TYPE_PURCHASE, pTerminal->szName, szRequest) < 0)
+			break;
+		inStatus = inResultStatus(fd, (unsigned long)i, &pszResponse);
+		pClient->pdbLatencies[i] = dbNow() - dbStart;
+		if(inStatus != ECR_GW_OK || strstr(pszResponse, szExpect) == NULL || strstr(pszResponse, szDateTime) == NULL)
+		{
+			if(inVerbose)
+				fprintf(stderr, "client %d request %d: status %d %s\n", pClient->inIndex, i, inStatus, inStatus == ECR_GW_OK ? pszResponse : "");
+			pClient->lnErrors++;
+			if(inStatus < 0)
+				break;
+		}
+	}
+	pClient->lnErrors += pClient->inRequests - i;
+	close(fd);
+	return NULL;
+}
+
+/* Queries the gateway status; returns the number of terminals connected and
+   sums their delivered and failed counts */
+static int inGatewayStatus(long *plnDelivered, long *plnFailures, int inPrint)
+{
+	unsigned char aucMessage[ECR_GW_HEADER_SIZE + 4] = { 0, 4, ECR_GW_STATUS, 0, 0, 0, 0, 7 };
+	unsigned char aucBody[4096];
+	int fd = inConnectGateway(1);
+	int inLength = 0;
+	int inOffset = 5;
+	int inConnected = 0;
+	int inName = 0;
+	int i = 0;
+
+	*plnDelivered = 0;
+	*plnFailures = 0;
+	if(fd < 0)
+		return -1;
+	if(inWriteAll(fd, aucMessage, sizeof(aucMessage)) < 0
+			|| inReadMessage(fd, aucBody, sizeof(aucBody), &inLength) != ECR_GW_STATUS_REPLY || inLength < 5)
+	{
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	for(i = 0; i < aucBody[4] && inOffset < inLength; i++)
+	{
+		inName = aucBody[inOffset];
+		if(aucBody[inOffset + 1 + inName] >= ECR_GW_TERMINAL_IDLE)
+			inConnected++;
+		*plnDelivered += (long)ECR_GW_GET32(aucBody + inOffset + 4 + inName);
+		*plnFailures += (long)ECR_GW_GET32(aucBody + inOffset + 8 + inName);
+		if(inPrint)
+			printf("  %.*s: state %d, queued %u, delivered %lu, failures %lu\n", inName, aucBody + inOffset + 1,
+					aucBody[inOffset + 1 + inName], ECR_GW_GET16(aucBody + inOffset + 2 + inName),
+					ECR_GW_GET32(aucBody + inOffset + 4 + inName), ECR_GW_GET32(aucBody + inOffset + 8 + inName));
+		inOffset += 1 + inName + 11;
+	}
+	return inConnected;
+}
+
+/* Statuses the gateway gives without a terminal round trip */
+static int inCheckRefusals(void)
+{
+	char *pszResponse = NULL;
+	int inFailed = 0;
+	int fd = inConnectGateway(1);
+
+	if(fd < 0)
+		return 1;
+	if(inSendTransact(fd, 1, TYPE_PURCHASE, "NOSUCH", "000000000000;100;1;R1!") < 0
+			|| inResultStatus(fd, 1, &pszResponse) != ECR_GW_UNKNOWN_TERMINAL)
+		inFailed++;
+	if(inSendTransact(fd, 2, TYPE_PURCHASE, aTerminals[0].szName, "000000000000;100!") < 0
+			|| inResultStatus(fd, 2, &pszResponse) != ECR_GW_BAD_REQUEST)
+		inFailed++;
+	if(inSendTransact(fd, 3, TYPE_PURCHASE, aTerminals[0].szName, "000000000000;100;1;R1") < 0
+			|| inResultStatus(fd, 3, &pszResponse) != ECR_GW_BAD_REQUEST)
+		inFailed++;
+	close(fd);
+	if(inFailed)
+		fprintf(stderr, "ecr_gateway_load: %d refusal checks failed\n", inFailed);
+	return inFailed;
+}
+
+static int inCompareDouble(const void *pvA, const void *pvB)
+{
+	double dbA = *(const double *)pvA;
+	double dbB = *(const double *)pvB;
+
+	return dbA < dbB ? -1 : dbA > dbB;
+}
+
+static pid_t startGateway(const char *pszGateway)
+{
+	char *apszArgs[8 + 2 * LOAD_MAX_TERMINALS];
+	char aszSpecs[LOAD_MAX_TERMINALS][64];
+	char szPort[16];
+	int inArgs = 0;
+	int fd = -1;
+	int i = 0;
+	pid_t pid = 0;
+
+	fd = inListenLoopback(&inGatewayPort);
+	close(fd);
+	snprintf(szPort, sizeof(szPort), "%d", inGatewayPort);
+	snprintf(szUnixPath, sizeof(szUnixPath), "/tmp/ecr_gateway_load.%d", (int)getpid());
+
+	apszArgs[inArgs++] = (char *)pszGateway;
+	apszArgs[inArgs++] = "-u";
+	apszArgs[inArgs++] = szUnixPath;
+	apszArgs[inArgs++] = "-p";
+	apszArgs[inArgs++] = szPort;
+	for(i = 0; i < inTerminals; i++)
+	{
+		snprintf(aszSpecs[i], sizeof(aszSpecs[i]), "%.15s=127.0.0.1:%d", aTerminals[i].szName, aTerminals[i].inPort);
+		apszArgs[inArgs++] = "-t";
+		apszArgs[inArgs++] = aszSpecs[i];
+	}
+	apszArgs[inArgs] = NULL;
+
+	pid = fork();
+	if(pid == 0)
+	{
+		if(!inVerbose)
+			(void)!freopen("/dev/null", "w", stderr);
+		execv(pszGateway, apszArgs);
+		_exit(127);
+	}
+	return pid;
+}
+
+int main(int argc, char **argv)
+{
+	static LOAD_CLIENT aClients[LOAD_MAX_CLIENTS];
+	static pthread_t aThreads[LOAD_MAX_CLIENTS];
+	const char *pszGateway = "./ecr_gateway";
+	pthread_t thread;
+	double *pdbLatencies = NULL;
+	double dbStart = 0;
+	double dbElapsed = 0;
+	long lnDelivered = 0;
+	long lnFailures = 0;
+	long lnErrors = 0;
+	long lnOverlaps = 0;
+	long lnTotal = 0;
+	int inClients = 32;
+	int inRequests = 200;
+	int inDelayMs = 0;
+	int inOption = 0;
+	int inStatus = 0;
+	int i = 0;
+	pid_t pid = 0;
+
+	while((inOption = getopt(argc, argv, "g:t:c:n:d:v")) != -1)
+	{
+		switch(inOption)
+		{
+			case 'g': pszGateway = optarg; break;
+			case 't': inTerminals = atoi(optarg); break;
+			case 'c': inClients = atoi(optarg); break;
+			case 'n': inRequests = atoi(optarg); break;
+			case 'd': inDelayMs = atoi(optarg); break;
+			case 'v': inVerbose = 1; break;
+			default:
+				fprintf(stderr, "usage: ecr_gateway_load [-g ./ecr_gateway] [-t terminals] [-c clients] [-n requests] [-d delay ms] [-v]\n");
+				return 2;
+		}
+	}
+	if(inTerminals < 1 || inTerminals > LOAD_MAX_TERMINALS || inClients < 1 || inClients > LOAD_MAX_CLIENTS || inRequests < 1)
+		return 2;
+	signal(SIGPIPE, SIG_IGN);
+
+	for(i = 0; i < inTerminals; i++)
+	{
+		snprintf(aTerminals[i].szName, sizeof(aTerminals[i].szName), "T%02d", i);
+		aTerminals[i].inDelayMs = inDelayMs;
+		aTerminals[i].fdListen = inListenLoopback(&aTerminals[i].inPort);
+		if(aTerminals[i].fdListen < 0 || pthread_create(&thread, NULL, pvStandIn, &aTerminals[i]) != 0)
+		{
+			perror("ecr_gateway_load: stand-in");
+			return 1;
+		}
+		pthread_detach(thread);
+	}
+	pid = startGateway(pszGateway);
+	if(pid < 0)
+	{
+		perror("ecr_gateway_load: fork");
+		return 1;
+	}
+	for(dbStart = dbNow(); inGatewayStatus(&lnDelivered, &lnFailures, 0) != inTerminals; vdSleepMs(20))
+	{
+		if(dbNow() - dbStart > LOAD_READY_MS / 1000.0 || waitpid(pid, &inStatus, WNOHANG) == pid)
+		{
+			fprintf(stderr, "ecr_gateway_load: %s did not connect to the terminals\n", pszGateway);
+			kill(pid, SIGKILL);
+			return 1;
+		}
+	}
+	lnErrors += inCheckRefusals();
+
+	pdbLatencies = malloc(sizeof(double) * (size_t)inClients * (size_t)inRequests);
+	if(pdbLatencies == NULL)
+		return 1;
+	dbStart = dbNow();
+	for(i = 0; i < inClients; i++)
+	{
+		aClients[i].inIndex = i;
+		aClients[i].inRequests = inRequests;
+		aClients[i].pdbLatencies = pdbLatencies + (size_t)i * (size_t)inRequests;
+		pthread_create(&aThreads[i], NULL, pvClient, &aClients[i]);
+	}
+	for(i = 0; i < inClients; i++)
+	{
+		pthread_join(aThreads[i], NULL);
+		lnErrors += aClients[i].lnErrors;
+	}
+	dbElapsed = dbNow() - dbStart;
+	lnTotal = (long)inClients * inRequests;
+	qsort(pdbLatencies, (size_t)lnTotal, sizeof(double), inCompareDouble);
+
+	printf("%d terminals, %d clients, %ld requests in %.3f s: %.0f req/s\n", inTerminals, inClients, lnTotal, dbElapsed,
+			(double)lnTotal / dbElapsed);
+	printf("latency p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", pdbLatencies[lnTotal / 2] * 1e3,
+			pdbLatencies[lnTotal * 99 / 100] * 1e3, pdbLatencies[lnTotal - 1] * 1e3);
+	if(inGatewayStatus(&lnDelivered, &lnFailures, 1) < 0)
+		lnErrors++;
+	for(i = 0; i < inTerminals; i++)
+		lnOverlaps += aTerminals[i].lnOverlaps;
+	if(lnDelivered != lnTotal || lnFailures != 0)
+		lnErrors++;
+	printf("errors %ld, overlapping requests %ld\n", lnErrors, lnOverlaps);
+
+	kill(pid, SIGTERM);
+	if(waitpid(pid, &inStatus, 0) != pid || !WIFEXITED(inStatus) || WEXITSTATUS(inStatus) != 0
+			|| access(szUnixPath, F_OK) == 0)
+	{
+		fprintf(stderr, "ecr_gateway_load: gateway did not stop cleanly\n");
+		lnErrors++;
+	}
+	free(pdbLatencies);
+	return (lnErrors || lnOverlaps) ? 1 : 0;
+}
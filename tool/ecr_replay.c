@@ -0,0 +1,366 @@
+/*
+ * ecr_replay.c
+ *
+ *  Replays wire captures (see CoreECR/ECRCapture.h) through frame reassembly,
+ *  parse(), field tokenizing and the core decoders, as fast as the host allows.
+ *
+ *  Build from the repository root on any host with a C11 compiler:
+ *    cc -O2 -std=c11 -I ios/Frameworks/SkyBandECRSDK/CoreECR -o ecr_replay tool/ecr_replay.c \
+ *       ios/Frameworks/SkyBandECRSDK/CoreECR/{SBCoreECR,ECRSrc,Utilities,ECRCapture,ECRSettlement,ECRRecord,ECRSha256}.c
+ *
+ *  Usage:
+ *    ecr_replay [-n iterations] [-o digests.txt] [-b baseline.txt] capture.skbcap...
+ *
+ *  Every inbound frame gets one digest line:
+ *    <frame> <transaction type> <fields> <sha256 of the decoded output>
+ *  Write them with -o on one build and compare with -b on the next; frames that
+ *  decode differently are listed and the exit status is 1.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "SBCoreECR.h"
+#include "ECRCapture.h"
+#include "ECRSettlement.h"
+#include "ECRSha256.h"
+
+#define REPLAY_RESPONSE_SIZE			(ECR_CAPTURE_FRAME_MAX + 1)
+#define REPLAY_MAX_FIELDS				1024
+#define REPLAY_MAX_TYPES				256
+#define REPLAY_MAX_LISTED				20		// Differing frames printed before summarising
+
+/* Fields the SDK needs before it decodes a reply in full, by transaction type;
+   replies with fewer fall back to the response code and message only. Keep in
+   step with the count checks in -[SKBCoreServices receivedData:]. */
+static const int ainFullLayout[] =
+{
+	32, 34, 32, 32, 32, 32, 32, 0, 32, 32,		// 0..9
+	28, 6, 6, 10, 10, 0, 0, 0, 3, 3,			// 10..19
+	31, 28										// 20..21
+};
+
+typedef struct
+{
+	long long llFrames;
+	long long llFullLayout;
+	int inMinFields;
+	int inMaxFields;
+} REPLAY_TYPE_STATS;
+
+typedef struct
+{
+	int transactionType;
+	long long llFrames;
+	long long llBytes;
+	long long llFields;
+	long long llSettlementRows;
+	ECR_SETTLEMENT_COLUMNS settlement;
+	char szTerminalId[256];
+
+	// Digest pass only
+	int inDigest;
+	FILE *fpDigests;
+	char **ppszBaseline;
+	long long llBaselineLines;
+	long long llDifferences;
+	REPLAY_TYPE_STATS aStats[REPLAY_MAX_TYPES];
+} REPLAY;
+
+static double dbNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int inTokenize(const char *pszResponse, int inLength, int *pinOffsets)
+{
+	int inFields = 0;
+	int i = 0;
+
+	pinOffsets[inFields++] = 0;
+	for(i = 0; i < inLength && inFields < REPLAY_MAX_FIELDS; i++)
+	{
+		if(pszResponse[i] == ';')
+			pinOffsets[inFields++] = i + 1;
+	}
+	return inFields;
+}
+
+static void vdDigestSettlement(const REPLAY *pReplay, int inFirstRow, SHA256_CTX *pCtx)
+{
+	const ECR_SETTLEMENT_COLUMNS *pColumns = &pReplay->settlement;
+	char szRow[128];
+	int i = 0;
+
+	for(i = inFirstRow; i < pColumns->inRows; i++)
+	{
+		int inLength = snprintf(szRow, sizeof(szRow), "%s,%s,%s,%u,%lld\n", pColumns->pszSchemes[pColumns->pusScheme[i]],
+				ecrSettlementSourceName(pColumns->pucSource[i]), ecrSettlementKindName(pColumns->pucKind[i]),
+				pColumns->pulCount[i], (long long)pColumns->pllAmount[i]);
+		sha256Update(pCtx, szRow, (size_t)inLength);
+	}
+}
+
+static void vdCompareDigest(REPLAY *pReplay, const char *pszLine)
+{
+	long long llFrame = pReplay->llFrames - 1;
+	const char *pszBaseline = llFrame < pReplay->llBaselineLines ? pReplay->ppszBaseline[llFrame] : "(missing)";
+
+	if(strcmp(pszLine, pszBaseline) == 0)
+		return;
+	if(pReplay->llDifferences < REPLAY_MAX_LISTED)
+		printf("frame %lld differs\n  baseline %s\n  this     %s\n", llFrame, pszBaseline, pszLine);
+	pReplay->llDifferences++;
+}
+
+static void vdRecordDigest(REPLAY *pReplay, const char *pszResponse, int inLength, int inFields, int inFirstRow)
+{
+	REPLAY_TYPE_STATS *pStats = &pReplay->aStats[pReplay->transactionType & (REPLAY_MAX_TYPES - 1)];
+	unsigned char aucDigest[SHA256_DIGEST_SIZE];
+	char szHex[SHA256_DIGEST_SIZE * 2 + 1];
+	char szLine[160];
+	SHA256_CTX ctx;
+
+	if(pStats->llFrames == 0 || inFields < pStats->inMinFields)
+		pStats->inMinFields = inFields;
+	if(inFields > pStats->inMaxFields)
+		pStats->inMaxFields = inFields;
+	pStats->llFrames++;
+	if(pReplay->transactionType < (int)(sizeof(ainFullLayout) / sizeof(ainFullLayout[0]))
+			&& ainFullLayout[pReplay->transactionType] > 0 && inFields >= ainFullLayout[pReplay->transactionType])
+		pStats->llFullLayout++;
+
+	sha256Init(&ctx);
+	sha256Update(&ctx, pszResponse, (size_t)inLength);
+	vdDigestSettlement(pReplay, inFirstRow, &ctx);
+	sha256Final(&ctx, aucDigest);
+	sha256ToHex(aucDigest, szHex);
+	szHex[SHA256_DIGEST_SIZE * 2] = '\0';
+
+	snprintf(szLine, sizeof(szLine), "%lld %d %d %s", pReplay->llFrames - 1, pReplay->transactionType, inFields, szHex);
+	if(pReplay->fpDigests != NULL)
+		fprintf(pReplay->fpDigests, "%s\n", szLine);
+	if(pReplay->ppszBaseline != NULL)
+		vdCompareDigest(pReplay, szLine);
+}
+
+// ECR_FRAME_HANDLER: the same steps -[SKBCoreServices receivedData:] takes
+static void vdDecodeFrame(void *pvContext, const unsigned char *pucFrame, int inLength)
+{
+	REPLAY *pReplay = (REPLAY *)pvContext;
+	char szFrame[REPLAY_RESPONSE_SIZE];
+	char szResponse[REPLAY_RESPONSE_SIZE];
+	int ainOffsets[REPLAY_MAX_FIELDS];
+	int inResponseLength = 0;
+	int inFields = 0;
+	int inFirstRow = pReplay->settlement.inRows;
+
+	memcpy(szFrame, pucFrame, (size_t)inLength);
+	szFrame[inLength] = '\0';
+	parse(szFrame, szResponse);
+	inResponseLength = (int)strlen(szFrame);
+	szResponse[inResponseLength] = '\0';
+
+	inFields = inTokenize(szResponse, inResponseLength, ainOffsets);
+	if(pReplay->transactionType == 10) // SETTLEMENT
+	{
+		int inRows = ecrSettlementDecode(&pReplay->settlement, pReplay->szTerminalId, szResponse);
+		if(inRows > 0)
+			pReplay->llSettlementRows += inRows;
+	}
+
+	pReplay->llFrames++;
+	pReplay->llBytes += inLength;
+	pReplay->llFields += inFields;
+	if(pReplay->inDigest)
+		vdRecordDigest(pReplay, szResponse, inResponseLength, inFields, inFirstRow);
+}
+
+static int inReplayCapture(REPLAY *pReplay, const unsigned char *pucData, long lSize)
+{
+	ECR_REASSEMBLER *pReassembler = (ECR_REASSEMBLER *)malloc(sizeof(ECR_REASSEMBLER));
+	ECR_CAPTURE_RECORD record;
+	long lOffset = ECR_CAPTURE_HEADER_SIZE;
+	int inResult = 0;
+
+	if(pReassembler == NULL)
+		return -1;
+	ecrReassemblerInit(pReassembler);
+	while((inResult = ecrCaptureNext(pucData, lSize, &lOffset, &record)) > 0)
+	{
+		if(record.inDirection == ECR_CAPTURE_OUTBOUND)
+		{
+			// A new request ends whatever reply was still open
+			ecrReassemblerFlush(pReassembler, vdDecodeFrame, pReplay);
+			continue;
+		}
+		pReplay->transactionType = record.transactionType;
+		memcpy(pReplay->szTerminalId, record.pszTerminalId, (size_t)record.inTerminalIdLength);
+		pReplay->szTerminalId[record.inTerminalIdLength] = '\0';
+		ecrReassemblerPush(pReassembler, record.pucFrame, record.inFrameLength, vdDecodeFrame, pReplay);
+	}
+	ecrReassemblerFlush(pReassembler, vdDecodeFrame, pReplay);
+	free(pReassembler);
+	return inResult;
+}
+
+static char **ppszLoadBaseline(const char *pszPath, long long *pllLines)
+{
+	FILE *fp = fopen(pszPath, "r");
+	char **ppszLines = NULL;
+	long long llCapacity = 0;
+	char szLine[256];
+
+	*pllLines = 0;
+	if(fp == NULL)
+		return NULL;
+	while(fgets(szLine, sizeof(szLine), fp) != NULL)
+	{
+		szLine[strcspn(szLine, "\r\n")] = '\0';
+		if(*pllLines == llCapacity)
+		{
+			char **ppszGrown = NULL;
+
+			llCapacity = llCapacity ? llCapacity * 2 : 1024;
+			ppszGrown = (char **)realloc(ppszLines, (size_t)llCapacity * sizeof(char *));
+			if(ppszGrown == NULL)
+				break;
+			ppszLines = ppszGrown;
+		}
+		ppszLines[(*pllLines)++] = strdup(szLine);
+	}
+	fclose(fp);
+	return ppszLines;
+}
+
+static void vdPrintStats(const REPLAY *pReplay)
+{
+	int i = 0;
+
+	printf("type  frames  full layout  fields min..max\n");
+	for(i = 0; i < REPLAY_MAX_TYPES; i++)
+	{
+		const REPLAY_TYPE_STATS *pStats = &pReplay->aStats[i];
+
+		if(pStats->llFrames == 0)
+			continue;
+		printf("%4d  %6lld  %11lld  %d..%d\n", i, pStats->llFrames, pStats->llFullLayout, pStats->inMinFields, pStats->inMaxFields);
+	}
+}
+
+static int inUsage(void)
+{
+	fprintf(stderr, "usage: ecr_replay [-n iterations] [-o digests.txt] [-b baseline.txt] capture.skbcap...\n");
+	return 2;
+}
+
+int main(int argc, char **argv)
+{
+	REPLAY *pReplay = (REPLAY *)calloc(1, sizeof(REPLAY));
+	const char *pszDigests = NULL;
+	const char *pszBaseline = NULL;
+	unsigned char **ppucCaptures = NULL;
+	long *plSizes = NULL;
+	int inCaptures = 0;
+	int inIterations = 10;
+	int inResult = 0;
+	int inArg = 1;
+	int i = 0, j = 0;
+	double dbStart = 0, dbElapsed = 0;
+	long long llFrames = 0, llBytes = 0;
+
+	for(inArg = 1; inArg < argc && argv[inArg][0] == '-'; inArg++)
+	{
+		if(inArg + 1 >= argc)
+			return inUsage();
+		if(!strcmp(argv[inArg], "-n"))
+			inIterations = atoi(argv[++inArg]);
+		else if(!strcmp(argv[inArg], "-o"))
+			pszDigests = argv[++inArg];
+		else if(!strcmp(argv[inArg], "-b"))
+			pszBaseline = argv[++inArg];
+		else
+			return inUsage();
+	}
+	if(inArg == argc || pReplay == NULL || inIterations < 1)
+		return inUsage();
+
+	inCaptures = argc - inArg;
+	ppucCaptures = (unsigned char **)calloc((size_t)inCaptures, sizeof(unsigned char *));
+	plSizes = (long *)calloc((size_t)inCaptures, sizeof(long));
+	for(i = 0; i < inCaptures; i++)
+	{
+		if(ecrCaptureLoad(argv[inArg + i], &ppucCaptures[i], &plSizes[i]) != 0)
+		{
+			fprintf(stderr, "%s: not a readable capture\n", argv[inArg + i]);
+			return 2;
+		}
+	}
+
+	// Digest pass, untimed
+	pReplay->inDigest = 1;
+	if(pszDigests != NULL && (pReplay->fpDigests = fopen(pszDigests, "w")) == NULL)
+	{
+		fprintf(stderr, "%s: cannot write\n", pszDigests);
+		return 2;
+	}
+	if(pszBaseline != NULL && (pReplay->ppszBaseline = ppszLoadBaseline(pszBaseline, &pReplay->llBaselineLines)) == NULL)
+	{
+		fprintf(stderr, "%s: cannot read\n", pszBaseline);
+		return 2;
+	}
+	ecrSettlementInit(&pReplay->settlement);
+	for(i = 0; i < inCaptures; i++)
+	{
+		if(inReplayCapture(pReplay, ppucCaptures[i], plSizes[i]) < 0)
+			fprintf(stderr, "%s: truncated, replayed up to the last whole record\n", argv[inArg + i]);
+	}
+	if(pReplay->ppszBaseline != NULL && pReplay->llBaselineLines != pReplay->llFrames)
+	{
+		printf("baseline has %lld frames, this build decoded %lld\n", pReplay->llBaselineLines, pReplay->llFrames);
+		pReplay->llDifferences++;
+	}
+	if(pReplay->fpDigests != NULL)
+		fclose(pReplay->fpDigests);
+	vdPrintStats(pReplay);
+	printf("settlement rows %lld\n", pReplay->llSettlementRows);
+	ecrSettlementFree(&pReplay->settlement);
+
+	// Timed passes
+	pReplay->inDigest = 0;
+	pReplay->llFrames = pReplay->llBytes = pReplay->llFields = pReplay->llSettlementRows = 0;
+	dbStart = dbNow();
+	for(j = 0; j < inIterations; j++)
+	{
+		ecrSettlementInit(&pReplay->settlement);
+		for(i = 0; i < inCaptures; i++)
+			inReplayCapture(pReplay, ppucCaptures[i], plSizes[i]);
+		ecrSettlementFree(&pReplay->settlement);
+	}
+	dbElapsed = dbNow() - dbStart;
+	llFrames = pReplay->llFrames;
+	llBytes = pReplay->llBytes;
+
+	printf("%d iterations, %lld frames, %lld bytes in %.3f s\n", inIterations, llFrames, llBytes, dbElapsed);
+	if(dbElapsed > 0)
+		printf("%.0f frames/s, %.2f MB/s\n", llFrames / dbElapsed, llBytes / dbElapsed / 1e6);
+
+	if(pReplay->ppszBaseline != NULL)
+		printf("%lld frame(s) decode differently from %s\n", pReplay->llDifferences, pszBaseline);
+	inResult = pReplay->llDifferences ? 1 : 0;
+
+	for(i = 0; i < inCaptures; i++)
+		free(ppucCaptures[i]);
+	for(llFrames = 0; llFrames < pReplay->llBaselineLines; llFrames++)
+		free(pReplay->ppszBaseline[llFrames]);
+	free(pReplay->ppszBaseline);
+	free(ppucCaptures);
+	free(plSizes);
+	free(pReplay);
+	return inResult;
+}
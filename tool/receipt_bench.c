@@ -0,0 +1,259 @@
+/*
+ * receipt_bench.c
+ *
+ *  Compares the HTML receipt with the text and ESC/POS receipts of
+ *  CoreECR/ECRTextReceipt.c for one purchase: output size and render time.
+ *
+ *  The HTML side runs the Purchase placeholder replacements one after the
+ *  other, one full copy per replacement, as -[SKBCoreServices getHtmlString:...]
+ *  did with stringByReplacingOccurrencesOfString before it rendered from the
+ *  bundle's segments. It stops at the filled document;
+ *  the WebView or PDF pass a printer needs afterwards is not included.
+ *
+ *  Build from the repository root on any host with a C11 compiler:
+ *    cc -O2 -std=c11 -I ios/Frameworks/SkyBandECRSDK/CoreECR -o receipt_bench tool/receipt_bench.c \
+ *       ios/Frameworks/SkyBandECRSDK/CoreECR/ECRTextReceipt.c
+ *
+ *  Usage:
+ *    receipt_bench [-n iterations] [-w width] [-p] "SKBTransactionRecipts/Purchase(customer_copy).html"
+ *  -p prints the text receipt.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ECRSrc.h"
+#include "ECRTextReceipt.h"
+
+typedef struct
+{
+	const char *pszPlaceholder;
+	int inField;
+	const char *pszValue;				// Used when inField is -1
+} HTML_REPLACEMENT;
+
+// Formatted purchase values, as the SDK helpers produce them
+static const char *apszSample[ECR_TEXT_FIELDS] =
+{
+	[ECR_TEXT_FIELD_MERCHANT_NAME] = "SKYBAND TEST MERCHANT",
+	[ECR_TEXT_FIELD_MERCHANT_ADDRESS] = "KING KHALID ROAD BURAIDAH",
+	[ECR_TEXT_FIELD_MERCHANT_NAME_AR] = "\xD9\x85\xD8\xB9\xD8\xB1\xD8\xB6 \xD8\xB3\xD9\x84\xD9\x8A\xD9\x85\xD8\xA7\xD9\x86",
+	[ECR_TEXT_FIELD_MERCHANT_ADDRESS_AR] = "\xD8\xB7\xD8\xB1\xD9\x8A\xD9\x82 \xD8\xA7\xD9\x84\xD9\x85\xD9\x84\xD9\x83 \xD8\xAE\xD8\xA7\xD9\x84\xD8\xAF",
+	[ECR_TEXT_FIELD_DATE] = "19/10/2026",
+	[ECR_TEXT_FIELD_TIME] = "10:42:07",
+	[ECR_TEXT_FIELD_MID] = "600000000012",
+	[ECR_TEXT_FIELD_TID] = "1234567890123456",
+	[ECR_TEXT_FIELD_BUSS_CODE] = "5411",
+	[ECR_TEXT_FIELD_STAN] = "000123",
+	[ECR_TEXT_FIELD_APP_VERSION] = "1.0.12",
+	[ECR_TEXT_FIELD_RRN] = "229112345678",
+	[ECR_TEXT_FIELD_SCHEME] = "mada",
+	[ECR_TEXT_FIELD_SCHEME_AR] = "\xD9\x85\xD8\xAF\xD9\x89",
+	[ECR_TEXT_FIELD_PAN] = "588845******1234",
+	[ECR_TEXT_FIELD_EXPIRY] = "12/28",
+	[ECR_TEXT_FIELD_AMOUNT] = "150.00",
+	[ECR_TEXT_FIELD_AMOUNT_AR] = "\xD9\xA1\xD9\xA5\xD9\xA0.\xD9\xA0\xD9\xA0",
+	[ECR_TEXT_FIELD_CURRENCY_AR] = "\xD8\xB1.\xD8\xB3",
+	[ECR_TEXT_FIELD_RESULT] = "APPROVED",
+	[ECR_TEXT_FIELD_RESULT_AR] = "\xD9\x85\xD9\x82\xD8\xA8\xD9\x88\xD9\x84\xD8\xA9",
+	[ECR_TEXT_FIELD_DISCLAIMER] = "CARDHOLDER VERIFIED BY PIN",
+	[ECR_TEXT_FIELD_DISCLAIMER_AR] = "\xD8\xAA\xD9\x85 \xD8\xA7\xD9\x84\xD8\xAA\xD8\xAD\xD9\x82\xD9\x82",
+	[ECR_TEXT_FIELD_AUTH_CODE] = "A1B2C3",
+	[ECR_TEXT_FIELD_AUTH_CODE_AR] = "A1B2C3",
+	[ECR_TEXT_FIELD_ENTRY_MODE] = "CONTACTLESS",
+	[ECR_TEXT_FIELD_RESPONSE_CODE] = "000",
+	[ECR_TEXT_FIELD_AID] = "A0000002281010",
+	[ECR_TEXT_FIELD_TVR] = "0000000000",
+	[ECR_TEXT_FIELD_CVR] = "1F0302",
+	[ECR_TEXT_FIELD_CID] = "40",
+	[ECR_TEXT_FIELD_CRYPTOGRAM] = "8A1F2E3D4C5B6A79",
+	[ECR_TEXT_FIELD_KERNEL_ID] = "02",
+	[ECR_TEXT_FIELD_PAR] = "",
+	[ECR_TEXT_FIELD_PAN_SUFFIX] = "1234",
+	[ECR_TEXT_FIELD_TSI] = "E800"
+};
+
+// Purchase replacements in getHtmlString order
+static const HTML_REPLACEMENT aReplacements[] =
+{
+	{ "currentTime", ECR_TEXT_FIELD_TIME, NULL }, { "currentDate", ECR_TEXT_FIELD_DATE, NULL },
+	{ "arabicSAR", ECR_TEXT_FIELD_CURRENCY_AR, NULL }, { "ResponseCode", ECR_TEXT_FIELD_RESPONSE_CODE, NULL },
+	{ "approved", ECR_TEXT_FIELD_RESULT, NULL },
+	{ "\xD9\x85\xD9\x82\xD8\xA8\xD9\x88\xD9\x84\xD8\xA9", ECR_TEXT_FIELD_RESULT_AR, NULL },
+	{ "panNumber", ECR_TEXT_FIELD_PAN, NULL }, { "CurrentAmount", ECR_TEXT_FIELD_AMOUNT, NULL },
+	{ "amountSAR", ECR_TEXT_FIELD_AMOUNT_AR, NULL }, { "Buzzcode", ECR_TEXT_FIELD_BUSS_CODE, NULL },
+	{ "StanNo", ECR_TEXT_FIELD_STAN, NULL }, { "ExpiryDate", ECR_TEXT_FIELD_EXPIRY, NULL },
+	{ "RRN", ECR_TEXT_FIELD_RRN, NULL }, { "approovalcodearabic", ECR_TEXT_FIELD_AUTH_CODE_AR, NULL },
+	{ "authCode", ECR_TEXT_FIELD_AUTH_CODE, NULL }, { "TID", ECR_TEXT_FIELD_TID, NULL },
+	{ "MID", ECR_TEXT_FIELD_MID, NULL }, { "AIDaid", ECR_TEXT_FIELD_AID, NULL },
+	{ "applicationCryptogram", ECR_TEXT_FIELD_CRYPTOGRAM, NULL }, { "CID", ECR_TEXT_FIELD_CID, NULL },
+	{ "CVR", ECR_TEXT_FIELD_CVR, NULL }, { "TVR", ECR_TEXT_FIELD_TVR, NULL }, { "TSI", ECR_TEXT_FIELD_TSI, NULL },
+	{ "KERNEL-ID", ECR_TEXT_FIELD_KERNEL_ID, NULL }, { "PAR", ECR_TEXT_FIELD_PAR, NULL },
+	{ "PANSUFFIX", ECR_TEXT_FIELD_PAN_SUFFIX, NULL }, { "CONTACTLESS", ECR_TEXT_FIELD_ENTRY_MODE, NULL },
+	{ "MerchantCategoryCode", -1, "5411" }, { "SchemeLabel", ECR_TEXT_FIELD_SCHEME, NULL },
+	{ "Scheme Text", ECR_TEXT_FIELD_SCHEME, NULL }, { "SchemeText_Arabic", ECR_TEXT_FIELD_SCHEME_AR, NULL },
+	{ "ApplicationVersion", ECR_TEXT_FIELD_APP_VERSION, NULL }, { "Disclaimer Text", ECR_TEXT_FIELD_DISCLAIMER, NULL },
+	{ "DisclaimerText_Arabic", ECR_TEXT_FIELD_DISCLAIMER_AR, NULL }, { "Merchant Name", ECR_TEXT_FIELD_MERCHANT_NAME, NULL },
+	{ "Merchant Address", ECR_TEXT_FIELD_MERCHANT_ADDRESS, NULL },
+	{ "MerchantName_Arebic", ECR_TEXT_FIELD_MERCHANT_NAME_AR, NULL },
+	{ "MerchantAddress_Arebic", ECR_TEXT_FIELD_MERCHANT_ADDRESS_AR, NULL }
+};
+
+static double dbNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char *pszReplaceAll(const char *pszText, const char *pszFind, const char *pszWith)
+{
+	size_t ulFind = strlen(pszFind), ulWith = strlen(pszWith), ulCount = 0;
+	const char *pszAt = pszText;
+	char *pszOut = NULL, *pszWrite = NULL;
+
+	while((pszAt = strstr(pszAt, pszFind)) != NULL)
+	{
+		ulCount++;
+		pszAt += ulFind;
+	}
+	pszOut = (char *)malloc(strlen(pszText) + ulCount * ulWith + 1);
+	if(pszOut == NULL)
+	{
+		fprintf(stderr, "receipt_bench: out of memory\n");
+		exit(1);
+	}
+
+	pszWrite = pszOut;
+	while((pszAt = strstr(pszText, pszFind)) != NULL)
+	{
+		memcpy(pszWrite, pszText, (size_t)(pszAt - pszText));
+		pszWrite += pszAt - pszText;
+		memcpy(pszWrite, pszWith, ulWith);
+		pszWrite += ulWith;
+		pszText = pszAt + ulFind;
+	}
+	strcpy(pszWrite, pszText);
+	return pszOut;
+}
+
+static size_t ulRenderHtml(const char *pszTemplate)
+{
+	char *pszHtml = strdup(pszTemplate);
+	size_t ulLength = 0;
+	size_t i = 0;
+
+	for(i = 0; i < sizeof(aReplacements) / sizeof(aReplacements[0]); i++)
+	{
+		const HTML_REPLACEMENT *pReplacement = &aReplacements[i];
+		char *pszNext = pszReplaceAll(pszHtml, pReplacement->pszPlaceholder,
+				pReplacement->inField >= 0 ? apszSample[pReplacement->inField] : pReplacement->pszValue);
+
+		free(pszHtml);
+		pszHtml = pszNext;
+	}
+	ulLength = strlen(pszHtml);
+	free(pszHtml);
+	return ulLength;
+}
+
+static char *pszLoad(const char *pszPath)
+{
+	FILE *fp = fopen(pszPath, "rb");
+	char *pszText = NULL;
+	long lLength = 0;
+
+	if(fp == NULL)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	lLength = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	pszText = (char *)malloc((size_t)lLength + 1);
+	if(pszText != NULL && fread(pszText, 1, (size_t)lLength, fp) == (size_t)lLength)
+		pszText[lLength] = '\0';
+	else
+	{
+		free(pszText);
+		pszText = NULL;
+	}
+	fclose(fp);
+	return pszText;
+}
+
+static void vdReport(const char *pszName, long long llBytes, double dbSeconds, long lIterations, double dbBaseline)
+{
+	double dbMicros = dbSeconds * 1e6 / (double)lIterations;
+
+	printf("%-8s %8lld bytes %10.2f us/receipt %12.0f receipts/s", pszName, llBytes, dbMicros, (double)lIterations / dbSeconds);
+	if(dbBaseline > 0)
+		printf("   %6.1fx faster", dbBaseline / dbMicros);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	static unsigned char aucReceipt[ECR_TEXT_RECEIPT_BUFFER_SIZE];
+	long lIterations = 20000, l = 0;
+	int inWidth = ECR_TEXT_RECEIPT_WIDTH, inPrint = 0;
+	int inArg = 1, inText = 0, inEscPos = 0;
+	long long llHtml = 0;
+	double dbStart = 0, dbHtml = 0, dbText = 0, dbEscPos = 0;
+	char *pszTemplate = NULL;
+
+	for(; inArg < argc && argv[inArg][0] == '-'; inArg++)
+	{
+		if(strcmp(argv[inArg], "-n") == 0 && inArg + 1 < argc)
+			lIterations = atol(argv[++inArg]);
+		else if(strcmp(argv[inArg], "-w") == 0 && inArg + 1 < argc)
+			inWidth = atoi(argv[++inArg]);
+		else if(strcmp(argv[inArg], "-p") == 0)
+			inPrint = 1;
+		else
+			break;
+	}
+	if(inArg != argc - 1 || lIterations < 1)
+	{
+		fprintf(stderr, "usage: receipt_bench [-n iterations] [-w width] [-p] purchase.html\n");
+		return 2;
+	}
+	pszTemplate = pszLoad(argv[inArg]);
+	if(pszTemplate == NULL)
+	{
+		fprintf(stderr, "receipt_bench: cannot read %s\n", argv[inArg]);
+		return 1;
+	}
+
+	dbStart = dbNow();
+	for(l = 0; l < lIterations; l++)
+		llHtml = (long long)ulRenderHtml(pszTemplate);
+	dbHtml = dbNow() - dbStart;
+
+	dbStart = dbNow();
+	for(l = 0; l < lIterations; l++)
+		inText = ecrTextReceiptCard(TYPE_PURCHASE, apszSample, ECR_RECEIPT_FORMAT_TEXT, inWidth, aucReceipt, sizeof(aucReceipt));
+	dbText = dbNow() - dbStart;
+	if(inPrint && inText > 0)
+		fwrite(aucReceipt, 1, (size_t)inText, stdout);
+
+	dbStart = dbNow();
+	for(l = 0; l < lIterations; l++)
+		inEscPos = ecrTextReceiptCard(TYPE_PURCHASE, apszSample, ECR_RECEIPT_FORMAT_ESCPOS, inWidth, aucReceipt, sizeof(aucReceipt));
+	dbEscPos = dbNow() - dbStart;
+
+	free(pszTemplate);
+	if(inText < 0 || inEscPos < 0)
+	{
+		fprintf(stderr, "receipt_bench: receipt did not fit %d bytes\n", ECR_TEXT_RECEIPT_BUFFER_SIZE);
+		return 1;
+	}
+
+	printf("purchase receipt, both copies, %d columns, %ld iterations\n", inWidth, lIterations);
+	vdReport("html", llHtml, dbHtml, lIterations, 0);
+	vdReport("text", inText, dbText, lIterations, dbHtml * 1e6 / (double)lIterations);
+	vdReport("escpos", inEscPos, dbEscPos, lIterations, dbHtml * 1e6 / (double)lIterations);
+	printf("html excludes the WebView or PDF pass needed before printing\n");
+	return 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * receipt_bundle.c
+ *
+ *  Build step: compiles the receipt HTML templates into the bundle read by
+ *  CoreECR/ECRReceiptBundle.c. Run by the "Compile Receipt Bundle" phase of the
+ *  SkyBandECRSDK target; by hand from the repository root:
+ *    cc -O2 -std=c11 -o receipt_bundle tool/receipt_bundle.c
+ *    ./receipt_bundle Receipts.skbrb ios/Frameworks/SkyBandECRSDK/SKBTransactionRecipts/?*.html
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../ios/Frameworks/SkyBandECRSDK/CoreECR/ECRReceiptBundle.h"
+
+#define BUNDLE_MAX_SEGMENT				0xFFFF
+
+/* The words -[SKBCoreServices getHtmlString:...] fills in the templates, report
+   table fragments included. A word missing here is never filled, so keep in step
+   when a receipt gains a field. */
+static const char *aszPlaceholders[] =
+{
+	"AIDaid", "AUTHAmount", "AUTHCount", "AppVersion", "ApplicationVersion", "Buzzcode", "CADVAmount", "CADVCount",
+	"CID", "CONTACTLESS", "CVR", "CashbackAmount", "CurrentAmount", "Disclaimer Text", "DisclaimerText_Arabic",
+	"ExpiryDate", "KERNEL-ID", "MID", "Merchant Address", "Merchant Name", "MerchantAddress_Arebic",
+	"MerchantName_Arebic", "NAQDAmount", "NAQDCount", "PANSUFFIX", "PAR", "PosTable", "RRN", "ResponseCode",
+	"RetailerId", "Scheme", "Scheme Text", "SchemeLabel", "SchemeText_Arabic", "StanNo", "TID", "TOTALSAmount",
+	"TOTALSCount", "TSI", "TVR", "TerminalId", "TotalAmount", "TransactionAmount", "amountSAR", "amountSARPUR",
+	"amountSARcashback", "amountSARtotal", "applicationCryptogram", "approovalcodearabic", "approved", "arabicSAR",
+	"authCode", "busscode", "currentDate", "currentTime", "merchantId", "no_Transaction", "panNumber", "responseCode",
+	"running balance", "schemename", "terminalId", "totalCBAmount", "totalCBCount", "totalDBAmount", "totalDBCount",
+	"traceNumber", "transactionAmount", "transactionDate", "transactionNumber", "transactionPANNumber",
+	"transactionRRN", "transactionState", "transactionTime", "transactionType",
+	"\xD9\x82\xD9\x8E\xD8\xAF\xD9\x90\xD9\x8A\xD8\xB1\xD9\x9E",	// Arabic scheme name
+	"\xD9\x85\xD8\xAF\xD9\x89",											// "mada"
+	"\xD9\x85\xD9\x82\xD8\xA8\xD9\x88\xD9\x84\xD8\xA9"				// "approved"
+};
+
+#define BUNDLE_PLACEHOLDERS				((int)(sizeof(aszPlaceholders) / sizeof(aszPlaceholders[0])))
+
+typedef struct
+{
+	char *pszName;
+	char *pszText;
+	long lLength;
+	unsigned int ulFirstSegment;
+	unsigned int ulSegments;
+} TEMPLATE;
+
+typedef struct
+{
+	unsigned int ulStart;
+	unsigned int ulLength;
+	unsigned int ulPlaceholder;
+} SEGMENT;
+
+static SEGMENT *pSegments = NULL;
+static unsigned int ulSegments = 0, ulSegmentCapacity = 0;
+
+static void vdPut32(FILE *fp, unsigned int ulValue)
+{
+	unsigned char auc[4] = { (unsigned char)ulValue, (unsigned char)(ulValue >> 8), (unsigned char)(ulValue >> 16), (unsigned char)(ulValue >> 24) };
+	fwrite(auc, 1, 4, fp);
+}
+
+static void vdPut16(FILE *fp, unsigned int ulValue)
+{
+	unsigned char auc[2] = { (unsigned char)ulValue, (unsigned char)(ulValue >> 8) };
+	fwrite(auc, 1, 2, fp);
+}
+
+static void vdAddSegment(unsigned int ulStart, unsigned int ulLength, unsigned int ulPlaceholder)
+{
+	// Literal runs that do not fit the 16 bit length are split
+	while(ulLength > 0)
+	{
+		unsigned int ulPart = ulLength > BUNDLE_MAX_SEGMENT ? BUNDLE_MAX_SEGMENT : ulLength;
+
+		if(ulSegments == ulSegmentCapacity)
+		{
+			ulSegmentCapacity = ulSegmentCapacity ? ulSegmentCapacity * 2 : 1024;
+			pSegments = (SEGMENT *)realloc(pSegments, ulSegmentCapacity * sizeof(SEGMENT));
+			if(pSegments == NULL)
+			{
+				fprintf(stderr, "receipt_bundle: out of memory\n");
+				exit(1);
+			}
+		}
+		pSegments[ulSegments].ulStart = ulStart;
+		pSegments[ulSegments].ulLength = ulPart;
+		pSegments[ulSegments].ulPlaceholder = ulPlaceholder;
+		ulSegments++;
+		ulStart += ulPart;
+		ulLength -= ulPart;
+	}
+}
+
+static int inLongestPlaceholder(const char *pszText, long lLeft, unsigned int *pulLength)
+{
+	int inBest = -1;
+	unsigned int ulBest = 0;
+	int i = 0;
+
+	for(i = 0; i < BUNDLE_PLACEHOLDERS; i++)
+	{
+		unsigned int ulLength = (unsigned int)strlen(aszPlaceholders[i]);
+
+		if(ulLength > ulBest && ulLength <= (unsigned long)lLeft && pszText[0] == aszPlaceholders[i][0]
+				&& memcmp(pszText, aszPlaceholders[i], ulLength) == 0)
+		{
+			inBest = i;
+			ulBest = ulLength;
+		}
+	}
+	*pulLength = ulBest;
+	return inBest;
+}
+
+static void vdSplit(TEMPLATE *pTemplate)
+{
+	long lLiteral = 0, lIndex = 0;
+
+	pTemplate->ulFirstSegment = ulSegments;
+	while(lIndex < pTemplate->lLength)
+	{
+		unsigned int ulLength = 0;
+		int inPlaceholder = inLongestPlaceholder(&pTemplate->pszText[lIndex], pTemplate->lLength - lIndex, &ulLength);
+
+		if(inPlaceholder < 0)
+		{
+			lIndex++;
+			continue;
+		}
+		vdAddSegment((unsigned int)lLiteral, (unsigned int)(lIndex - lLiteral), ECR_RECEIPT_LITERAL);
+		vdAddSegment((unsigned int)lIndex, ulLength, (unsigned int)inPlaceholder);
+		lIndex += ulLength;
+		lLiteral = lIndex;
+	}
+	vdAddSegment((unsigned int)lLiteral, (unsigned int)(lIndex - lLiteral), ECR_RECEIPT_LITERAL);
+	pTemplate->ulSegments = ulSegments - pTemplate->ulFirstSegment;
+}
+
+static int inLoad(TEMPLATE *pTemplate, const char *pszPath)
+{
+	const char *pszBase = strrchr(pszPath, '/');
+	size_t ulNameLength = 0;
+	FILE *fp = fopen(pszPath, "rb");
+
+	if(fp == NULL)
+		return -1;
+	fseek(fp, 0, SEEK_END);
+	pTemplate->lLength = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	pTemplate->pszText = (char *)malloc((size_t)pTemplate->lLength + 1);
+	if(pTemplate->pszText == NULL || fread(pTemplate->pszText, 1, (size_t)pTemplate->lLength, fp) != (size_t)pTemplate->lLength)
+	{
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	pTemplate->pszText[pTemplate->lLength] = '\0';
+
+	// The name is the file name without ".html", as passed to URLForResource before
+	pszBase = pszBase != NULL ? pszBase + 1 : pszPath;
+	ulNameLength = strlen(pszBase);
+	if(ulNameLength > 5 && strcmp(&pszBase[ulNameLength - 5], ".html") == 0)
+		ulNameLength -= 5;
+	pTemplate->pszName = (char *)malloc(ulNameLength + 1);
+	memcpy(pTemplate->pszName, pszBase, ulNameLength);
+	pTemplate->pszName[ulNameLength] = '\0';
+	return 0;
+}
+
+static int inCompareTemplates(const void *pvLeft, const void *pvRight)
+{
+	return strcmp(((const TEMPLATE *)pvLeft)->pszName, ((const TEMPLATE *)pvRight)->pszName);
+}
+
+int main(int argc, char **argv)
+{
+	TEMPLATE *pTemplates = NULL;
+	int inTemplates = argc - 2;
+	unsigned int ulIndex = ECR_RECEIPT_HEADER_SIZE, ulPlaceholderTable = 0, ulSegmentTable = 0, ulStrings = 0, ulOffset = 0;
+	FILE *fp = NULL;
+	int i = 0;
+
+	if(argc < 3)
+	{
+		fprintf(stderr, "usage: receipt_bundle output.skbrb template.html...\n");
+		return 2;
+	}
+
+	pTemplates = (TEMPLATE *)calloc((size_t)inTemplates, sizeof(TEMPLATE));
+	for(i = 0; i < inTemplates; i++)
+	{
+		if(pTemplates == NULL || inLoad(&pTemplates[i], argv[i + 2]) != 0)
+		{
+			fprintf(stderr, "receipt_bundle: cannot read %s\n", argv[i + 2]);
+			return 1;
+		}
+	}
+	qsort(pTemplates, (size_t)inTemplates, sizeof(TEMPLATE), inCompareTemplates);
+	for(i = 0; i < inTemplates; i++)
+	{
+		if(i > 0 && strcmp(pTemplates[i - 1].pszName, pTemplates[i].pszName) == 0)
+		{
+			fprintf(stderr, "receipt_bundle: %s given twice\n", pTemplates[i].pszName);
+			return 1;
+		}
+		vdSplit(&pTemplates[i]);
+	}
+
+	ulPlaceholderTable = ulIndex + (unsigned int)inTemplates * ECR_RECEIPT_INDEX_ENTRY_SIZE;
+	ulSegmentTable = ulPlaceholderTable + BUNDLE_PLACEHOLDERS * ECR_RECEIPT_PLACEHOLDER_SIZE;
+	ulStrings = ulSegmentTable + ulSegments * ECR_RECEIPT_SEGMENT_SIZE;
+
+	fp = fopen(argv[1], "wb");
+	if(fp == NULL)
+	{
+		fprintf(stderr, "receipt_bundle: cannot write %s\n", argv[1]);
+		return 1;
+	}
+
+	fwrite(ECR_RECEIPT_MAGIC, 1, 4, fp);
+	vdPut16(fp, ECR_RECEIPT_VERSION);
+	vdPut16(fp, 0);
+	vdPut32(fp, (unsigned int)inTemplates);
+	vdPut32(fp, BUNDLE_PLACEHOLDERS);
+	vdPut32(fp, ulSegments);
+	vdPut32(fp, ulIndex);
+	vdPut32(fp, ulPlaceholderTable);
+	vdPut32(fp, ulSegmentTable);
+
+	// Strings go in index order: names, then texts, then placeholders
+	ulOffset = ulStrings;
+	for(i = 0; i < inTemplates; i++)
+	{
+		unsigned int ulNameLength = (unsigned int)strlen(pTemplates[i].pszName);
+
+		vdPut32(fp, ulOffset);
+		vdPut32(fp, ulNameLength);
+		ulOffset += ulNameLength + 1;
+		vdPut32(fp, ulOffset);
+		vdPut32(fp, (unsigned int)pTemplates[i].lLength);
+		ulOffset += (unsigned int)pTemplates[i].lLength + 1;
+		vdPut32(fp, pTemplates[i].ulFirstSegment);
+		vdPut32(fp, pTemplates[i].ulSegments);
+	}
+	for(i = 0; i < BUNDLE_PLACEHOLDERS; i++)
+	{
+		unsigned int ulLength = (unsigned int)strlen(aszPlaceholders[i]);
+
+		vdPut32(fp, ulOffset);
+		vdPut32(fp, ulLength);
+		ulOffset += ulLength + 1;
+	}
+	for(i = 0; i < (int)ulSegments; i++)
+	{
+		vdPut32(fp, pSegments[i].ulStart);
+		vdPut16(fp, pSegments[i].ulLength);
+		vdPut16(fp, pSegments[i].ulPlaceholder);
+	}
+	for(i = 0; i < inTemplates; i++)
+	{
+		fwrite(pTemplates[i].pszName, 1, strlen(pTemplates[i].pszName) + 1, fp);
+		fwrite(pTemplates[i].pszText, 1, (size_t)pTemplates[i].lLength + 1, fp);
+	}
+	for(i = 0; i < BUNDLE_PLACEHOLDERS; i++)
+		fwrite(aszPlaceholders[i], 1, strlen(aszPlaceholders[i]) + 1, fp);
+
+	if(fclose(fp) != 0)
+	{
+		fprintf(stderr, "receipt_bundle: cannot write %s\n", argv[1]);
+		return 1;
+	}
+	printf("receipt_bundle: %d templates, %u segments, %u bytes\n", inTemplates, ulSegments, ulOffset);
+
+	for(i = 0; i < inTemplates; i++)
+	{
+		free(pTemplates[i].pszName);
+		free(pTemplates[i].pszText);
+	}
+	free(pTemplates);
+	free(pSegments);
+	return 0;
+}